@@ -7,7 +7,8 @@ const char *usage_const = "Usage: global [-adEFGilMnNqrstTvx][-S dir][-e] patter
        global -I[ailMnqtvx][-S dir][-e] pattern\n\
        global -P[aEGilMnoOqtvVx][-S dir][-e] pattern\n\
        global -p[qrv]\n\
-       global -u[qv]\n";
+       global -u[qv]\n\
+       global --server\n";
 const char *help_const = "Commands:\n\
 <no command> pattern\n\
        No command means tag search command.\n\
@@ -34,6 +35,21 @@ const char *help_const = "Commands:\n\
        If no pattern is given, print all paths in the project.\n\
 -p, --print-dbpath\n\
        Print location of GTAGS.\n\
+--server\n\
+       Answer queries of global in the project until terminated.\n\
+       The server keeps the configuration loaded and the tag files opened,\n\
+       and listens on the socket GTAGS.sock in the same directory\n\
+       as GTAGS.\n\
+       While it is running, global lets it answer the queries\n\
+       except for those reading the standard input.\n\
+       If the server would use other tag files or other configuration,\n\
+       or the socket belongs to another user,\n\
+       global does the work by itself.\n\
+       The environment variables listed in ENVIRONMENT, HOME,\n\
+       PWD and TMPDIR are passed to the server,\n\
+       and the others are taken from the server.\n\
+       Only the --gtagsconf and --gtagslabel options\n\
+       are allowed with this command.\n\
 -u, --update\n\
        Update tag files incrementally.\n\
        This command internally invokes gtags(1).\n\
@@ -157,6 +173,11 @@ Options:\n\
 -s, --symbol\n\
        Print other symbol tags.\n\
        Other symbol means the reference to a symbol which has no definition.\n\
+--statistics[=format]\n\
+       Print statistics information to the standard error output,\n\
+       like gtags(1) does.\n\
+       Format is one of table (default), list\n\
+       and json.\n\
 -S, --scope dir\n\
        Print only tags which exist under dir directory.\n\
        It is similar to the -l option, but you need not change directory.\n\
@@ -52,6 +52,7 @@
 #include "output.h"
 #include "literal.h"
 #include "convert.h"
+#include "server.h"
 
 /*
  * ensure GTAGSLIBPATH compares correctly
@@ -135,6 +136,7 @@ int type;				/**< path conversion type */
 int match_part;				/**< match part only	*/
 int abslib;				/**< absolute path only in library project */
 int use_color;				/**< coloring */
+int statistics = STATISTICS_STYLE_NONE;	/**< --statistics option */
 const char *cwd;			/**< current directory	*/
 const char *root;			/**< root of source tree	*/
 const char *dbpath;			/**< dbpath directory	*/
@@ -178,6 +180,7 @@ help(void)
 #define OPT_USE_COLOR		135
 #define OPT_GTAGSCONF		136
 #define OPT_GTAGSLABEL		137
+#define OPT_STATISTICS		138
 #define SORT_FILTER     1
 #define PATH_FILTER     2
 #define BOTH_FILTER     (SORT_FILTER|PATH_FILTER)
@@ -235,6 +238,7 @@ static struct option const long_options[] = {
 	{"result", required_argument, NULL, OPT_RESULT},
 	{"nosource", no_argument, &nosource, 1},
 	{"single-update", required_argument, NULL, OPT_SINGLE_UPDATE},
+	{"statistics", optional_argument, NULL, OPT_STATISTICS},
 	{ 0 }
 };
 
@@ -270,6 +274,7 @@ decide_tag_by_context(const char *tag, const char *file, int lineno)
 	char path[MAXPATHLEN], s_fid[MAXFIDLEN];
 	const char *tagline, *p;
 	DBOP *dbop;
+	BLOOM *bloom;
 	int db = GSYMS;
 	int iscompline = 0;
 
@@ -292,7 +297,17 @@ decide_tag_by_context(const char *tag, const char *file, int lineno)
 		die("cannot open GTAGS.");
 	if (dbop_getoption(dbop, COMPLINEKEY))
 		iscompline = 1;
-	tagline = dbop_first(dbop, tag, NULL, 0);
+	/*
+	 * The Bloom filter tells that the tag is not defined without
+	 * searching the B-tree.
+	 */
+	bloom = gtags_open_bloom(dbpath, dbop);
+	if (bloom && !bloom_test(bloom, tag))
+		tagline = NULL;
+	else
+		tagline = dbop_first(dbop, tag, NULL, 0);
+	if (bloom)
+		bloom_close(bloom);
 	if (tagline) {
 		db = GTAGS;
 		for (; tagline; tagline = dbop_next(dbop)) {
@@ -368,7 +383,13 @@ finish:
 			dbop = dbop_open(makepath(libdbpath, dbname(GTAGS), NULL), 0, 0, 0);
 			if (dbop == NULL)
 				continue;
-			tagline = dbop_first(dbop, tag, NULL, 0);
+			bloom = gtags_open_bloom(libdbpath, dbop);
+			if (bloom && !bloom_test(bloom, tag))
+				tagline = NULL;
+			else
+				tagline = dbop_first(dbop, tag, NULL, 0);
+			if (bloom)
+				bloom_close(bloom);
 			dbop_close(dbop);
 			if (tagline != NULL) {
 				db = GTAGS;
@@ -379,6 +400,37 @@ finish:
 	}
 	return db;
 }
+/**
+ * server_option: check the --server option
+ *
+ *	@return		1: --server is specified, 0: not specified
+ *
+ * The server accepts only the --gtagsconf and --gtagslabel options,
+ * which have been processed by preparse_options().
+ */
+static int
+server_option(int argc, char *const *argv)
+{
+	int i, server = 0;
+
+	for (i = 1; i < argc; i++)
+		if (!strcmp(argv[i], "--server"))
+			server = 1;
+	if (!server)
+		return 0;
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--server"))
+			continue;
+		if (!strcmp(argv[i], "--gtagsconf") || !strcmp(argv[i], "--gtagslabel")) {
+			i++;
+			continue;
+		}
+		if (!strncmp(argv[i], "--gtagsconf=", 12) || !strncmp(argv[i], "--gtagslabel=", 13))
+			continue;
+		die_with_code(2, "the --server option accepts only the --gtagsconf and --gtagslabel options.");
+	}
+	return 1;
+}
 int
 main(int argc, char **argv)
 {
@@ -387,6 +439,7 @@ main(int argc, char **argv)
 	int optchar;
 	int option_index = 0;
 	int status = 0;
+	int server;
 
 	/*
 	 * get path of following directories.
@@ -407,11 +460,33 @@ main(int argc, char **argv)
 	 * according to the --gtagsconf and --gtagslabel option.
 	 */
 	preparse_options(argc, argv);
+	server = server_option(argc, argv);
+	/*
+	 * Let the server of the dbpath answer, if it is running.
+	 */
+	if (!server && dbpath != NULL) {
+		int code = client_run(dbpath, argc, argv);
+
+		if (code >= 0)
+			exit(code);
+	}
 	/*
 	 * Open configuration file.
 	 */
 	openconf(root);
 	setenv_from_config();
+	/*
+	 * Wait for queries. It returns in a process forked for a query,
+	 * which is processed in the usual way.
+	 */
+	if (server) {
+		if (dbpath == NULL)
+			die_with_code(-status, "%s", gtags_dbpath_error);
+		server_run(dbpath, root, &argc, &argv);
+		cwd = get_cwd();
+		root = get_root();
+		dbpath = get_dbpath();
+	}
 	logging_arguments(argc, argv);
 	while ((optchar = getopt_long(argc, argv, "acde:EifFgGIlL:MnNoOpPqrsS:tTuvVx", long_options, &option_index)) != EOF) {
 		switch (optchar) {
@@ -612,6 +687,11 @@ main(int argc, char **argv)
 		case OPT_SINGLE_UPDATE:
 			single_update = optarg;
 			break;
+		case OPT_STATISTICS:
+			statistics = statistics_style(optarg);
+			if (statistics < 0)
+				die_with_code(2, "unknown format type for the --statistics option.");
+			break;
 		default:
 			usage();
 			break;
@@ -625,6 +705,11 @@ main(int argc, char **argv)
 		help();
 	if (dbpath == NULL)
 		die_with_code(-status, "%s", gtags_dbpath_error);
+	/*
+	 * Start statistics.
+	 */
+	if (statistics)
+		init_statistics();
 	
 	if (Nflag) {
 		if (nearbase) {
@@ -677,7 +762,7 @@ main(int argc, char **argv)
 		if (!(getenv("ANSICON") || LoadLibrary("ANSI32.dll")) && use_color == 2)
 			use_color = 0;
 #endif
-		if (use_color == 2 && !isatty(1))
+		if (use_color == 2 && !server_isatty(1))
 			use_color = 0;
 		if (Vflag)
 			use_color = 0;
@@ -859,6 +944,8 @@ main(int argc, char **argv)
 			completion_path(dbpath, av);
 		else
 			completion(dbpath, root, av, db);
+		if (statistics)
+			print_statistics(statistics);
 		exit(0);
 	}
 	/*
@@ -969,6 +1056,8 @@ main(int argc, char **argv)
 	else {
 		tagsearch(av, cwd, root, dbpath, db);
 	}
+	if (statistics)
+		print_statistics(statistics);
 	return 0;
 }
 /**
@@ -984,7 +1073,7 @@ int
 completion_tags(const char *dbpath, const char *root, const char *prefix, int db)
 {
 	int flags = GTOP_KEY | GTOP_NOREGEX | GTOP_PREFIX;
-	GTOP *gtop = gtags_open(dbpath, root, db, GTAGS_READ, 0);
+	GTOP *gtop = server_gtags_open(dbpath, root, db, 0);
 	GTP *gtp;
 	int count = 0;
 
@@ -1749,7 +1838,7 @@ search(const char *pattern, const char *root, const char *cwd, const char *dbpat
 	/*
 	 * open tag file.
 	 */
-	gtop = gtags_open(dbpath, root, db, GTAGS_READ, debug ? GTAGS_DEBUG : 0);
+	gtop = server_gtags_open(dbpath, root, db, debug ? GTAGS_DEBUG : 0);
 	cv = convert_open(type, format, root, cwd, dbpath, stdout, db);
 	/*
 	 * search through tag file.
@@ -0,0 +1,801 @@
+/*
+ * Copyright (c) 2015
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "global.h"
+#include "server.h"
+
+/*
+ * Query server (global --server).
+ *
+ * The server listens on the socket 'GTAGS.sock' in the dbpath, with the
+ * configuration loaded and the tag files opened. Global(1) invoked in the
+ * project sends its arguments to the server instead of doing the work by
+ * itself, if the server is running.
+ *
+ * Each query is answered by a process forked from the server, which
+ * continues the usual processing of global(1) with the arguments of the
+ * client. So the query shares the opened tag files and the parsed
+ * configuration with the server, and cannot leave any state behind.
+ *
+ *	client(global)		server(global --server)
+ *	---------------------------------------------------
+ *	request		=====>	session process
+ *					|
+ *					query process (stdout, stderr)
+ *	reply		<=====	session process
+ *
+ * Both the request and the reply are sequences of frames. A frame is
+ * a type character, the length of the data (4 bytes, big endian) and
+ * the data.
+ *
+ *	request:
+ *	'C'	current directory
+ *	'V'	environment variable (NAME=value), repeated (see passed_env())
+ *	'T'	"1" if the standard output is a terminal, "0" otherwise
+ *	'A'	argument, repeated in the order of argv[0], argv[1], ...
+ *	'Q'	end of the request (no data)
+ *
+ *	reply:
+ *	'O'	data written to the standard output
+ *	'E'	data written to the standard error output
+ *	'X'	exit code (decimal); end of the reply
+ *	'N'	the server cannot answer; the client should do it by itself
+ *
+ * Queries which read the standard input are not sent to the server.
+ *
+ * Both sides make sure that the other side is the same user. The client
+ * connects only to a socket owned by the user, and the server answers
+ * only the user.
+ */
+#if !defined(_WIN32) && !defined(__DJGPP__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+
+/** upper limit of the data of a frame */
+#define MAXFRAMELEN	(1024 * 1024)
+
+extern char **environ;
+
+static const char *server_dbpath;	/**< dbpath served */
+static const char *server_root;		/**< root of the source tree */
+static const char *server_conf[3];	/**< variables deciding the configuration */
+static const char *confname[] = { "GTAGSCONF", "GTAGSLABEL", "HOME" };
+/** variables passed to the server besides GTAGS* */
+static const char *envname[] = {
+	"HOME", "TMPDIR", "PWD", "MAKEOBJDIR", "MAKEOBJDIRPREFIX",
+	"GREP_COLOR", "GREP_COLORS"
+};
+static pid_t server_pid;		/**< pid of the server process */
+static char sockpath[MAXPATHLEN];	/**< socket to be removed at exit */
+static int client_tty = -1;		/**< -1: not a query process */
+static GTOP *warm[GTAGLIM];		/**< tag files opened by the server */
+static struct stat stamp[GTAGLIM];	/**< status of the tag files */
+static time_t warm_time;		/**< when the tag files were opened */
+
+/**
+ * put_frame: send a frame
+ *
+ *	@param[in]	op	output stream
+ *	@param[in]	type	frame type
+ *	@param[in]	data	data
+ *	@param[in]	size	size of the data
+ *	@return		0: normal, -1: error
+ */
+static int
+put_frame(FILE *op, int type, const char *data, size_t size)
+{
+	unsigned char head[5];
+
+	head[0] = type;
+	head[1] = (size >> 24) & 0xff;
+	head[2] = (size >> 16) & 0xff;
+	head[3] = (size >> 8) & 0xff;
+	head[4] = size & 0xff;
+	if (fwrite(head, sizeof(head), 1, op) != 1)
+		return -1;
+	if (size > 0 && fwrite(data, size, 1, op) != 1)
+		return -1;
+	return 0;
+}
+/**
+ * put_string: send a frame which has a string
+ */
+static int
+put_string(FILE *op, int type, const char *s)
+{
+	return put_frame(op, type, s, strlen(s));
+}
+/**
+ * get_frame: receive a frame
+ *
+ *	@param[in]	ip	input stream
+ *	@param[out]	sb	data of the frame
+ *	@return		frame type, EOF: end of stream or error
+ */
+static int
+get_frame(FILE *ip, STRBUF *sb)
+{
+	unsigned char head[5];
+	char buf[BUFSIZ];
+	size_t size, n;
+
+	if (fread(head, sizeof(head), 1, ip) != 1)
+		return EOF;
+	size = ((size_t)head[1] << 24) | (head[2] << 16) | (head[3] << 8) | head[4];
+	if (size > MAXFRAMELEN)
+		return EOF;
+	strbuf_reset(sb);
+	while (size > 0) {
+		n = fread(buf, 1, size < sizeof(buf) ? size : sizeof(buf), ip);
+		if (n == 0)
+			return EOF;
+		strbuf_nputs(sb, buf, n);
+		size -= n;
+	}
+	return head[0];
+}
+/**
+ * socket_address: make the address of the server of the dbpath
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[out]	addr	socket address
+ *	@return		0: normal, -1: the path name is too long
+ */
+static int
+socket_address(const char *dbpath, struct sockaddr_un *addr)
+{
+	const char *path = makepath(dbpath, dbname(GTAGS), "sock");
+
+	if (strlen(path) >= sizeof(addr->sun_path))
+		return -1;
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strlimcpy(addr->sun_path, path, sizeof(addr->sun_path));
+	return 0;
+}
+/**
+ * connect_server: connect to the server
+ *
+ *	@param[in]	addr	socket address
+ *	@return		socket, -1: no server
+ */
+static int
+connect_server(const struct sockaddr_un *addr)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd < 0)
+		return -1;
+	if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+/**
+ * same_user: whether the peer of the connection is the user
+ *
+ *	@param[in]	fd	connection
+ *	@return		1: the user, 0: another user or unknown
+ *
+ * Where the peer cannot be known, the permission of the socket is
+ * relied on.
+ */
+static int
+same_user(int fd)
+{
+#if defined(SO_PEERCRED) && defined(__linux__)
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+		return 0;
+	return cred.uid == getuid();
+#elif defined(HAVE_GETPEEREID)
+	uid_t uid;
+	gid_t gid;
+
+	if (getpeereid(fd, &uid, &gid) < 0)
+		return 0;
+	return uid == getuid();
+#else
+	return 1;
+#endif
+}
+/**
+ * passed_env: whether an environment variable is passed to the server
+ *
+ *	@param[in]	var	NAME=value
+ *	@return		1: passed, 0: not passed
+ *
+ * Only the variables which global(1) reads are passed. The query process
+ * takes the other variables from the server.
+ */
+static int
+passed_env(const char *var)
+{
+	size_t len = strcspn(var, "=");
+	int i;
+
+	if (!strncmp(var, "GTAGS", 5))
+		return 1;
+	for (i = 0; i < sizeof(envname) / sizeof(char *); i++)
+		if (strlen(envname[i]) == len && !strncmp(var, envname[i], len))
+			return 1;
+	return 0;
+}
+/**
+ * servable: whether the server can answer the query or not
+ *
+ * The query process of the server has no standard input.
+ */
+static int
+servable(int argc, char *const *argv)
+{
+	const char *p;
+	int i, len;
+
+	for (i = 1; i < argc; i++) {
+		p = argv[i];
+		len = strlen(p);
+		if (!strcmp(p, "-") || !strcmp(p, "--server"))
+			return 0;
+		if (!strncmp(p, "--path-convert", 14))
+			return 0;
+		/* --file-list=-, -L- */
+		if (len > 1 && p[len - 1] == '-' && (p[len - 2] == '=' || p[len - 2] == 'L'))
+			return 0;
+	}
+	return 1;
+}
+/**
+ * client_run: let the server answer the query
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	argc	argc of main()
+ *	@param[in]	argv	argv of main()
+ *	@return		exit code of the query,
+ *			-1: no server is available
+ */
+int
+client_run(const char *dbpath, int argc, char *const *argv)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	STRBUF *sb;
+	FILE *ip, *op;
+	char **e;
+	int i, fd, type, code = -1, output = 0;
+
+	if (!servable(argc, argv))
+		return -1;
+	if (socket_address(dbpath, &addr) < 0)
+		return -1;
+	/*
+	 * The query and the environment are sent only to a server of the
+	 * user. Any other server is ignored.
+	 */
+	if (lstat(addr.sun_path, &st) < 0 || !S_ISSOCK(st.st_mode) || st.st_uid != getuid())
+		return -1;
+	if ((fd = connect_server(&addr)) < 0)
+		return -1;
+	if (!same_user(fd)) {
+		close(fd);
+		return -1;
+	}
+	ip = fdopen(fd, "r");
+	op = fdopen(dup(fd), "w");
+	if (ip == NULL || op == NULL)
+		die("fdopen(3) failed.");
+	put_string(op, 'C', get_cwd());
+	for (e = environ; *e != NULL; e++)
+		if (passed_env(*e))
+			put_string(op, 'V', *e);
+	put_string(op, 'T', isatty(1) ? "1" : "0");
+	for (i = 0; i < argc; i++)
+		put_string(op, 'A', argv[i]);
+	put_frame(op, 'Q', NULL, 0);
+	if (fflush(op) != 0 || ferror(op)) {
+		fclose(op);
+		fclose(ip);
+		return -1;
+	}
+	fclose(op);
+	sb = strbuf_open(0);
+	while (code < 0 && (type = get_frame(ip, sb)) != EOF) {
+		switch (type) {
+		case 'O':
+			fwrite(strbuf_value(sb), 1, strbuf_getlen(sb), stdout);
+			output = 1;
+			break;
+		case 'E':
+			fflush(stdout);
+			fwrite(strbuf_value(sb), 1, strbuf_getlen(sb), stderr);
+			output = 1;
+			break;
+		case 'X':
+			code = atoi(strbuf_value(sb));
+			break;
+		case 'N':
+			strbuf_close(sb);
+			fclose(ip);
+			return -1;
+		default:
+			break;
+		}
+	}
+	strbuf_close(sb);
+	fclose(ip);
+	if (code < 0) {
+		/*
+		 * The server went away. Do it by ourselves unless a part
+		 * of the answer has been printed.
+		 */
+		if (!output)
+			return -1;
+		die("the connection to the server was lost.");
+	}
+	if (fflush(stdout) != 0)
+		code = 1;
+	return code;
+}
+/**
+ * get_stamp: get the status of a tag file
+ */
+static void
+get_stamp(int db, struct stat *st)
+{
+	memset(st, 0, sizeof(*st));
+	(void)stat(makepath(server_dbpath, dbname(db), NULL), st);
+}
+/**
+ * warm_open: open the tag files for the query processes
+ *
+ * Sqlite3 connections cannot be shared with forked processes, so
+ * the tag files are opened by each query in that case.
+ */
+static void
+warm_open(void)
+{
+	int db;
+
+	warm_time = time(NULL);
+	for (db = GPATH; db < GTAGLIM; db++)
+		get_stamp(db, &stamp[db]);
+#ifdef USE_SQLITE3
+	if (is_sqlite3(makepath(server_dbpath, dbname(GTAGS), NULL)))
+		return;
+#endif
+	for (db = GTAGS; db < GTAGLIM; db++) {
+		if (db != GTAGS && !test("f", makepath(server_dbpath, dbname(GRTAGS), NULL)))
+			continue;
+		warm[db] = gtags_open(server_dbpath, server_root, db, GTAGS_READ, 0);
+	}
+}
+/**
+ * warm_close: close the tag files opened by warm_open()
+ */
+static void
+warm_close(void)
+{
+	int db;
+
+	for (db = GTAGS; db < GTAGLIM; db++) {
+		if (warm[db]) {
+			gtags_close(warm[db]);
+			warm[db] = NULL;
+		}
+	}
+}
+/**
+ * warm_changed: whether the tag files were updated or replaced
+ *
+ * A file modified in the second in which it was opened is regarded
+ * as changed, since the modification time cannot tell the order.
+ */
+static int
+warm_changed(void)
+{
+	struct stat st;
+	int db;
+
+	for (db = GPATH; db < GTAGLIM; db++) {
+		get_stamp(db, &st);
+		if (st.st_dev != stamp[db].st_dev || st.st_ino != stamp[db].st_ino
+		    || st.st_size != stamp[db].st_size || st.st_mtime != stamp[db].st_mtime
+		    || st.st_mtime >= warm_time)
+			return 1;
+	}
+	return 0;
+}
+/**
+ * server_gtags_open: open a tag file for reading
+ *
+ * In a query process, the tag file opened by the server is used once.
+ * Otherwise it is the same as gtags_open(dbpath, root, db, GTAGS_READ, flags).
+ */
+GTOP *
+server_gtags_open(const char *dbpath, const char *root, int db, int flags)
+{
+	GTOP *gtop = NULL;
+
+	if (client_tty >= 0) {
+		if (flags == 0 && db >= GTAGS && db < GTAGLIM && warm[db]
+		    && !strcmp(dbpath, server_dbpath) && !strcmp(root, server_root)) {
+			gtop = warm[db];
+			warm[db] = NULL;
+		}
+		/*
+		 * The rest keep GPATH of the dbpath opened, which would be
+		 * used for the tag files in the library path by gpath_open().
+		 */
+		warm_close();
+		if (gtop)
+			return gtop;
+	}
+	return gtags_open(dbpath, root, db, GTAGS_READ, flags);
+}
+/**
+ * server_isatty: isatty(3) which answers about the client in a query process
+ */
+int
+server_isatty(int fd)
+{
+	if (client_tty >= 0 && fd == 1)
+		return client_tty;
+	return isatty(fd);
+}
+/**
+ * remove_socket: remove the socket at exit of the server
+ */
+static void
+remove_socket(void)
+{
+	if (getpid() == server_pid)
+		(void)unlink(sockpath);
+}
+static void
+onsignal(int signo)
+{
+	remove_socket();
+	_exit(1);
+}
+static void
+onchild(int signo)
+{
+	int save = errno;
+
+	while (waitpid(-1, NULL, WNOHANG) > 0)
+		;
+	errno = save;
+}
+/**
+ * default_signals: restore the signal handlers in a forked process
+ */
+static void
+default_signals(void)
+{
+	signal(SIGCHLD, SIG_DFL);
+	signal(SIGHUP, SIG_DFL);
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGPIPE, SIG_DFL);
+}
+static int
+same(const char *a, const char *b)
+{
+	if (a == NULL || b == NULL)
+		return a == b;
+	return !strcmp(a, b);
+}
+/**
+ * relay: send the output of the query process to the client
+ *
+ *	@param[in]	out	standard output of the query process
+ *	@param[in]	err	standard error output of the query process
+ *	@param[in]	op	client
+ */
+static void
+relay(int out, int err, FILE *op)
+{
+	struct pollfd pfd[2];
+	char buf[BUFSIZ];
+	ssize_t n;
+	int i, active = 2;
+
+	pfd[0].fd = out;
+	pfd[1].fd = err;
+	pfd[0].events = pfd[1].events = POLLIN;
+	while (active > 0) {
+		if (poll(pfd, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (i = 0; i < 2; i++) {
+			if (pfd[i].fd < 0 || pfd[i].revents == 0)
+				continue;
+			n = read(pfd[i].fd, buf, sizeof(buf));
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n > 0 && put_frame(op, i == 0 ? 'O' : 'E', buf, n) == 0 && fflush(op) == 0)
+				continue;
+			/* end of output or the client went away */
+			close(pfd[i].fd);
+			pfd[i].fd = -1;
+			active--;
+		}
+	}
+}
+/**
+ * session: receive a request and answer it
+ *
+ *	@param[in]	fd	connection
+ *	@param[out]	argcp	argc of the query
+ *	@param[out]	argvp	argv of the query
+ *
+ * It returns only in the query process.
+ */
+static void
+session(int fd, int *argcp, char ***argvp)
+{
+	STRBUF *sb = strbuf_open(0);
+	STRBUF *dir = strbuf_open(0);
+	STRBUF *args = strbuf_open(0);
+	STRBUF *envs = strbuf_open(0);
+	FILE *ip, *op;
+	char **argv, **envp, **e, *p;
+	char buf[32];
+	int i, type, nargs = 0, nenvs = 0, tty = 0;
+	int out[2], err[2], status, null;
+	pid_t pid;
+
+	ip = fdopen(fd, "r");
+	op = fdopen(dup(fd), "w");
+	if (ip == NULL || op == NULL)
+		_exit(1);
+	while ((type = get_frame(ip, sb)) != 'Q') {
+		switch (type) {
+		case 'C':
+			strbuf_reset(dir);
+			strbuf_puts(dir, strbuf_value(sb));
+			break;
+		case 'V':
+			if (passed_env(strbuf_value(sb))) {
+				strbuf_puts0(envs, strbuf_value(sb));
+				nenvs++;
+			}
+			break;
+		case 'T':
+			tty = atoi(strbuf_value(sb)) ? 1 : 0;
+			break;
+		case 'A':
+			strbuf_puts0(args, strbuf_value(sb));
+			nargs++;
+			break;
+		default:
+			_exit(1);
+		}
+	}
+	fclose(ip);
+	/*
+	 * Take over the variables of the client, and the others of the server.
+	 */
+	for (e = environ; *e != NULL; e++)
+		if (!passed_env(*e))
+			nenvs++;
+	envp = (char **)check_malloc(sizeof(char *) * (nenvs + 1));
+	for (i = 0, e = environ; *e != NULL; e++)
+		if (!passed_env(*e))
+			envp[i++] = *e;
+	for (p = strbuf_value(envs); i < nenvs; i++, p += strlen(p) + 1)
+		envp[i] = p;
+	envp[i] = NULL;
+	environ = envp;
+	/*
+	 * The client should do it by itself, if it would use another
+	 * configuration or other tag files.
+	 */
+	for (i = 0; i < sizeof(confname) / sizeof(char *); i++)
+		if (!same(getenv(confname[i]), server_conf[i]))
+			goto reject;
+	setenv_from_config();
+	if (chdir(strbuf_value(dir)) < 0)
+		goto reject;
+	if (nargs == 0)
+		goto reject;
+	if (setupdbpath(0) != 0 || strcmp(get_dbpath(), server_dbpath) || strcmp(get_root(), server_root))
+		goto reject;
+	/*
+	 * Start the query process.
+	 */
+	if (pipe(out) < 0 || pipe(err) < 0)
+		goto reject;
+	pid = fork();
+	if (pid == 0) {
+		fclose(op);
+		close(out[0]);
+		close(err[0]);
+		dup2(out[1], 1);
+		dup2(err[1], 2);
+		close(out[1]);
+		close(err[1]);
+		if ((null = open("/dev/null", O_RDONLY)) >= 0) {
+			dup2(null, 0);
+			close(null);
+		}
+		signal(SIGPIPE, SIG_DFL);
+		client_tty = tty;
+		argv = (char **)check_malloc(sizeof(char *) * (nargs + 1));
+		for (i = 0, p = strbuf_value(args); i < nargs; i++, p += strlen(p) + 1)
+			argv[i] = p;
+		argv[i] = NULL;
+		*argcp = nargs;
+		*argvp = argv;
+		strbuf_close(sb);
+		strbuf_close(dir);
+		return;
+	}
+	if (pid < 0)
+		goto reject;
+	close(out[1]);
+	close(err[1]);
+	relay(out[0], err[0], op);
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR)
+			_exit(1);
+	if (WIFEXITED(status))
+		snprintf(buf, sizeof(buf), "%d", WEXITSTATUS(status));
+	else
+		snprintf(buf, sizeof(buf), "%d", 128 + WTERMSIG(status));
+	put_string(op, 'X', buf);
+	fflush(op);
+	_exit(0);
+reject:
+	put_frame(op, 'N', NULL, 0);
+	fflush(op);
+	_exit(0);
+}
+/**
+ * server_run: answer queries on the socket in the dbpath
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	root	root of the source tree
+ *	@param[out]	argcp	argc of a query
+ *	@param[out]	argvp	argv of a query
+ *
+ * It returns only in a query process, which should continue the
+ * processing of global(1) with the arguments.
+ */
+void
+server_run(const char *dbpath, const char *root, int *argcp, char ***argvp)
+{
+	struct sockaddr_un addr;
+	mode_t mask;
+	pid_t pid;
+	int i, sock, fd, lock;
+
+	server_dbpath = check_strdup(dbpath);
+	server_root = check_strdup(root);
+	for (i = 0; i < sizeof(confname) / sizeof(char *); i++)
+		if (getenv(confname[i]))
+			server_conf[i] = check_strdup(getenv(confname[i]));
+	if (socket_address(dbpath, &addr) < 0)
+		die("path name of the socket is too long.");
+	if ((fd = connect_server(&addr)) >= 0)
+		die("server is already running for '%s'.", dbpath);
+	(void)unlink(addr.sun_path);
+	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		die("cannot make a socket.");
+	/* only the owner can use the server */
+	mask = umask(077);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		die("cannot bind the socket to '%s'.", addr.sun_path);
+	umask(mask);
+	server_pid = getpid();
+	strlimcpy(sockpath, addr.sun_path, sizeof(sockpath));
+	atexit(remove_socket);
+	if (listen(sock, SOMAXCONN) < 0)
+		die("cannot listen on '%s'.", addr.sun_path);
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	signal(SIGHUP, onsignal);
+	signal(SIGINT, onsignal);
+	signal(SIGTERM, onsignal);
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGCHLD, onchild);
+	warm_open();
+	for (;;) {
+		if ((fd = accept(sock, NULL, NULL)) < 0) {
+			if (errno == EINTR)
+				continue;
+			die("accept(2) failed.");
+		}
+		if (!same_user(fd)) {
+			close(fd);
+			continue;
+		}
+		/*
+		 * The tag files are reopened under the shared lock, not to
+		 * see tag files which 'gtags --snapshot' is replacing.
+		 */
+		lock = lockdirectory(dbpath, 0);
+		if (warm_changed()) {
+			warm_close();
+			warm_open();
+		}
+		unlockdirectory(lock);
+		pid = fork();
+		if (pid == 0) {
+			default_signals();
+			signal(SIGPIPE, SIG_IGN);
+			close(sock);
+			session(fd, argcp, argvp);
+			return;
+		}
+		if (pid < 0)
+			warning("fork(2) failed.");
+		close(fd);
+	}
+}
+#else /* _WIN32 || __DJGPP__ */
+int
+client_run(const char *dbpath, int argc, char *const *argv)
+{
+	return -1;
+}
+void
+server_run(const char *dbpath, const char *root, int *argcp, char ***argvp)
+{
+	die("server mode is not supported.");
+}
+GTOP *
+server_gtags_open(const char *dbpath, const char *root, int db, int flags)
+{
+	return gtags_open(dbpath, root, db, GTAGS_READ, flags);
+}
+int
+server_isatty(int fd)
+{
+	return isatty(fd);
+}
+#endif
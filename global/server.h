@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2015
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include "gtagsop.h"
+
+int client_run(const char *, int, char *const *);
+void server_run(const char *, const char *, int *, char ***);
+GTOP *server_gtags_open(const char *, const char *, int, int);
+int server_isatty(int);
+
+#endif /* ! _SERVER_H_ */
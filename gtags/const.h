@@ -36,13 +36,33 @@ const char *help_const = "Options:\n\
        In addition to tag files, make ID database for idutils(1).\n\
 -i, --incremental\n\
        Update tag files incrementally.\n\
+       Only source files whose contents were changed are parsed again.\n\
+       Changes are detected by the size, the modification time\n\
+       and a hash value of the contents recorded in GPATH.\n\
+       The records of the changed files are found through an index\n\
+       of the names of each file, which makes GTAGS and\n\
+       GRTAGS about 30% larger.\n\
+       The index is not used for tag files made by older versions.\n\
        It's better to use global(1) with the -u command.\n\
+--jobs number\n\
+       Parse source files by number processes in parallel,\n\
+       and read directories by number threads in parallel.\n\
+       The tag files are the same as those made without this option.\n\
+       Parsing in parallel is effective only when making tag files\n\
+       from scratch.\n\
 -O, --objdir\n\
        Use BSD-style objdir as the location of tag files.\n\
        If $MAKEOBJDIRPREFIX directory exists, gtags creates\n\
        $MAKEOBJDIRPREFIX/<current directory> directory and makes\n\
        tag files in it.\n\
        If dbpath is specified, this option is ignored.\n\
+--prefix-compression\n\
+       Store each key in the tag files as the part which differs from\n\
+       the previous key, which makes them smaller.\n\
+       It is effective for keys sharing long prefixes like path names.\n\
+       The tag files cannot be read by older versions of GLOBAL,\n\
+       and this option is ignored with the --sqlite3 option.\n\
+       Incremental updating keeps the format.\n\
 --single-update file\n\
        Update tag files for a single file.\n\
        It is considered that file was added, updated or deleted,\n\
@@ -50,16 +70,45 @@ const char *help_const = "Options:\n\
        This option implies the -i option.\n\
 --skip-unreadable\n\
        Skip unreadable files.\n\
---sqlite3\n\
+--snapshot\n\
+       In incremental updating, update copies of the tag files\n\
+       and replace the tag files with them at once.\n\
+       global(1) invoked meanwhile keeps using the old ones.\n\
+       It needs disk space for the copies.\n\
+       It cannot be used with tag files made with --sqlite3=wal,\n\
+       which already give the same effect.\n\
+--sqlite3[=wal]\n\
        Use Sqlite 3 API to make tag files. By default, BSD/DB 1.85 API is used.\n\
        To use this option, you need to invoke configure script with\n\
        --with-sqlite3 in the build phase.\n\
---statistics\n\
-       Print statistics information.\n\
+       With wal, the tag files use write-ahead logging:\n\
+       global(1) keeps reading the last updated tags while\n\
+       incremental updating is in progress, and the updated tags\n\
+       appear at once when it finishes.\n\
+       The mode is kept in the tag files, and the files with suffixes\n\
+       -wal and -shm may be made beside them.\n\
+       Remaking such tag files keeps the mode.\n\
+--statistics[=format]\n\
+       Print statistics information to the standard error output:\n\
+       the time of each phase and, for each tag file, the pages read\n\
+       and written, the hits and misses of the page cache, the pages\n\
+       got from a mapped tag file, the page splits and the overflow pages.\n\
+       Format is one of table (default), list\n\
+       and json.\n\
 -q, --quiet\n\
        Quiet mode.\n\
 -v, --verbose\n\
        Verbose mode.\n\
+--watch\n\
+       After making or updating tag files, keep running and update\n\
+       them whenever files in the project are changed.\n\
+       Changes are detected by inotify(7), collected for a short\n\
+       time and applied at once.\n\
+       Directories in the skip list are not watched.\n\
+       If a file list is given, new files are ignored.\n\
+       Send SIGINT or SIGTERM to stop.\n\
+       This option implies the -i option.\n\
+       This option is available only on systems which support inotify.\n\
 -w, --warning\n\
        Print warning messages.\n\
 dbpath\n\
@@ -70,9 +70,19 @@ int _CRT_glob = __CRT_GLOB_USE_MINGW__ | __CRT_GLOB_BRACKET_GROUPS__;
 static void usage(void);
 static void help(void);
 int main(int, char **);
+static int modified(const char *, const char *, const struct stat *, time_t);
+static void put_fingerprint(const char *);
+static void refresh_fingerprint(const char *, const FINGERPRINT *);
+static void put_refreshed(void);
+static const char *snapshot_begin(const char *, int);
+static void snapshot_commit(const char *, const char *, int);
+static int updatefiles(const char *, const char *, IDSET *, STRBUF *, STRBUF *, STRBUF *);
 int incremental(const char *, const char *);
 void updatetags(const char *, const char *, IDSET *, STRBUF *);
 void createtags(const char *, const char *);
+#ifdef HAVE_SYS_INOTIFY_H
+void watchtags(const char *, const char *);
+#endif
 int printconf(const char *);
 
 int cflag;					/**< compact format */
@@ -91,17 +101,22 @@ int debug;
 const char *config_name;
 const char *file_list;
 const char *dump_target;
+const char *bench_target;
 char *single_update;
 int statistics = STATISTICS_STYLE_NONE;
 int explain;
+int watch;					/**< watch mode */
+int snapshot;					/**< update tag files as a snapshot */
+int prefix_compression;				/**< prefix compressed tag files */
 #ifdef USE_SQLITE3
-int use_sqlite3;
+int use_sqlite3;				/**< 1: sqlite3, 2: sqlite3 in WAL mode */
 #endif
 
 #define GTAGSFILES "gtags.files"
 
 int extractmethod;
 int total;
+int jobs = 1;					/**< number of parser processes */
 
 static void
 usage(void)
@@ -148,24 +163,35 @@ static struct option const long_options[] = {
 #define OPT_SINGLE_UPDATE	132
 #define OPT_ACCEPT_DOTFILES	133
 #define OPT_SKIP_UNREADABLE	134
+#define OPT_JOBS		135
+#define OPT_BENCH_MATCH		136
+#define OPT_STATISTICS		137
+#define OPT_SQLITE3		138
 	/* flag value */
 	{"accept-dotfiles", no_argument, NULL, OPT_ACCEPT_DOTFILES},
+	{"bench-match", required_argument, NULL, OPT_BENCH_MATCH},	/* for developers */
 	{"debug", no_argument, &debug, 1},
 	{"explain", no_argument, &explain, 1},
-#ifdef USE_SQLITE3
-	{"sqlite3", no_argument, &use_sqlite3, 1},
-#endif
+	{"prefix-compression", no_argument, &prefix_compression, 1},
 	{"skip-unreadable", no_argument, NULL, OPT_SKIP_UNREADABLE},
-	{"statistics", no_argument, &statistics, STATISTICS_STYLE_TABLE},
+	{"snapshot", no_argument, &snapshot, 1},
 	{"version", no_argument, &show_version, 1},
+#ifdef HAVE_SYS_INOTIFY_H
+	{"watch", no_argument, &watch, 1},
+#endif
 	{"help", no_argument, &show_help, 1},
 
 	/* accept value */
 	{"config", optional_argument, NULL, OPT_CONFIG},
 	{"gtagsconf", required_argument, NULL, OPT_GTAGSCONF},
 	{"gtagslabel", required_argument, NULL, OPT_GTAGSLABEL},
+	{"jobs", required_argument, NULL, OPT_JOBS},
 	{"path", required_argument, NULL, OPT_PATH},
 	{"single-update", required_argument, NULL, OPT_SINGLE_UPDATE},
+	{"statistics", optional_argument, NULL, OPT_STATISTICS},
+#ifdef USE_SQLITE3
+	{"sqlite3", optional_argument, NULL, OPT_SQLITE3},
+#endif
 	{ 0 }
 };
 
@@ -256,12 +282,41 @@ main(int argc, char **argv)
 		case OPT_SKIP_UNREADABLE:
 			set_skip_unreadable();
 			break;
+		case OPT_JOBS:
+			{
+				char *end;
+
+				jobs = (int)strtol(optarg, &end, 10);
+				if (*optarg == '\0' || *end != '\0' || jobs < 1)
+					die("--jobs requires a positive number.");
+				set_find_threads(jobs);
+			}
+			break;
 		case 'c':
 			cflag++;
 			break;
 		case 'd':
 			dump_target = optarg;
 			break;
+		case OPT_BENCH_MATCH:
+			bench_target = optarg;
+			break;
+		case OPT_STATISTICS:
+			statistics = statistics_style(optarg);
+			if (statistics < 0)
+				die("unknown format type for the --statistics option.");
+			break;
+#ifdef USE_SQLITE3
+		case OPT_SQLITE3:
+			use_sqlite3 = 1;
+			if (optarg) {
+				if (!strcmp(optarg, "wal"))
+					use_sqlite3 = 2;
+				else
+					die("unknown journal mode for the --sqlite3 option.");
+			}
+			break;
+#endif
 		case 'f':
 			file_list = optarg;
 			break;
@@ -303,6 +358,12 @@ main(int argc, char **argv)
 		version(NULL, vflag);
 	if (show_help)
 		help();
+	if (watch) {
+		if (single_update)
+			die("--watch and --single-update cannot be used together.");
+		/* use existing tag files if any */
+		iflag++;
+	}
 
 	argc -= optind;
         argv += optind;
@@ -317,6 +378,13 @@ main(int argc, char **argv)
 		else
 			fprintf(stdout, "%s\n", getconfline());
 		exit(0);
+	} else if (bench_target) {
+		/*
+		 * Compare the path matchers with regular expressions.
+		 */
+		openconf(setupdbpath(0) == 0 ? get_root() : NULL);
+		find_bench_match(bench_target, 100);
+		exit(0);
 	} else if (dump_target) {
 		/*
 		 * Dump a tag file.
@@ -445,6 +513,19 @@ main(int argc, char **argv)
 			warning("GTAGS, GRTAGS or GPATH not found. -i option ignored.");
 		iflag = 0;
 	}
+#ifdef USE_SQLITE3
+	/*
+	 * Readers of tag files in WAL mode find the -wal and -shm files
+	 * by name, so the files cannot be replaced under them.
+	 */
+	if (iflag && snapshot) {
+		int db;
+
+		for (db = GPATH; db < GTAGLIM; db++)
+			if (is_sqlite3_wal(makepath(dbpath, dbname(db), NULL)))
+				die("the --snapshot option cannot be used with tag files in WAL mode.");
+	}
+#endif
 	if (!test("d", dbpath))
 		die("directory '%s' not found.", dbpath);
 	/*
@@ -485,7 +566,7 @@ main(int argc, char **argv)
 		 * Version check. If existing tag files are old enough
 		 * gtagsopen() abort with error message.
 		 */
-		GTOP *gtop = gtags_open(dbpath, cwd, GTAGS, GTAGS_MODIFY, 0);
+		GTOP *gtop = gtags_open(dbpath, cwd, GTAGS, GTAGS_READ, 0);
 		gtags_close(gtop);
 		/*
 		 * GPATH is needed for incremental updating.
@@ -495,6 +576,11 @@ main(int argc, char **argv)
 		if (!test("f", makepath(dbpath, dbname(GPATH), NULL)))
 			die("Old version tag file found. Please remake it.");
 		(void)incremental(dbpath, cwd);
+#ifdef HAVE_SYS_INOTIFY_H
+		if (watch)
+			watchtags(dbpath, cwd);
+#endif
+		parser_exit();
 		print_statistics(statistics);
 		exit(0);
 	}
@@ -556,6 +642,11 @@ main(int argc, char **argv)
 				die("cannot chmod ID file.");
 		statistics_time_end(tim);
 	}
+#ifdef HAVE_SYS_INOTIFY_H
+	if (watch)
+		watchtags(dbpath, cwd);
+#endif
+	parser_exit();
 	if (vflag)
 		fprintf(stderr, "[%s] Done.\n", now());
 	closeconf();
@@ -564,6 +655,325 @@ main(int argc, char **argv)
 
 	return 0;
 }
+/**
+ * modified: check whether the content of a source file was modified
+ *
+ *	@param[in]	path	path name
+ *	@param[in]	fid	file id
+ *	@param[in]	st	result of stat(2) for the path
+ *	@param[in]	gtags_mtime	modification time of GTAGS
+ *	@return		1: modified, 0: not modified
+ *
+ * If the size, the modification time and the inode number are the same
+ * as the recorded ones, the file is assumed to be unchanged. Otherwise
+ * the hash value of the content is compared. So, touching files (e.g.
+ * by switching branches) doesn't cause re-parsing.
+ */
+static int
+modified(const char *path, const char *fid, const struct stat *st, time_t gtags_mtime)
+{
+	FINGERPRINT old, cur;
+	char fidbuf[MAXFIDLEN];
+
+	/*
+	 * The fid may point to the buffer of GPATH, which the next reading
+	 * overwrites. (It does in sqlite3 tag files.)
+	 */
+	strlimcpy(fidbuf, fid, sizeof(fidbuf));
+	fid = fidbuf;
+	if (gpath_get_fingerprint(fid, &old) < 0) {
+		/*
+		 * GPATH made by older version has no fingerprint.
+		 * Compare with the modification time of GTAGS,
+		 * and record the fingerprint for the next time.
+		 */
+		if (gtags_mtime < st->st_mtime)
+			return 1;
+		if (fingerprint_make(&cur, path) == 0)
+			refresh_fingerprint(fid, &cur);
+		return 0;
+	}
+	fingerprint_stat(&cur, st);
+	if (fingerprint_samestat(&old, &cur))
+		return 0;
+	if (old.size != cur.size)
+		return 1;
+	if (fingerprint_hash(&cur, path) < 0 || old.hash != cur.hash)
+		return 1;
+	/* only the attributes were changed */
+	refresh_fingerprint(fid, &cur);
+	return 0;
+}
+/**
+ * put_fingerprint: record the fingerprint of a source file in GPATH
+ *
+ *	@param[in]	path	path name
+ *
+ * It should be called before parsing the file, not to miss modification
+ * during the parsing.
+ */
+static void
+put_fingerprint(const char *path)
+{
+	char fid[MAXFIDLEN];
+	FINGERPRINT fp;
+	const char *p;
+
+	if ((p = gpath_path2fid(path, NULL)) == NULL)
+		die("GPATH is corrupted.('%s' not found)", path);
+	strlimcpy(fid, p, sizeof(fid));
+	if (fingerprint_make(&fp, path) == 0)
+		gpath_put_fingerprint(fid, &fp);
+}
+/*
+ * Fingerprints of unchanged files refreshed in the snapshot mode.
+ * GPATH is opened for reading while inspecting files, so they are put
+ * into the copy of GPATH later by put_refreshed().
+ */
+struct refreshed {
+	char fid[MAXFIDLEN];
+	FINGERPRINT fp;
+};
+static VARRAY *refreshed;
+/**
+ * refresh_fingerprint: record the new fingerprint of an unchanged file
+ *
+ *	@param[in]	fid	file id
+ *	@param[in]	fp	fingerprint
+ */
+static void
+refresh_fingerprint(const char *fid, const FINGERPRINT *fp)
+{
+	struct refreshed *r;
+
+	if (!snapshot) {
+		gpath_put_fingerprint(fid, fp);
+		return;
+	}
+	if (refreshed == NULL)
+		refreshed = varray_open(sizeof(struct refreshed), 100);
+	r = varray_append(refreshed);
+	strlimcpy(r->fid, fid, sizeof(r->fid));
+	r->fp = *fp;
+}
+/**
+ * put_refreshed: put the fingerprints kept by refresh_fingerprint()
+ *
+ * GPATH should be opened with mode 2.
+ */
+static void
+put_refreshed(void)
+{
+	struct refreshed *r;
+	int i;
+
+	if (refreshed == NULL)
+		return;
+	for (i = 0; i < refreshed->length; i++) {
+		r = varray_assign(refreshed, i, 0);
+		gpath_put_fingerprint(r->fid, &r->fp);
+	}
+	varray_reset(refreshed);
+}
+/*
+ * Snapshot update
+ *
+ * With the --snapshot option, the tag files are not updated in place.
+ * They are copied into a shadow directory in the dbpath, the copies are
+ * updated, and then they are moved back by rename(2) at once. Global(1)
+ * running meanwhile keeps reading the old version, and the files opened
+ * by it stay valid after the switch. The switch is done under the
+ * exclusive lock of the dbpath, which the readers lock in shared mode
+ * while they open the tag files, so that no reader sees a mixture of
+ * old and new files.
+ */
+#define SNAPSHOTDIR	".gtags.snapshot"
+
+/** files replaced as a snapshot */
+static const char *
+snapshot_file(int i)
+{
+	static char bloom[MAXPATHLEN];
+
+	switch (i) {
+	case 0:	return dbname(GPATH);
+	case 1:	return dbname(GTAGS);
+	case 2:	return dbname(GRTAGS);
+	case 3:
+		snprintf(bloom, sizeof(bloom), "%s.bloom", dbname(GTAGS));
+		return bloom;
+	default: return NULL;
+	}
+}
+/**
+ * snapshot_begin: make a copy of the tag files in the shadow directory
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	all	1: all the tag files, 0: only GPATH
+ *	@return		shadow directory
+ */
+static const char *
+snapshot_begin(const char *dbpath, int all)
+{
+	STATIC_STRBUF(sb);
+	char src[MAXPATHLEN], dst[MAXPATHLEN];
+	const char *file;
+	int i;
+
+	strbuf_clear(sb);
+	strbuf_puts(sb, makepath(dbpath, SNAPSHOTDIR, NULL));
+	/* remove the remains of an interrupted update */
+	if (test("d", strbuf_value(sb))) {
+		for (i = 0; (file = snapshot_file(i)) != NULL; i++)
+			(void)unlink(makepath(strbuf_value(sb), file, NULL));
+		(void)rmdir(strbuf_value(sb));
+	}
+	if (mkdir(strbuf_value(sb), 0775) < 0)
+		die("cannot make directory '%s'.", strbuf_value(sb));
+	for (i = 0; (all || i == 0) && (file = snapshot_file(i)) != NULL; i++) {
+		strlimcpy(src, makepath(dbpath, file, NULL), sizeof(src));
+		if (!test("f", src))
+			continue;
+		strlimcpy(dst, makepath(strbuf_value(sb), file, NULL), sizeof(dst));
+		copyfile(src, dst);
+		(void)chmod(dst, 0644);
+	}
+	return strbuf_value(sb);
+}
+/**
+ * snapshot_commit: replace the tag files with the updated copies
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	shadow	shadow directory
+ *	@param[in]	all	same as snapshot_begin()
+ */
+static void
+snapshot_commit(const char *dbpath, const char *shadow, int all)
+{
+	char src[MAXPATHLEN], dst[MAXPATHLEN];
+	const char *file;
+	int i, lock;
+
+	/*
+	 * Write the copies to the disk first, so that a crash never leaves
+	 * renamed but empty tag files.
+	 */
+	for (i = 0; (file = snapshot_file(i)) != NULL; i++) {
+		strlimcpy(src, makepath(shadow, file, NULL), sizeof(src));
+		if (test("f", src) && syncfile(src) < 0)
+			die("cannot write '%s' to the disk.", src);
+	}
+	(void)syncfile(shadow);
+	lock = lockdirectory(dbpath, 1);
+	for (i = 0; (all || i == 0) && (file = snapshot_file(i)) != NULL; i++) {
+		strlimcpy(src, makepath(shadow, file, NULL), sizeof(src));
+		strlimcpy(dst, makepath(dbpath, file, NULL), sizeof(dst));
+		if (test("f", src)) {
+			if (rename(src, dst) < 0)
+				die("cannot rename '%s' to '%s'.", src, dst);
+		} else {
+			/* the filter was dropped in the update */
+			(void)unlink(dst);
+		}
+	}
+	unlockdirectory(lock);
+	(void)syncfile(dbpath);
+	(void)syncfile(shadow);
+	if (rmdir(shadow) < 0)
+		warning("cannot remove directory '%s'.", shadow);
+}
+/**
+ * updatefiles: apply the changes of files to the tag files
+ *
+ *	@param[in]	dbpath		dbpath directory
+ *	@param[in]	root		root directory of source tree
+ *	@param[in]	deleteset	bit array of fid of deleted or modified files
+ *	@param[in]	addlist		'\0' separated list of added or modified files
+ *	@param[in]	deletelist	'\0' separated list of deleted files
+ *	@param[in]	addlist_other	'\0' separated list of added other files
+ *	@return		0: not updated, 1: updated
+ *
+ * GPATH should be opened with mode 2 by the caller, or with mode 0
+ * in the snapshot mode.
+ */
+static int
+updatefiles(const char *dbpath, const char *root, IDSET *deleteset, STRBUF *addlist, STRBUF *deletelist, STRBUF *addlist_other)
+{
+	STATISTICS_TIME *tim;
+	const char *dir = dbpath;
+	int db;
+
+	if (idset_empty(deleteset) && strbuf_getlen(addlist) == 0 &&
+	    strbuf_getlen(deletelist) + strbuf_getlen(addlist_other) == 0) {
+		/*
+		 * Only the fingerprints of unchanged files may be refreshed.
+		 * Then only GPATH is replaced.
+		 */
+		if (snapshot && refreshed != NULL && refreshed->length > 0) {
+			gpath_close();
+			dir = snapshot_begin(dbpath, 0);
+			if (gpath_open(dir, 2) < 0)
+				die("GPATH not found.");
+			put_refreshed();
+			gpath_close();
+			snapshot_commit(dbpath, dir, 0);
+			/* the caller closes it */
+			if (gpath_open(dbpath, 0) < 0)
+				die("GPATH not found.");
+		}
+		return 0;
+	}
+	tim = statistics_time_start("Time of updating %s and %s.", dbname(GTAGS), dbname(GRTAGS));
+	if (snapshot) {
+		gpath_close();
+		if (vflag)
+			fprintf(stderr, "[%s] Making a snapshot of tag files.\n", now());
+		dir = snapshot_begin(dbpath, 1);
+		if (gpath_open(dir, 2) < 0)
+			die("GPATH not found.");
+		put_refreshed();
+	}
+	if (!idset_empty(deleteset) || strbuf_getlen(addlist) > 0)
+		updatetags(dir, root, deleteset, addlist);
+	if (strbuf_getlen(deletelist) + strbuf_getlen(addlist_other) > 0) {
+		const char *start, *end, *p;
+
+		if (vflag)
+			fprintf(stderr, "[%s] Updating '%s'.\n", now(), dbname(GPATH));
+		/* gpath_open(dbpath, 2); */
+		if (strbuf_getlen(deletelist) > 0) {
+			start = strbuf_value(deletelist);
+			end = start + strbuf_getlen(deletelist);
+
+			for (p = start; p < end; p += strlen(p) + 1)
+				gpath_delete(p);
+		}
+		if (strbuf_getlen(addlist_other) > 0) {
+			start = strbuf_value(addlist_other);
+			end = start + strbuf_getlen(addlist_other);
+
+			for (p = start; p < end; p += strlen(p) + 1) {
+				gpath_put(p, GPATH_OTHER);
+			}
+		}
+		/* gpath_close(); */
+	}
+	/*
+	 * Update modification time of tag files
+	 * because they may have no definitions.
+	 */
+	for (db = GTAGS; db < GTAGLIM; db++)
+		utime(makepath(dir, dbname(db), NULL), NULL);
+	if (snapshot) {
+		gpath_close();
+		snapshot_commit(dbpath, dir, 1);
+		/* the caller closes it */
+		if (gpath_open(dbpath, 0) < 0)
+			die("GPATH not found.");
+	}
+	statistics_time_end(tim);
+	return 1;
+}
 /**
  * incremental: incremental update
  *
@@ -598,7 +1008,7 @@ incremental(const char *dbpath, const char *root)
 		die("stat failed '%s'.", path);
 	gtags_mtime = statp.st_mtime;
 
-	if (gpath_open(dbpath, 2) < 0)
+	if (gpath_open(dbpath, snapshot ? 0 : 2) < 0)
 		die("GPATH not found.");
 	/*
 	 * deleteset:
@@ -678,7 +1088,7 @@ incremental(const char *dbpath, const char *root)
 				if (fid == NULL) {
 					strbuf_puts0(addlist, path);
 					total++;
-				} else if (gtags_mtime < statp.st_mtime) {
+				} else if (modified(path, fid, &statp, gtags_mtime)) {
 					strbuf_puts0(addlist, path);
 					total++;
 					idset_add(deleteset, n_fid);
@@ -720,45 +1130,7 @@ incremental(const char *dbpath, const char *root)
 	/*
 	 * execute updating.
 	 */
-	if ((!idset_empty(deleteset) || strbuf_getlen(addlist) > 0) ||
-	    (strbuf_getlen(deletelist) + strbuf_getlen(addlist_other) > 0))
-	{
-		int db;
-		updated = 1;
-		tim = statistics_time_start("Time of updating %s and %s.", dbname(GTAGS), dbname(GRTAGS));
-		if (!idset_empty(deleteset) || strbuf_getlen(addlist) > 0)
-			updatetags(dbpath, root, deleteset, addlist);
-		if (strbuf_getlen(deletelist) + strbuf_getlen(addlist_other) > 0) {
-			const char *start, *end, *p;
-
-			if (vflag)
-				fprintf(stderr, "[%s] Updating '%s'.\n", now(), dbname(GPATH));
-			/* gpath_open(dbpath, 2); */
-			if (strbuf_getlen(deletelist) > 0) {
-				start = strbuf_value(deletelist);
-				end = start + strbuf_getlen(deletelist);
-
-				for (p = start; p < end; p += strlen(p) + 1)
-					gpath_delete(p);
-			}
-			if (strbuf_getlen(addlist_other) > 0) {
-				start = strbuf_value(addlist_other);
-				end = start + strbuf_getlen(addlist_other);
-
-				for (p = start; p < end; p += strlen(p) + 1) {
-					gpath_put(p, GPATH_OTHER);
-				}
-			}
-			/* gpath_close(); */
-		}
-		/*
-		 * Update modification time of tag files
-		 * because they may have no definitions.
-		 */
-		for (db = GTAGS; db < GTAGLIM; db++)
-			utime(makepath(dbpath, dbname(db), NULL), NULL);
-		statistics_time_end(tim);
-	}
+	updated = updatefiles(dbpath, root, deleteset, addlist, deletelist, addlist_other);
 exit:
 	if (vflag) {
 		if (updated)
@@ -828,6 +1200,284 @@ put_syms(int type, const char *tag, int lno, const char *path, const char *line_
 	}
 	gtags_put_using(gtop, tag, lno, data->fid, line_image);
 }
+#if !defined(_WIN32) && !defined(__DJGPP__)
+/*
+ * Parallel tag extraction (--jobs=N).
+ *
+ * Each worker is a child process which parses the files sent by the parent
+ * and sends back the raw output of the parser. The parent assigns file ids
+ * and writes the tag files in the order of find_read(), so the result is
+ * the same as that of the serial processing.
+ *
+ *	Parent(gtags)				Child(worker)
+ *	---------------------------------------------------
+ *	(w->op) path name   =====>	parse_file()
+ *	(w->ip) tag records <=====	put_syms_worker()
+ *
+ * The reply for a file is a sequence of frames. A frame is the byte length
+ * of the records followed by the records, and an empty frame ends the
+ * reply. A frame is sent when it exceeds WORKER_FRAMESIZE, so neither
+ * side holds all the records of a large file at once.
+ *
+ * A record consists of four '\0' terminated strings: type, line number,
+ * tag name and line image. The line image is prefixed with '+', or is
+ * only '=' if it is the same as that of the previous record of the file.
+ * Long lines which have many tags are sent only once.
+ */
+#include <fcntl.h>
+#include <sys/wait.h>
+
+/** size of a frame of tag records */
+#define WORKER_FRAMESIZE	(64 * 1024)
+
+struct worker {
+	pid_t pid;
+	FILE *op;		/**< path name to the worker */
+	FILE *ip;		/**< tag records from the worker */
+	char *path;		/**< path name in progress or NULL */
+};
+static struct worker *workers;
+static char *replybuf;
+static size_t replysize;
+static STRBUF *lastimage;	/**< line image of the previous record */
+
+/** reply in progress in a worker */
+struct worker_reply {
+	FILE *op;		/**< reply stream */
+	STRBUF *sb;		/**< records of the frame */
+	STRBUF *image;		/**< line image of the previous record */
+	int lno;		/**< line number of the previous record */
+};
+/**
+ * worker_send: send a frame of tag records.
+ *
+ *	@param[in]	reply	reply
+ */
+static void
+worker_send(struct worker_reply *reply)
+{
+	size_t size = strbuf_getlen(reply->sb);
+
+	if (fwrite(&size, sizeof(size), 1, reply->op) != 1
+	    || (size > 0 && fwrite(strbuf_value(reply->sb), size, 1, reply->op) != 1))
+		die("cannot send tag records to gtags.");
+	strbuf_reset(reply->sb);
+}
+/**
+ * put_syms_worker: callback function for parse_file() in a worker.
+ */
+static void
+put_syms_worker(int type, const char *tag, int lno, const char *path, const char *line_image, void *arg)
+{
+	struct worker_reply *reply = (struct worker_reply *)arg;
+	STRBUF *sb = reply->sb;
+
+	strbuf_putn(sb, type);
+	strbuf_putc(sb, '\0');
+	strbuf_putn(sb, lno);
+	strbuf_putc(sb, '\0');
+	strbuf_puts0(sb, tag);
+	if (lno == reply->lno && !strcmp(line_image, strbuf_value(reply->image))) {
+		strbuf_puts0(sb, "=");
+	} else {
+		strbuf_putc(sb, '+');
+		strbuf_puts0(sb, line_image);
+		strbuf_reset(reply->image);
+		strbuf_puts(reply->image, line_image);
+		reply->lno = lno;
+	}
+	if (strbuf_getlen(sb) >= WORKER_FRAMESIZE)
+		worker_send(reply);
+}
+/**
+ * worker_main: main loop of a worker. It never returns.
+ *
+ *	@param[in]	ip	request stream
+ *	@param[in]	op	reply stream
+ *	@param[in]	flags	flags for parse_file()
+ */
+static void
+worker_main(FILE *ip, FILE *op, int flags)
+{
+	STRBUF *path = strbuf_open(0);
+	struct worker_reply reply;
+
+	reply.op = op;
+	reply.sb = strbuf_open(0);
+	reply.image = strbuf_open(0);
+	while (strbuf_fgets(path, ip, STRBUF_NOCRLF) != NULL) {
+		reply.lno = 0;
+		strbuf_reset(reply.image);
+		parse_file(strbuf_value(path), flags, put_syms_worker, &reply);
+		if (strbuf_getlen(reply.sb) > 0)
+			worker_send(&reply);
+		/* end of the reply */
+		worker_send(&reply);
+		if (fflush(op) != 0)
+			die("cannot send tag records to gtags.");
+	}
+	parser_exit();
+	_exit(0);
+}
+/**
+ * workers_open: start parser processes.
+ *
+ *	@param[in]	flags	flags for parse_file()
+ *
+ * Workers should be started before any tag file is opened,
+ * not to inherit the descriptors of them.
+ */
+static void
+workers_open(int flags)
+{
+	int opipe[2], ipipe[2];
+	int i, j;
+
+	workers = (struct worker *)check_calloc(sizeof(struct worker), jobs);
+	for (i = 0; i < jobs; i++) {
+		struct worker *w = &workers[i];
+
+		if (pipe(opipe) < 0 || pipe(ipipe) < 0)
+			die("pipe(2) failed.");
+		w->pid = fork();
+		if (w->pid == 0) {
+			/* child process */
+			close(opipe[1]);
+			close(ipipe[0]);
+			for (j = 0; j < i; j++) {
+				fclose(workers[j].op);
+				fclose(workers[j].ip);
+			}
+			worker_main(fdopen(opipe[0], "r"), fdopen(ipipe[1], "w"), flags);
+		} else if (w->pid < 0)
+			die("fork(2) failed.");
+		/* parent process */
+		close(opipe[0]);
+		close(ipipe[1]);
+		fcntl(opipe[1], F_SETFD, FD_CLOEXEC);
+		fcntl(ipipe[0], F_SETFD, FD_CLOEXEC);
+		w->op = fdopen(opipe[1], "w");
+		w->ip = fdopen(ipipe[0], "r");
+		if (w->op == NULL || w->ip == NULL)
+			die("fdopen(3) failed.");
+	}
+}
+/**
+ * worker_collect: receive tag records from a worker and put them.
+ *
+ *	@param[in]	w	worker
+ *	@param[in]	data	tag files
+ */
+static void
+worker_collect(struct worker *w, struct put_func_data *data)
+{
+	char fid[MAXFIDLEN];
+	const char *p, *end, *tag;
+	int type, lno;
+	size_t size;
+
+	p = gpath_path2fid(w->path, NULL);
+	if (p == NULL)
+		die("GPATH is corrupted.('%s' not found)", w->path);
+	strlimcpy(fid, p, sizeof(fid));
+	data->fid = fid;
+	if (lastimage == NULL)
+		lastimage = strbuf_open(0);
+	strbuf_reset(lastimage);
+	for (;;) {
+		if (fread(&size, sizeof(size), 1, w->ip) != 1)
+			die("parser process terminated abnormally.");
+		if (size == 0)
+			break;
+		if (size > replysize) {
+			replysize = size;
+			replybuf = check_realloc(replybuf, replysize);
+		}
+		if (fread(replybuf, size, 1, w->ip) != 1)
+			die("parser process terminated abnormally.");
+		for (p = replybuf, end = replybuf + size; p < end; ) {
+			type = atoi(p);
+			p += strlen(p) + 1;
+			lno = atoi(p);
+			p += strlen(p) + 1;
+			tag = p;
+			p += strlen(p) + 1;
+			if (*p == '+') {
+				strbuf_reset(lastimage);
+				strbuf_puts(lastimage, p + 1);
+			}
+			p += strlen(p) + 1;
+			put_syms(type, tag, lno, w->path, strbuf_value(lastimage), data);
+		}
+	}
+	gtags_flush(data->gtop[GTAGS], data->fid);
+	gtags_flush(data->gtop[GRTAGS], data->fid);
+	free(w->path);
+	w->path = NULL;
+}
+/**
+ * worker_dispatch: send a file to a worker.
+ *
+ *	@param[in]	seqno	sequence number of the file
+ *	@param[in]	path	path name
+ *	@param[in]	data	tag files
+ *
+ * Files are assigned to the workers in rotation. Since a worker has
+ * at most one file, the file in progress of the worker is always the
+ * oldest one. It is collected first to keep the order of output.
+ */
+static void
+worker_dispatch(int seqno, const char *path, struct put_func_data *data)
+{
+	struct worker *w = &workers[seqno % jobs];
+
+	if (w->path)
+		worker_collect(w, data);
+	w->path = check_strdup(path);
+	fputs(path, w->op);
+	fputc('\n', w->op);
+	if (fflush(w->op) != 0)
+		die("cannot send path name to parser process.");
+}
+/**
+ * workers_close: collect the rest of files and stop parser processes.
+ *
+ *	@param[in]	seqno	number of files dispatched
+ *	@param[in]	data	tag files
+ */
+static void
+workers_close(int seqno, struct put_func_data *data)
+{
+	int i, status;
+
+	for (i = 0; i < jobs; i++) {
+		struct worker *w = &workers[(seqno + i) % jobs];
+
+		if (w->path)
+			worker_collect(w, data);
+	}
+	for (i = 0; i < jobs; i++) {
+		struct worker *w = &workers[i];
+
+		fclose(w->op);
+		fclose(w->ip);
+		while (waitpid(w->pid, &status, 0) < 0)
+			if (errno != EINTR)
+				die("waitpid(2) failed.");
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			die("parser process terminated abnormally.");
+	}
+	free(workers);
+	workers = NULL;
+	free(replybuf);
+	replybuf = NULL;
+	replysize = 0;
+	if (lastimage) {
+		strbuf_close(lastimage);
+		lastimage = NULL;
+	}
+}
+#endif
 /**
  * updatetags: update tag file.
  *
@@ -906,6 +1556,7 @@ updatetags(const char *dbpath, const char *root, IDSET *deleteset, STRBUF *addli
 	seqno = 0;
 	for (path = start; path < end; path += strlen(path) + 1) {
 		gpath_put(path, GPATH_SOURCE);
+		put_fingerprint(path);
 		data.fid = gpath_path2fid(path, NULL);
 		if (data.fid == NULL)
 			die("GPATH is corrupted.('%s' not found)", path);
@@ -916,7 +1567,6 @@ updatetags(const char *dbpath, const char *root, IDSET *deleteset, STRBUF *addli
 		if (data.gtop[GRTAGS] != NULL)
 			gtags_flush(data.gtop[GRTAGS], data.fid);
 	}
-	parser_exit();
 	gtags_close(data.gtop[GTAGS]);
 	if (data.gtop[GRTAGS] != NULL)
 		gtags_close(data.gtop[GRTAGS]);
@@ -939,17 +1589,6 @@ createtags(const char *dbpath, const char *root)
 	tim = statistics_time_start("Time of creating %s and %s.", dbname(GTAGS), dbname(GRTAGS));
 	if (vflag)
 		fprintf(stderr, "[%s] Creating '%s' and '%s'.\n", now(), dbname(GTAGS), dbname(GRTAGS));
-	openflags = cflag ? GTAGS_COMPACT : 0;
-#ifdef USE_SQLITE3
-	if (use_sqlite3)
-		openflags |= GTAGS_SQLITE3;
-#endif
-	data.gtop[GTAGS] = gtags_open(dbpath, root, GTAGS, GTAGS_CREATE, openflags);
-	data.gtop[GTAGS]->flags = 0;
-	if (extractmethod)
-		data.gtop[GTAGS]->flags |= GTAGS_EXTRACTMETHOD;
-	data.gtop[GRTAGS] = gtags_open(dbpath, root, GRTAGS, GTAGS_CREATE, openflags);
-	data.gtop[GRTAGS]->flags = data.gtop[GTAGS]->flags;
 	flags = 0;
 	if (vflag)
 		flags |= PARSER_VERBOSE;
@@ -961,6 +1600,25 @@ createtags(const char *dbpath, const char *root)
 		flags |= PARSER_EXPLAIN;
 	if (getenv("GTAGSFORCEENDBLOCK"))
 		flags |= PARSER_END_BLOCK;
+#if !defined(_WIN32) && !defined(__DJGPP__)
+	if (jobs > 1)
+		workers_open(flags);
+#endif
+	openflags = cflag ? GTAGS_COMPACT : 0;
+	if (prefix_compression)
+		openflags |= GTAGS_PFXLEAF;
+#ifdef USE_SQLITE3
+	if (use_sqlite3)
+		openflags |= GTAGS_SQLITE3;
+	if (use_sqlite3 == 2)
+		openflags |= GTAGS_WAL;
+#endif
+	data.gtop[GTAGS] = gtags_open(dbpath, root, GTAGS, GTAGS_CREATE, openflags);
+	data.gtop[GTAGS]->flags = 0;
+	if (extractmethod)
+		data.gtop[GTAGS]->flags |= GTAGS_EXTRACTMETHOD;
+	data.gtop[GRTAGS] = gtags_open(dbpath, root, GRTAGS, GTAGS_CREATE, openflags);
+	data.gtop[GRTAGS]->flags = data.gtop[GTAGS]->flags;
 	/*
 	 * Add tags to GTAGS and GRTAGS.
 	 */
@@ -977,6 +1635,15 @@ createtags(const char *dbpath, const char *root)
 			continue;
 		}
 		gpath_put(path, GPATH_SOURCE);
+		put_fingerprint(path);
+#if !defined(_WIN32) && !defined(__DJGPP__)
+		if (workers) {
+			if (vflag)
+				fprintf(stderr, " [%d] extracting tags of %s\n", seqno + 1, path + 2);
+			worker_dispatch(seqno++, path, &data);
+			continue;
+		}
+#endif
 		data.fid = gpath_path2fid(path, NULL);
 		if (data.fid == NULL)
 			die("GPATH is corrupted.('%s' not found)", path);
@@ -987,8 +1654,11 @@ createtags(const char *dbpath, const char *root)
 		gtags_flush(data.gtop[GTAGS], data.fid);
 		gtags_flush(data.gtop[GRTAGS], data.fid);
 	}
+#if !defined(_WIN32) && !defined(__DJGPP__)
+	if (workers)
+		workers_close(seqno, &data);
+#endif
 	total = seqno;
-	parser_exit();
 	find_close();
 	statistics_time_end(tim);
 	tim = statistics_time_start("Time of flushing B-tree cache");
@@ -1011,6 +1681,365 @@ createtags(const char *dbpath, const char *root)
 	}
 	strbuf_close(sb);
 }
+#ifdef HAVE_SYS_INOTIFY_H
+/*
+ * Watch mode (--watch)
+ *
+ * Gtags watches the directories of the project using inotify(7) and
+ * applies the changes of files to the tag files. Events are collected
+ * until no event arrives for WATCH_DELAY milliseconds (but at most for
+ * WATCH_MAXWAIT seconds), and then applied at once in the same way as
+ * incremental updating. Directories and files in the skip list are not
+ * watched.
+ *
+ * When a directory is renamed, or the event queue of the kernel overflows,
+ * the watches are rebuilt and the whole project is inspected by
+ * incremental().
+ */
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+#define WATCH_DELAY	300		/**< debounce interval (msec) */
+#define WATCH_MAXWAIT	5		/**< maximum delay of updating (sec) */
+#define WATCH_MASK	(IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+
+static int watch_fd = -1;		/**< inotify descriptor */
+static VARRAY *watch_dirs;		/**< watch descriptor => directory */
+static STRHASH *watch_pending;		/**< changed files */
+static STRBUF *watch_removed;		/**< removed directories */
+static int watch_rescan;		/**< 1: inspect the whole project */
+static volatile sig_atomic_t watch_stop;
+
+static void
+watch_onsignal(int signo)
+{
+	watch_stop = 1;
+}
+/**
+ * watch_add: watch a directory and the subdirectories.
+ *
+ *	@param[in]	dir	directory (must start with "./" and end with "/")
+ *	@param[in]	enqueue	1: treat the files in the directories as changed
+ */
+static void
+watch_add(const char *dir, int enqueue)
+{
+	STRBUF *sb;
+	DIR *dirp;
+	struct dirent *dp;
+	const char *p, *end;
+	char **slot;
+	int wd;
+
+	if ((wd = inotify_add_watch(watch_fd, dir, WATCH_MASK)) < 0) {
+		if (errno == ENOSPC)
+			die("too many directories to watch. Please increase fs.inotify.max_user_watches.");
+		warning("cannot watch directory '%s'. ignored.", trimpath(dir));
+		return;
+	}
+	while (watch_dirs->length <= wd)
+		*(char **)varray_append(watch_dirs) = NULL;
+	slot = varray_assign(watch_dirs, wd, 0);
+	/*
+	 * The same directory is already watched. This also prevents
+	 * symbolic link loops.
+	 */
+	if (*slot != NULL)
+		return;
+	*slot = check_strdup(dir);
+	if ((dirp = opendir(dir)) == NULL)
+		return;
+	sb = strbuf_open(0);
+	while ((dp = readdir(dirp)) != NULL) {
+		const char *path;
+
+		if (!strcmp(dp->d_name, ".") || !strcmp(dp->d_name, ".."))
+			continue;
+		path = makepath(dir, dp->d_name, NULL);
+		if (test("d", path)) {
+			strbuf_puts(sb, path);
+			strbuf_puts0(sb, "/");
+		} else if (enqueue) {
+			strhash_assign(watch_pending, path, 1);
+		}
+	}
+	(void)closedir(dirp);
+	/*
+	 * Subdirectories are processed after closing the directory
+	 * not to consume file descriptors.
+	 */
+	end = strbuf_value(sb) + strbuf_getlen(sb);
+	for (p = strbuf_value(sb); p < end; p += strlen(p) + 1)
+		if (!skipthisfile(p))
+			watch_add(p, enqueue);
+	strbuf_close(sb);
+}
+/**
+ * watch_open: start watching the project.
+ */
+static void
+watch_open(void)
+{
+	if ((watch_fd = inotify_init1(IN_CLOEXEC)) < 0)
+		die("cannot initialize inotify.");
+	watch_add("./", 0);
+}
+/**
+ * watch_close: stop watching the project.
+ */
+static void
+watch_close(void)
+{
+	int i;
+
+	close(watch_fd);
+	watch_fd = -1;
+	for (i = 0; i < watch_dirs->length; i++) {
+		char **slot = varray_assign(watch_dirs, i, 0);
+
+		if (*slot)
+			free(*slot);
+	}
+	varray_reset(watch_dirs);
+}
+/**
+ * watch_read: read events and record the changed files.
+ */
+static void
+watch_read(void)
+{
+	static union {
+		struct inotify_event ev;	/* for alignment */
+		char buf[65536];
+	} u;
+	ssize_t len;
+	char *p;
+
+	if ((len = read(watch_fd, u.buf, sizeof(u.buf))) < 0) {
+		if (errno == EINTR)
+			return;
+		die("cannot read inotify events.");
+	}
+	for (p = u.buf; p < u.buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+		struct inotify_event *ev = (struct inotify_event *)p;
+		const char *dir, *path;
+		char **slot;
+
+		if (ev->mask & IN_Q_OVERFLOW) {
+			watch_rescan = 1;
+			continue;
+		}
+		if (ev->wd < 0 || ev->wd >= watch_dirs->length)
+			continue;
+		slot = varray_assign(watch_dirs, ev->wd, 0);
+		if (ev->mask & IN_IGNORED) {
+			/* the directory was removed */
+			if (*slot)
+				free(*slot);
+			*slot = NULL;
+			continue;
+		}
+		if ((dir = *slot) == NULL || ev->len == 0)
+			continue;
+		path = makepath(dir, ev->name, NULL);
+		if (ev->mask & IN_ISDIR) {
+			STATIC_STRBUF(sb);
+
+			strbuf_clear(sb);
+			strbuf_puts(sb, path);
+			strbuf_putc(sb, '/');
+			if (ev->mask & IN_MOVED_FROM)
+				watch_rescan = 1;
+			else if (ev->mask & IN_DELETE)
+				strbuf_puts0(watch_removed, strbuf_value(sb));
+			else if (!skipthisfile(strbuf_value(sb)))
+				watch_add(strbuf_value(sb), 1);
+		} else {
+			strhash_assign(watch_pending, path, 1);
+		}
+	}
+}
+/**
+ * watch_update: apply the changes of the recorded files.
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	root	root directory of source tree
+ *
+ * This is the same as incremental() except that only the recorded files
+ * are inspected.
+ */
+static void
+watch_update(const char *dbpath, const char *root)
+{
+	STRBUF *addlist = strbuf_open(0);
+	STRBUF *deletelist = strbuf_open(0);
+	STRBUF *addlist_other = strbuf_open(0);
+	IDSET *deleteset;
+	struct sh_entry *ent;
+	struct stat statp;
+	time_t gtags_mtime;
+	const char *path;
+
+	/*
+	 * Files in the removed directories were removed too.
+	 */
+	if (strbuf_getlen(watch_removed) > 0) {
+		const char *start = strbuf_value(watch_removed);
+		const char *end = start + strbuf_getlen(watch_removed);
+
+		for (path = start; path < end; path += strlen(path) + 1) {
+			GFIND *gp = gfind_open(dbpath, path, GPATH_BOTH, 0);
+			const char *p;
+
+			while ((p = gfind_read(gp)) != NULL)
+				strhash_assign(watch_pending, p, 1);
+			gfind_close(gp);
+		}
+		strbuf_reset(watch_removed);
+	}
+	path = makepath(dbpath, dbname(GTAGS), NULL);
+	if (stat(path, &statp) < 0)
+		die("stat failed '%s'.", path);
+	gtags_mtime = statp.st_mtime;
+	if (gpath_open(dbpath, snapshot ? 0 : 2) < 0)
+		die("GPATH not found.");
+	deleteset = idset_open(gpath_nextkey());
+	total = 0;
+	for (ent = strhash_first(watch_pending); ent != NULL; ent = strhash_next(watch_pending)) {
+		char fid[MAXFIDLEN];
+		const char *p;
+		int type;
+
+		path = ent->name;
+		if (skipthisfile(path))
+			continue;
+		p = gpath_path2fid(path, &type);
+		if (p == NULL) {
+			/*
+			 * New file. A file list limits the project,
+			 * so new files are not accepted.
+			 */
+			if (file_list || !test("f", path) || !test("r", path))
+				continue;
+			if (issourcefile(path)) {
+				strbuf_puts0(addlist, path);
+				total++;
+			} else if (!test("b", path)) {
+				strbuf_puts0(addlist_other, path);
+			}
+			continue;
+		}
+		strlimcpy(fid, p, sizeof(fid));
+		if (stat(path, &statp) < 0 || !S_ISREG(statp.st_mode)) {
+			/* deleted */
+			if (type != GPATH_OTHER)
+				idset_add(deleteset, atoi(fid));
+			strbuf_puts0(deletelist, path);
+		} else if (type != GPATH_OTHER && modified(path, fid, &statp, gtags_mtime)) {
+			/* modified */
+			idset_add(deleteset, atoi(fid));
+			strbuf_puts0(addlist, path);
+			total++;
+		}
+	}
+	if (updatefiles(dbpath, root, deleteset, addlist, deletelist, addlist_other) && vflag)
+		fprintf(stderr, "[%s] Global databases have been modified.\n", now());
+	gpath_close();
+	idset_close(deleteset);
+	strbuf_close(addlist);
+	strbuf_close(deletelist);
+	strbuf_close(addlist_other);
+	strhash_reset(watch_pending);
+}
+/**
+ * watch_flush: apply the recorded changes to the tag files.
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	root	root directory of source tree
+ */
+static void
+watch_flush(const char *dbpath, const char *root)
+{
+	if (watch_rescan) {
+		/*
+		 * The directory names in watch_dirs may be wrong.
+		 * Rebuild all watches and inspect the whole project.
+		 */
+		watch_rescan = 0;
+		strhash_reset(watch_pending);
+		strbuf_reset(watch_removed);
+		watch_close();
+		watch_open();
+		(void)incremental(dbpath, root);
+	} else if (watch_pending->entries > 0 || strbuf_getlen(watch_removed) > 0) {
+		watch_update(dbpath, root);
+	}
+}
+/**
+ * watchtags: keep the tag files up to date until interrupted.
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	root	root directory of source tree
+ *
+ * The tag files should be up to date when this function is called.
+ */
+void
+watchtags(const char *dbpath, const char *root)
+{
+	time_t first = 0;
+
+	signal(SIGINT, watch_onsignal);
+	signal(SIGTERM, watch_onsignal);
+	signal(SIGHUP, watch_onsignal);
+	watch_dirs = varray_open(sizeof(char *), 100);
+	watch_pending = strhash_open(256);
+	watch_removed = strbuf_open(0);
+	watch_open();
+	if (vflag)
+		fprintf(stderr, "[%s] Watching the changes of files.\n", now());
+	while (!watch_stop) {
+		struct pollfd pfd;
+		int timeout = -1;
+		int changed = watch_rescan || watch_pending->entries > 0 || strbuf_getlen(watch_removed) > 0;
+
+		if (changed) {
+			if (first == 0) {
+				first = time(NULL);
+			} else if (time(NULL) - first >= WATCH_MAXWAIT) {
+				/* files keep changing */
+				watch_flush(dbpath, root);
+				first = 0;
+				continue;
+			}
+			timeout = WATCH_DELAY;
+		}
+		pfd.fd = watch_fd;
+		pfd.events = POLLIN;
+		switch (poll(&pfd, 1, timeout)) {
+		case -1:
+			if (errno != EINTR)
+				die("poll(2) failed.");
+			break;
+		case 0:
+			watch_flush(dbpath, root);
+			first = 0;
+			break;
+		default:
+			watch_read();
+			break;
+		}
+	}
+	/* apply the rest of changes before exiting */
+	watch_flush(dbpath, root);
+	watch_close();
+	varray_close(watch_dirs);
+	strhash_close(watch_pending);
+	strbuf_close(watch_removed);
+	if (vflag)
+		fprintf(stderr, "[%s] Stopped watching.\n", now());
+}
+#endif /* HAVE_SYS_INOTIFY_H */
 /**
  * printconf: print configuration data.
  *
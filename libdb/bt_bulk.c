@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <sys/types.h>
+
+#include <errno.h>
+#include <stdio.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include "db.h"
+#include "btree.h"
+
+/*
+ * Bulk loading of a btree.
+ *
+ * When the records arrive in sorted order, there is no need to search the
+ * tree and split pages for each record.  The bulk loader fills the leaf
+ * pages from left to right up to the fill factor, and each time a page is
+ * started, posts its first key to the parent level, which is built in the
+ * same way.  The tree grows from the bottom.
+ *
+ * The root page must stay at P_ROOT.  So the first page of the highest level
+ * is always built on the root page.  When that level gets its second page,
+ * the first page is moved to a new page and the root becomes the first page
+ * of the new highest level.
+ *
+ *	db = dbopen(...);		// new tree
+ *	__bt_bulk_open(db, fill);
+ *	while (...)
+ *		__bt_bulk_put(db, &key, &data);	// in sorted order
+ *	__bt_bulk_close(db);
+ *
+ * No other operation is allowed between __bt_bulk_open() and
+ * __bt_bulk_close() except for close and sync, which close bulk loading
+ * implicitly.
+ */
+static int	 bulk_room(BTREE *, BTBULK *, PAGE *, u_int32_t);
+static PAGE	*bulk_newpage(BTREE *, BTBULK *, int);
+static int	 bulk_post(BTREE *, BTBULK *, int, const DBT *, u_char, pgno_t, const DBT *);
+static int	 bulk_preserve(BTREE *, pgno_t);
+
+/**
+ * __BT_BULK_OPEN -- Start bulk loading.
+ *
+ *	@param dbp	pointer to access method
+ *	@param fill	fill factor of each page in percent (1-100).
+ *			0: use the default (BT_BULKFILL).
+ *
+ * @return RET_ERROR, RET_SUCCESS
+ *
+ * The tree must be empty.
+ */
+int
+__bt_bulk_open(dbp, fill)
+	const DB *dbp;
+	int fill;
+{
+	BTREE *t;
+	BTBULK *bk;
+	PAGE *h;
+
+	t = dbp->internal;
+
+	/* Toss any page pinned across calls. */
+	if (t->bt_pinned != NULL) {
+		mpool_put(t->bt_mp, t->bt_pinned, 0);
+		t->bt_pinned = NULL;
+	}
+
+	/* Check for change to a read-only tree. */
+	if (F_ISSET(t, B_RDONLY)) {
+		errno = EPERM;
+		return (RET_ERROR);
+	}
+	if (F_ISSET(t, R_RECNO) || t->bt_bulk != NULL || fill < 0 || fill > 100) {
+		errno = EINVAL;
+		return (RET_ERROR);
+	}
+
+	/* The tree must consist of an empty root page. */
+	if ((h = mpool_get(t->bt_mp, P_ROOT, 0)) == NULL)
+		return (RET_ERROR);
+	if (!(h->flags & P_BLEAF) || NEXTINDEX(h) != 0) {
+		mpool_put(t->bt_mp, h, 0);
+		errno = EINVAL;
+		return (RET_ERROR);
+	}
+	if ((bk = (BTBULK *)malloc(sizeof(BTBULK))) == NULL) {
+		mpool_put(t->bt_mp, h, 0);
+		return (RET_ERROR);
+	}
+	memset(bk, 0, sizeof(BTBULK));
+	bk->fill = fill ? fill : BT_BULKFILL;
+	bk->limit = (t->bt_psize - BTDATAOFF) * bk->fill / 100;
+	bk->nlevels = 1;
+	bk->cur[0] = h;
+	bk->empty = 1;
+	bk->pfxrun = 0;
+	t->bt_bulk = bk;
+	return (RET_SUCCESS);
+}
+
+/**
+ * __BT_BULK_PUT -- Append a record to the tree.
+ *
+ *	@param dbp	pointer to access method
+ *	@param key	key
+ *	@param data	data
+ *
+ * @return RET_ERROR, RET_SUCCESS
+ *
+ * The key must not be less than the last key.  It must be greater than
+ * the last key unless duplicate keys are permitted.
+ */
+int
+__bt_bulk_put(dbp, key, data)
+	const DB *dbp;
+	const DBT *key, *data;
+{
+	BTREE *t;
+	BTBULK *bk;
+	DBT tkey, tdata;
+	const DBT *ukey;
+	PAGE *h;
+	indx_t index;
+	pgno_t pg;
+	u_int32_t len, nbytes, shared;
+	int cmp, dflags, pfx;
+	u_char *p1, *p2;
+	char *dest, db[NOVFLSIZE], kb[NOVFLSIZE];
+
+	t = dbp->internal;
+	if ((bk = t->bt_bulk) == NULL) {
+		errno = EINVAL;
+		return (RET_ERROR);
+	}
+
+	/* Check the order of the keys. */
+	if (!bk->empty) {
+		cmp = (*t->bt_cmp)(key, &bk->lastkey);
+		if (cmp < 0 || (cmp == 0 && F_ISSET(t, B_NODUPS))) {
+			errno = EINVAL;
+			return (RET_ERROR);
+		}
+	}
+
+	/*
+	 * If the key/data pair won't fit on a page, store it on overflow
+	 * pages in the same way as __bt_put().
+	 */
+	ukey = key;
+	dflags = 0;
+	if (key->size + data->size > t->bt_ovflsize) {
+		if (key->size > t->bt_ovflsize) {
+storekey:		if (__ovfl_put(t, key, &pg) == RET_ERROR)
+				return (RET_ERROR);
+			tkey.data = kb;
+			tkey.size = NOVFLSIZE;
+			memmove(kb, &pg, sizeof(pgno_t));
+			memmove(kb + sizeof(pgno_t),
+			    &key->size, sizeof(u_int32_t));
+			dflags |= P_BIGKEY;
+			key = &tkey;
+		}
+		if (key->size + data->size > t->bt_ovflsize) {
+			if (__ovfl_put(t, data, &pg) == RET_ERROR)
+				return (RET_ERROR);
+			tdata.data = db;
+			tdata.size = NOVFLSIZE;
+			memmove(db, &pg, sizeof(pgno_t));
+			memmove(db + sizeof(pgno_t),
+			    &data->size, sizeof(u_int32_t));
+			dflags |= P_BIGDATA;
+			data = &tdata;
+		}
+		if (key->size + data->size > t->bt_ovflsize)
+			goto storekey;
+	}
+
+	/*
+	 * If the leaf page is filled, start a new one and post its first
+	 * key to the parent level.
+	 */
+	shared = 0;
+	pfx = F_ISSET(t, B_PFXLEAF) && !(dflags & P_BIGKEY);
+	if (pfx && bk->pfxrun > 0 && bk->pfxrun < BT_PFXRESTART) {
+		len = MIN(bk->lastkey.size, key->size);
+		if (len > t->bt_pfxmax)
+			len = t->bt_pfxmax;
+		for (p1 = bk->lastkey.data, p2 = key->data;
+		    shared < len && *p1 == *p2; ++shared, ++p1, ++p2)
+			;
+	}
+	nbytes = pfx ? NBLEAFPFX(shared, key->size, data->size) :
+	    NBLEAFDBT(key->size, data->size);
+	h = bk->cur[0];
+	if (!bulk_room(t, bk, h, nbytes)) {
+		if ((h = bulk_newpage(t, bk, 0)) == NULL)
+			goto err;
+		if (shared > 0) {
+			shared = 0;
+			nbytes = NBLEAFPFX(0, key->size, data->size);
+		}
+		if (dflags & P_BIGKEY) {
+			memmove(&pg, kb, sizeof(pgno_t));
+			if (bulk_preserve(t, pg) == RET_ERROR)
+				goto err;
+			if (bulk_post(t, bk, 1, key, P_BIGKEY, h->pgno, NULL) == RET_ERROR)
+				goto err;
+		} else {
+			if (bulk_post(t, bk, 1, ukey, 0, h->pgno, &bk->lastkey) == RET_ERROR)
+				goto err;
+		}
+	}
+	index = NEXTINDEX(h);
+	h->lower += sizeof(indx_t);
+	h->linp[index] = h->upper -= nbytes;
+	dest = (char *)h + h->upper;
+	if (pfx) {
+		WR_BLEAFPFX(dest, shared, key, data, dflags);
+		bk->pfxrun = shared ? bk->pfxrun + 1 : 1;
+	} else {
+		WR_BLEAF(dest, key, data, dflags);
+		bk->pfxrun = 0;
+	}
+	BT_PFXCLR(t);
+
+	/* Remember the key for the order check and the prefix of the next page. */
+	if (ukey->size > bk->lastkeyalloc) {
+		void *p = realloc(bk->lastkey.data, ukey->size);
+
+		if (p == NULL)
+			goto err;
+		bk->lastkey.data = p;
+		bk->lastkeyalloc = ukey->size;
+	}
+	memmove(bk->lastkey.data, ukey->data, ukey->size);
+	bk->lastkey.size = ukey->size;
+	bk->empty = 0;
+
+	F_SET(t, B_MODIFIED);
+	return (RET_SUCCESS);
+err:
+	__dbpanic(t->bt_dbp);
+	return (RET_ERROR);
+}
+
+/**
+ * __BT_BULK_CLOSE -- End bulk loading.
+ *
+ *	@param dbp	pointer to access method
+ *
+ * @return RET_ERROR, RET_SUCCESS
+ */
+int
+__bt_bulk_close(dbp)
+	const DB *dbp;
+{
+	BTREE *t;
+	BTBULK *bk;
+	int level, status;
+
+	t = dbp->internal;
+	if ((bk = t->bt_bulk) == NULL) {
+		errno = EINVAL;
+		return (RET_ERROR);
+	}
+	status = RET_SUCCESS;
+	for (level = 0; level < bk->nlevels; level++)
+		if (mpool_put(t->bt_mp, bk->cur[level], MPOOL_DIRTY) == RET_ERROR)
+			status = RET_ERROR;
+	if (bk->lastkey.data != NULL)
+		free(bk->lastkey.data);
+	free(bk);
+	t->bt_bulk = NULL;
+	return (status);
+}
+
+/**
+ * BULK_ROOM -- Check whether an item can be appended to the page.
+ *
+ *	@param t	tree
+ *	@param bk	bulk loading state
+ *	@param h	page
+ *	@param nbytes	size of the item
+ *
+ * @return 1: can be appended, 0: the page is filled
+ *
+ * The fill factor is applied after a page has the minimum number of keys,
+ * so that each level has fewer pages than the level below it.
+ */
+static int
+bulk_room(t, bk, h, nbytes)
+	BTREE *t;
+	BTBULK *bk;
+	PAGE *h;
+	u_int32_t nbytes;
+{
+	u_int32_t used;
+
+	if ((u_int32_t)(h->upper - h->lower) < nbytes + sizeof(indx_t))
+		return (0);
+	if (NEXTINDEX(h) < DEFMINKEYPAGE)
+		return (1);
+	used = (h->lower - BTDATAOFF) + (t->bt_psize - h->upper);
+	return (used + nbytes + sizeof(indx_t) <= bk->limit);
+}
+
+/**
+ * BULK_NEWPAGE -- Start a new page on the level.
+ *
+ *	@param t	tree
+ *	@param bk	bulk loading state
+ *	@param level	level (0: leaf)
+ *
+ * @return Pointer to the new (pinned) page, NULL on error.
+ *
+ * The current page of the level is unpinned.  If it is the root page, it
+ * is moved to a new page and the root page becomes the parent level.
+ */
+static PAGE *
+bulk_newpage(t, bk, level)
+	BTREE *t;
+	BTBULK *bk;
+	int level;
+{
+	PAGE *h, *m, *np;
+	pgno_t npg;
+	char *dest;
+
+	h = bk->cur[level];
+	if (h->pgno == P_ROOT) {
+		if (level + 1 >= BT_BULKMAXLEVEL) {
+			errno = EINVAL;
+			return (NULL);
+		}
+		if ((m = __bt_new(t, &npg)) == NULL)
+			return (NULL);
+		memmove(m, h, t->bt_psize);
+		m->pgno = npg;
+
+		/*
+		 * The root page becomes an internal page which has the moved
+		 * page as the left-most child.  The left-most key on any level
+		 * is never used (see bt_broot()).
+		 */
+		h->prevpg = h->nextpg = P_INVALID;
+		h->flags = P_BINTERNAL;
+		h->lower = BTDATAOFF + sizeof(indx_t);
+		h->linp[0] = h->upper = t->bt_psize - NBINTERNAL(0);
+		dest = (char *)h + h->upper;
+		WR_BINTERNAL(dest, 0, m->pgno, 0);
+		bk->cur[level + 1] = h;
+		bk->nlevels++;
+		h = bk->cur[level] = m;
+	}
+	if ((np = __bt_new(t, &npg)) == NULL)
+		return (NULL);
+	np->pgno = npg;
+	np->prevpg = h->pgno;
+	np->nextpg = P_INVALID;
+	np->lower = BTDATAOFF;
+	np->upper = t->bt_psize;
+	np->flags = h->flags & P_TYPE;
+	h->nextpg = npg;
+	mpool_put(t->bt_mp, h, MPOOL_DIRTY);
+	bk->cur[level] = np;
+	return (np);
+}
+
+/**
+ * BULK_POST -- Append a key to an internal level.
+ *
+ *	@param t	tree
+ *	@param bk	bulk loading state
+ *	@param level	level (>= 1)
+ *	@param key	the first key of the child page
+ *	@param flags	P_BIGKEY or 0
+ *	@param pgno	child page
+ *	@param left	the last key of the left sibling of the child,
+ *			if the key can be shortened, else NULL.
+ *
+ * @return RET_ERROR, RET_SUCCESS
+ *
+ * Prefix trees: retain only what's needed to distinguish between the key
+ * and the last key on the page to its left, in the same way as __bt_split().
+ */
+static int
+bulk_post(t, bk, level, key, flags, pgno, left)
+	BTREE *t;
+	BTBULK *bk;
+	int level;
+	const DBT *key;
+	u_char flags;
+	pgno_t pgno;
+	const DBT *left;
+{
+	DBT sep;
+	PAGE *h;
+	indx_t index;
+	u_int32_t nbytes, n;
+	int newpage;
+	char *dest;
+
+	h = bk->cur[level];
+	for (newpage = 0;; newpage = 1) {
+		sep = *key;
+		if (left != NULL && t->bt_pfx &&
+		    (h->prevpg != P_INVALID || NEXTINDEX(h) > 1)) {
+			n = t->bt_pfx(left, key);
+			if (n < sep.size)
+				sep.size = n;
+		}
+		nbytes = NBINTERNAL(sep.size);
+		if (newpage || bulk_room(t, bk, h, nbytes))
+			break;
+		if ((h = bulk_newpage(t, bk, level)) == NULL)
+			return (RET_ERROR);
+	}
+	index = NEXTINDEX(h);
+	h->lower += sizeof(indx_t);
+	h->linp[index] = h->upper -= nbytes;
+	dest = (char *)h + h->upper;
+	WR_BINTERNAL(dest, sep.size, pgno, flags);
+	memmove(dest, sep.data, sep.size);
+
+	/* A new page was started on this level: post it to the parent. */
+	if (newpage)
+		return (bulk_post(t, bk, level + 1, &sep, flags, h->pgno, NULL));
+	return (RET_SUCCESS);
+}
+
+/**
+ * BULK_PRESERVE -- Mark a chain of pages as used by an internal node.
+ *
+ *	@param t	tree
+ *	@param pg	page number of first page in the chain.
+ *
+ * @return RET_SUCCESS, RET_ERROR.
+ */
+static int
+bulk_preserve(t, pg)
+	BTREE *t;
+	pgno_t pg;
+{
+	PAGE *h;
+
+	if ((h = mpool_get(t->bt_mp, pg, 0)) == NULL)
+		return (RET_ERROR);
+	h->flags |= P_PRESERVE;
+	mpool_put(t->bt_mp, h, MPOOL_DIRTY);
+	return (RET_SUCCESS);
+}
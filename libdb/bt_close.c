@@ -80,6 +80,10 @@ __bt_close(dbp, abandon)
 		t->bt_pinned = NULL;
 	}
 
+	/* Finish bulk loading. */
+	if (t->bt_bulk != NULL && __bt_bulk_close(dbp) == RET_ERROR)
+		return (RET_ERROR);
+
 	/* Sync the tree. */
 	/*
 	 * If abandon flag is set, omit writing to the disk.
@@ -109,6 +113,12 @@ __bt_close(dbp, abandon)
 		t->bt_rdata.size = 0;
 		t->bt_rdata.data = NULL;
 	}
+	if (t->bt_rkeys.data)
+		free(t->bt_rkeys.data);
+	if (t->bt_pfxkey.data)
+		free(t->bt_pfxkey.data);
+	if (t->bt_pfxtmp.data)
+		free(t->bt_pfxtmp.data);
 
 	fd = t->bt_fd;
 	free(t);
@@ -146,6 +156,10 @@ __bt_sync(dbp, flags)
 		return (RET_ERROR);
 	}
 
+	/* Finish bulk loading. */
+	if (t->bt_bulk != NULL && __bt_bulk_close(dbp) == RET_ERROR)
+		return (RET_ERROR);
+
 	if (F_ISSET(t, B_INMEM | B_RDONLY) || !F_ISSET(t, B_MODIFIED))
 		return (RET_SUCCESS);
 
@@ -41,6 +41,9 @@ static char sccsid[] = "@(#)bt_delete.c	8.13 (Berkeley) 7/28/94";
 
 #include <errno.h>
 #include <stdio.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
 #ifdef HAVE_STRING_H
 #include <string.h>
 #else
@@ -50,9 +53,24 @@ static char sccsid[] = "@(#)bt_delete.c	8.13 (Berkeley) 7/28/94";
 #include "db.h"
 #include "btree.h"
 
+/** state of __bt_bulk_delete() */
+typedef struct {
+	const DBT *start;		/**< first key or NULL */
+	const DBT *stop;		/**< last key or NULL */
+	int (*func)(const DBT *, const DBT *, void *);	/**< predicate */
+	void *arg;			/**< argument of the predicate */
+	PAGE *tmp;			/**< working page */
+	char *mark;			/**< records to be deleted in a page */
+	int done;			/**< passed the last key */
+} BDELETE;
+
 static int __bt_bdelete(BTREE *, const DBT *);
+static indx_t __bt_bdfirst(BTREE *, const DBT *, PAGE *, indx_t);
+static int __bt_bdleaf(BTREE *, BDELETE *, PAGE *, int *);
+static int __bt_bdpage(BTREE *, BDELETE *, pgno_t, int *);
 static int __bt_curdel(BTREE *, const DBT *, PAGE *, u_int);
 static int __bt_pdelete(BTREE *, PAGE *);
+static void __bt_pfxreplace(BTREE *, PAGE *, indx_t, u_int32_t);
 static int __bt_relink(BTREE *, PAGE *);
 static int __bt_stkacq(BTREE *, PAGE **, CURSOR *);
 
@@ -472,8 +490,8 @@ __bt_dleaf(t, key, h, index)
 	u_int index;
 {
 	BLEAF *bl;
-	indx_t cnt, *ip, offset;
-	u_int32_t nbytes;
+	indx_t cnt, *ip, next, offset;
+	u_int32_t nbytes, nnext;
 	void *to;
 	char *from;
 
@@ -484,8 +502,27 @@ __bt_dleaf(t, key, h, index)
 	    __bt_curdel(t, key, h, index))
 		return (RET_ERROR);
 
+	/*
+	 * On a prefix compressed page, the next record may share more with
+	 * this one than with the previous one.  Build it sharing no more
+	 * than this one does, which takes less room than this one frees.
+	 */
+	bl = GETBLEAF(h, index);
+	next = 0;
+	if (F_ISSET(t, B_PFXLEAF) && !(bl->flags & P_BIGKEY)) {
+		for (next = index + 1; next < NEXTINDEX(h) &&
+		    GETBLEAF(h, next)->flags & P_BIGKEY; ++next)
+			;
+		if (next < NEXTINDEX(h) &&
+		    GETPFX(GETBLEAF(h, next)) > GETPFX(bl)) {
+			if (__bt_pfxrecode(t, h, next, GETPFX(bl), &nnext))
+				return (RET_ERROR);
+		} else
+			next = 0;
+	}
+
 	/* If the entry uses overflow pages, make them available for reuse. */
-	to = bl = GETBLEAF(h, index);
+	to = bl;
 	if (bl->flags & P_BIGKEY && __ovfl_delete(t, bl->bytes) == RET_ERROR)
 		return (RET_ERROR);
 	if (bl->flags & P_BIGDATA &&
@@ -506,6 +543,9 @@ __bt_dleaf(t, key, h, index)
 	for (cnt = NEXTINDEX(h) - index; --cnt; ++ip)
 		ip[0] = ip[1] < offset ? ip[1] + nbytes : ip[1];
 	h->lower -= sizeof(indx_t);
+	if (next)
+		__bt_pfxreplace(t, h, next - 1, nnext);
+	BT_PFXCLR(t);
 
 	/* If the cursor is on this page, adjust it as necessary. */
 	if (F_ISSET(&t->bt_cursor, CURS_INIT) &&
@@ -516,6 +556,42 @@ __bt_dleaf(t, key, h, index)
 	return (RET_SUCCESS);
 }
 
+/**
+ * __bt_pfxreplace --
+ *	Replace a record of a leaf page with the one in t->bt_pfxtmp.
+ *
+ *	@param t	tree
+ *	@param h	leaf page
+ *	@param index	index of the record
+ *	@param nbytes	size of the new record
+ *
+ * The overflow pages of the old record are taken over by the new one.
+ */
+static void
+__bt_pfxreplace(t, h, index, nbytes)
+	BTREE *t;
+	PAGE *h;
+	indx_t index;
+	u_int32_t nbytes;
+{
+	BLEAF *bl;
+	indx_t cnt, *ip, offset;
+	u_int32_t obytes;
+	char *from;
+
+	bl = GETBLEAF(h, index);
+	obytes = NBLEAF(bl);
+	from = (char *)h + h->upper;
+	memmove(from + obytes, from, (char *)bl - from);
+	h->upper += obytes;
+	offset = h->linp[index];
+	for (cnt = NEXTINDEX(h), ip = &h->linp[0]; cnt--; ++ip)
+		if (ip[0] < offset)
+			ip[0] += obytes;
+	h->linp[index] = h->upper -= nbytes;
+	memmove((char *)h + h->upper, t->bt_pfxtmp.data, nbytes);
+}
+
 /**
  * __bt_curdel --
  *	Delete the cursor.
@@ -646,3 +722,338 @@ __bt_relink(t, h)
 	}
 	return (0);
 }
+
+/**
+ * __bt_bulk_delete --
+ *	Delete the records in a key range which satisfy a predicate.
+ *
+ *	@param dbp	pointer to access method
+ *	@param start	first key of the range, NULL: from the first record
+ *	@param stop	last key of the range, NULL: to the last record
+ *	@param func	predicate called with key and data, which returns
+ *			non-zero for a record to be deleted, NULL: all records
+ *	@param arg	argument of the predicate
+ *
+ * @return RET_ERROR, RET_SUCCESS and RET_SPECIAL if no record was deleted.
+ *
+ * The tree is walked once from the root.  Subtrees out of the range are
+ * skipped, each leaf page is compacted at once, and the pages which get
+ * empty are unlinked and freed on the way back.  The cursor is reset.
+ */
+int
+__bt_bulk_delete(dbp, start, stop, func, arg)
+	const DB *dbp;
+	const DBT *start, *stop;
+	int (*func)(const DBT *, const DBT *, void *);
+	void *arg;
+{
+	BTREE *t;
+	BDELETE d;
+	int deleted, status;
+
+	t = dbp->internal;
+
+	/* Toss any page pinned across calls. */
+	if (t->bt_pinned != NULL) {
+		mpool_put(t->bt_mp, t->bt_pinned, 0);
+		t->bt_pinned = NULL;
+	}
+
+	/* Check for change to a read-only tree. */
+	if (F_ISSET(t, B_RDONLY)) {
+		errno = EPERM;
+		return (RET_ERROR);
+	}
+
+	/* The record under the cursor may disappear; forget the cursor. */
+	if (t->bt_cursor.key.data != NULL) {
+		free(t->bt_cursor.key.data);
+		t->bt_cursor.key.size = 0;
+		t->bt_cursor.key.data = NULL;
+	}
+	F_CLR(&t->bt_cursor, CURS_ACQUIRE | CURS_AFTER | CURS_BEFORE | CURS_INIT);
+
+	/* Pages may be compacted or freed; forget the last insert position. */
+	t->bt_order = NOT;
+
+	d.start = start;
+	d.stop = stop;
+	d.func = func;
+	d.arg = arg;
+	d.done = 0;
+	if ((d.tmp = (PAGE *)malloc(t->bt_psize)) == NULL)
+		return (RET_ERROR);
+	if ((d.mark = (char *)malloc(t->bt_psize / sizeof(indx_t))) == NULL) {
+		free(d.tmp);
+		return (RET_ERROR);
+	}
+	deleted = 0;
+	status = __bt_bdpage(t, &d, P_ROOT, &deleted);
+	free(d.mark);
+	free(d.tmp);
+	if (status != RET_SUCCESS)
+		return (status);
+	if (!deleted)
+		return (RET_SPECIAL);
+	F_SET(t, B_MODIFIED);
+	return (RET_SUCCESS);
+}
+
+/**
+ * __bt_bdfirst --
+ *	Find the first entry of a page not less than a key.
+ *
+ *	@param t	tree
+ *	@param key	key
+ *	@param h	page
+ *	@param base	first index to look at
+ *
+ * @return The index, or NEXTINDEX(h) if all entries are less than key.
+ */
+static indx_t
+__bt_bdfirst(t, key, h, base)
+	BTREE *t;
+	const DBT *key;
+	PAGE *h;
+	indx_t base;
+{
+	EPG e;
+	indx_t lim;
+
+	e.page = h;
+	for (lim = NEXTINDEX(h); base < lim;) {
+		e.index = base + (lim - base) / 2;
+		if (__bt_cmp(t, key, &e) <= 0)
+			lim = e.index;
+		else
+			base = e.index + 1;
+	}
+	return (base);
+}
+
+/**
+ * __bt_bdpage --
+ *	Delete records in a subtree for __bt_bulk_delete().
+ *
+ *	@param t	tree
+ *	@param d	state
+ *	@param pgno	root page of the subtree
+ *	@param deleted	set to 1 if a record was deleted
+ *
+ * @return RET_SUCCESS, RET_ERROR.
+ *	   RET_SPECIAL if the page got empty and was freed.
+ */
+static int
+__bt_bdpage(t, d, pgno, deleted)
+	BTREE *t;
+	BDELETE *d;
+	pgno_t pgno;
+	int *deleted;
+{
+	BINTERNAL *bi;
+	EPG e;
+	PAGE *h;
+	indx_t cnt, index, *ip, offset;
+	u_int32_t nksize;
+	char *from;
+	int dirty, status;
+
+	if ((h = mpool_get(t->bt_mp, pgno, 0)) == NULL)
+		return (RET_ERROR);
+	if (h->flags & P_BLEAF)
+		return (__bt_bdleaf(t, d, h, deleted));
+
+	/*
+	 * The records of a child are not less than its key, and not
+	 * greater than the key of the next child.  Skip the children
+	 * which have only keys less than the first key.  The first key
+	 * of a page may be greater than the records of the first child
+	 * once the child before it has been deleted, so it never ends
+	 * the walk.
+	 */
+	e.page = h;
+	index = 0;
+	if (d->start != NULL)
+		index = __bt_bdfirst(t, d->start, h, 1) - 1;
+	dirty = 0;
+	while (index < NEXTINDEX(h) && !d->done) {
+		if (d->stop != NULL && index > 0) {
+			e.index = index;
+			if (__bt_cmp(t, d->stop, &e) < 0) {
+				d->done = 1;
+				break;
+			}
+		}
+		bi = GETBINTERNAL(h, index);
+		status = __bt_bdpage(t, d, bi->pgno, deleted);
+		if (status == RET_ERROR) {
+			mpool_put(t->bt_mp, h, dirty ? MPOOL_DIRTY : 0);
+			return (RET_ERROR);
+		}
+		if (status == RET_SUCCESS) {
+			index++;
+			continue;
+		}
+
+		/* The child was freed; remove its key as __bt_pdelete does. */
+		if (bi->flags & P_BIGKEY &&
+		    __ovfl_delete(t, bi->bytes) == RET_ERROR) {
+			mpool_put(t->bt_mp, h, dirty ? MPOOL_DIRTY : 0);
+			return (RET_ERROR);
+		}
+		nksize = NBINTERNAL(bi->ksize);
+		from = (char *)h + h->upper;
+		memmove(from + nksize, from, (char *)bi - from);
+		h->upper += nksize;
+		offset = h->linp[index];
+		for (cnt = index, ip = &h->linp[0]; cnt--; ++ip)
+			if (ip[0] < offset)
+				ip[0] += nksize;
+		for (cnt = NEXTINDEX(h) - index; --cnt; ++ip)
+			ip[0] = ip[1] < offset ? ip[1] + nksize : ip[1];
+		h->lower -= sizeof(indx_t);
+		dirty = 1;
+	}
+
+	/*
+	 * Free the page if it lost all the children, unless it's the
+	 * root page, which is turned back into an empty leaf page.
+	 */
+	if (NEXTINDEX(h) == 0) {
+		if (h->pgno == P_ROOT) {
+			h->lower = BTDATAOFF;
+			h->upper = t->bt_psize;
+			h->flags = P_BLEAF;
+			mpool_put(t->bt_mp, h, MPOOL_DIRTY);
+			return (RET_SUCCESS);
+		}
+		if (__bt_relink(t, h) || __bt_free(t, h))
+			return (RET_ERROR);
+		return (RET_SPECIAL);
+	}
+	mpool_put(t->bt_mp, h, dirty ? MPOOL_DIRTY : 0);
+	return (RET_SUCCESS);
+}
+
+/**
+ * __bt_bdleaf --
+ *	Delete records in a leaf page for __bt_bulk_delete().
+ *
+ *	@param t	tree
+ *	@param d	state
+ *	@param h	leaf page
+ *	@param deleted	set to 1 if a record was deleted
+ *
+ * @return RET_SUCCESS, RET_ERROR.
+ *	   RET_SPECIAL if the page got empty and was freed.
+ *
+ * The records to be deleted are marked first.  Then the remaining
+ * records are packed into a working page, and copied back at once.
+ *
+ * Side-effects:
+ *	mpool_put's the page
+ */
+static int
+__bt_bdleaf(t, d, h, deleted)
+	BTREE *t;
+	BDELETE *d;
+	PAGE *h;
+	int *deleted;
+{
+	BLEAF *bl;
+	DBT key, data;
+	EPG e;
+	PAGE *tmp;
+	indx_t index, nkeep, upper;
+	u_int32_t limit, nbytes;
+	int ndelete, pfx;
+	void *src;
+
+	e.page = h;
+	ndelete = 0;
+	memset(d->mark, 0, NEXTINDEX(h));
+	index = 0;
+	if (d->start != NULL) {
+		if (F_ISSET(t, B_PFXLEAF)) {
+			(void)__bt_pfxsearch(t, d->start, &e);
+			index = e.index;
+		} else
+			index = __bt_bdfirst(t, d->start, h, 0);
+	}
+	for (; index < NEXTINDEX(h); index++) {
+		e.index = index;
+		if (d->stop != NULL && __bt_cmp(t, d->stop, &e) < 0) {
+			d->done = 1;
+			break;
+		}
+		if (d->func != NULL) {
+			if (__bt_ret(t, &e,
+			    &key, &t->bt_rkey, &data, &t->bt_rdata, 0)) {
+				mpool_put(t->bt_mp, h, 0);
+				return (RET_ERROR);
+			}
+			if (!(*d->func)(&key, &data, d->arg))
+				continue;
+		}
+		d->mark[index] = 1;
+		ndelete++;
+	}
+	if (ndelete == 0) {
+		mpool_put(t->bt_mp, h, 0);
+		return (RET_SUCCESS);
+	}
+	*deleted = 1;
+
+	/*
+	 * On a prefix compressed page, a record kept after deleted ones may
+	 * share with the previous record kept no more than any of them did.
+	 */
+	tmp = d->tmp;
+	nkeep = 0;
+	upper = t->bt_psize;
+	limit = 0;
+	for (index = 0; index < NEXTINDEX(h); index++) {
+		bl = GETBLEAF(h, index);
+		pfx = F_ISSET(t, B_PFXLEAF) && !(bl->flags & P_BIGKEY);
+		if (d->mark[index]) {
+			if (pfx && GETPFX(bl) < limit)
+				limit = GETPFX(bl);
+			/* If the entry uses overflow pages, free them. */
+			if (bl->flags & P_BIGKEY &&
+			    __ovfl_delete(t, bl->bytes) == RET_ERROR)
+				goto err;
+			if (bl->flags & P_BIGDATA &&
+			    __ovfl_delete(t, bl->bytes + bl->ksize) == RET_ERROR)
+				goto err;
+			continue;
+		}
+		src = bl;
+		nbytes = NBLEAF(bl);
+		if (pfx) {
+			if (GETPFX(bl) > limit) {
+				if (__bt_pfxrecode(t, h, index, limit, &nbytes))
+					goto err;
+				src = t->bt_pfxtmp.data;
+			}
+			limit = PFXMAX;
+		}
+		upper -= nbytes;
+		memmove((char *)tmp + upper, src, nbytes);
+		tmp->linp[nkeep++] = upper;
+	}
+	BT_PFXCLR(t);
+	if (nkeep == 0 && h->pgno != P_ROOT) {
+		if (__bt_relink(t, h) || __bt_free(t, h))
+			return (RET_ERROR);
+		return (RET_SPECIAL);
+	}
+	memmove(h->linp, tmp->linp, nkeep * sizeof(indx_t));
+	memmove((char *)h + upper, (char *)tmp + upper, t->bt_psize - upper);
+	h->lower = BTDATAOFF + nkeep * sizeof(indx_t);
+	h->upper = upper;
+	mpool_put(t->bt_mp, h, MPOOL_DIRTY);
+	return (RET_SUCCESS);
+
+err:	mpool_put(t->bt_mp, h, 0);
+	return (RET_ERROR);
+}
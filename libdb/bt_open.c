@@ -126,8 +126,8 @@ __bt_open(fname, flags, mode, openinfo, dflags)
 	if (openinfo) {
 		b = *openinfo;
 
-		/* Flags: R_DUP. */
-		if (b.flags & ~(R_DUP))
+		/* Flags: R_DUP, R_CACHE2Q, R_MMAP, R_PFXLEAF. */
+		if (b.flags & ~(R_DUP | R_CACHE2Q | R_MMAP | R_PFXLEAF))
 			goto einval;
 
 		/*
@@ -164,6 +164,7 @@ __bt_open(fname, flags, mode, openinfo, dflags)
 		b.minkeypage = DEFMINKEYPAGE;
 		b.prefix = __bt_defpfx;
 		b.psize = 0;
+		b.readahead = 0;
 	}
 
 	/* Check for the ubiquitous PDP-11. */
@@ -177,6 +178,7 @@ __bt_open(fname, flags, mode, openinfo, dflags)
 	t->bt_fd = -1;			/* Don't close unopened fd on error. */
 	t->bt_lorder = b.lorder;
 	t->bt_order = NOT;
+	t->bt_readahead = b.readahead;
 	t->bt_cmp = b.compare;
 	t->bt_pfx = b.prefix;
 	t->bt_rfd = -1;
@@ -288,6 +290,10 @@ __bt_open(fname, flags, mode, openinfo, dflags)
 		if (!(b.flags & R_DUP))
 			F_SET(t, B_NODUPS);
 
+		/* Set flag if leaf pages are prefix compressed. */
+		if (b.flags & R_PFXLEAF)
+			F_SET(t, B_PFXLEAF);
+
 		t->bt_free = P_INVALID;
 		t->bt_nrecs = 0;
 		F_SET(t, B_METADIRTY);
@@ -295,6 +301,10 @@ __bt_open(fname, flags, mode, openinfo, dflags)
 
 	t->bt_psize = b.psize;
 
+	/* Prefix compression depends on the order of bytes. */
+	if (F_ISSET(t, B_PFXLEAF) && t->bt_cmp != __bt_defcmp)
+		goto einval;
+
 	/* Set the cache size; must be a multiple of the page size. */
 	if (b.cachesize && b.cachesize & (b.psize - 1))
 		b.cachesize += (~b.cachesize & (b.psize - 1)) + 1;
@@ -317,6 +327,20 @@ __bt_open(fname, flags, mode, openinfo, dflags)
 	 */
 	t->bt_ovflsize = (t->bt_psize - BTDATAOFF) / b.minkeypage -
 	    (sizeof(indx_t) + NBLEAFDBT(0, 0));
+	/*
+	 * A record moved to the right page in a split may have to hold its
+	 * whole key (bt_split.c).  Leave room for it by limiting the bytes
+	 * a record can share with the previous one.
+	 */
+	if (F_ISSET(t, B_PFXLEAF)) {
+		t->bt_pfxmax = t->bt_ovflsize / 4;
+		t->bt_ovflsize -= LALIGN(t->bt_pfxmax) + PFXSIZE +
+		    sizeof(pgno_t);
+		if ((t->bt_pfxkey.data = malloc(t->bt_psize)) == NULL ||
+		    (t->bt_pfxtmp.data = malloc(t->bt_psize)) == NULL)
+			goto err;
+		t->bt_pfxkey.size = t->bt_pfxtmp.size = t->bt_psize;
+	}
 	if (t->bt_ovflsize < NBLEAFDBT(NOVFLSIZE, NOVFLSIZE) + sizeof(indx_t))
 		t->bt_ovflsize =
 		    NBLEAFDBT(NOVFLSIZE, NOVFLSIZE) + sizeof(indx_t);
@@ -325,8 +349,18 @@ __bt_open(fname, flags, mode, openinfo, dflags)
 	if ((t->bt_mp =
 	    mpool_open(NULL, t->bt_fd, t->bt_psize, ncache)) == NULL)
 		goto err;
+	if (b.flags & R_CACHE2Q &&
+	    mpool_policy(t->bt_mp, MPOOL_2Q) == RET_ERROR)
+		goto err;
 	if (!F_ISSET(t, B_INMEM))
 		mpool_filter(t->bt_mp, __bt_pgin, __bt_pgout, t);
+	/*
+	 * A read only tree in the host byte order can use the pages in the
+	 * mapped file as they are.  If mapping fails, the cache is used.
+	 */
+	if (b.flags & R_MMAP && F_ISSET(t, B_RDONLY) &&
+	    !F_ISSET(t, B_INMEM | B_NEEDSWAP))
+		(void)mpool_mmap(t->bt_mp);
 
 	/* Create a root page if new tree. */
 	if (nroot(t) == RET_ERROR)
@@ -351,6 +385,10 @@ eftype:	errno = EFTYPE;
 err:	if (t) {
 		if (t->bt_dbp)
 			free(t->bt_dbp);
+		if (t->bt_pfxkey.data)
+			free(t->bt_pfxkey.data);
+		if (t->bt_pfxtmp.data)
+			free(t->bt_pfxtmp.data);
 		if (t->bt_fd != -1)
 			(void)close(t->bt_fd);
 		free(t);
@@ -156,6 +156,7 @@ __ovfl_put(t, dbt, pg)
 	    p = (char *)p + plen, last = h) {
 		if ((h = __bt_new(t, &npg)) == NULL)
 			return (RET_ERROR);
+		++t->bt_novflpage;
 
 		h->pgno = npg;
 		h->nextpg = h->prevpg = P_INVALID;
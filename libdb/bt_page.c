@@ -63,6 +63,10 @@ __bt_free(t, h)
 	t->bt_free = h->pgno;
 	F_SET(t, B_METADIRTY);
 
+	/* Don't let the next sorted insert land on a free page. */
+	if (t->bt_order != NOT && t->bt_last.pgno == h->pgno)
+		t->bt_order = NOT;
+
 	/* Make sure the page gets written back. */
 	return (mpool_put(t->bt_mp, h, MPOOL_DIRTY));
 }
@@ -81,7 +81,7 @@ __bt_put(dbp, key, data, flags)
 	indx_t index, nxtindex;
 	pgno_t pg;
 	u_int32_t nbytes;
-	int dflags, exact, status;
+	int dflags, exact, shared, status;
 	char *dest, db[NOVFLSIZE], kb[NOVFLSIZE];
 
 	t = dbp->internal;
@@ -204,8 +204,19 @@ delete:		if (__bt_dleaf(t, key, h, index) == RET_ERROR) {
 	 * insert the key and data and unpin the current page.  If inserting
 	 * into the offset array, shift the pointers up.
 	 */
-	nbytes = NBLEAFDBT(key->size, data->size);
+	shared = -1;
+	if (F_ISSET(t, B_PFXLEAF) && !(dflags & P_BIGKEY)) {
+		if ((shared = __bt_pfxshared(t, h, index, key)) < 0) {
+			mpool_put(t->bt_mp, h, 0);
+			return (RET_ERROR);
+		}
+		nbytes = NBLEAFPFX(shared, key->size, data->size);
+	} else
+		nbytes = NBLEAFDBT(key->size, data->size);
 	if (h->upper - h->lower < nbytes + sizeof(indx_t)) {
+		/* The split puts the record as a restart point. */
+		if (shared > 0)
+			nbytes = NBLEAFPFX(0, key->size, data->size);
 		if ((status = __bt_split(t, h, key,
 		    data, dflags, nbytes, index)) != RET_SUCCESS)
 			return (status);
@@ -219,7 +230,11 @@ delete:		if (__bt_dleaf(t, key, h, index) == RET_ERROR) {
 
 	h->linp[index] = h->upper -= nbytes;
 	dest = (char *)h + h->upper;
-	WR_BLEAF(dest, key, data, dflags);
+	if (shared >= 0) {
+		WR_BLEAFPFX(dest, shared, key, data, dflags);
+		BT_PFXCLR(t);
+	} else
+		WR_BLEAF(dest, key, data, dflags);
 
 	/* If the cursor is on this page, adjust it as necessary. */
 	if (F_ISSET(&t->bt_cursor, CURS_INIT) &&
@@ -285,7 +300,9 @@ bt_fast(t, key, data, exactp)
 	 * If won't fit in this page or have too many keys in this page,
 	 * have to search to get split stack.
 	 */
-	nbytes = NBLEAFDBT(key->size, data->size);
+	nbytes = F_ISSET(t, B_PFXLEAF) ?
+	    NBLEAFPFX(0, key->size, data->size) :
+	    NBLEAFDBT(key->size, data->size);
 	if (h->upper - h->lower < nbytes + sizeof(indx_t))
 		goto miss;
 
@@ -78,6 +78,14 @@ __bt_search(t, key, exactp)
 
 		/* Do a binary search on the current page. */
 		t->bt_cur.page = h;
+		if (h->flags & P_BLEAF && F_ISSET(t, B_PFXLEAF)) {
+			if (__bt_pfxsearch(t, key, &t->bt_cur) == 0) {
+				*exactp = 1;
+				return (&t->bt_cur);
+			}
+			base = t->bt_cur.index;
+			goto leaf;
+		}
 		for (base = 0, lim = NEXTINDEX(h); lim; lim >>= 1) {
 			t->bt_cur.index = index = base + (lim >> 1);
 			if ((cmp = __bt_cmp(t, key, &t->bt_cur)) == 0) {
@@ -102,7 +110,7 @@ __bt_search(t, key, exactp)
 		 * end of a page, check the adjacent page.
 		 */
 		if (h->flags & P_BLEAF) {
-			if (!F_ISSET(t, B_NODUPS)) {
+leaf:			if (!F_ISSET(t, B_NODUPS)) {
 				if (base == 0 &&
 				    h->prevpg != P_INVALID &&
 				    __bt_sprev(t, h, key, exactp))
@@ -132,6 +140,61 @@ next:		BT_PUSH(t, h->pgno, index);
 	}
 }
 
+/**
+ * __bt_pfxsearch --
+ *	Search a prefix compressed leaf page for a key.
+ *
+ *	@param[in] t	tree
+ *	@param[in] key	key to find
+ *	@param[in,out] e	page to search (input), the smallest record
+ *			not less than the key (output)
+ *
+ * @return
+ *	The result of comparing the key with the record, or > 0 if all
+ *	records are less than the key.
+ *
+ * Only restart points are looked at in the binary search, since they
+ * hold their whole key.  The rest is a linear scan from the last restart
+ * point less than the key, building each key from the previous one.
+ */
+int
+__bt_pfxsearch(t, key, e)
+	BTREE *t;
+	const DBT *key;
+	EPG *e;
+{
+	BLEAF *bl;
+	DBT k;
+	PAGE *h;
+	indx_t base, lim, mid, r, top;
+	int cmp;
+
+	h = e->page;
+	top = NEXTINDEX(h);
+	for (base = 0, lim = top; base < lim;) {
+		/* Find a restart point in (base, lim), near the middle. */
+		mid = base + (lim - base) / 2;
+		for (r = mid; r > base && !ISRESTART(GETBLEAF(h, r)); --r)
+			;
+		if (r == base)
+			for (r = mid + 1; r < lim && !ISRESTART(GETBLEAF(h, r)); ++r)
+				;
+		if (r == base || r == lim)
+			break;
+		bl = GETBLEAF(h, r);
+		k.data = bl->bytes + PFXSIZE;
+		k.size = bl->ksize - PFXSIZE;
+		if ((*t->bt_cmp)(key, &k) > 0)
+			base = r + 1;
+		else
+			lim = r;
+	}
+	for (e->index = base; e->index < top; ++e->index)
+		if ((cmp = __bt_cmp(t, key, e)) <= 0)
+			return (cmp);
+	return (1);
+}
+
 /**
  * __bt_snext --
  *	Check for an exact match after the key.
@@ -45,11 +45,17 @@ static char sccsid[] = "@(#)bt_seq.c	8.7 (Berkeley) 7/20/94";
 #ifdef STDC_HEADERS
 #include <stdlib.h>
 #endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
 
 #include "db.h"
 #include "btree.h"
 
 static int __bt_first(BTREE *, const DBT *, EPG *, int *);
+static void __bt_readahead(BTREE *, pgno_t);
 static int __bt_seqadv(BTREE *, EPG *, int);
 static int __bt_seqset(BTREE *, EPG *, DBT *, int);
 
@@ -132,6 +138,96 @@ __bt_seq(dbp, key, data, flags)
 	return (status);
 }
 
+/**
+ * __bt_seqbatch --
+ *	Btree sequential scan interface returning several records at once.
+ *
+ *	@param dbp	pointer to access method
+ *	@param keys	key for positioning and array of key return values
+ *	@param data	array of data return values
+ *	@param np	size of the arrays (input), number of records (output)
+ *	@param flags	R_CURSOR, R_FIRST, R_NEXT.
+ *
+ * @return
+ *	RET_ERROR, RET_SUCCESS or RET_SPECIAL if there's no next key.
+ *
+ * The first record is read as __bt_seq() does.  The following records
+ * are taken from the same leaf page, which stays pinned until the next
+ * call, so they are not copied, except the keys of a prefix compressed
+ * page, which are built in a buffer valid until the next call.  The batch
+ * ends at the end of the page or before a record stored in overflow pages.
+ * The cursor is left on the last record returned.
+ */
+int
+__bt_seqbatch(dbp, keys, data, np, flags)
+	const DB *dbp;
+	DBT *keys, *data;
+	u_int *np;
+	u_int flags;
+{
+	BTREE *t;
+	BLEAF *bl;
+	PAGE *h;
+	indx_t index;
+	size_t size;
+	u_int i, n;
+	int status;
+	char *dest;
+	void *p;
+
+	if (*np == 0 || (flags != R_CURSOR && flags != R_FIRST &&
+	    flags != R_NEXT)) {
+		errno = EINVAL;
+		return (RET_ERROR);
+	}
+	if ((status = __bt_seq(dbp, &keys[0], &data[0], flags)) != RET_SUCCESS) {
+		*np = 0;
+		return (status);
+	}
+	t = dbp->internal;
+	n = 1;
+	if ((h = t->bt_pinned) != NULL) {
+		size = 0;
+		for (index = t->bt_cursor.pg.index;
+		    n < *np && index + 1 < NEXTINDEX(h); n++) {
+			bl = GETBLEAF(h, index + 1);
+			if (bl->flags & (P_BIGKEY | P_BIGDATA))
+				break;
+			index++;
+			keys[n].size = bl->ksize;
+			keys[n].data = bl->bytes;
+			data[n].size = bl->dsize;
+			data[n].data = bl->bytes + bl->ksize;
+			if (F_ISSET(t, B_PFXLEAF))
+				size += GETPFX(bl) + bl->ksize - PFXSIZE;
+		}
+		/* Build the keys of a prefix compressed page in t->bt_rkeys. */
+		if (F_ISSET(t, B_PFXLEAF) && n > 1) {
+			if (size > t->bt_rkeys.size) {
+				p = (void *)(t->bt_rkeys.data == NULL ?
+				    malloc(size) : realloc(t->bt_rkeys.data, size));
+				if (p == NULL)
+					return (RET_ERROR);
+				t->bt_rkeys.data = p;
+				t->bt_rkeys.size = size;
+			}
+			dest = t->bt_rkeys.data;
+			for (i = 1; i < n; i++) {
+				if (__bt_pfxkey(t, h,
+				    t->bt_cursor.pg.index + i, &keys[i]))
+					return (RET_ERROR);
+				memmove(dest, keys[i].data, keys[i].size);
+				keys[i].data = dest;
+				dest += keys[i].size;
+			}
+		}
+		if (n > 1)
+			__bt_setcur(t, h->pgno, index);
+	}
+	*np = n;
+	return (RET_SUCCESS);
+}
+
 /**
  * __bt_seqset --
  *	Set the sequential scan to a specific key.
@@ -284,6 +380,8 @@ __bt_seqadv(t, ep, flags)
 			mpool_put(t->bt_mp, h, 0);
 			if (pg == P_INVALID)
 				return (RET_SPECIAL);
+			if (t->bt_readahead)
+				__bt_readahead(t, pg);
 			if ((h = mpool_get(t->bt_mp, pg, 0)) == NULL)
 				return (RET_ERROR);
 			index = 0;
@@ -320,6 +418,36 @@ usecurrent:		F_CLR(c, CURS_AFTER | CURS_BEFORE);
 	return (RET_SUCCESS);
 }
 
+/**
+ * __BT_READAHEAD -- Request the following leaf pages of a forward scan.
+ *
+ *	@param t	tree
+ *	@param pg	leaf page which the cursor is moving to
+ *
+ * The leaf pages of a tree built by the bulk loader or by sorted writing
+ * are laid out in the file in key order.  While the scan moves to the
+ * physically next page, the next bt_readahead pages are requested, and
+ * the window is renewed when the scan enters its latter half.  A jump
+ * stops reading ahead until the scan becomes sequential again.
+ */
+static void
+__bt_readahead(t, pg)
+	BTREE *t;
+	pgno_t pg;
+{
+	pgno_t start, end;
+
+	if (pg != t->bt_raprev + 1)
+		t->bt_raend = 0;
+	else if (pg + t->bt_readahead / 2 >= t->bt_raend) {
+		start = MAX(pg + 1, t->bt_raend);
+		end = pg + 1 + t->bt_readahead;
+		mpool_advise(t->bt_mp, start, end - start);
+		t->bt_raend = end;
+	}
+	t->bt_raprev = pg;
+}
+
 /**
  * __bt_first --
  *	Find the first entry.
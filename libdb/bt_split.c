@@ -119,8 +119,11 @@ __bt_split(t, sp, key, data, flags, ilen, argskip)
 	dest = (char *)h + h->upper;
 	if (F_ISSET(t, R_RECNO))
 		WR_RLEAF(dest, data, flags)
+	else if (F_ISSET(t, B_PFXLEAF) && !(flags & P_BIGKEY))
+		WR_BLEAFPFX(dest, 0, key, data, flags)
 	else
 		WR_BLEAF(dest, key, data, flags)
+	BT_PFXCLR(t);
 
 	/* If the root page was split, make it look right. */
 	if (sp->pgno == P_ROOT &&
@@ -186,14 +189,21 @@ __bt_split(t, sp, key, data, flags, ilen, argskip)
 			break;
 		case P_BLEAF:
 			bl = GETBLEAF(rchild, 0);
-			nbytes = NBINTERNAL(bl->ksize);
+			BLEAFKEY(t, bl, &b);
+			nbytes = NBINTERNAL(b.size);
 			if (t->bt_pfx && !(bl->flags & P_BIGKEY) &&
 			    (h->prevpg != P_INVALID || skip > 1)) {
 				tbl = GETBLEAF(lchild, NEXTINDEX(lchild) - 1);
-				a.size = tbl->ksize;
-				a.data = tbl->bytes;
-				b.size = bl->ksize;
-				b.data = bl->bytes;
+				if (tbl->flags & P_BIGKEY) {
+					nksize = 0;
+					break;
+				}
+				if (!F_ISSET(t, B_PFXLEAF)) {
+					a.size = tbl->ksize;
+					a.data = tbl->bytes;
+				} else if (__bt_pfxkey(t, lchild,
+				    NEXTINDEX(lchild) - 1, &a))
+					goto err1;
 				nksize = t->bt_pfx(&a, &b);
 				n = NBINTERNAL(nksize);
 				if (n < nbytes) {
@@ -242,9 +252,9 @@ __bt_split(t, sp, key, data, flags, ilen, argskip)
 		case P_BLEAF:
 			h->linp[skip] = h->upper -= nbytes;
 			dest = (char *)h + h->linp[skip];
-			WR_BINTERNAL(dest, nksize ? nksize : bl->ksize,
+			WR_BINTERNAL(dest, nksize ? nksize : b.size,
 			    rchild->pgno, bl->flags & P_BIGKEY);
-			memmove(dest, bl->bytes, nksize ? nksize : bl->ksize);
+			memmove(dest, b.data, nksize ? nksize : b.size);
 			if (bl->flags & P_BIGKEY &&
 			    bt_preserve(t, *(pgno_t *)bl->bytes) == RET_ERROR)
 				goto err1;
@@ -308,6 +318,7 @@ __bt_split(t, sp, key, data, flags, ilen, argskip)
 	/* Unpin the held pages. */
 	mpool_put(t->bt_mp, l, MPOOL_DIRTY);
 	mpool_put(t->bt_mp, r, MPOOL_DIRTY);
+	BT_PFXCLR(t);
 
 	/* Clear any pages left on the stack. */
 	return (RET_SUCCESS);
@@ -322,6 +333,7 @@ err1:	mpool_put(t->bt_mp, lchild, MPOOL_DIRTY);
 
 err2:	mpool_put(t->bt_mp, l, 0);
 	mpool_put(t->bt_mp, r, 0);
+	BT_PFXCLR(t);
 	__dbpanic(t->bt_dbp);
 	return (RET_ERROR);
 }
@@ -352,6 +364,7 @@ bt_page(t, h, lp, rp, skip, ilen)
 #ifdef STATISTICS
 	++bt_split;
 #endif
+	++t->bt_nsplit;
 	/* Put the new right page for the split into place. */
 	if ((r = __bt_new(t, &npg)) == NULL)
 		return (NULL);
@@ -391,6 +404,8 @@ bt_page(t, h, lp, rp, skip, ilen)
 	}
 #ifdef PURIFY
 	memset(l, 0xff, t->bt_psize);
+#else
+	memset(l, 0, t->bt_psize);
 #endif
 	l->pgno = h->pgno;
 	l->nextpg = r->pgno;
@@ -417,7 +432,11 @@ bt_page(t, h, lp, rp, skip, ilen)
 	 * the left page in place.  Since the left page can't change, we have
 	 * to swap the original and the allocated left page after the split.
 	 */
-	tp = bt_psplit(t, h, l, r, skip, ilen);
+	if ((tp = bt_psplit(t, h, l, r, skip, ilen)) == NULL) {
+		free(l);
+		mpool_put(t->bt_mp, r, 0);
+		return (NULL);
+	}
 
 	/* Move the new left page onto the old left page. */
 	memmove(h, l, t->bt_psize);
@@ -457,6 +476,8 @@ bt_root(t, h, lp, rp, skip, ilen)
 	++bt_split;
 	++bt_rootsplit;
 #endif
+	++t->bt_nsplit;
+	++t->bt_nrootsplit;
 	/* Put the new left and right pages for the split into place. */
 	if ((l = __bt_new(t, &lnpg)) == NULL ||
 	    (r = __bt_new(t, &rnpg)) == NULL)
@@ -471,7 +492,11 @@ bt_root(t, h, lp, rp, skip, ilen)
 	l->flags = r->flags = h->flags & P_TYPE;
 
 	/* Split the root page. */
-	tp = bt_psplit(t, h, l, r, skip, ilen);
+	if ((tp = bt_psplit(t, h, l, r, skip, ilen)) == NULL) {
+		mpool_put(t->bt_mp, l, 0);
+		mpool_put(t->bt_mp, r, 0);
+		return (NULL);
+	}
 
 	*lp = l;
 	*rp = r;
@@ -535,6 +560,7 @@ bt_broot(t, h, l, r)
 {
 	BINTERNAL *bi;
 	BLEAF *bl;
+	DBT key;
 	u_int32_t nbytes;
 	char *dest;
 
@@ -554,11 +580,12 @@ bt_broot(t, h, l, r)
 	switch (h->flags & P_TYPE) {
 	case P_BLEAF:
 		bl = GETBLEAF(r, 0);
-		nbytes = NBINTERNAL(bl->ksize);
+		BLEAFKEY(t, bl, &key);
+		nbytes = NBINTERNAL(key.size);
 		h->linp[1] = h->upper -= nbytes;
 		dest = (char *)h + h->upper;
-		WR_BINTERNAL(dest, bl->ksize, r->pgno, 0);
-		memmove(dest, bl->bytes, bl->ksize);
+		WR_BINTERNAL(dest, key.size, r->pgno, 0);
+		memmove(dest, key.data, key.size);
 
 		/*
 		 * If the key is on an overflow page, mark the overflow chain
@@ -602,7 +629,7 @@ bt_broot(t, h, l, r)
  *	@param ilen	insert length
  *
  * @return
- *	Pointer to page in which to insert.
+ *	Pointer to page in which to insert or NULL on error.
  */
 static PAGE *
 bt_psplit(t, h, l, r, pskip, ilen)
@@ -619,7 +646,7 @@ bt_psplit(t, h, l, r, pskip, ilen)
 	void *src = NULL;
 	indx_t full, half, nxt, off, skip, top, used;
 	u_int32_t nbytes;
-	int bigkeycnt, isbigkey;
+	int bigkeycnt, isbigkey, restart;
 
 	/*
 	 * Split the data to the left and right pages.  Leave the skip index
@@ -729,6 +756,7 @@ bt_psplit(t, h, l, r, pskip, ilen)
 		*pskip -= nxt;
 	}
 
+	restart = F_ISSET(t, B_PFXLEAF);
 	for (off = 0; nxt < top; ++off) {
 		if (skip == nxt) {
 			++off;
@@ -742,6 +770,18 @@ bt_psplit(t, h, l, r, pskip, ilen)
 		case P_BLEAF:
 			src = bl = GETBLEAF(h, nxt);
 			nbytes = NBLEAF(bl);
+			/*
+			 * The first key on a prefix compressed page must
+			 * be whole, since the previous key is left behind.
+			 */
+			if (restart && !(bl->flags & P_BIGKEY)) {
+				restart = 0;
+				if (GETPFX(bl) > 0) {
+					if (__bt_pfxrecode(t, h, nxt, 0, &nbytes))
+						return (NULL);
+					src = t->bt_pfxtmp.data;
+				}
+			}
 			break;
 		case P_RINTERNAL:
 			src = GETRINTERNAL(h, nxt);
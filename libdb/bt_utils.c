@@ -37,6 +37,7 @@ static char sccsid[] = "@(#)bt_utils.c	8.8 (Berkeley) 7/20/94";
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
+#include <errno.h>
 #include <stdio.h>
 #ifdef STDC_HEADERS
 #include <stdlib.h>
@@ -73,6 +74,7 @@ __bt_ret(t, e, key, rkey, data, rdata, copy)
 	int copy;
 {
 	BLEAF *bl;
+	DBT pkey;
 	void *p;
 
 	bl = GETBLEAF(e->page, e->index);
@@ -90,6 +92,21 @@ __bt_ret(t, e, key, rkey, data, rdata, copy)
 		    &key->size, &rkey->data, &rkey->size))
 			return (RET_ERROR);
 		key->data = rkey->data;
+	} else if (F_ISSET(t, B_PFXLEAF)) {
+		/* The key is built in a buffer shared by the tree; copy it. */
+		if (__bt_pfxkey(t, e->page, e->index, &pkey))
+			return (RET_ERROR);
+		if (pkey.size > rkey->size) {
+			p = (void *)(rkey->data == NULL ?
+			    malloc(pkey.size) : realloc(rkey->data, pkey.size));
+			if (p == NULL)
+				return (RET_ERROR);
+			rkey->data = p;
+			rkey->size = pkey.size;
+		}
+		memmove(rkey->data, pkey.data, pkey.size);
+		key->size = pkey.size;
+		key->data = rkey->data;
 	} else if (copy || F_ISSET(t, B_DB_LOCK)) {
 		if (bl->ksize > rkey->size) {
 			p = (void *)(rkey->data == NULL ?
@@ -178,7 +195,10 @@ __bt_cmp(t, k1, e)
 		bl = GETBLEAF(h, e->index);
 		if (bl->flags & P_BIGKEY)
 			bigkey = bl->bytes;
-		else {
+		else if (F_ISSET(t, B_PFXLEAF)) {
+			if (__bt_pfxkey(t, h, e->index, &k2))
+				return (RET_ERROR);
+		} else {
 			k2.data = bl->bytes;
 			k2.size = bl->ksize;
 		}
@@ -257,3 +277,211 @@ __bt_defpfx(a, b)
 	/* a->size must be <= b->size, or they wouldn't be in this order. */
 	return (a->size < b->size ? a->size + 1 : a->size);
 }
+
+/**
+ * __BT_PFXKEY -- Build a key of a prefix compressed leaf page.
+ *
+ *	@param t	tree
+ *	@param h	leaf page
+ *	@param index	index of a record whose key is not on overflow pages
+ *	@param key	key (output)
+ *
+ * @return
+ *	RET_ERROR, RET_SUCCESS.
+ *
+ * The key is built in t->bt_pfxkey, and is valid until the next call.
+ * Walking forward from the key built last time saves work when records
+ * are read in order.
+ */
+int
+__bt_pfxkey(t, h, index, key)
+	BTREE *t;
+	PAGE *h;
+	indx_t index;
+	DBT *key;
+{
+	BLEAF *bl;
+	indx_t i;
+	u_int32_t len, shared, size;
+	void *p;
+
+	/* Find the built key or the nearest restart point at or before index. */
+	for (i = index;; --i) {
+		if (t->bt_pfxpg == h->pgno && t->bt_pfxindex == i) {
+			len = t->bt_pfxksize;
+			++i;
+			break;
+		}
+		bl = GETBLEAF(h, i);
+		if (ISRESTART(bl)) {
+			len = 0;
+			break;
+		}
+		if (i == 0)
+			goto corrupt;
+	}
+	for (; i <= index; ++i) {
+		bl = GETBLEAF(h, i);
+		if (bl->flags & P_BIGKEY)
+			continue;
+		shared = GETPFX(bl);
+		if (shared > len || bl->ksize < PFXSIZE)
+			goto corrupt;
+		size = shared + bl->ksize - PFXSIZE;
+		if (size > t->bt_pfxkey.size) {
+			p = (void *)(t->bt_pfxkey.data == NULL ?
+			    malloc(size) : realloc(t->bt_pfxkey.data, size));
+			if (p == NULL) {
+				BT_PFXCLR(t);
+				return (RET_ERROR);
+			}
+			t->bt_pfxkey.data = p;
+			t->bt_pfxkey.size = size;
+		}
+		memmove((char *)t->bt_pfxkey.data + shared,
+		    bl->bytes + PFXSIZE, bl->ksize - PFXSIZE);
+		len = size;
+	}
+	t->bt_pfxpg = h->pgno;
+	t->bt_pfxindex = index;
+	t->bt_pfxksize = len;
+	key->data = t->bt_pfxkey.data;
+	key->size = len;
+	return (RET_SUCCESS);
+corrupt:
+	BT_PFXCLR(t);
+	errno = EFTYPE;
+	return (RET_ERROR);
+}
+
+/**
+ * __BT_PFXRECODE -- Make a record share fewer bytes with the previous one.
+ *
+ *	@param t	tree
+ *	@param h	leaf page
+ *	@param index	index of a record whose key is not on overflow pages
+ *	@param shared	number of the bytes to share (not more than now)
+ *	@param nbytesp	size of the new record (output)
+ *
+ * @return
+ *	RET_ERROR, RET_SUCCESS.
+ *
+ * The new record is built in t->bt_pfxtmp.  The page is not changed.
+ */
+int
+__bt_pfxrecode(t, h, index, shared, nbytesp)
+	BTREE *t;
+	PAGE *h;
+	indx_t index;
+	u_int32_t shared;
+	u_int32_t *nbytesp;
+{
+	BLEAF *bl;
+	DBT k, d, *key, *data;
+	char *dest;
+
+	key = &k;
+	data = &d;
+	if (__bt_pfxkey(t, h, index, key))
+		return (RET_ERROR);
+	bl = GETBLEAF(h, index);
+	data->data = bl->bytes + bl->ksize;
+	data->size = bl->dsize;
+	*nbytesp = NBLEAFPFX(shared, key->size, data->size);
+	if (*nbytesp > t->bt_pfxtmp.size) {
+		errno = EFTYPE;
+		return (RET_ERROR);
+	}
+	dest = t->bt_pfxtmp.data;
+	WR_BLEAFPFX(dest, shared, key, data, bl->flags);
+	return (RET_SUCCESS);
+}
+
+/**
+ * __BT_PFXSHARED -- Decide how much a new key shares with the previous one.
+ *
+ *	@param t	tree
+ *	@param h	leaf page
+ *	@param index	index at which the key is to be inserted
+ *	@param key	key
+ *
+ * @return
+ *	Number of the bytes to share, or -1 on error.
+ *
+ * Nothing is shared at the start of a page, or when there has been no
+ * restart point in the last BT_PFXRESTART records, which makes the new
+ * record a restart point.
+ */
+int
+__bt_pfxshared(t, h, index, key)
+	BTREE *t;
+	PAGE *h;
+	indx_t index;
+	const DBT *key;
+{
+	BLEAF *bl;
+	DBT prev;
+	indx_t i;
+	u_char *p1, *p2;
+	u_int32_t len, shared;
+	int run;
+
+	/* Count the records back to the restart point. */
+	run = 0;
+	for (i = index; i > 0; --i) {
+		bl = GETBLEAF(h, i - 1);
+		if (bl->flags & P_BIGKEY)
+			continue;
+		if (++run >= BT_PFXRESTART)
+			return (0);
+		if (ISRESTART(bl))
+			break;
+	}
+	if (run == 0)
+		return (0);
+	/* Build the key of the previous record. */
+	for (i = index; GETBLEAF(h, i - 1)->flags & P_BIGKEY; --i)
+		;
+	if (__bt_pfxkey(t, h, i - 1, &prev))
+		return (-1);
+	len = MIN(prev.size, key->size);
+	if (len > t->bt_pfxmax)
+		len = t->bt_pfxmax;
+	for (shared = 0, p1 = prev.data, p2 = key->data;
+	    shared < len && *p1 == *p2; ++shared, ++p1, ++p2)
+		;
+	return (shared);
+}
+
+/**
+ * __BT_CACHESTAT -- Get the statistics of the buffer pool and the tree.
+ *
+ *	@param dbp	pointer to access method
+ *	@param st	statistics (output)
+ *
+ * @return RET_SUCCESS
+ */
+int
+__bt_cachestat(dbp, st)
+	const DB *dbp;
+	DBCACHESTAT *st;
+{
+	BTREE *t;
+	MPOOL *mp;
+
+	t = dbp->internal;
+	mp = t->bt_mp;
+	st->cachehit = mp->cachehit;
+	st->cachemiss = mp->cachemiss;
+	st->mapget = mp->mapget;
+	st->pageread = mp->pageread;
+	st->pagewrite = mp->pagewrite;
+	st->curcache = mp->curcache;
+	st->maxcache = mp->maxcache;
+	st->npages = mp->npages;
+	st->psize = t->bt_psize;
+	st->split = t->bt_nsplit;
+	st->rootsplit = t->bt_nrootsplit;
+	st->ovflpage = t->bt_novflpage;
+	return (RET_SUCCESS);
+}
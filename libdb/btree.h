@@ -215,6 +215,58 @@ typedef struct _bleaf {
 	memmove(p, data->data, data->size);				\
 }
 
+/**
+ * Prefix compressed leaf pages (B_PFXLEAF).  The key of a BLEAF begins with
+ * the number of bytes it shares with the key of the previous record (2 bytes,
+ * big endian), followed by the rest of the key, and ksize includes the count.
+ * Records whose key is on overflow pages are stored as usual, and the records
+ * around them are coded as if they were not there.  A record which shares
+ * nothing holds its whole key and is a restart point: binary search looks at
+ * them only, and a key is built by walking forward from the nearest one.
+ * The first such record of each page is always a restart point, and a new
+ * restart point is put every BT_PFXRESTART records.
+ */
+#define	PFXSIZE		2
+#define	PFXMAX		0xffff
+#define	BT_PFXRESTART	16
+
+/** Get the number of key bytes shared with the previous record. */
+#define	GETPFX(bl)							\
+	(((u_char *)(bl)->bytes)[0] << 8 | ((u_char *)(bl)->bytes)[1])
+
+/** Whether the record holds its whole key (not a big key). */
+#define	ISRESTART(bl)	(!((bl)->flags & P_BIGKEY) && GETPFX(bl) == 0)
+
+/** Get the number of bytes in a record sharing shared bytes of the key. */
+#define	NBLEAFPFX(shared, ksize, dsize)					\
+	NBLEAFDBT(PFXSIZE + (ksize) - (shared), (dsize))
+
+/** Copy a BLEAF entry sharing shared bytes of the key to the page. */
+#define	WR_BLEAFPFX(p, shared, key, data, flags) {			\
+	*(u_int32_t *)p = PFXSIZE + key->size - (shared);		\
+	p += sizeof(u_int32_t);						\
+	*(u_int32_t *)p = data->size;					\
+	p += sizeof(u_int32_t);						\
+	*(u_char *)p = flags;						\
+	p += sizeof(u_char);						\
+	*(u_char *)p++ = (shared) >> 8;					\
+	*(u_char *)p++ = (shared) & 0xff;				\
+	memmove(p, (char *)key->data + (shared), key->size - (shared));	\
+	p += key->size - (shared);					\
+	memmove(p, data->data, data->size);				\
+}
+
+/** Get the key of a BLEAF holding its whole key or a big key reference. */
+#define	BLEAFKEY(t, bl, k) {						\
+	if (F_ISSET(t, B_PFXLEAF) && !((bl)->flags & P_BIGKEY)) {	\
+		(k)->data = (bl)->bytes + PFXSIZE;			\
+		(k)->size = (bl)->ksize - PFXSIZE;			\
+	} else {							\
+		(k)->data = (bl)->bytes;				\
+		(k)->size = (bl)->ksize;				\
+	}								\
+}
+
 /** For the recno leaf pages, the item is a data entry. */
 typedef struct _rleaf {
 	u_int32_t	dsize;		/**< size of data */
@@ -316,10 +368,29 @@ typedef struct _btmeta {
 	u_int32_t	free;		/**< page number of first free page */
 	u_int32_t	nrecs;		/**< R: number of records */
 
-#define	SAVEMETA	(B_NODUPS | R_RECNO)
+#define	SAVEMETA	(B_NODUPS | R_RECNO | B_PFXLEAF)
 	u_int32_t	flags;		/**< bt_flags & SAVEMETA */
 } BTMETA;
 
+/** Maximum levels of a tree built by the bulk loader (bt_bulk.c) */
+#define	BT_BULKMAXLEVEL	50
+
+/** Default fill factor of the bulk loader (percent) */
+#define	BT_BULKFILL	100
+
+/** The state of bulk loading. */
+typedef struct _btbulk {
+	int	  fill;			/**< fill factor (percent) */
+	u_int32_t limit;		/**< bytes to fill in a page */
+	int	  nlevels;		/**< number of levels */
+	PAGE	 *cur[BT_BULKMAXLEVEL];	/**< current (pinned) page of each level */
+	DBT	  lastkey;		/**< last key put */
+	size_t	  lastkeyalloc;		/**< allocated size of lastkey.data */
+	int	  empty;		/**< no record is put yet */
+	int	  pfxrun;		/**< records since the last restart point,
+					     0: the next one must be a restart point */
+} BTBULK;
+
 /** The in-memory btree/recno data structure. */
 typedef struct _btree {
 	MPOOL	 *bt_mp;		/**< memory pool cookie */
@@ -330,6 +401,7 @@ typedef struct _btree {
 	PAGE	 *bt_pinned;		/**< page pinned across calls */
 
 	CURSOR	  bt_cursor;		/**< cursor */
+	BTBULK	 *bt_bulk;		/**< bulk loading or NULL */
 
 #define	BT_PUSH(t, p, i) {						\
 	t->bt_sp->pgno = p; 						\
@@ -343,6 +415,15 @@ typedef struct _btree {
 
 	DBT	  bt_rkey;		/**< returned key */
 	DBT	  bt_rdata;		/**< returned data */
+	DBT	  bt_rkeys;		/**< keys returned by __bt_seqbatch() */
+
+	DBT	  bt_pfxkey;		/**< B: key built from a B_PFXLEAF page */
+	u_int32_t bt_pfxksize;		/**< B: size of the key */
+	u_int32_t bt_pfxmax;		/**< B: maximum bytes to share */
+	pgno_t	  bt_pfxpg;		/**< B: page of the key or P_INVALID */
+	indx_t	  bt_pfxindex;		/**< B: index of the key */
+	DBT	  bt_pfxtmp;		/**< B: working area for a record */
+#define	BT_PFXCLR(t)	((t)->bt_pfxpg = P_INVALID)
 
 	int	  bt_fd;		/**< tree file descriptor */
 
@@ -353,6 +434,12 @@ typedef struct _btree {
 					/** sorted order */
 	enum { NOT, BACK, FORWARD } bt_order;
 	EPGNO	  bt_last;		/**< last insert */
+	pgno_t	  bt_readahead;		/**< pages to read ahead (0: none) */
+	pgno_t	  bt_raprev;		/**< last leaf page of a forward scan */
+	pgno_t	  bt_raend;		/**< end of the readahead window */
+	u_long	  bt_nsplit;		/**< pages split */
+	u_long	  bt_nrootsplit;	/**< root pages split */
+	u_long	  bt_novflpage;		/**< overflow pages written */
 
 					/** B: key comparison function */
 	int	(*bt_cmp)(const DBT *, const DBT *);
@@ -375,7 +462,7 @@ typedef struct _btree {
 
 /*
  * NB:
- * B_NODUPS and R_RECNO are stored on disk, and may not be changed.
+ * B_NODUPS, R_RECNO and B_PFXLEAF are stored on disk, and may not be changed.
  */
 		/** in-memory tree */
 #define	B_INMEM		0x00001
@@ -417,6 +504,10 @@ typedef struct _btree {
 #define	B_DB_SHMEM	0x08000
 		/** DB_TXN specified. */
 #define	B_DB_TXN	0x10000
+
+/** prefix compressed leaf pages.
+    [Note] B_PFXLEAF is stored on disk, and may not be changed. */
+#define	B_PFXLEAF	0x20000
 	u_int32_t flags;
 } BTREE;
 
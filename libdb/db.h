@@ -141,6 +141,12 @@ typedef struct __db {
 #define	BTREEVERSION	3
 		/** duplicate keys */
 #define	R_DUP		0x01
+		/** scan resistant cache (2Q) */
+#define	R_CACHE2Q	0x02
+		/** map the file if opened read only */
+#define	R_MMAP		0x04
+		/** prefix compressed leaf pages (new tree only) */
+#define	R_PFXLEAF	0x08
 
 /** Structure used to pass parameters to the btree routines. */
 typedef struct {
@@ -154,8 +160,25 @@ typedef struct {
 	size_t	(*prefix)	/**< prefix function */
 	   (const DBT *, const DBT *);
 	int	lorder;		/**< byte order */
+	u_int	readahead;	/**< pages to read ahead in a forward scan */
 } BTREEINFO;
 
+/** Statistics of the buffer pool and the tree, which are always counted. */
+typedef struct {
+	u_long	cachehit;	/**< pages found in the cache */
+	u_long	cachemiss;	/**< pages not found in the cache */
+	u_long	mapget;		/**< pages got from the mapping */
+	u_long	pageread;	/**< pages read from the file */
+	u_long	pagewrite;	/**< pages written to the file */
+	pgno_t	curcache;	/**< current number of cached pages */
+	pgno_t	maxcache;	/**< max number of cached pages */
+	pgno_t	npages;		/**< pages in the file */
+	u_int	psize;		/**< page size */
+	u_long	split;		/**< pages split */
+	u_long	rootsplit;	/**< root pages split */
+	u_long	ovflpage;	/**< overflow pages written */
+} DBCACHESTAT;
+
 #define	HASHMAGIC	0x061561
 #define	HASHVERSION	2
 
@@ -239,6 +262,13 @@ typedef struct {
 DB	*dbopen(const char *, int, int, DBTYPE, const void *);
 
 DB	*__bt_open(const char *, int, int, const BTREEINFO *, int);
+int	 __bt_bulk_open(const DB *, int);
+int	 __bt_bulk_put(const DB *, const DBT *, const DBT *);
+int	 __bt_bulk_close(const DB *);
+int	 __bt_bulk_delete(const DB *, const DBT *, const DBT *,
+	    int (*)(const DBT *, const DBT *, void *), void *);
+int	 __bt_cachestat(const DB *, DBCACHESTAT *);
+int	 __bt_seqbatch(const DB *, DBT *, DBT *, u_int *, u_int);
 DB	*__hash_open(const char *, int, int, const HASHINFO *, int);
 DB	*__rec_open(const char *, int, int, const RECNOINFO *, int);
 void	 __dbpanic(DB *dbp);
@@ -42,6 +42,10 @@ int	 __bt_get(const DB *, const DBT *, DBT *, u_int);
 PAGE	*__bt_new(BTREE *, pgno_t *);
 void	 __bt_pgin(void *, pgno_t, void *);
 void	 __bt_pgout(void *, pgno_t, void *);
+int	 __bt_pfxkey(BTREE *, PAGE *, indx_t, DBT *);
+int	 __bt_pfxrecode(BTREE *, PAGE *, indx_t, u_int32_t, u_int32_t *);
+int	 __bt_pfxsearch(BTREE *, const DBT *, EPG *);
+int	 __bt_pfxshared(BTREE *, PAGE *, indx_t, const DBT *);
 int	 __bt_push(BTREE *, pgno_t, int);
 int	 __bt_put(const DB *dbp, DBT *, const DBT *, u_int);
 int	 __bt_ret(BTREE *, EPG *, DBT *, DBT *, DBT *, DBT *, int);
@@ -37,6 +37,7 @@ static char sccsid[] = "@(#)mpool.c	8.5 (Berkeley) 7/26/94";
 #include <sys/stat.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #ifdef STDC_HEADERS
 #include <stdlib.h>
@@ -49,6 +50,9 @@ static char sccsid[] = "@(#)mpool.c	8.5 (Berkeley) 7/26/94";
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #if (defined(_WIN32) && !defined(__CYGWIN__))
 #define fsync _commit
@@ -62,6 +66,9 @@ static char sccsid[] = "@(#)mpool.c	8.5 (Berkeley) 7/26/94";
 
 static BKT *mpool_bkt(MPOOL *);
 static BKT *mpool_look(MPOOL *, pgno_t);
+static void mpool_enqueue(MPOOL *, BKT *);
+static BKT *mpool_victim(MPOOL *, struct _lqh *);
+static void mpool_ghost(MPOOL *, pgno_t);
 static int  mpool_write(MPOOL *, BKT *);
 
 /**
@@ -81,7 +88,7 @@ mpool_open(key, fd, pagesize, maxcache)
 {
 	struct stat sb;
 	MPOOL *mp;
-	int entry;
+	pgno_t entry, hashsize;
 
 	/*
 	 * Get information about the file.
@@ -100,8 +107,21 @@ mpool_open(key, fd, pagesize, maxcache)
 	if ((mp = (MPOOL *)calloc(1, sizeof(MPOOL))) == NULL)
 		return (NULL);
 	CIRCLEQ_INIT(&mp->lqh);
-	for (entry = 0; entry < HASHSIZE; ++entry)
+	CIRCLEQ_INIT(&mp->a1qh);
+	CIRCLEQ_INIT(&mp->gqh);
+	CIRCLEQ_INIT(&mp->gfqh);
+	/* The number of hash queues grows with the cache size. */
+	for (hashsize = HASHSIZE; hashsize < maxcache && hashsize < 0x40000000;
+	    hashsize <<= 1)
+		;
+	if ((mp->hqh = malloc(hashsize * sizeof(mp->hqh[0]))) == NULL) {
+		free(mp);
+		return (NULL);
+	}
+	for (entry = 0; entry < hashsize; ++entry)
 		CIRCLEQ_INIT(&mp->hqh[entry]);
+	mp->hashmask = hashsize - 1;
+	mp->policy = MPOOL_LRU;
 	mp->maxcache = maxcache;
 	mp->npages = sb.st_size / pagesize;
 	mp->pagesize = pagesize;
@@ -129,7 +149,127 @@ mpool_filter(mp, pgin, pgout, pgcookie)
 	mp->pgout = pgout;
 	mp->pgcookie = pgcookie;
 }
+
+/**
+ * mpool_policy --
+ *	Select the page replacement policy.
+ *
+ *	@param mp
+ *	@param policy	MPOOL_LRU or MPOOL_2Q
+ *
+ * It must be called before getting any page.
+ */
+int
+mpool_policy(mp, policy)
+	MPOOL *mp;
+	int policy;
+{
+	pgno_t entry, nghost;
+
+	if (mp->curcache != 0 || mp->ghost != NULL) {
+		errno = EINVAL;
+		return (RET_ERROR);
+	}
+	if (policy == MPOOL_2Q) {
+		/*
+		 * The sizes recommended by the authors: A1in holds 25% of
+		 * the cache, and A1out remembers as many pages as 50%.
+		 */
+		mp->a1max = mp->maxcache / 4;
+		if (mp->a1max == 0)
+			mp->a1max = 1;
+		nghost = mp->maxcache / 2;
+		if (nghost == 0)
+			nghost = 1;
+		if ((mp->ghost = malloc(nghost * sizeof(GHOST))) == NULL)
+			return (RET_ERROR);
+		if ((mp->ghqh = malloc((mp->hashmask + 1) * sizeof(mp->ghqh[0]))) == NULL) {
+			free(mp->ghost);
+			mp->ghost = NULL;
+			return (RET_ERROR);
+		}
+		for (entry = 0; entry <= mp->hashmask; ++entry)
+			CIRCLEQ_INIT(&mp->ghqh[entry]);
+		for (entry = 0; entry < nghost; ++entry)
+			CIRCLEQ_INSERT_TAIL(&mp->gfqh, &mp->ghost[entry], q);
+	} else if (policy != MPOOL_LRU) {
+		errno = EINVAL;
+		return (RET_ERROR);
+	}
+	mp->policy = policy;
+	return (RET_SUCCESS);
+}
 	
+/**
+ * mpool_mmap --
+ *	Map the file to read pages directly from the mapping.
+ *
+ *	@param mp
+ *
+ * It must be called before getting any page.  The pool must be used
+ * for reading only, and the page in filter must do nothing, because the
+ * pages are mapped read only.
+ */
+int
+mpool_mmap(mp)
+	MPOOL *mp;
+{
+#ifdef HAVE_MMAP
+	void *map;
+	size_t size;
+
+	if (mp->curcache != 0 || mp->map != NULL || mp->npages == 0) {
+		errno = EINVAL;
+		return (RET_ERROR);
+	}
+	size = (size_t)mp->npages * mp->pagesize;
+	map = mmap(NULL, size, PROT_READ, MAP_SHARED, mp->fd, (off_t)0);
+	if (map == MAP_FAILED)
+		return (RET_ERROR);
+	mp->map = map;
+	mp->mapsize = size;
+	return (RET_SUCCESS);
+#else
+	errno = ENOSYS;
+	return (RET_ERROR);
+#endif
+}
+
+/**
+ * mpool_advise --
+ *	Tell the system that pages will be needed soon.
+ *
+ *	@param mp
+ *	@param pgno	first page
+ *	@param npages	number of pages
+ *
+ * The system may start reading them in the background.  It is only a hint.
+ */
+void
+mpool_advise(mp, pgno, npages)
+	MPOOL *mp;
+	pgno_t pgno, npages;
+{
+	off_t off;
+	size_t len;
+
+	if (pgno >= mp->npages || npages == 0)
+		return;
+	if (npages > mp->npages - pgno)
+		npages = mp->npages - pgno;
+	off = (off_t)mp->pagesize * pgno;
+	len = (size_t)mp->pagesize * npages;
+	if (mp->map != NULL) {
+#if defined(HAVE_MMAP) && defined(HAVE_MADVISE)
+		(void)madvise((char *)mp->map + off, len, MADV_WILLNEED);
+#endif
+		return;
+	}
+#ifdef HAVE_POSIX_FADVISE
+	(void)posix_fadvise(mp->fd, off, (off_t)len, POSIX_FADV_WILLNEED);
+#endif
+}
+
 /**
  * mpool_new --
  *	Get a new page of memory.
@@ -149,9 +289,7 @@ mpool_new(mp, pgnoaddr)
 		(void)fprintf(stderr, "mpool_new: page allocation overflow.\n");
 		abort();
 	}
-#ifdef STATISTICS
 	++mp->pagenew;
-#endif
 	/*
 	 * Get a BKT from the cache.  Assign a new page number, attach
 	 * it to the head of the hash chain, the tail of the lru chain,
@@ -161,10 +299,15 @@ mpool_new(mp, pgnoaddr)
 		return (NULL);
 	*pgnoaddr = bp->pgno = mp->npages++;
 	bp->flags = MPOOL_PINNED;
+	/*
+	 * Clear the page not to write garbage into the unused area.
+	 * It makes the file reproducible.
+	 */
+	memset(bp->page, 0, mp->pagesize);
 
-	head = &mp->hqh[HASHKEY(bp->pgno)];
+	head = &mp->hqh[HASHKEY(mp, bp->pgno)];
 	CIRCLEQ_INSERT_HEAD(head, bp, hq);
-	CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+	mpool_enqueue(mp, bp);
 	return (bp->page);
 }
 
@@ -193,9 +336,13 @@ mpool_get(mp, pgno, flags)
 		return (NULL);
 	}
 
-#ifdef STATISTICS
 	++mp->pageget;
-#endif
+
+	/* Return a page in the mapping. */
+	if (mp->map != NULL) {
+		++mp->mapget;
+		return ((char *)mp->map + mp->pagesize * pgno);
+	}
 
 	/* Check for a page that is cached. */
 	if ((bp = mpool_look(mp, pgno)) != NULL) {
@@ -208,13 +355,16 @@ mpool_get(mp, pgno, flags)
 #endif
 		/*
 		 * Move the page to the head of the hash chain and the tail
-		 * of the lru chain.
+		 * of the lru chain.  A page on the A1in queue stays there;
+		 * a correlated reference does not make the page hot.
 		 */
-		head = &mp->hqh[HASHKEY(bp->pgno)];
+		head = &mp->hqh[HASHKEY(mp, bp->pgno)];
 		CIRCLEQ_REMOVE(head, bp, hq);
 		CIRCLEQ_INSERT_HEAD(head, bp, hq);
-		CIRCLEQ_REMOVE(&mp->lqh, bp, q);
-		CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+		if (!(bp->flags & MPOOL_A1IN)) {
+			CIRCLEQ_REMOVE(&mp->lqh, bp, q);
+			CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+		}
 
 		/* Return a pinned page. */
 		bp->flags |= MPOOL_PINNED;
@@ -226,9 +376,7 @@ mpool_get(mp, pgno, flags)
 		return (NULL);
 
 	/* Read in the contents. */
-#ifdef STATISTICS
 	++mp->pageread;
-#endif
 	off = mp->pagesize * pgno;
 #ifdef HAVE_PREAD
 	if ((nr = pread(mp->fd, bp->page, mp->pagesize, off)) != mp->pagesize) {
@@ -254,9 +402,9 @@ mpool_get(mp, pgno, flags)
 	 * Add the page to the head of the hash chain and the tail
 	 * of the lru chain.
 	 */
-	head = &mp->hqh[HASHKEY(bp->pgno)];
+	head = &mp->hqh[HASHKEY(mp, bp->pgno)];
 	CIRCLEQ_INSERT_HEAD(head, bp, hq);
-	CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+	mpool_enqueue(mp, bp);
 
 	/* Run through the user's filter. */
 	if (mp->pgin != NULL)
@@ -281,9 +429,9 @@ mpool_put(mp, page, flags)
 {
 	BKT *bp;
 
-#ifdef STATISTICS
 	++mp->pageput;
-#endif
+	if (mp->map != NULL)
+		return (RET_SUCCESS);
 	bp = (BKT *)((char *)page - sizeof(BKT));
 #ifdef DEBUG
 	if (!(bp->flags & MPOOL_PINNED)) {
@@ -314,8 +462,22 @@ mpool_close(mp)
 		CIRCLEQ_REMOVE(&mp->lqh, mp->lqh.cqh_first, q);
 		free(bp);
 	}
+	while ((bp = mp->a1qh.cqh_first) != (void *)&mp->a1qh) {
+		CIRCLEQ_REMOVE(&mp->a1qh, mp->a1qh.cqh_first, q);
+		free(bp);
+	}
+
+#ifdef HAVE_MMAP
+	if (mp->map != NULL)
+		(void)munmap(mp->map, mp->mapsize);
+#endif
 
 	/* Free the MPOOL cookie. */
+	if (mp->ghost != NULL) {
+		free(mp->ghost);
+		free(mp->ghqh);
+	}
+	free(mp->hqh);
 	free(mp);
 	return (RET_SUCCESS);
 }
@@ -332,7 +494,12 @@ mpool_sync(mp)
 {
 	BKT *bp;
 
-	/* Walk the lru chain, flushing any dirty pages to disk. */
+	/* Walk the lru chains, flushing any dirty pages to disk. */
+	for (bp = mp->a1qh.cqh_first;
+	    bp != (void *)&mp->a1qh; bp = bp->q.cqe_next)
+		if (bp->flags & MPOOL_DIRTY &&
+		    mpool_write(mp, bp) == RET_ERROR)
+			return (RET_ERROR);
 	for (bp = mp->lqh.cqh_first;
 	    bp != (void *)&mp->lqh; bp = bp->q.cqe_next)
 		if (bp->flags & MPOOL_DIRTY &&
@@ -365,36 +532,45 @@ mpool_bkt(mp)
 	 * can flush.  If we find one, write it (if necessary) and take it
 	 * off any lists.  If we don't find anything we grow the cache anyway.
 	 * The cache never shrinks.
+	 *
+	 * With MPOOL_2Q, a page is taken from the A1in queue while it is
+	 * larger than its share, and otherwise from the Am queue.
 	 */
-	for (bp = mp->lqh.cqh_first;
-	    bp != (void *)&mp->lqh; bp = bp->q.cqe_next)
-		if (!(bp->flags & MPOOL_PINNED)) {
-			/* Flush if dirty. */
-			if (bp->flags & MPOOL_DIRTY &&
-			    mpool_write(mp, bp) == RET_ERROR)
-				return (NULL);
-#ifdef STATISTICS
-			++mp->pageflush;
-#endif
-			/* Remove from the hash and lru queues. */
-			head = &mp->hqh[HASHKEY(bp->pgno)];
-			CIRCLEQ_REMOVE(head, bp, hq);
+	if (mp->policy == MPOOL_2Q && mp->a1cur > mp->a1max) {
+		if ((bp = mpool_victim(mp, &mp->a1qh)) == NULL)
+			bp = mpool_victim(mp, &mp->lqh);
+	} else {
+		if ((bp = mpool_victim(mp, &mp->lqh)) == NULL)
+			bp = mpool_victim(mp, &mp->a1qh);
+	}
+	if (bp != NULL) {
+		/* Flush if dirty. */
+		if (bp->flags & MPOOL_DIRTY &&
+		    mpool_write(mp, bp) == RET_ERROR)
+			return (NULL);
+		++mp->pageflush;
+		/* Remove from the hash and lru queues. */
+		head = &mp->hqh[HASHKEY(mp, bp->pgno)];
+		CIRCLEQ_REMOVE(head, bp, hq);
+		if (bp->flags & MPOOL_A1IN) {
+			CIRCLEQ_REMOVE(&mp->a1qh, bp, q);
+			--mp->a1cur;
+			mpool_ghost(mp, bp->pgno);
+		} else
 			CIRCLEQ_REMOVE(&mp->lqh, bp, q);
 #ifdef DEBUG
-			{ void *spage;
-				spage = bp->page;
-				memset(bp, 0xff, sizeof(BKT) + mp->pagesize);
-				bp->page = spage;
-			}
-#endif
-			return (bp);
+		{ void *spage;
+			spage = bp->page;
+			memset(bp, 0xff, sizeof(BKT) + mp->pagesize);
+			bp->page = spage;
 		}
+#endif
+		return (bp);
+	}
 
 new:	if ((bp = (BKT *)malloc(sizeof(BKT) + mp->pagesize)) == NULL)
 		return (NULL);
-#ifdef STATISTICS
 	++mp->pagealloc;
-#endif
 #if defined(DEBUG) || defined(PURIFY)
 	memset(bp, 0xff, sizeof(BKT) + mp->pagesize);
 #endif
@@ -417,9 +593,7 @@ mpool_write(mp, bp)
 {
 	off_t off;
 
-#ifdef STATISTICS
 	++mp->pagewrite;
-#endif
 
 	/* Run through the user's filter. */
 	if (mp->pgout)
@@ -455,20 +629,100 @@ mpool_look(mp, pgno)
 	struct _hqh *head;
 	BKT *bp;
 
-	head = &mp->hqh[HASHKEY(pgno)];
+	head = &mp->hqh[HASHKEY(mp, pgno)];
 	for (bp = head->cqh_first; bp != (void *)head; bp = bp->hq.cqe_next)
 		if (bp->pgno == pgno) {
-#ifdef STATISTICS
 			++mp->cachehit;
-#endif
 			return (bp);
 		}
-#ifdef STATISTICS
 	++mp->cachemiss;
-#endif
 	return (NULL);
 }
 
+/**
+ * mpool_enqueue
+ *	Put a page just read or created on the lru queue.
+ *
+ *	@param mp
+ *	@param bp
+ *
+ * With MPOOL_2Q, a page which is remembered in the A1out queue goes to
+ * the Am queue, and the others go to the A1in queue.
+ */
+static void
+mpool_enqueue(mp, bp)
+	MPOOL *mp;
+	BKT *bp;
+{
+	struct _ghqh *head;
+	GHOST *gp;
+
+	if (mp->policy == MPOOL_2Q) {
+		head = &mp->ghqh[HASHKEY(mp, bp->pgno)];
+		for (gp = head->cqh_first; gp != (void *)head; gp = gp->hq.cqe_next)
+			if (gp->pgno == bp->pgno)
+				break;
+		if (gp == (void *)head) {
+			bp->flags |= MPOOL_A1IN;
+			CIRCLEQ_INSERT_TAIL(&mp->a1qh, bp, q);
+			++mp->a1cur;
+			return;
+		}
+		CIRCLEQ_REMOVE(head, gp, hq);
+		CIRCLEQ_REMOVE(&mp->gqh, gp, q);
+		CIRCLEQ_INSERT_TAIL(&mp->gfqh, gp, q);
+	}
+	CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+}
+
+/**
+ * mpool_victim
+ *	Find the least recently used page which is not pinned.
+ *
+ *	@param mp
+ *	@param qh	lru queue
+ */
+static BKT *
+mpool_victim(mp, qh)
+	MPOOL *mp;
+	struct _lqh *qh;
+{
+	BKT *bp;
+
+	for (bp = qh->cqh_first; bp != (void *)qh; bp = bp->q.cqe_next)
+		if (!(bp->flags & MPOOL_PINNED))
+			return (bp);
+	return (NULL);
+}
+
+/**
+ * mpool_ghost
+ *	Remember the page number of a page evicted from the A1in queue.
+ *
+ *	@param mp
+ *	@param pgno
+ *
+ * If the A1out queue is full, the oldest one is forgotten.
+ */
+static void
+mpool_ghost(mp, pgno)
+	MPOOL *mp;
+	pgno_t pgno;
+{
+	GHOST *gp;
+
+	if ((gp = mp->gfqh.cqh_first) != (void *)&mp->gfqh)
+		CIRCLEQ_REMOVE(&mp->gfqh, gp, q);
+	else {
+		gp = mp->gqh.cqh_first;
+		CIRCLEQ_REMOVE(&mp->gqh, gp, q);
+		CIRCLEQ_REMOVE(&mp->ghqh[HASHKEY(mp, gp->pgno)], gp, hq);
+	}
+	gp->pgno = pgno;
+	CIRCLEQ_INSERT_HEAD(&mp->ghqh[HASHKEY(mp, pgno)], gp, hq);
+	CIRCLEQ_INSERT_TAIL(&mp->gqh, gp, q);
+}
+
 #ifdef STATISTICS
 /**
  * mpool_stat
@@ -499,6 +753,9 @@ mpool_stat(mp)
 		    * 100, mp->cachehit, mp->cachemiss);
 	(void)fprintf(stderr, "%lu page reads, %lu page writes\n",
 	    mp->pageread, mp->pagewrite);
+	if (mp->map != NULL)
+		(void)fprintf(stderr, "%lu pages got from the mapping\n",
+		    mp->mapget);
 
 	sep = "";
 	cnt = 0;
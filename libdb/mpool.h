@@ -37,9 +37,23 @@
  * are threaded on a hash chain (hashed by page number) and an lru chain.
  * Inactive pages are threaded on a free chain.  Each reference to a memory
  * pool is handed an opaque MPOOL cookie which stores all of this information.
+ *
+ * The number of hash chains is a power of two which is not less than the
+ * maximum number of cached pages (at least HASHSIZE), so the chains stay
+ * short however large the cache is.
+ *
+ * With the MPOOL_2Q policy, the lru chain is split into two queues as in the
+ * 2Q algorithm (T. Johnson and D. Shasha, 1994).  A page read for the first
+ * time goes to the A1in fifo queue, and only a page which is requested again
+ * after it was evicted from A1in (its page number is remembered in the A1out
+ * ghost queue for a while) goes to the Am lru queue.  A sequential scan
+ * passes through A1in without evicting the hot pages in Am.
+ *
+ * A read only pool can map the whole file instead (mpool_mmap()).  Then
+ * mpool_get() returns a pointer into the mapping, and no page is cached.
  */
 #define	HASHSIZE	128
-#define	HASHKEY(pgno)	((pgno - 1) % HASHSIZE)
+#define	HASHKEY(mp, pgno)	((pgno) & (mp)->hashmask)
 
 /** The BKT structures are the elements of the queues. */
 typedef struct _bkt {
@@ -52,25 +66,59 @@ typedef struct _bkt {
 #define	MPOOL_DIRTY	0x01
 			/** page is pinned into memory */
 #define	MPOOL_PINNED	0x02
+			/** page is on the A1in queue (MPOOL_2Q) */
+#define	MPOOL_A1IN	0x04
 	u_int8_t flags;			/**< flags */
 } BKT;
 
+/** The GHOST structures remember the page numbers of the A1out queue. */
+typedef struct _ghost {
+	CIRCLEQ_ENTRY(_ghost) hq;	/**< hash queue */
+	CIRCLEQ_ENTRY(_ghost) q;	/**< fifo or free queue */
+	pgno_t   pgno;			/**< page number */
+} GHOST;
+
+		/** replace the least recently used page */
+#define	MPOOL_LRU	0
+		/** scan resistant 2Q */
+#define	MPOOL_2Q	1
+
 typedef struct MPOOL {
 
 #ifndef IS__DOXYGEN_
-	CIRCLEQ_HEAD(_lqh, _bkt) lqh;	/**< lru queue head */
+	CIRCLEQ_HEAD(_lqh, _bkt) lqh;	/**< lru queue head (Am) */
+	struct _lqh a1qh;		/**< A1in queue head */
 					/** hash queue array */
-	CIRCLEQ_HEAD(_hqh, _bkt) hqh[HASHSIZE];
+	CIRCLEQ_HEAD(_hqh, _bkt) *hqh;
+	CIRCLEQ_HEAD(_gqh, _ghost) gqh;	/**< A1out queue head */
+	struct _gqh gfqh;		/**< free ghost queue head */
+					/** ghost hash queue array */
+	CIRCLEQ_HEAD(_ghqh, _ghost) *ghqh;
 #else
 	struct _lqh {
 		struct _bkt *cqh_first;
 		struct _bkt *cqh_last;
-	} lqh;							/**< lru queue head */
+	} lqh;							/**< lru queue head (Am) */
+	struct _lqh a1qh;					/**< A1in queue head */
 	struct _hqh {
 		struct _bkt *cqh_first;
 		struct _bkt *cqh_last;
-	} hqh[HASHSIZE];				/**< hash queue array */
+	} *hqh;							/**< hash queue array */
+	struct _gqh {
+		struct _ghost *cqh_first;
+		struct _ghost *cqh_last;
+	} gqh;							/**< A1out queue head */
+	struct _gqh gfqh;					/**< free ghost queue head */
+	struct _ghqh {
+		struct _ghost *cqh_first;
+		struct _ghost *cqh_last;
+	} *ghqh;						/**< ghost hash queue array */
 #endif
+	pgno_t	hashmask;		/**< number of hash queues - 1 */
+	int	policy;			/**< MPOOL_LRU or MPOOL_2Q */
+	GHOST	*ghost;			/**< ghost area (MPOOL_2Q) */
+	pgno_t	a1cur;			/**< current number of pages in A1in */
+	pgno_t	a1max;			/**< max number of pages in A1in */
 	pgno_t	curcache;		/**< current number of cached pages */
 	pgno_t	maxcache;		/**< max number of cached pages */
 	pgno_t	npages;			/**< number of pages in the file */
@@ -81,9 +129,11 @@ typedef struct MPOOL {
 					/** page out conversion routine */
 	void    (*pgout)(void *, pgno_t, void *);
 	void	*pgcookie;		/**< cookie for page in/out routines */
-#ifdef STATISTICS
+	void	*map;			/**< mapped file or NULL */
+	size_t	mapsize;		/**< size of the mapping */
 	u_long	cachehit;
 	u_long	cachemiss;
+	u_long	mapget;			/**< pages got from the mapping */
 	u_long	pagealloc;
 	u_long	pageflush;
 	u_long	pageget;
@@ -91,12 +141,14 @@ typedef struct MPOOL {
 	u_long	pageput;
 	u_long	pageread;
 	u_long	pagewrite;
-#endif
 } MPOOL;
 
 MPOOL	*mpool_open(void *, int, pgno_t, pgno_t);
 void	 mpool_filter(MPOOL *, void (*)(void *, pgno_t, void *),
 	    void (*)(void *, pgno_t, void *), void *);
+int	 mpool_policy(MPOOL *, int);
+int	 mpool_mmap(MPOOL *);
+void	 mpool_advise(MPOOL *, pgno_t, pgno_t);
 void	*mpool_new(MPOOL *, pgno_t *);
 void	*mpool_get(MPOOL *, pgno_t, u_int);
 int	 mpool_put(MPOOL *, void *, u_int);
@@ -35,11 +35,12 @@
 #include "token.h"
 #include "c_res.h"
 
+struct state;
 static void C_family(const struct parser_param *, int);
-static void process_attribute(const struct parser_param *);
-static int function_definition(const struct parser_param *, char *);
-static void condition_macro(const struct parser_param *, int);
-static int enumerator_list(const struct parser_param *);
+static void process_attribute(const struct parser_param *, struct state *);
+static int function_definition(const struct parser_param *, struct state *, char [MAXTOKEN]);
+static void condition_macro(const struct parser_param *, struct state *, int);
+static int enumerator_list(const struct parser_param *, struct state *);
 
 #define IS_TYPE_QUALIFIER(c)	((c) == C_CONST || (c) == C_RESTRICT || (c) == C_VOLATILE)
 
@@ -54,16 +55,23 @@ static int enumerator_list(const struct parser_param *);
 #define MAXPIFSTACK	100
 
 /*
- * #ifdef stack.
+ * Parser state.
+ * It is allocated for each file, so that the parser is reentrant.
  */
-static struct {
-	short start;		/* level when '#if' block started */
-	short end;		/* level when '#if' block end */
-	short if0only;		/* '#if 0' or notdef only */
-} stack[MAXPIFSTACK], *cur;
-static int piflevel;		/* condition macro level */
-static int level;		/* brace level */
-static int externclevel;	/* 'extern "C"' block level */
+struct state {
+	TOKEN *t;		/* tokenizer */
+	/*
+	 * #ifdef stack.
+	 */
+	struct {
+		short start;	/* level when '#if' block started */
+		short end;	/* level when '#if' block end */
+		short if0only;	/* '#if 0' or notdef only */
+	} stack[MAXPIFSTACK], *cur;
+	int piflevel;		/* condition macro level */
+	int level;		/* brace level */
+	int externclevel;	/* 'extern "C"' block level */
+};
 
 /**
  * yacc: read yacc file and pickup tag entries.
@@ -93,6 +101,8 @@ C_family(const struct parser_param *param, int type)
 	int startmacro, startsharp;
 	const char *interested = "{}=;";
 	STRBUF *sb = strbuf_open(0);
+	struct state state, *st = &state;
+	TOKEN *t;
 	/*
 	 * yacc file format is like the following.
 	 *
@@ -106,32 +116,34 @@ C_family(const struct parser_param *param, int type)
 	int yaccstatus = (type == TYPE_YACC) ? DECLARATIONS : PROGRAMS;
 	int inC = (type == TYPE_YACC) ? 0 : 1;	/* 1 while C source */
 
-	level = piflevel = externclevel = 0;
+	/* the '#else' out of any '#if' block uses the zeroed bottom of the stack */
+	memset(st, 0, sizeof(*st));
 	savelevel = -1;
 	startmacro = startsharp = 0;
 
-	if (!opentoken(param->file))
+	if ((t = opentoken(param->file)) == NULL)
 		die("'%s' cannot open.", param->file);
-	cmode = 1;			/* allow token like '#xxx' */
-	crflag = 1;			/* require '\n' as a token */
+	st->t = t;
+	t->cmode = 1;			/* allow token like '#xxx' */
+	t->crflag = 1;			/* require '\n' as a token */
 	if (type == TYPE_YACC)
-		ymode = 1;		/* allow token like '%xxx' */
+		t->ymode = 1;		/* allow token like '%xxx' */
 
-	while ((cc = nexttoken(interested, c_reserved_word)) != EOF) {
+	while ((cc = nexttoken(t, interested, c_reserved_word)) != EOF) {
 		switch (cc) {
 		case SYMBOL:		/* symbol	*/
-			if (inC && peekc(0) == '('/* ) */) {
-				if (param->isnotfunction(token)) {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
-				} else if (level > 0 || startmacro) {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
-				} else if (level == 0 && !startmacro && !startsharp) {
+			if (inC && peekc(t, 0) == '('/* ) */) {
+				if (param->isnotfunction(t->token)) {
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
+				} else if (st->level > 0 || startmacro) {
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
+				} else if (st->level == 0 && !startmacro && !startsharp) {
 					char arg1[MAXTOKEN], savetok[MAXTOKEN], *saveline;
-					int savelineno = lineno;
+					int savelineno = t->lineno;
 
-					strlimcpy(savetok, token, sizeof(savetok));
+					strlimcpy(savetok, t->token, sizeof(savetok));
 					strbuf_reset(sb);
-					strbuf_puts(sb, sp);
+					strbuf_puts(sb, t->sp);
 					saveline = strbuf_value(sb);
 					arg1[0] = '\0';
 					/*
@@ -148,7 +160,7 @@ C_family(const struct parser_param *param, int type)
 					 *
 					 * We should assume the first argument as a function name instead of 'SCM_DEFINE'.
 					 */
-					if (function_definition(param, arg1)) {
+					if (function_definition(param, st, arg1)) {
 						if (!strcmp(savetok, "SCM_DEFINE") && *arg1)
 							strlimcpy(savetok, arg1, sizeof(savetok));
 						PUT(PARSER_DEF, savetok, savelineno, saveline);
@@ -157,83 +169,83 @@ C_family(const struct parser_param *param, int type)
 					}
 				}
 			} else {
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			}
 			break;
 		case '{':  /* } */
-			DBG_PRINT(level, "{"); /* } */
-			if (yaccstatus == RULES && level == 0)
+			DBG_PRINT(st->level, "{"); /* } */
+			if (yaccstatus == RULES && st->level == 0)
 				inC = 1;
-			++level;
-			if ((param->flags & PARSER_BEGIN_BLOCK) && atfirst) {
-				if ((param->flags & PARSER_WARNING) && level != 1)
-					warning("forced level 1 block start by '{' at column 0 [+%d %s].", lineno, curfile); /* } */
-				level = 1;
+			++st->level;
+			if ((param->flags & PARSER_BEGIN_BLOCK) && atfirst(t)) {
+				if ((param->flags & PARSER_WARNING) && st->level != 1)
+					warning("forced level 1 block start by '{' at column 0 [+%d %s].", t->lineno, t->curfile); /* } */
+				st->level = 1;
 			}
 			break;
 			/* { */
 		case '}':
-			if (--level < 0) {
-				if (externclevel > 0)
-					externclevel--;
+			if (--st->level < 0) {
+				if (st->externclevel > 0)
+					st->externclevel--;
 				else if (param->flags & PARSER_WARNING)
-					warning("missing left '{' [+%d %s].", lineno, curfile); /* } */
-				level = 0;
+					warning("missing left '{' [+%d %s].", t->lineno, t->curfile); /* } */
+				st->level = 0;
 			}
-			if ((param->flags & PARSER_END_BLOCK) && atfirst) {
-				if ((param->flags & PARSER_WARNING) && level != 0) /* { */
-					warning("forced level 0 block end by '}' at column 0 [+%d %s].", lineno, curfile);
-				level = 0;
+			if ((param->flags & PARSER_END_BLOCK) && atfirst(t)) {
+				if ((param->flags & PARSER_WARNING) && st->level != 0) /* { */
+					warning("forced level 0 block end by '}' at column 0 [+%d %s].", t->lineno, t->curfile);
+				st->level = 0;
 			}
-			if (yaccstatus == RULES && level == 0)
+			if (yaccstatus == RULES && st->level == 0)
 				inC = 0;
 			/* { */
-			DBG_PRINT(level, "}");
+			DBG_PRINT(st->level, "}");
 			break;
 		case '\n':
-			if (startmacro && level != savelevel) {
+			if (startmacro && st->level != savelevel) {
 				if (param->flags & PARSER_WARNING)
-					warning("different level before and after #define macro. reseted. [+%d %s].", lineno, curfile);
-				level = savelevel;
+					warning("different level before and after #define macro. reseted. [+%d %s].", t->lineno, t->curfile);
+				st->level = savelevel;
 			}
 			startmacro = startsharp = 0;
 			break;
 		case YACC_SEP:		/* %% */
-			if (level != 0) {
+			if (st->level != 0) {
 				if (param->flags & PARSER_WARNING)
-					warning("forced level 0 block end by '%%' [+%d %s].", lineno, curfile);
-				level = 0;
+					warning("forced level 0 block end by '%%' [+%d %s].", t->lineno, t->curfile);
+				st->level = 0;
 			}
 			if (yaccstatus == DECLARATIONS) {
-				PUT(PARSER_DEF, "yyparse", lineno, sp);
+				PUT(PARSER_DEF, "yyparse", t->lineno, t->sp);
 				yaccstatus = RULES;
 			} else if (yaccstatus == RULES)
 				yaccstatus = PROGRAMS;
 			inC = (yaccstatus == PROGRAMS) ? 1 : 0;
 			break;
 		case YACC_BEGIN:	/* %{ */
-			if (level != 0) {
+			if (st->level != 0) {
 				if (param->flags & PARSER_WARNING)
-					warning("forced level 0 block end by '%%{' [+%d %s].", lineno, curfile);
-				level = 0;
+					warning("forced level 0 block end by '%%{' [+%d %s].", t->lineno, t->curfile);
+				st->level = 0;
 			}
 			if (inC == 1 && (param->flags & PARSER_WARNING))
-				warning("'%%{' appeared in C mode. [+%d %s].", lineno, curfile);
+				warning("'%%{' appeared in C mode. [+%d %s].", t->lineno, t->curfile);
 			inC = 1;
 			break;
 		case YACC_END:		/* %} */
-			if (level != 0) {
+			if (st->level != 0) {
 				if (param->flags & PARSER_WARNING)
-					warning("forced level 0 block end by '%%}' [+%d %s].", lineno, curfile);
-				level = 0;
+					warning("forced level 0 block end by '%%}' [+%d %s].", t->lineno, t->curfile);
+				st->level = 0;
 			}
 			if (inC == 0 && (param->flags & PARSER_WARNING))
-				warning("'%%}' appeared in Yacc mode. [+%d %s].", lineno, curfile);
+				warning("'%%}' appeared in Yacc mode. [+%d %s].", t->lineno, t->curfile);
 			inC = 0;
 			break;
 		case YACC_UNION:	/* %union {...} */
 			if (yaccstatus == DECLARATIONS)
-				PUT(PARSER_DEF, "YYSTYPE", lineno, sp);
+				PUT(PARSER_DEF, "YYSTYPE", t->lineno, t->sp);
 			break;
 		/*
 		 * #xxx
@@ -241,20 +253,20 @@ C_family(const struct parser_param *param, int type)
 		case SHARP_DEFINE:
 		case SHARP_UNDEF:
 			startmacro = 1;
-			savelevel = level;
-			if ((c = nexttoken(interested, c_reserved_word)) != SYMBOL) {
-				pushbacktoken();
+			savelevel = st->level;
+			if ((c = nexttoken(t, interested, c_reserved_word)) != SYMBOL) {
+				pushbacktoken(t);
 				break;
 			}
-			if (peekc(1) == '('/* ) */) {
-				PUT(PARSER_DEF, token, lineno, sp);
-				while ((c = nexttoken("()", c_reserved_word)) != EOF && c != '\n' && c != /* ( */ ')')
+			if (peekc(t, 1) == '('/* ) */) {
+				PUT(PARSER_DEF, t->token, t->lineno, t->sp);
+				while ((c = nexttoken(t, "()", c_reserved_word)) != EOF && c != '\n' && c != /* ( */ ')')
 					if (c == SYMBOL)
-						PUT(PARSER_REF_SYM, token, lineno, sp);
+						PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 				if (c == '\n')
-					pushbacktoken();
+					pushbacktoken(t);
 			} else {
-				PUT(PARSER_DEF, token, lineno, sp);
+				PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 			}
 			break;
 		case SHARP_IMPORT:
@@ -266,7 +278,7 @@ C_family(const struct parser_param *param, int type)
 		case SHARP_WARNING:
 		case SHARP_IDENT:
 		case SHARP_SCCS:
-			while ((c = nexttoken(interested, c_reserved_word)) != EOF && c != '\n')
+			while ((c = nexttoken(t, interested, c_reserved_word)) != EOF && c != '\n')
 				;
 			break;
 		case SHARP_IFDEF:
@@ -275,46 +287,46 @@ C_family(const struct parser_param *param, int type)
 		case SHARP_ELIF:
 		case SHARP_ELSE:
 		case SHARP_ENDIF:
-			condition_macro(param, cc);
+			condition_macro(param, st, cc);
 			break;
 		case SHARP_SHARP:		/* ## */
-			(void)nexttoken(interested, c_reserved_word);
+			(void)nexttoken(t, interested, c_reserved_word);
 			break;
 		case C_EXTERN: /* for 'extern "C"/"C++"' */
-			if (peekc(0) != '"') /* " */
+			if (peekc(t, 0) != '"') /* " */
 				continue; /* If does not start with '"', continue. */
-			while ((c = nexttoken(interested, c_reserved_word)) == '\n')
+			while ((c = nexttoken(t, interested, c_reserved_word)) == '\n')
 				;
 			/*
 			 * 'extern "C"/"C++"' block is a kind of namespace block.
 			 * (It doesn't have any influence on level.)
 			 */
 			if (c == '{') /* } */
-				externclevel++;
+				st->externclevel++;
 			else
-				pushbacktoken();
+				pushbacktoken(t);
 			break;
 		case C_STRUCT:
 		case C_ENUM:
 		case C_UNION:
-			while ((c = nexttoken(interested, c_reserved_word)) == C___ATTRIBUTE__)
-				process_attribute(param);
+			while ((c = nexttoken(t, interested, c_reserved_word)) == C___ATTRIBUTE__)
+				process_attribute(param, st);
 			while (c == '\n')
-				c = nexttoken(interested, c_reserved_word);
+				c = nexttoken(t, interested, c_reserved_word);
 			if (c == SYMBOL) {
-				if (peekc(0) == '{') /* } */ {
-					PUT(PARSER_DEF, token, lineno, sp);
+				if (peekc(t, 0) == '{') /* } */ {
+					PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 				} else {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 				}
-				c = nexttoken(interested, c_reserved_word);
+				c = nexttoken(t, interested, c_reserved_word);
 			}
 			while (c == '\n')
-				c = nexttoken(interested, c_reserved_word);
+				c = nexttoken(t, interested, c_reserved_word);
 			if (c == '{' /* } */ && cc == C_ENUM) {
-				enumerator_list(param);
+				enumerator_list(param, st);
 			} else {
-				pushbacktoken();
+				pushbacktoken(t);
 			}
 			break;
 		/* control statement check */
@@ -330,8 +342,8 @@ C_family(const struct parser_param *param, int type)
 		case C_RETURN:
 		case C_SWITCH:
 		case C_WHILE:
-			if ((param->flags & PARSER_WARNING) && !startmacro && level == 0)
-				warning("Out of function. %8s [+%d %s]", token, lineno, curfile);
+			if ((param->flags & PARSER_WARNING) && !startmacro && st->level == 0)
+				warning("Out of function. %8s [+%d %s]", t->token, t->lineno, t->curfile);
 			break;
 		case C_TYPEDEF:
 			{
@@ -341,44 +353,44 @@ C_family(const struct parser_param *param, int type)
 				 */
 				char savetok[MAXTOKEN];
 				int savelineno = 0;
-				int typedef_savelevel = level;
+				int typedef_savelevel = st->level;
 
 				savetok[0] = 0;
 
 				/* skip type qualifiers */
 				do {
-					c = nexttoken("{}(),;", c_reserved_word);
+					c = nexttoken(t, "{}(),;", c_reserved_word);
 				} while (IS_TYPE_QUALIFIER(c) || c == '\n');
 
 				if ((param->flags & PARSER_WARNING) && c == EOF) {
-					warning("unexpected eof. [+%d %s]", lineno, curfile);
+					warning("unexpected eof. [+%d %s]", t->lineno, t->curfile);
 					break;
 				} else if (c == C_ENUM || c == C_STRUCT || c == C_UNION) {
 					char *interest_enum = "{},;";
 					int c_ = c;
 
-					while ((c = nexttoken(interest_enum, c_reserved_word)) == C___ATTRIBUTE__)
-						process_attribute(param);
+					while ((c = nexttoken(t, interest_enum, c_reserved_word)) == C___ATTRIBUTE__)
+						process_attribute(param, st);
 					while (c == '\n')
-						c = nexttoken(interest_enum, c_reserved_word);
+						c = nexttoken(t, interest_enum, c_reserved_word);
 					/* read tag name if exist */
 					if (c == SYMBOL) {
-						if (peekc(0) == '{') /* } */ {
-							PUT(PARSER_DEF, token, lineno, sp);
+						if (peekc(t, 0) == '{') /* } */ {
+							PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 						} else {
-							PUT(PARSER_REF_SYM, token, lineno, sp);
+							PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 						}
-						c = nexttoken(interest_enum, c_reserved_word);
+						c = nexttoken(t, interest_enum, c_reserved_word);
 					}
 					while (c == '\n')
-						c = nexttoken(interest_enum, c_reserved_word);
+						c = nexttoken(t, interest_enum, c_reserved_word);
 					if (c_ == C_ENUM) {
 						if (c == '{') /* } */
-							c = enumerator_list(param);
+							c = enumerator_list(param, st);
 						else
-							pushbacktoken();
+							pushbacktoken(t);
 					} else {
-						for (; c != EOF; c = nexttoken(interest_enum, c_reserved_word)) {
+						for (; c != EOF; c = nexttoken(t, interest_enum, c_reserved_word)) {
 							switch (c) {
 							case SHARP_IFDEF:
 							case SHARP_IFNDEF:
@@ -386,39 +398,39 @@ C_family(const struct parser_param *param, int type)
 							case SHARP_ELIF:
 							case SHARP_ELSE:
 							case SHARP_ENDIF:
-								condition_macro(param, c);
+								condition_macro(param, st, c);
 								continue;
 							default:
 								break;
 							}
-							if (c == ';' && level == typedef_savelevel) {
+							if (c == ';' && st->level == typedef_savelevel) {
 								if (savetok[0])
-									PUT(PARSER_DEF, savetok, savelineno, sp);
+									PUT(PARSER_DEF, savetok, savelineno, t->sp);
 								break;
 							} else if (c == '{')
-								level++;
+								st->level++;
 							else if (c == '}') {
-								if (--level == typedef_savelevel)
+								if (--st->level == typedef_savelevel)
 									break;
 							} else if (c == SYMBOL) {
-								PUT(PARSER_REF_SYM, token, lineno, sp);
+								PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 								/* save lastest token */
-								strlimcpy(savetok, token, sizeof(savetok));
-								savelineno = lineno;
+								strlimcpy(savetok, t->token, sizeof(savetok));
+								savelineno = t->lineno;
 							}
 						}
 						if (c == ';')
 							break;
 					}
 					if ((param->flags & PARSER_WARNING) && c == EOF) {
-						warning("unexpected eof. [+%d %s]", lineno, curfile);
+						warning("unexpected eof. [+%d %s]", t->lineno, t->curfile);
 						break;
 					}
 				} else if (c == SYMBOL) {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 				}
 				savetok[0] = 0;
-				while ((c = nexttoken("(),;", c_reserved_word)) != EOF) {
+				while ((c = nexttoken(t, "(),;", c_reserved_word)) != EOF) {
 					switch (c) {
 					case SHARP_IFDEF:
 					case SHARP_IFNDEF:
@@ -426,46 +438,46 @@ C_family(const struct parser_param *param, int type)
 					case SHARP_ELIF:
 					case SHARP_ELSE:
 					case SHARP_ENDIF:
-						condition_macro(param, c);
+						condition_macro(param, st, c);
 						continue;
 					default:
 						break;
 					}
 					if (c == '(')
-						level++;
+						st->level++;
 					else if (c == ')')
-						level--;
+						st->level--;
 					else if (c == SYMBOL) {
-						if (level > typedef_savelevel) {
-							PUT(PARSER_REF_SYM, token, lineno, sp);
+						if (st->level > typedef_savelevel) {
+							PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 						} else {
 							/* put latest token if any */
 							if (savetok[0]) {
-								PUT(PARSER_REF_SYM, savetok, savelineno, sp);
+								PUT(PARSER_REF_SYM, savetok, savelineno, t->sp);
 							}
 							/* save lastest token */
-							strlimcpy(savetok, token, sizeof(savetok));
-							savelineno = lineno;
+							strlimcpy(savetok, t->token, sizeof(savetok));
+							savelineno = t->lineno;
 						}
 					} else if (c == ',' || c == ';') {
 						if (savetok[0]) {
-							PUT(PARSER_DEF, savetok, lineno, sp);
+							PUT(PARSER_DEF, savetok, t->lineno, t->sp);
 							savetok[0] = 0;
 						}
 					}
-					if (level == typedef_savelevel && c == ';')
+					if (st->level == typedef_savelevel && c == ';')
 						break;
 				}
 				if (param->flags & PARSER_WARNING) {
 					if (c == EOF)
-						warning("unexpected eof. [+%d %s]", lineno, curfile);
-					else if (level != typedef_savelevel)
-						warning("unmatched () block. (last at level %d.)[+%d %s]", level, lineno, curfile);
+						warning("unexpected eof. [+%d %s]", t->lineno, t->curfile);
+					else if (st->level != typedef_savelevel)
+						warning("unmatched () block. (last at level %d.)[+%d %s]", st->level, t->lineno, t->curfile);
 				}
 			}
 			break;
 		case C___ATTRIBUTE__:
-			process_attribute(param);
+			process_attribute(param, st);
 			break;
 		default:
 			break;
@@ -473,32 +485,33 @@ C_family(const struct parser_param *param, int type)
 	}
 	strbuf_close(sb);
 	if (param->flags & PARSER_WARNING) {
-		if (level != 0)
-			warning("unmatched {} block. (last at level %d.)[+%d %s]", level, lineno, curfile);
-		if (piflevel != 0)
-			warning("unmatched #if block. (last at level %d.)[+%d %s]", piflevel, lineno, curfile);
+		if (st->level != 0)
+			warning("unmatched {} block. (last at level %d.)[+%d %s]", st->level, t->lineno, t->curfile);
+		if (st->piflevel != 0)
+			warning("unmatched #if block. (last at level %d.)[+%d %s]", st->piflevel, t->lineno, t->curfile);
 	}
-	closetoken();
+	closetoken(t);
 }
 /**
  * process_attribute: skip attributes in '__attribute__((...))'.
  */
 static void
-process_attribute(const struct parser_param *param)
+process_attribute(const struct parser_param *param, struct state *st)
 {
+	TOKEN *t = st->t;
 	int brace = 0;
 	int c;
 	/*
 	 * Skip '...' in __attribute__((...))
 	 * but pick up symbols in it.
 	 */
-	while ((c = nexttoken("()", c_reserved_word)) != EOF) {
+	while ((c = nexttoken(t, "()", c_reserved_word)) != EOF) {
 		if (c == '(')
 			brace++;
 		else if (c == ')')
 			brace--;
 		else if (c == SYMBOL) {
-			PUT(PARSER_REF_SYM, token, lineno, sp);
+			PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 		}
 		if (brace == 0)
 			break;
@@ -508,18 +521,20 @@ process_attribute(const struct parser_param *param)
  * function_definition: return if function definition or not.
  *
  *	@param	param	
+ *	@param	st	parser state
  *	@param[out]	arg1	the first argument
  *	@return	target type
  */
 static int
-function_definition(const struct parser_param *param, char arg1[MAXTOKEN])
+function_definition(const struct parser_param *param, struct state *st, char arg1[MAXTOKEN])
 {
+	TOKEN *t = st->t;
 	int c;
 	int brace_level, isdefine;
 	int accept_arg1 = 0;
 
 	brace_level = isdefine = 0;
-	while ((c = nexttoken("()", c_reserved_word)) != EOF) {
+	while ((c = nexttoken(t, "()", c_reserved_word)) != EOF) {
 		switch (c) {
 		case SHARP_IFDEF:
 		case SHARP_IFNDEF:
@@ -527,7 +542,7 @@ function_definition(const struct parser_param *param, char arg1[MAXTOKEN])
 		case SHARP_ELIF:
 		case SHARP_ELSE:
 		case SHARP_ENDIF:
-			condition_macro(param, c);
+			condition_macro(param, st, c);
 			continue;
 		default:
 			break;
@@ -542,15 +557,15 @@ function_definition(const struct parser_param *param, char arg1[MAXTOKEN])
 		if (c == SYMBOL) {
 			if (accept_arg1 == 0) {
 				accept_arg1 = 1;
-				strlimcpy(arg1, token, MAXTOKEN);
+				strlimcpy(arg1, t->token, MAXTOKEN);
 			}
-			PUT(PARSER_REF_SYM, token, lineno, sp);
+			PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 		}
 	}
 	if (c == EOF)
 		return 0;
 	brace_level = 0;
-	while ((c = nexttoken(",;[](){}=", c_reserved_word)) != EOF) {
+	while ((c = nexttoken(t, ",;[](){}=", c_reserved_word)) != EOF) {
 		switch (c) {
 		case SHARP_IFDEF:
 		case SHARP_IFNDEF:
@@ -558,13 +573,13 @@ function_definition(const struct parser_param *param, char arg1[MAXTOKEN])
 		case SHARP_ELIF:
 		case SHARP_ELSE:
 		case SHARP_ENDIF:
-			condition_macro(param, c);
+			condition_macro(param, st, c);
 			continue;
 		case C___ATTRIBUTE__:
-			process_attribute(param);
+			process_attribute(param, st);
 			continue;
 		case SHARP_DEFINE:
-			pushbacktoken();
+			pushbacktoken(t);
 			return 0;
 		default:
 			break;
@@ -574,13 +589,13 @@ function_definition(const struct parser_param *param, char arg1[MAXTOKEN])
 		else if (c == /* ( */')' || c == ']')
 			brace_level--;
 		else if (brace_level == 0
-		    && ((c == SYMBOL && strcmp(token, "__THROW")) || IS_RESERVED_WORD(c)))
+		    && ((c == SYMBOL && strcmp(t->token, "__THROW")) || IS_RESERVED_WORD(c)))
 			isdefine = 1;
 		else if (c == ';' || c == ',') {
 			if (!isdefine)
 				break;
 		} else if (c == '{' /* } */) {
-			pushbacktoken();
+			pushbacktoken(t);
 			return 1;
 		} else if (c == /* { */'}')
 			break;
@@ -589,7 +604,7 @@ function_definition(const struct parser_param *param, char arg1[MAXTOKEN])
 
 		/* pick up symbol */
 		if (c == SYMBOL)
-			PUT(PARSER_REF_SYM, token, lineno, sp);
+			PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 	}
 	return 0;
 }
@@ -598,59 +613,62 @@ function_definition(const struct parser_param *param, char arg1[MAXTOKEN])
  * condition_macro: 
  *
  *	@param	param	
+ *	@param	st	parser state
  *	@param[in]	cc	token
  */
 static void
-condition_macro(const struct parser_param *param, int cc)
+condition_macro(const struct parser_param *param, struct state *st, int cc)
 {
-	cur = &stack[piflevel];
+	TOKEN *t = st->t;
+
+	st->cur = &st->stack[st->piflevel];
 	if (cc == SHARP_IFDEF || cc == SHARP_IFNDEF || cc == SHARP_IF) {
-		DBG_PRINT(piflevel, "#if");
-		if (++piflevel >= MAXPIFSTACK)
-			die("#if stack over flow. [%s]", curfile);
-		++cur;
-		cur->start = level;
-		cur->end = -1;
-		cur->if0only = 0;
-		if (peekc(0) == '0')
-			cur->if0only = 1;
-		else if ((cc = nexttoken(NULL, c_reserved_word)) == SYMBOL && !strcmp(token, "notdef"))
-			cur->if0only = 1;
+		DBG_PRINT(st->piflevel, "#if");
+		if (++st->piflevel >= MAXPIFSTACK)
+			die("#if stack over flow. [%s]", t->curfile);
+		++st->cur;
+		st->cur->start = st->level;
+		st->cur->end = -1;
+		st->cur->if0only = 0;
+		if (peekc(t, 0) == '0')
+			st->cur->if0only = 1;
+		else if ((cc = nexttoken(t, NULL, c_reserved_word)) == SYMBOL && !strcmp(t->token, "notdef"))
+			st->cur->if0only = 1;
 		else
-			pushbacktoken();
+			pushbacktoken(t);
 	} else if (cc == SHARP_ELIF || cc == SHARP_ELSE) {
-		DBG_PRINT(piflevel - 1, "#else");
-		if (cur->end == -1)
-			cur->end = level;
-		else if (cur->end != level && (param->flags & PARSER_WARNING))
-			warning("uneven level. [+%d %s]", lineno, curfile);
-		level = cur->start;
-		cur->if0only = 0;
+		DBG_PRINT(st->piflevel - 1, "#else");
+		if (st->cur->end == -1)
+			st->cur->end = st->level;
+		else if (st->cur->end != st->level && (param->flags & PARSER_WARNING))
+			warning("uneven level. [+%d %s]", t->lineno, t->curfile);
+		st->level = st->cur->start;
+		st->cur->if0only = 0;
 	} else if (cc == SHARP_ENDIF) {
 		int minus = 0;
 
-		--piflevel;
-		if (piflevel < 0) {
+		--st->piflevel;
+		if (st->piflevel < 0) {
 			minus = 1;
-			piflevel = 0;
+			st->piflevel = 0;
 		}
-		DBG_PRINT(piflevel, "#endif");
+		DBG_PRINT(st->piflevel, "#endif");
 		if (minus) {
 			if (param->flags & PARSER_WARNING)
-				warning("unmatched #if block. reseted. [+%d %s]", lineno, curfile);
+				warning("unmatched #if block. reseted. [+%d %s]", t->lineno, t->curfile);
 		} else {
-			if (cur->if0only)
-				level = cur->start;
-			else if (cur->end != -1) {
-				if (cur->end != level && (param->flags & PARSER_WARNING))
-					warning("uneven level. [+%d %s]", lineno, curfile);
-				level = cur->end;
+			if (st->cur->if0only)
+				st->level = st->cur->start;
+			else if (st->cur->end != -1) {
+				if (st->cur->end != st->level && (param->flags & PARSER_WARNING))
+					warning("uneven level. [+%d %s]", t->lineno, t->curfile);
+				st->level = st->cur->end;
 			}
 		}
 	}
-	while ((cc = nexttoken(NULL, c_reserved_word)) != EOF && cc != '\n') {
-		if (cc == SYMBOL && strcmp(token, "defined") != 0)
-			PUT(PARSER_REF_SYM, token, lineno, sp);
+	while ((cc = nexttoken(t, NULL, c_reserved_word)) != EOF && cc != '\n') {
+		if (cc == SYMBOL && strcmp(t->token, "defined") != 0)
+			PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 	}
 }
 
@@ -658,13 +676,14 @@ condition_macro(const struct parser_param *param, int cc)
  * enumerator_list: process "symbol (= expression), ... "}
  */
 static int
-enumerator_list(const struct parser_param *param)
+enumerator_list(const struct parser_param *param, struct state *st)
 {
-	int savelevel = level;
+	TOKEN *t = st->t;
+	int savelevel = st->level;
 	int in_expression = 0;
 	int c = '{';
 
-	for (; c != EOF; c = nexttoken("{}(),=", c_reserved_word)) {
+	for (; c != EOF; c = nexttoken(t, "{}(),=", c_reserved_word)) {
 		switch (c) {
 		case SHARP_IFDEF:
 		case SHARP_IFNDEF:
@@ -672,25 +691,25 @@ enumerator_list(const struct parser_param *param)
 		case SHARP_ELIF:
 		case SHARP_ELSE:
 		case SHARP_ENDIF:
-			condition_macro(param, c);
+			condition_macro(param, st, c);
 			break;
 		case SYMBOL:
 			if (in_expression)
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			else
-				PUT(PARSER_DEF, token, lineno, sp);
+				PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 			break;
 		case '{':
 		case '(':
-			level++;
+			st->level++;
 			break;
 		case '}':
 		case ')':
-			if (--level == savelevel)
+			if (--st->level == savelevel)
 				return c;
 			break;
 		case ',':
-			if (level == savelevel + 1)
+			if (st->level == savelevel + 1)
 				in_expression = 0;
 			break;
 		case '=':
@@ -35,10 +35,11 @@
 #include "token.h"
 #include "cpp_res.h"
 
-static void process_attribute(const struct parser_param *);
-static int function_definition(const struct parser_param *);
-static void condition_macro(const struct parser_param *, int);
-static int enumerator_list(const struct parser_param *);
+struct state;
+static void process_attribute(const struct parser_param *, struct state *);
+static int function_definition(const struct parser_param *, struct state *);
+static void condition_macro(const struct parser_param *, struct state *, int);
+static int enumerator_list(const struct parser_param *, struct state *);
 
 		/** max size of complete name of class */
 #define MAXCOMPLETENAME 1024
@@ -49,17 +50,23 @@ static int enumerator_list(const struct parser_param *);
 #define MAXPIFSTACK	100
 
 /*
- * #ifdef stack.
+ * Parser state.
+ * It is allocated for each file, so that the parser is reentrant.
  */
-
-static struct {
-	short start;		/**< level when '#if' block started */
-	short end;		/**< level when '#if' block end */
-	short if0only;		/**< '#if 0' or notdef only */
-} pifstack[MAXPIFSTACK], *cur;
-static int piflevel;		/**< condition macro level */
-static int level;		/**< brace level */
-static int namespacelevel;	/**< namespace block level */
+struct state {
+	TOKEN *t;		/**< tokenizer */
+	/*
+	 * #ifdef stack.
+	 */
+	struct {
+		short start;	/**< level when '#if' block started */
+		short end;	/**< level when '#if' block end */
+		short if0only;	/**< '#if 0' or notdef only */
+	} pifstack[MAXPIFSTACK], *cur;
+	int piflevel;		/**< condition macro level */
+	int level;		/**< brace level */
+	int namespacelevel;	/**< namespace block level */
+};
 
 /**
  * Cpp: read C++ file and pickup tag entries.
@@ -81,42 +88,47 @@ Cpp(const struct parser_param *param)
 	} stack[MAXCLASSSTACK];
 	const char *interested = "{}=;~";
 	STRBUF *sb = strbuf_open(0);
+	struct state state, *st = &state;
+	TOKEN *t;
 
 	*classname = *completename = 0;
 	stack[0].classname = completename;
 	stack[0].terminate = completename;
 	stack[0].level = 0;
-	level = classlevel = piflevel = namespacelevel = 0;
+	/* the '#else' out of any '#if' block uses the zeroed bottom of the stack */
+	memset(st, 0, sizeof(*st));
+	classlevel = 0;
 	savelevel = -1;
 	startclass = startthrow = startmacro = startsharp = startequal = 0;
 
-	if (!opentoken(param->file))
+	if ((t = opentoken(param->file)) == NULL)
 		die("'%s' cannot open.", param->file);
-	cmode = 1;			/* allow token like '#xxx' */
-	crflag = 1;			/* require '\n' as a token */
-	cppmode = 1;			/* treat '::' as a token */
+	st->t = t;
+	t->cmode = 1;			/* allow token like '#xxx' */
+	t->crflag = 1;			/* require '\n' as a token */
+	t->cppmode = 1;			/* treat '::' as a token */
 
-	while ((cc = nexttoken(interested, cpp_reserved_word)) != EOF) {
-		if (cc == '~' && level == stack[classlevel].level)
+	while ((cc = nexttoken(t, interested, cpp_reserved_word)) != EOF) {
+		if (cc == '~' && st->level == stack[classlevel].level)
 			continue;
 		switch (cc) {
 		case SYMBOL:		/* symbol	*/
 			if (startclass || startthrow) {
-				PUT(PARSER_REF_SYM, token, lineno, sp);
-			} else if (peekc(0) == '('/* ) */) {
-				if (param->isnotfunction(token)) {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
-				} else if (level > stack[classlevel].level || startequal || startmacro) {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
-				} else if (level == stack[classlevel].level && !startmacro && !startsharp && !startequal) {
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
+			} else if (peekc(t, 0) == '('/* ) */) {
+				if (param->isnotfunction(t->token)) {
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
+				} else if (st->level > stack[classlevel].level || startequal || startmacro) {
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
+				} else if (st->level == stack[classlevel].level && !startmacro && !startsharp && !startequal) {
 					char savetok[MAXTOKEN], *saveline;
-					int savelineno = lineno;
+					int savelineno = t->lineno;
 
-					strlimcpy(savetok, token, sizeof(savetok));
+					strlimcpy(savetok, t->token, sizeof(savetok));
 					strbuf_reset(sb);
-					strbuf_puts(sb, sp);
+					strbuf_puts(sb, t->sp);
 					saveline = strbuf_value(sb);
-					if (function_definition(param)) {
+					if (function_definition(param, st)) {
 						/* ignore constructor */
 						if (strcmp(stack[classlevel].classname, savetok))
 							PUT(PARSER_DEF, savetok, savelineno, saveline);
@@ -125,55 +137,55 @@ Cpp(const struct parser_param *param)
 					}
 				}
 			} else {
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			}
 			break;
 		case CPP_USING:
-			crflag = 0;
+			t->crflag = 0;
 			/*
 			 * using namespace name;
 			 * using ...;
 			 */
-			if ((c = nexttoken(interested, cpp_reserved_word)) == CPP_NAMESPACE) {
-				if ((c = nexttoken(interested, cpp_reserved_word)) == SYMBOL) {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
+			if ((c = nexttoken(t, interested, cpp_reserved_word)) == CPP_NAMESPACE) {
+				if ((c = nexttoken(t, interested, cpp_reserved_word)) == SYMBOL) {
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 				} else {
 					if (param->flags & PARSER_WARNING)
-						warning("missing namespace name. [+%d %s].", lineno, curfile);
-					pushbacktoken();
+						warning("missing namespace name. [+%d %s].", t->lineno, t->curfile);
+					pushbacktoken(t);
 				}
 			} else if (c  == SYMBOL) {
 				char savetok[MAXTOKEN], *saveline;
-				int savelineno = lineno;
+				int savelineno = t->lineno;
 
-				strlimcpy(savetok, token, sizeof(savetok));
+				strlimcpy(savetok, t->token, sizeof(savetok));
 				strbuf_reset(sb);
-				strbuf_puts(sb, sp);
+				strbuf_puts(sb, t->sp);
 				saveline = strbuf_value(sb);
-				if ((c = nexttoken(interested, cpp_reserved_word)) == '=') {
+				if ((c = nexttoken(t, interested, cpp_reserved_word)) == '=') {
 					PUT(PARSER_DEF, savetok, savelineno, saveline);
 				} else {
 					PUT(PARSER_REF_SYM, savetok, savelineno, saveline);
 					while (c == SYMBOL) {
-						PUT(PARSER_REF_SYM, token, lineno, sp);
-						c = nexttoken(interested, cpp_reserved_word);
+						PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
+						c = nexttoken(t, interested, cpp_reserved_word);
 					}
 				}
 			} else {
-				pushbacktoken();
+				pushbacktoken(t);
 			}
-			crflag = 1;
+			t->crflag = 1;
 			break;
 		case CPP_NAMESPACE:
-			crflag = 0;
+			t->crflag = 0;
 			/*
 			 * namespace name = ...;
 			 * namespace [name] { ... }
 			 */
-			if ((c = nexttoken(interested, cpp_reserved_word)) == SYMBOL) {
-				PUT(PARSER_DEF, token, lineno, sp);
-				if ((c = nexttoken(interested, cpp_reserved_word)) == '=') {
-					crflag = 1;
+			if ((c = nexttoken(t, interested, cpp_reserved_word)) == SYMBOL) {
+				PUT(PARSER_DEF, t->token, t->lineno, t->sp);
+				if ((c = nexttoken(t, interested, cpp_reserved_word)) == '=') {
+					t->crflag = 1;
 					break;
 				}
 			}
@@ -181,56 +193,56 @@ Cpp(const struct parser_param *param)
 			 * Namespace block doesn't have any influence on level.
 			 */
 			if (c == '{') /* } */ {
-				namespacelevel++;
+				st->namespacelevel++;
 			} else {
 				if (param->flags & PARSER_WARNING)
-					warning("missing namespace block. [+%d %s](0x%x).", lineno, curfile, c);
+					warning("missing namespace block. [+%d %s](0x%x).", t->lineno, t->curfile, c);
 			}
-			crflag = 1;
+			t->crflag = 1;
 			break;
 		case CPP_EXTERN: /* for 'extern "C"/"C++"' */
-			if (peekc(0) != '"') /* " */
+			if (peekc(t, 0) != '"') /* " */
 				continue; /* If does not start with '"', continue. */
-			while ((c = nexttoken(interested, cpp_reserved_word)) == '\n')
+			while ((c = nexttoken(t, interested, cpp_reserved_word)) == '\n')
 				;
 			/*
 			 * 'extern "C"/"C++"' block is a kind of namespace block.
 			 * (It doesn't have any influence on level.)
 			 */
 			if (c == '{') /* } */
-				namespacelevel++;
+				st->namespacelevel++;
 			else
-				pushbacktoken();
+				pushbacktoken(t);
 			break;
 		case CPP_STRUCT:
 		case CPP_CLASS:
-			DBG_PRINT(level, cc == CPP_CLASS ? "class" : "struct");
-			while ((c = nexttoken(NULL, cpp_reserved_word)) == CPP___ATTRIBUTE__ || c == '\n')
+			DBG_PRINT(st->level, cc == CPP_CLASS ? "class" : "struct");
+			while ((c = nexttoken(t, NULL, cpp_reserved_word)) == CPP___ATTRIBUTE__ || c == '\n')
 				if (c == CPP___ATTRIBUTE__)
-					process_attribute(param);
+					process_attribute(param, st);
 			if (c == SYMBOL) {
 				char *saveline;
 				int savelineno;
 				do {
 					if (c == SYMBOL) {
-						savelineno = lineno;
+						savelineno = t->lineno;
 						strbuf_reset(sb);
-						strbuf_puts(sb, sp);
+						strbuf_puts(sb, t->sp);
 						saveline = strbuf_value(sb);
-						strlimcpy(classname, token, sizeof(classname));
+						strlimcpy(classname, t->token, sizeof(classname));
 					}
-					c = nexttoken(NULL, cpp_reserved_word);
+					c = nexttoken(t, NULL, cpp_reserved_word);
 					if (c == SYMBOL)
 						PUT(PARSER_REF_SYM, classname, savelineno, saveline);
 					else if (c == '<') {
 						int templates = 1;
 						for (;;) {
-							c = nexttoken(NULL, cpp_reserved_word);
+							c = nexttoken(t, NULL, cpp_reserved_word);
 							if (c == SYMBOL)
-								PUT(PARSER_REF_SYM, token, lineno, sp);
+								PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 							if (c == '<') {
-								if (peekc(1) == '<')
-									throwaway_nextchar();
+								if (peekc(t, 1) == '<')
+									throwaway_nextchar(t);
 								else
 									++templates;
 							} else if (c == '>') {
@@ -238,11 +250,11 @@ Cpp(const struct parser_param *param)
 									break;
 							} else if (c == EOF) {
 								if (param->flags & PARSER_WARNING) 
-									warning("failed to parse template [+%d %s].", savelineno, curfile);
+									warning("failed to parse template [+%d %s].", savelineno, t->curfile);
 								goto finish;
 							}
 						}
-						c = nexttoken(NULL, cpp_reserved_word);
+						c = nexttoken(t, NULL, cpp_reserved_word);
 					}
 				} while (c == SYMBOL || c == '\n');
 				if (c == ':' || c == '{') /* } */ {
@@ -251,57 +263,57 @@ Cpp(const struct parser_param *param)
 				} else
 					PUT(PARSER_REF_SYM, classname, savelineno, saveline);
 			}
-			pushbacktoken();
+			pushbacktoken(t);
 			break;
 		case '{':  /* } */
-			DBG_PRINT(level, "{"); /* } */
-			++level;
-			if ((param->flags & PARSER_BEGIN_BLOCK) && atfirst) {
-				if ((param->flags & PARSER_WARNING) && level != 1)
-					warning("forced level 1 block start by '{' at column 0 [+%d %s].", lineno, curfile); /* } */
-				level = 1;
+			DBG_PRINT(st->level, "{"); /* } */
+			++st->level;
+			if ((param->flags & PARSER_BEGIN_BLOCK) && atfirst(t)) {
+				if ((param->flags & PARSER_WARNING) && st->level != 1)
+					warning("forced level 1 block start by '{' at column 0 [+%d %s].", t->lineno, t->curfile); /* } */
+				st->level = 1;
 			}
 			if (startclass) {
 				char *p = stack[classlevel].terminate;
 				char *q = classname;
 
 				if (++classlevel >= MAXCLASSSTACK)
-					die("class stack over flow.[%s]", curfile);
+					die("class stack over flow.[%s]", t->curfile);
 				if (classlevel > 1 && p < completename_limit)
 					*p++ = '.';
 				stack[classlevel].classname = p;
 				while (*q && p < completename_limit)
 					*p++ = *q++;
 				stack[classlevel].terminate = p;
-				stack[classlevel].level = level;
+				stack[classlevel].level = st->level;
 				*p++ = 0;
 			}
 			startclass = startthrow = 0;
 			break;
 			/* { */
 		case '}':
-			if (--level < 0) {
-				if (namespacelevel > 0)
-					namespacelevel--;
+			if (--st->level < 0) {
+				if (st->namespacelevel > 0)
+					st->namespacelevel--;
 				else if (param->flags & PARSER_WARNING)
-					warning("missing left '{' [+%d %s].", lineno, curfile); /* } */
-				level = 0;
+					warning("missing left '{' [+%d %s].", t->lineno, t->curfile); /* } */
+				st->level = 0;
 			}
-			if ((param->flags & PARSER_END_BLOCK) && atfirst) {
-				if ((param->flags & PARSER_WARNING) && level != 0)
+			if ((param->flags & PARSER_END_BLOCK) && atfirst(t)) {
+				if ((param->flags & PARSER_WARNING) && st->level != 0)
 					/* { */
-					warning("forced level 0 block end by '}' at column 0 [+%d %s].", lineno, curfile);
-				level = 0;
+					warning("forced level 0 block end by '}' at column 0 [+%d %s].", t->lineno, t->curfile);
+				st->level = 0;
 			}
-			if (level < stack[classlevel].level)
+			if (st->level < stack[classlevel].level)
 				*(stack[--classlevel].terminate) = 0;
 			/* { */
-			DBG_PRINT(level, "}");
+			DBG_PRINT(st->level, "}");
 			break;
 		case '=':
 			/* dirty hack. Don't mimic this. */
-			if (peekc(0) == '=') {
-				throwaway_nextchar();
+			if (peekc(t, 0) == '=') {
+				throwaway_nextchar(t);
 			} else {
 				startequal = 1;
 			}
@@ -310,10 +322,10 @@ Cpp(const struct parser_param *param)
 			startthrow = startequal = 0;
 			break;
 		case '\n':
-			if (startmacro && level != savelevel) {
+			if (startmacro && st->level != savelevel) {
 				if (param->flags & PARSER_WARNING)
-					warning("different level before and after #define macro. reseted. [+%d %s].", lineno, curfile);
-				level = savelevel;
+					warning("different level before and after #define macro. reseted. [+%d %s].", t->lineno, t->curfile);
+				st->level = savelevel;
 			}
 			startmacro = startsharp = 0;
 			break;
@@ -323,20 +335,20 @@ Cpp(const struct parser_param *param)
 		case SHARP_DEFINE:
 		case SHARP_UNDEF:
 			startmacro = 1;
-			savelevel = level;
-			if ((c = nexttoken(interested, cpp_reserved_word)) != SYMBOL) {
-				pushbacktoken();
+			savelevel = st->level;
+			if ((c = nexttoken(t, interested, cpp_reserved_word)) != SYMBOL) {
+				pushbacktoken(t);
 				break;
 			}
-			if (peekc(1) == '('/* ) */) {
-				PUT(PARSER_DEF, token, lineno, sp);
-				while ((c = nexttoken("()", cpp_reserved_word)) != EOF && c != '\n' && c != /* ( */ ')')
+			if (peekc(t, 1) == '('/* ) */) {
+				PUT(PARSER_DEF, t->token, t->lineno, t->sp);
+				while ((c = nexttoken(t, "()", cpp_reserved_word)) != EOF && c != '\n' && c != /* ( */ ')')
 					if (c == SYMBOL)
-						PUT(PARSER_REF_SYM, token, lineno, sp);
+						PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 				if (c == '\n')
-					pushbacktoken();
+					pushbacktoken(t);
 			}  else {
-				PUT(PARSER_DEF, token, lineno, sp);
+				PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 			}
 			break;
 		case SHARP_IMPORT:
@@ -348,7 +360,7 @@ Cpp(const struct parser_param *param)
 		case SHARP_WARNING:
 		case SHARP_IDENT:
 		case SHARP_SCCS:
-			while ((c = nexttoken(interested, cpp_reserved_word)) != EOF && c != '\n')
+			while ((c = nexttoken(t, interested, cpp_reserved_word)) != EOF && c != '\n')
 				;
 			break;
 		case SHARP_IFDEF:
@@ -357,68 +369,68 @@ Cpp(const struct parser_param *param)
 		case SHARP_ELIF:
 		case SHARP_ELSE:
 		case SHARP_ENDIF:
-			condition_macro(param, cc);
+			condition_macro(param, st, cc);
 			break;
 		case SHARP_SHARP:		/* ## */
-			(void)nexttoken(interested, cpp_reserved_word);
+			(void)nexttoken(t, interested, cpp_reserved_word);
 			break;
 		case CPP_NEW:
-			if ((c = nexttoken(interested, cpp_reserved_word)) == SYMBOL)
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+			if ((c = nexttoken(t, interested, cpp_reserved_word)) == SYMBOL)
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			break;
 		case CPP_ENUM:
 		case CPP_UNION:
-			while ((c = nexttoken(interested, cpp_reserved_word)) == CPP___ATTRIBUTE__)
-				process_attribute(param);
+			while ((c = nexttoken(t, interested, cpp_reserved_word)) == CPP___ATTRIBUTE__)
+				process_attribute(param, st);
 			while (c == '\n')
-				c = nexttoken(interested, cpp_reserved_word);
+				c = nexttoken(t, interested, cpp_reserved_word);
 			if (c == SYMBOL) {
-				if (peekc(0) == '{') /* } */ {
-					PUT(PARSER_DEF, token, lineno, sp);
+				if (peekc(t, 0) == '{') /* } */ {
+					PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 				} else {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 				}
-				c = nexttoken(interested, cpp_reserved_word);
+				c = nexttoken(t, interested, cpp_reserved_word);
 			}
 			while (c == '\n')
-				c = nexttoken(interested, cpp_reserved_word);
+				c = nexttoken(t, interested, cpp_reserved_word);
 			if (c == '{' /* } */ && cc == CPP_ENUM) {
-				enumerator_list(param);
+				enumerator_list(param, st);
 			} else {
-				pushbacktoken();
+				pushbacktoken(t);
 			}
 			break;
 		case CPP_TEMPLATE:
 			{
-				int level = 0;
+				int nest = 0;
 
-				while ((c = nexttoken("<>", cpp_reserved_word)) != EOF) {
+				while ((c = nexttoken(t, "<>", cpp_reserved_word)) != EOF) {
 					if (c == '<')
-						++level;
+						++nest;
 					else if (c == '>') {
-						if (--level == 0)
+						if (--nest == 0)
 							break;
 					} else if (c == SYMBOL) {
-						PUT(PARSER_REF_SYM, token, lineno, sp);
+						PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 					}
 				}
 				if (c == EOF && (param->flags & PARSER_WARNING))
-					warning("template <...> isn't closed. [+%d %s].", lineno, curfile);
+					warning("template <...> isn't closed. [+%d %s].", t->lineno, t->curfile);
 			}
 			break;
 		case CPP_OPERATOR:
-			while ((c = nexttoken(";{", /* } */ cpp_reserved_word)) != EOF) {
+			while ((c = nexttoken(t, ";{", /* } */ cpp_reserved_word)) != EOF) {
 				if (c == '{') /* } */ {
-					pushbacktoken();
+					pushbacktoken(t);
 					break;
 				} else if (c == ';') {
 					break;
 				} else if (c == SYMBOL) {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 				}
 			}
 			if (c == EOF && (param->flags & PARSER_WARNING))
-				warning("'{' doesn't exist after 'operator'. [+%d %s].", lineno, curfile); /* } */
+				warning("'{' doesn't exist after 'operator'. [+%d %s].", t->lineno, t->curfile); /* } */
 			break;
 		/* control statement check */
 		case CPP_THROW:
@@ -438,8 +450,8 @@ Cpp(const struct parser_param *param)
 		case CPP_SWITCH:
 		case CPP_TRY:
 		case CPP_WHILE:
-			if ((param->flags & PARSER_WARNING) && !startmacro && level == 0)
-				warning("Out of function. %8s [+%d %s]", token, lineno, curfile);
+			if ((param->flags & PARSER_WARNING) && !startmacro && st->level == 0)
+				warning("Out of function. %8s [+%d %s]", t->token, t->lineno, t->curfile);
 			break;
 		case CPP_TYPEDEF:
 			{
@@ -449,45 +461,45 @@ Cpp(const struct parser_param *param)
 				 */
 				char savetok[MAXTOKEN];
 				int savelineno = 0;
-				int typedef_savelevel = level;
+				int typedef_savelevel = st->level;
 				int templates = 0;
 
 				savetok[0] = 0;
 
 				/* skip CV qualifiers */
 				do {
-					c = nexttoken("{}(),;", cpp_reserved_word);
+					c = nexttoken(t, "{}(),;", cpp_reserved_word);
 				} while (IS_CV_QUALIFIER(c) || c == '\n');
 
 				if ((param->flags & PARSER_WARNING) && c == EOF) {
-					warning("unexpected eof. [+%d %s]", lineno, curfile);
+					warning("unexpected eof. [+%d %s]", t->lineno, t->curfile);
 					break;
 				} else if (c == CPP_ENUM || c == CPP_STRUCT || c == CPP_UNION) {
 					char *interest_enum = "{},;";
 					int c_ = c;
 
-					while ((c = nexttoken(interest_enum, cpp_reserved_word)) == CPP___ATTRIBUTE__)
-						process_attribute(param);
+					while ((c = nexttoken(t, interest_enum, cpp_reserved_word)) == CPP___ATTRIBUTE__)
+						process_attribute(param, st);
 					while (c == '\n')
-						c = nexttoken(interest_enum, cpp_reserved_word);
+						c = nexttoken(t, interest_enum, cpp_reserved_word);
 					/* read tag name if exist */
 					if (c == SYMBOL) {
-						if (peekc(0) == '{') /* } */ {
-							PUT(PARSER_DEF, token, lineno, sp);
+						if (peekc(t, 0) == '{') /* } */ {
+							PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 						} else {
-							PUT(PARSER_REF_SYM, token, lineno, sp);
+							PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 						}
-						c = nexttoken(interest_enum, cpp_reserved_word);
+						c = nexttoken(t, interest_enum, cpp_reserved_word);
 					}
 					while (c == '\n')
-						c = nexttoken(interest_enum, cpp_reserved_word);
+						c = nexttoken(t, interest_enum, cpp_reserved_word);
 					if (c_ == CPP_ENUM) {
 						if (c == '{') /* } */
-							c = enumerator_list(param);
+							c = enumerator_list(param, st);
 						else
-							pushbacktoken();
+							pushbacktoken(t);
 					} else {
-						for (; c != EOF; c = nexttoken(interest_enum, cpp_reserved_word)) {
+						for (; c != EOF; c = nexttoken(t, interest_enum, cpp_reserved_word)) {
 							switch (c) {
 							case SHARP_IFDEF:
 							case SHARP_IFNDEF:
@@ -495,39 +507,39 @@ Cpp(const struct parser_param *param)
 							case SHARP_ELIF:
 							case SHARP_ELSE:
 							case SHARP_ENDIF:
-								condition_macro(param, c);
+								condition_macro(param, st, c);
 								continue;
 							default:
 								break;
 							}
-							if (c == ';' && level == typedef_savelevel) {
+							if (c == ';' && st->level == typedef_savelevel) {
 								if (savetok[0])
-									PUT(PARSER_DEF, savetok, savelineno, sp);
+									PUT(PARSER_DEF, savetok, savelineno, t->sp);
 								break;
 							} else if (c == '{')
-								level++;
+								st->level++;
 							else if (c == '}') {
-								if (--level == typedef_savelevel)
+								if (--st->level == typedef_savelevel)
 									break;
 							} else if (c == SYMBOL) {
-								PUT(PARSER_REF_SYM, token, lineno, sp);
+								PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 								/* save lastest token */
-								strlimcpy(savetok, token, sizeof(savetok));
-								savelineno = lineno;
+								strlimcpy(savetok, t->token, sizeof(savetok));
+								savelineno = t->lineno;
 							}
 						}
 						if (c == ';')
 							break;
 					}
 					if ((param->flags & PARSER_WARNING) && c == EOF) {
-						warning("unexpected eof. [+%d %s]", lineno, curfile);
+						warning("unexpected eof. [+%d %s]", t->lineno, t->curfile);
 						break;
 					}
 				} else if (c == SYMBOL) {
-					PUT(PARSER_REF_SYM, token, lineno, sp);
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 				}
 				savetok[0] = 0;
-				while ((c = nexttoken("()<>,;", cpp_reserved_word)) != EOF) {
+				while ((c = nexttoken(t, "()<>,;", cpp_reserved_word)) != EOF) {
 					switch (c) {
 					case SHARP_IFDEF:
 					case SHARP_IFNDEF:
@@ -535,50 +547,50 @@ Cpp(const struct parser_param *param)
 					case SHARP_ELIF:
 					case SHARP_ELSE:
 					case SHARP_ENDIF:
-						condition_macro(param, c);
+						condition_macro(param, st, c);
 						continue;
 					default:
 						break;
 					}
 					if (c == '(')
-						level++;
+						st->level++;
 					else if (c == ')')
-						level--;
+						st->level--;
 					else if (c == '<')
 						templates++;
 					else if (c == '>')
 						templates--;
 					else if (c == SYMBOL) {
-						if (level > typedef_savelevel) {
-							PUT(PARSER_REF_SYM, token, lineno, sp);
+						if (st->level > typedef_savelevel) {
+							PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 						} else {
 							/* put latest token if any */
 							if (savetok[0]) {
-								PUT(PARSER_REF_SYM, savetok, savelineno, sp);
+								PUT(PARSER_REF_SYM, savetok, savelineno, t->sp);
 							}
 							/* save lastest token */
-							strlimcpy(savetok, token, sizeof(savetok));
-							savelineno = lineno;
+							strlimcpy(savetok, t->token, sizeof(savetok));
+							savelineno = t->lineno;
 						}
 					} else if (c == ',' || c == ';') {
 						if (savetok[0]) {
-							PUT(templates ? PARSER_REF_SYM : PARSER_DEF, savetok, lineno, sp);
+							PUT(templates ? PARSER_REF_SYM : PARSER_DEF, savetok, t->lineno, t->sp);
 							savetok[0] = 0;
 						}
 					}
-					if (level == typedef_savelevel && c == ';')
+					if (st->level == typedef_savelevel && c == ';')
 						break;
 				}
 				if (param->flags & PARSER_WARNING) {
 					if (c == EOF)
-						warning("unexpected eof. [+%d %s]", lineno, curfile);
-					else if (level != typedef_savelevel)
-						warning("unmatched () block. (last at level %d.)[+%d %s]", level, lineno, curfile);
+						warning("unexpected eof. [+%d %s]", t->lineno, t->curfile);
+					else if (st->level != typedef_savelevel)
+						warning("unmatched () block. (last at level %d.)[+%d %s]", st->level, t->lineno, t->curfile);
 				}
 			}
 			break;
 		case CPP___ATTRIBUTE__:
-			process_attribute(param);
+			process_attribute(param, st);
 			break;
 		default:
 			break;
@@ -587,32 +599,33 @@ Cpp(const struct parser_param *param)
 finish:
 	strbuf_close(sb);
 	if (param->flags & PARSER_WARNING) {
-		if (level != 0)
-			warning("unmatched {} block. (last at level %d.)[+%d %s]", level, lineno, curfile);
-		if (piflevel != 0)
-			warning("unmatched #if block. (last at level %d.)[+%d %s]", piflevel, lineno, curfile);
+		if (st->level != 0)
+			warning("unmatched {} block. (last at level %d.)[+%d %s]", st->level, t->lineno, t->curfile);
+		if (st->piflevel != 0)
+			warning("unmatched #if block. (last at level %d.)[+%d %s]", st->piflevel, t->lineno, t->curfile);
 	}
-	closetoken();
+	closetoken(t);
 }
 /**
  * process_attribute: skip attributes in '__attribute__((...))'.
  */
 static void
-process_attribute(const struct parser_param *param)
+process_attribute(const struct parser_param *param, struct state *st)
 {
+	TOKEN *t = st->t;
 	int brace = 0;
 	int c;
 	/*
 	 * Skip '...' in __attribute__((...))
 	 * but pick up symbols in it.
 	 */
-	while ((c = nexttoken("()", cpp_reserved_word)) != EOF) {
+	while ((c = nexttoken(t, "()", cpp_reserved_word)) != EOF) {
 		if (c == '(')
 			brace++;
 		else if (c == ')')
 			brace--;
 		else if (c == SYMBOL) {
-			PUT(PARSER_REF_SYM, token, lineno, sp);
+			PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 		}
 		if (brace == 0)
 			break;
@@ -624,13 +637,14 @@ process_attribute(const struct parser_param *param)
  *	@return	target type
  */
 static int
-function_definition(const struct parser_param *param)
+function_definition(const struct parser_param *param, struct state *st)
 {
+	TOKEN *t = st->t;
 	int c;
 	int brace_level;
 
 	brace_level = 0;
-	while ((c = nexttoken("()", cpp_reserved_word)) != EOF) {
+	while ((c = nexttoken(t, "()", cpp_reserved_word)) != EOF) {
 		switch (c) {
 		case SHARP_IFDEF:
 		case SHARP_IFNDEF:
@@ -638,7 +652,7 @@ function_definition(const struct parser_param *param)
 		case SHARP_ELIF:
 		case SHARP_ELSE:
 		case SHARP_ENDIF:
-			condition_macro(param, c);
+			condition_macro(param, st, c);
 			continue;
 		default:
 			break;
@@ -651,16 +665,16 @@ function_definition(const struct parser_param *param)
 		}
 		/* pick up symbol */
 		if (c == SYMBOL)
-			PUT(PARSER_REF_SYM, token, lineno, sp);
+			PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 	}
 	if (c == EOF)
 		return 0;
-	if (peekc(0) == ';') {
-		(void)nexttoken(";", NULL);
+	if (peekc(t, 0) == ';') {
+		(void)nexttoken(t, ";", NULL);
 		return 0;
 	}
 	brace_level = 0;
-	while ((c = nexttoken(",;[](){}=", cpp_reserved_word)) != EOF) {
+	while ((c = nexttoken(t, ",;[](){}=", cpp_reserved_word)) != EOF) {
 		switch (c) {
 		case SHARP_IFDEF:
 		case SHARP_IFNDEF:
@@ -668,13 +682,13 @@ function_definition(const struct parser_param *param)
 		case SHARP_ELIF:
 		case SHARP_ELSE:
 		case SHARP_ENDIF:
-			condition_macro(param, c);
+			condition_macro(param, st, c);
 			continue;
 		case CPP___ATTRIBUTE__:
-			process_attribute(param);
+			process_attribute(param, st);
 			continue;
 		case SHARP_DEFINE:
-			pushbacktoken();
+			pushbacktoken(t);
 			return 0;
 		default:
 			break;
@@ -686,16 +700,16 @@ function_definition(const struct parser_param *param)
 		else if (brace_level == 0 && (c == ';' || c == ','))
 			break;
 		else if (c == '{' /* } */) {
-			pushbacktoken();
+			pushbacktoken(t);
 			return 1;
 		} else if (c == /* { */'}') {
-			pushbacktoken();
+			pushbacktoken(t);
 			break;
 		} else if (c == '=')
 			break;
 		/* pick up symbol */
 		if (c == SYMBOL)
-			PUT(PARSER_REF_SYM, token, lineno, sp);
+			PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 	}
 	return 0;
 }
@@ -704,59 +718,62 @@ function_definition(const struct parser_param *param)
  * condition_macro: 
  *
  *	@param[in]	param
+ *	@param[in]	st	parser state
  *	@param[in]	cc	token
  */
 static void
-condition_macro(const struct parser_param *param, int cc)
+condition_macro(const struct parser_param *param, struct state *st, int cc)
 {
-	cur = &pifstack[piflevel];
+	TOKEN *t = st->t;
+
+	st->cur = &st->pifstack[st->piflevel];
 	if (cc == SHARP_IFDEF || cc == SHARP_IFNDEF || cc == SHARP_IF) {
-		DBG_PRINT(piflevel, "#if");
-		if (++piflevel >= MAXPIFSTACK)
-			die("#if pifstack over flow. [%s]", curfile);
-		++cur;
-		cur->start = level;
-		cur->end = -1;
-		cur->if0only = 0;
-		if (peekc(0) == '0')
-			cur->if0only = 1;
-		else if ((cc = nexttoken(NULL, cpp_reserved_word)) == SYMBOL && !strcmp(token, "notdef"))
-			cur->if0only = 1;
+		DBG_PRINT(st->piflevel, "#if");
+		if (++st->piflevel >= MAXPIFSTACK)
+			die("#if pifstack over flow. [%s]", t->curfile);
+		++st->cur;
+		st->cur->start = st->level;
+		st->cur->end = -1;
+		st->cur->if0only = 0;
+		if (peekc(t, 0) == '0')
+			st->cur->if0only = 1;
+		else if ((cc = nexttoken(t, NULL, cpp_reserved_word)) == SYMBOL && !strcmp(t->token, "notdef"))
+			st->cur->if0only = 1;
 		else
-			pushbacktoken();
+			pushbacktoken(t);
 	} else if (cc == SHARP_ELIF || cc == SHARP_ELSE) {
-		DBG_PRINT(piflevel - 1, "#else");
-		if (cur->end == -1)
-			cur->end = level;
-		else if (cur->end != level && (param->flags & PARSER_WARNING))
-			warning("uneven level. [+%d %s]", lineno, curfile);
-		level = cur->start;
-		cur->if0only = 0;
+		DBG_PRINT(st->piflevel - 1, "#else");
+		if (st->cur->end == -1)
+			st->cur->end = st->level;
+		else if (st->cur->end != st->level && (param->flags & PARSER_WARNING))
+			warning("uneven level. [+%d %s]", t->lineno, t->curfile);
+		st->level = st->cur->start;
+		st->cur->if0only = 0;
 	} else if (cc == SHARP_ENDIF) {
 		int minus = 0;
 
-		--piflevel;
-		if (piflevel < 0) {
+		--st->piflevel;
+		if (st->piflevel < 0) {
 			minus = 1;
-			piflevel = 0;
+			st->piflevel = 0;
 		}
-		DBG_PRINT(piflevel, "#endif");
+		DBG_PRINT(st->piflevel, "#endif");
 		if (minus) {
 			if (param->flags & PARSER_WARNING)
-				warning("unmatched #if block. reseted. [+%d %s]", lineno, curfile);
+				warning("unmatched #if block. reseted. [+%d %s]", t->lineno, t->curfile);
 		} else {
-			if (cur->if0only)
-				level = cur->start;
-			else if (cur->end != -1) {
-				if (cur->end != level && (param->flags & PARSER_WARNING))
-					warning("uneven level. [+%d %s]", lineno, curfile);
-				level = cur->end;
+			if (st->cur->if0only)
+				st->level = st->cur->start;
+			else if (st->cur->end != -1) {
+				if (st->cur->end != st->level && (param->flags & PARSER_WARNING))
+					warning("uneven level. [+%d %s]", t->lineno, t->curfile);
+				st->level = st->cur->end;
 			}
 		}
 	}
-	while ((cc = nexttoken(NULL, cpp_reserved_word)) != EOF && cc != '\n') {
-                if (cc == SYMBOL && strcmp(token, "defined") != 0) {
-			PUT(PARSER_REF_SYM, token, lineno, sp);
+	while ((cc = nexttoken(t, NULL, cpp_reserved_word)) != EOF && cc != '\n') {
+                if (cc == SYMBOL && strcmp(t->token, "defined") != 0) {
+			PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 		}
 	}
 }
@@ -765,13 +782,14 @@ condition_macro(const struct parser_param *param, int cc)
  * enumerator_list: process "symbol (= expression), ... "}
  */
 static int
-enumerator_list(const struct parser_param *param)
+enumerator_list(const struct parser_param *param, struct state *st)
 {
-	int savelevel = level;
+	TOKEN *t = st->t;
+	int savelevel = st->level;
 	int in_expression = 0;
 	int c = '{';
 
-	for (; c != EOF; c = nexttoken("{}(),=", cpp_reserved_word)) {
+	for (; c != EOF; c = nexttoken(t, "{}(),=", cpp_reserved_word)) {
 		switch (c) {
 		case SHARP_IFDEF:
 		case SHARP_IFNDEF:
@@ -779,25 +797,25 @@ enumerator_list(const struct parser_param *param)
 		case SHARP_ELIF:
 		case SHARP_ELSE:
 		case SHARP_ENDIF:
-			condition_macro(param, c);
+			condition_macro(param, st, c);
 			break;
 		case SYMBOL:
 			if (in_expression)
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			else
-				PUT(PARSER_DEF, token, lineno, sp);
+				PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 			break;
 		case '{':
 		case '(':
-			level++;
+			st->level++;
 			break;
 		case '}':
 		case ')':
-			if (--level == savelevel)
+			if (--st->level == savelevel)
 				return c;
 			break;
 		case ',':
-			if (level == savelevel + 1)
+			if (st->level == savelevel + 1)
 				in_expression = 0;
 			break;
 		case '=':
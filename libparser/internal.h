@@ -25,15 +25,20 @@
 #include "strbuf.h"
 #include "token.h"
 
+/*
+ * PUT() and DBG_PRINT() refer to 'param' and 'st' of the caller.
+ * The parser state 'st' should have the tokenizer 't' and the brace
+ * level 'level'.
+ */
 #define PUT(type, tag, lno, line) do {					\
-	DBG_PRINT(level, line);						\
-	param->put(type, tag, lno, curfile, line, param->arg);		\
+	DBG_PRINT(st->level, line);					\
+	param->put(type, tag, lno, param->file, line, param->arg);	\
 } while (0)
 
 #ifdef DEBUG
 #define DBG_PRINT(level, a) do {					\
 	if (param->flags & PARSER_DEBUG)				\
-		dbg_print(level, a);					\
+		dbg_print(level, st->t->lineno, a);			\
 } while (0)
 #else
 #define DBG_PRINT(level, a) do {} while (0)
@@ -47,7 +52,7 @@ void java(const struct parser_param *);
 void php(const struct parser_param *);
 void assembly(const struct parser_param *);
 
-void dbg_print(int, const char *);
+void dbg_print(int, int, const char *);
 
 extern STRBUF *asm_symtable;
 void asm_initscan(void);
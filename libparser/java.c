@@ -36,6 +36,14 @@
 #define MAXCOMPLETENAME 1024            /* max size of complete name of class */
 #define MAXCLASSSTACK   100             /* max size of class stack */
 
+/*
+ * Parser state.
+ */
+struct state {
+	TOKEN *t;					/* tokenizer */
+	int level;					/* brace level */
+};
+
 /*
  * java: read java file and pickup tag entries.
  */
@@ -43,7 +51,8 @@ void
 java(const struct parser_param *param)
 {
 	int c;
-	int level;					/* brace level */
+	struct state state, *st = &state;
+	TOKEN *t;
 	int startclass, startthrows, startequal;
 	char classname[MAXTOKEN];
 	char completename[MAXCOMPLETENAME];
@@ -59,64 +68,65 @@ java(const struct parser_param *param)
 	stack[0].classname = completename;
 	stack[0].terminate = completename;
 	stack[0].level = 0;
-	level = classlevel = 0;
+	st->level = classlevel = 0;
 	startclass = startthrows = startequal = 0;
 
-	if (!opentoken(param->file))
+	if ((t = opentoken(param->file)) == NULL)
 		die("'%s' cannot open.", param->file);
-	while ((c = nexttoken(interested, java_reserved_word)) != EOF) {
+	st->t = t;
+	while ((c = nexttoken(t, interested, java_reserved_word)) != EOF) {
 		switch (c) {
 		case SYMBOL:					/* symbol */
-			for (; c == SYMBOL && peekc(1) == '.'; c = nexttoken(interested, java_reserved_word)) {
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+			for (; c == SYMBOL && peekc(t, 1) == '.'; c = nexttoken(t, interested, java_reserved_word)) {
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			}
 			if (c != SYMBOL)
 				break;
 			if (startclass || startthrows) {
-				PUT(PARSER_REF_SYM, token, lineno, sp);
-			} else if (peekc(0) == '('/* ) */) {
-				if (level == stack[classlevel].level && !startequal)
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
+			} else if (peekc(t, 0) == '('/* ) */) {
+				if (st->level == stack[classlevel].level && !startequal)
 					/* ignore constructor */
-					if (strcmp(stack[classlevel].classname, token))
-						PUT(PARSER_DEF, token, lineno, sp);
-				if (level > stack[classlevel].level || startequal)
-					PUT(PARSER_REF_SYM, token, lineno, sp);
+					if (strcmp(stack[classlevel].classname, t->token))
+						PUT(PARSER_DEF, t->token, t->lineno, t->sp);
+				if (st->level > stack[classlevel].level || startequal)
+					PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			} else {
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			}
 			break;
 		case '{': /* } */
-			DBG_PRINT(level, "{");	/* } */
+			DBG_PRINT(st->level, "{");	/* } */
 
-			++level;
+			++st->level;
 			if (startclass) {
 				char *p = stack[classlevel].terminate;
 				char *q = classname;
 
 				if (++classlevel >= MAXCLASSSTACK)
-					die("class stack over flow.[%s]", curfile);
+					die("class stack over flow.[%s]", t->curfile);
 				if (classlevel > 1)
 					*p++ = '.';
 				stack[classlevel].classname = p;
 				while (*q)
 					*p++ = *q++;
 				stack[classlevel].terminate = p;
-				stack[classlevel].level = level;
+				stack[classlevel].level = st->level;
 				*p++ = 0;
 			}
 			startclass = startthrows = 0;
 			break;
 			/* { */
 		case '}':
-			if (--level < 0) {
+			if (--st->level < 0) {
 				if (param->flags & PARSER_WARNING)
-					warning("missing left '{' (at %d).", lineno); /* } */
-				level = 0;
+					warning("missing left '{' (at %d).", t->lineno); /* } */
+				st->level = 0;
 			}
-			if (level < stack[classlevel].level)
+			if (st->level < stack[classlevel].level)
 				*(stack[--classlevel].terminate) = 0;
 			/* { */
-			DBG_PRINT(level, "}");
+			DBG_PRINT(st->level, "}");
 			break;
 		case '=':
 			startequal = 1;
@@ -127,18 +137,18 @@ java(const struct parser_param *param)
 		case JAVA_CLASS:
 		case JAVA_INTERFACE:
 		case JAVA_ENUM:
-			if ((c = nexttoken(interested, java_reserved_word)) == SYMBOL) {
-				strlimcpy(classname, token, sizeof(classname));
+			if ((c = nexttoken(t, interested, java_reserved_word)) == SYMBOL) {
+				strlimcpy(classname, t->token, sizeof(classname));
 				startclass = 1;
-				PUT(PARSER_DEF, token, lineno, sp);
+				PUT(PARSER_DEF, t->token, t->lineno, t->sp);
 			}
 			break;
 		case JAVA_NEW:
 		case JAVA_INSTANCEOF:
-			while ((c = nexttoken(interested, java_reserved_word)) == SYMBOL && peekc(1) == '.')
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+			while ((c = nexttoken(t, interested, java_reserved_word)) == SYMBOL && peekc(t, 1) == '.')
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			if (c == SYMBOL)
-				PUT(PARSER_REF_SYM, token, lineno, sp);
+				PUT(PARSER_REF_SYM, t->token, t->lineno, t->sp);
 			break;
 		case JAVA_THROWS:
 			startthrows = 1;
@@ -152,12 +162,12 @@ java(const struct parser_param *param)
 		case JAVA_LONG:
 		case JAVA_SHORT:
 		case JAVA_VOID:
-			if (peekc(1) == '.' && (c = nexttoken(interested, java_reserved_word)) != JAVA_CLASS)
-				pushbacktoken();
+			if (peekc(t, 1) == '.' && (c = nexttoken(t, interested, java_reserved_word)) != JAVA_CLASS)
+				pushbacktoken(t);
 			break;
 		default:
 			break;
 		}
 	}
-	closetoken();
+	closetoken(t);
 }
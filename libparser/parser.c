@@ -450,7 +450,7 @@ parse_file(const char *path, int flags, PARSER_CALLBACK put, void *arg)
 }
 
 void
-dbg_print(int level, const char *s)
+dbg_print(int level, int lineno, const char *s)
 {
 	fprintf(stderr, "[%04d]", lineno);
 	for (; level > 0; level--)
@@ -0,0 +1,484 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "bloom.h"
+#include "checkalloc.h"
+#include "strbuf.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/*
+
+Bloom filter of the keys of a tag file
+
+global(1) looks up many names which are not defined at all. A Bloom filter
+answers 'not defined' with a few bit tests, while the B-tree needs a descent
+from the root to a leaf. The filter never says 'not defined' for a defined
+name. It may say 'may be defined' for a name which is not defined (about 1%).
+
+This is a blocked Bloom filter: all the bits of a key are in one block of
+512 bits (64 bytes), so a lookup touches only one cache line of the file.
+
+File format (in the byte order of the host):
+
+	offset	length
+	0	8	magic "GBLOOM1\n"
+	8	8	stamp of the tag file
+	16	8	number of blocks
+	24	8	number of keys
+	32	32	reserved
+	64	...	blocks
+
+The stamp is a hash value of the filter, so the same keys always make
+the same file. It is also recorded in the tag file. If they are not the
+same, the filter is out of date and must not be used.
+
+When keys are added to a loaded filter, its size is not changed.
+If the number of keys exceeds the capacity, bloom_isfull() returns 1.
+Then bloom_reset() clears the filter except for the keys added after
+loading, and the other keys should be added again.
+
+	[create]
+	bloom = bloom_create();
+	bloom_add(bloom, key); ...
+	bloom_write(bloom, path);
+	=> record bloom->stamp in the tag file
+	bloom_close(bloom);
+
+	[update]
+	bloom = bloom_load(path, stamp);
+	bloom_add(bloom, key); ...
+	if (bloom_isfull(bloom)) {
+		bloom_reset(bloom);
+		bloom_add(bloom, key); ... (the keys before the update)
+	}
+	bloom_write(bloom, path);
+	=> record bloom->stamp in the tag file
+	bloom_close(bloom);
+
+	[read]
+	bloom = bloom_open(path, stamp);
+	if (!bloom_test(bloom, key))
+		=> not defined
+	bloom_close(bloom);
+*/
+#define BLOOM_MAGIC	"GBLOOM1\n"
+#define BLOOM_HEADER	64
+#define BLOOM_BLOCK	64
+		/** number of bits per key */
+#define BLOOM_BITS	12
+		/** number of bits set for a key */
+#define BLOOM_PROBES	7
+
+typedef struct {
+	char magic[8];
+	unsigned long long stamp;
+	unsigned long long nblocks;
+	unsigned long long nkeys;
+} BLOOMHEADER;
+
+/**
+ * hash: compute the hash value of a key (FNV-1a and a finalizer).
+ */
+static unsigned long long
+hash(const char *key)
+{
+	const unsigned char *p = (const unsigned char *)key;
+	unsigned long long h = 0xcbf29ce484222325ULL;
+
+	for (; *p; p++) {
+		h ^= *p;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+static unsigned long long
+mix(unsigned long long h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+/**
+ * setbits: set the bits of a hash value.
+ */
+static void
+setbits(BLOOM *bloom, unsigned long long h)
+{
+	unsigned char *block = bloom->bits + (mix(h) & (bloom->nblocks - 1)) * BLOOM_BLOCK;
+	unsigned long long h2 = mix(h ^ 0x9e3779b97f4a7c15ULL);
+	int i;
+
+	for (i = 0; i < BLOOM_PROBES; i++, h2 >>= 9)
+		block[(h2 & 511) >> 3] |= 1 << (h2 & 7);
+}
+/**
+ * testbits: test the bits of a hash value.
+ *
+ *	@return		1: may be added, 0: not added
+ */
+static int
+testbits(BLOOM *bloom, unsigned long long h)
+{
+	const unsigned char *block = bloom->bits + (mix(h) & (bloom->nblocks - 1)) * BLOOM_BLOCK;
+	unsigned long long h2 = mix(h ^ 0x9e3779b97f4a7c15ULL);
+	int i;
+
+	for (i = 0; i < BLOOM_PROBES; i++, h2 >>= 9)
+		if (!(block[(h2 & 511) >> 3] & (1 << (h2 & 7))))
+			return 0;
+	return 1;
+}
+/**
+ * digest: compute the stamp of a filter from its contents.
+ */
+static unsigned long long
+digest(BLOOM *bloom)
+{
+	const unsigned char *p = bloom->bits;
+	const unsigned char *end = p + bloom->nblocks * BLOOM_BLOCK;
+	unsigned long long h = 0xcbf29ce484222325ULL;
+
+	h = mix(h ^ bloom->nblocks);
+	h = mix(h ^ bloom->nkeys);
+	for (; p < end; p++) {
+		h ^= *p;
+		h *= 0x100000001b3ULL;
+	}
+	return mix(h);
+}
+/**
+ * readheader: read and check the header of a filter file.
+ *
+ *	@param[in]	fd	file descriptor
+ *	@param[in]	stamp	stamp of the tag file
+ *	@param[out]	hd	header
+ *	@return		0: valid, -1: invalid or out of date
+ */
+static int
+readheader(int fd, unsigned long long stamp, BLOOMHEADER *hd)
+{
+	struct stat st;
+
+	if (fstat(fd, &st) < 0)
+		return -1;
+	if (read(fd, hd, sizeof(*hd)) != sizeof(*hd))
+		return -1;
+	if (memcmp(hd->magic, BLOOM_MAGIC, sizeof(hd->magic)) || hd->stamp != stamp)
+		return -1;
+	if (hd->nblocks == 0 || (hd->nblocks & (hd->nblocks - 1)))
+		return -1;
+	if (st.st_size != BLOOM_HEADER + hd->nblocks * BLOOM_BLOCK)
+		return -1;
+	return 0;
+}
+/**
+ * bloom_open: open a filter file for reading.
+ *
+ *	@param[in]	path	path of the filter file
+ *	@param[in]	stamp	stamp recorded in the tag file
+ *	@return		filter or NULL (not found or out of date)
+ */
+BLOOM *
+bloom_open(const char *path, unsigned long long stamp)
+{
+#ifdef HAVE_MMAP
+	BLOOMHEADER hd;
+	BLOOM *bloom;
+	void *map;
+	size_t size;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY | O_BINARY)) < 0)
+		return NULL;
+	if (readheader(fd, stamp, &hd) < 0) {
+		close(fd);
+		return NULL;
+	}
+	size = BLOOM_HEADER + hd.nblocks * BLOOM_BLOCK;
+	map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+	bloom = (BLOOM *)check_calloc(sizeof(BLOOM), 1);
+	bloom->stamp = stamp;
+	bloom->nblocks = hd.nblocks;
+	bloom->nkeys = hd.nkeys;
+	bloom->map = map;
+	bloom->mapsize = size;
+	bloom->bits = (unsigned char *)map + BLOOM_HEADER;
+	return bloom;
+#else
+	return bloom_load(path, stamp);
+#endif
+}
+/**
+ * bloom_load: load a filter file to add keys.
+ *
+ *	@param[in]	path	path of the filter file
+ *	@param[in]	stamp	stamp recorded in the tag file
+ *	@return		filter or NULL (not found or out of date)
+ */
+BLOOM *
+bloom_load(const char *path, unsigned long long stamp)
+{
+	BLOOMHEADER hd;
+	BLOOM *bloom;
+	size_t size;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY | O_BINARY)) < 0)
+		return NULL;
+	if (readheader(fd, stamp, &hd) < 0) {
+		close(fd);
+		return NULL;
+	}
+	size = hd.nblocks * BLOOM_BLOCK;
+	bloom = (BLOOM *)check_calloc(sizeof(BLOOM), 1);
+	bloom->bits = (unsigned char *)check_malloc(size);
+	if (lseek(fd, BLOOM_HEADER, SEEK_SET) != BLOOM_HEADER
+	    || (size_t)read(fd, bloom->bits, size) != size) {
+		close(fd);
+		bloom_close(bloom);
+		return NULL;
+	}
+	close(fd);
+	bloom->stamp = stamp;
+	bloom->nblocks = hd.nblocks;
+	bloom->nkeys = hd.nkeys;
+	bloom->added = varray_open(sizeof(unsigned long long), 1024);
+	return bloom;
+}
+/**
+ * bloom_create: create a new filter.
+ *
+ *	@return		filter
+ *
+ * The size is decided by the number of keys in bloom_write().
+ */
+BLOOM *
+bloom_create(void)
+{
+	BLOOM *bloom = (BLOOM *)check_calloc(sizeof(BLOOM), 1);
+
+	bloom->hashes = varray_open(sizeof(unsigned long long), 1024);
+	return bloom;
+}
+/**
+ * bloom_add: add a key.
+ *
+ *	@param[in]	bloom	filter
+ *	@param[in]	key	key
+ */
+void
+bloom_add(BLOOM *bloom, const char *key)
+{
+	if (bloom->hashes) {
+		unsigned long long *hp = varray_append(bloom->hashes);
+		*hp = hash(key);
+	} else {
+		unsigned long long h = hash(key);
+
+		/* A key which seems to be added already is not counted. */
+		if (!testbits(bloom, h)) {
+			setbits(bloom, h);
+			bloom->nkeys++;
+		}
+		if (bloom->added) {
+			unsigned long long *hp = varray_append(bloom->added);
+			*hp = h;
+		}
+	}
+}
+/**
+ * bloom_test: test whether a key may have been added.
+ *
+ *	@param[in]	bloom	filter
+ *	@param[in]	key	key
+ *	@return		1: may have been added, 0: never added
+ */
+int
+bloom_test(BLOOM *bloom, const char *key)
+{
+	if (bloom->hashes)
+		return 1;
+	return testbits(bloom, hash(key));
+}
+/**
+ * bloom_isfull: test whether a filter has more keys than its capacity.
+ *
+ *	@param[in]	bloom	filter
+ *	@return		1: full, 0: not full
+ *
+ * The false positive rate of a full filter is higher than designed.
+ */
+int
+bloom_isfull(BLOOM *bloom)
+{
+	if (bloom->hashes)
+		return 0;
+	return bloom->nkeys * BLOOM_BITS > bloom->nblocks * BLOOM_BLOCK * 8;
+}
+/**
+ * bloom_reset: clear a loaded filter to make it again.
+ *
+ *	@param[in]	bloom	filter
+ *
+ * Only the keys added after loading remain. The size is decided again
+ * by bloom_write().
+ */
+void
+bloom_reset(BLOOM *bloom)
+{
+	if (bloom->hashes || bloom->map)
+		return;
+	free(bloom->bits);
+	bloom->bits = NULL;
+	bloom->nblocks = bloom->nkeys = 0;
+	bloom->hashes = bloom->added;
+	bloom->added = NULL;
+}
+static int
+compare_hash(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+/**
+ * bloom_write: write a filter to a file.
+ *
+ *	@param[in]	bloom	filter
+ *	@param[in]	path	path of the filter file
+ *	@return		0: normal, -1: error
+ *
+ * The stamp of the filter is set to bloom->stamp.
+ * The file is written under a temporary name and renamed, so readers
+ * never see a half-written filter.
+ */
+int
+bloom_write(BLOOM *bloom, const char *path)
+{
+	STRBUF *tmp;
+	BLOOMHEADER hd;
+	char reserved[BLOOM_HEADER - sizeof(BLOOMHEADER)];
+	FILE *op;
+	int ret = 0;
+
+	/*
+	 * Decide the size from the number of distinct keys, and set bits.
+	 */
+	if (bloom->hashes) {
+		unsigned long long *hashes = (unsigned long long *)bloom->hashes->vbuf;
+		int n = bloom->hashes->length, i;
+		unsigned long long nkeys = 0;
+
+		qsort(hashes, n, sizeof(*hashes), compare_hash);
+		for (i = 0; i < n; i++)
+			if (i == 0 || hashes[i] != hashes[i - 1])
+				nkeys++;
+		for (bloom->nblocks = 1;
+		     bloom->nblocks * BLOOM_BLOCK * 8 < nkeys * BLOOM_BITS;
+		     bloom->nblocks <<= 1)
+			;
+		bloom->bits = (unsigned char *)check_calloc(bloom->nblocks, BLOOM_BLOCK);
+		for (i = 0; i < n; i++)
+			if (i == 0 || hashes[i] != hashes[i - 1])
+				setbits(bloom, hashes[i]);
+		bloom->nkeys = nkeys;
+		varray_close(bloom->hashes);
+		bloom->hashes = NULL;
+	}
+	memset(&hd, 0, sizeof(hd));
+	memcpy(hd.magic, BLOOM_MAGIC, sizeof(hd.magic));
+	hd.stamp = bloom->stamp = digest(bloom);
+	hd.nblocks = bloom->nblocks;
+	hd.nkeys = bloom->nkeys;
+	memset(reserved, 0, sizeof(reserved));
+	tmp = strbuf_open(0);
+	strbuf_sprintf(tmp, "%s.%d", path, (int)getpid());
+	if ((op = fopen(strbuf_value(tmp), "wb")) == NULL) {
+		strbuf_close(tmp);
+		return -1;
+	}
+	if (fwrite(&hd, sizeof(hd), 1, op) != 1
+	    || fwrite(reserved, sizeof(reserved), 1, op) != 1
+	    || fwrite(bloom->bits, BLOOM_BLOCK, bloom->nblocks, op) != bloom->nblocks)
+		ret = -1;
+	if (fclose(op) != 0)
+		ret = -1;
+	if (ret == 0 && rename(strbuf_value(tmp), path) < 0)
+		ret = -1;
+	if (ret < 0)
+		(void)unlink(strbuf_value(tmp));
+	strbuf_close(tmp);
+	return ret;
+}
+/**
+ * bloom_close: close a filter.
+ *
+ *	@param[in]	bloom	filter
+ */
+void
+bloom_close(BLOOM *bloom)
+{
+#ifdef HAVE_MMAP
+	if (bloom->map)
+		munmap(bloom->map, bloom->mapsize);
+	else
+#endif
+	if (bloom->bits)
+		free(bloom->bits);
+	if (bloom->hashes)
+		varray_close(bloom->hashes);
+	if (bloom->added)
+		varray_close(bloom->added);
+	free(bloom);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _BLOOM_H
+#define _BLOOM_H
+
+#include "varray.h"
+
+/** Bloom filter of the keys of a tag file */
+typedef struct {
+	unsigned long long stamp;	/**< stamp of the tag file */
+	unsigned long long nblocks;	/**< number of blocks (power of 2) */
+	unsigned long long nkeys;	/**< number of keys added */
+	unsigned char *bits;		/**< bit array or NULL */
+	void *map;			/**< mapped file or NULL */
+	size_t mapsize;			/**< size of the mapping */
+	VARRAY *hashes;			/**< hash values to be added */
+	VARRAY *added;			/**< hash values added after loading */
+} BLOOM;
+
+BLOOM *bloom_open(const char *, unsigned long long);
+BLOOM *bloom_load(const char *, unsigned long long);
+BLOOM *bloom_create(void);
+void bloom_add(BLOOM *, const char *);
+int bloom_test(BLOOM *, const char *);
+int bloom_isfull(BLOOM *);
+void bloom_reset(BLOOM *);
+int bloom_write(BLOOM *, const char *);
+void bloom_close(BLOOM *);
+
+#endif /* ! _BLOOM_H */
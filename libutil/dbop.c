@@ -44,8 +44,9 @@
 #include "checkalloc.h"
 #include "dbop.h"
 #include "die.h"
-#include "env.h"
+#include "extsort.h"
 #include "locatestring.h"
+#include "statistics.h"
 #include "strbuf.h"
 #include "strlimcpy.h"
 #include "test.h"
@@ -55,8 +56,7 @@ int is_sqlite3(const char *);
 DBOP *dbop3_open(const char *, int, int, int);
 const char *dbop3_get(DBOP *, const char *);
 const char *dbop3_getflag(DBOP *);
-char *dbop3_quote(char *);
-void dbop3_put(DBOP *, const char *, const char *, const char *);
+void dbop3_put(DBOP *, const char *, const char *, const char *, int);
 void dbop3_delete(DBOP *, const char *);
 void dbop3_update(DBOP *, const char *, const char *);
 const char *dbop3_first(DBOP *, const char *, regex_t *, int);
@@ -71,122 +71,16 @@ void dbop3_close(DBOP *);
 #define ismeta(p)	(*((char *)(p)) <= ' ')
 
 /**
- * Stuff for DBOP_SORTED_WRITE
+ * setlast: make a record the last located record
  */
-#define SORT_SEP '\t'
-
-/**
- * Two functions required for sorted writing.
- *
- * static void start_sort_process(DBOP *dbop)
- * (1) start_sort_process: start sort process for sorted writing
- *
- *	@param[in]	dbop	DBOP descriptor
- *
- * static void terminate_sort_process(DBOP *dbop)
- * (2) terminate_sort_process: terminate sort process
- *
- *	@param[in]	dbop	DBOP descriptor
- */
-static void start_sort_process(DBOP *);
-static void terminate_sort_process(DBOP *);
-static char *sortnotfound = "POSIX sort program not found. If available, the program will be speed up.\nPlease see ./configure --help.";
-/*
- * 1. DJGPP/Windows
- */
-#if defined(__DJGPP__) || defined(_WIN32)
-/*
- * Just ignored. DJGPP version doesn't use sorted writing; Windows (including
- * Cygwin) is slightly quicker without it.
- */
-static void
-start_sort_process(DBOP *dbop) {
-	return;
-}
-static void
-terminate_sort_process(DBOP *dbop) {
-	return;
-}
-/*
- * 2. UNIX
- */
-#else
-#include <sys/wait.h>
-/*
- * Though it doesn't understand why, GNU sort with no option is faster
- * than 'sort -k 1,1'. But we should use '-k 1,1' here not to rely on
- * a specific command.
- */
-static char *argv[] = {
-	POSIX_SORT,
-	"-k",
-	"1,1",
-	NULL
-};
-static void
-start_sort_process(DBOP *dbop) {
-	int opipe[2], ipipe[2];
-
-	if (!strcmp(POSIX_SORT, "no"))
-		return;
-	if (!test("fx", POSIX_SORT)) {
-		static int informed;
-
-		if (!informed) {
-			warning("%s", sortnotfound);
-			informed = 1;
-		}
-		return;
-	}
-	/*
-	 * Setup pipe for two way communication
-	 *
-	 *	Parent(gtags)				Child(sort)
-	 *	---------------------------------------------------
-	 *	(dbop->sortout) opipe[1] =====> opipe[0] (stdin)
-	 *	(dbop->sortin)  ipipe[0] <===== ipipe[1] (stdout)
-	 */
-	if (pipe(opipe) < 0 || pipe(ipipe) < 0)
-		die("pipe(2) failed.");
-	dbop->pid = fork();
-	if (dbop->pid == 0) {
-		/* child process */
-		close(opipe[1]);
-		close(ipipe[0]);
-		if (dup2(opipe[0], 0) < 0 || dup2(ipipe[1], 1) < 0)
-			die("dup2(2) failed.");
-		close(opipe[0]);
-		close(ipipe[1]);
-		/*
-		 * Use C locale in order to avoid the degradation of performance 	 
-		 * by internationalized sort command. 	 
-		 */
-		set_env("LC_ALL", "C");
-		execvp(POSIX_SORT, argv);
-	} else if (dbop->pid < 0)
-		die("fork(2) failed.");
-	/* parent process */
-	close(opipe[0]);
-	close(ipipe[1]);
-	fcntl(ipipe[0], F_SETFD, FD_CLOEXEC);
-	fcntl(opipe[1], F_SETFD, FD_CLOEXEC);
-	dbop->sortout = fdopen(opipe[1], "w");
-	dbop->sortin = fdopen(ipipe[0], "r");
-	if (dbop->sortout == NULL || dbop->sortin == NULL)
-		die("fdopen(3) failed.");
-}
 static void
-terminate_sort_process(DBOP *dbop) {
-	int ret, status;
-
-	while ((ret = waitpid(dbop->pid, &status, 0)) < 0 && errno == EINTR)
-		;
-	if (ret < 0)
-		die("waitpid(2) failed.");
-	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
-		die("terminated abnormally. '%s'", POSIX_SORT);
+setlast(DBOP *dbop, const DBOP_RECORD *rec)
+{
+	dbop->lastkey = (char *)rec->key;
+	dbop->lastkeysize = rec->keysize;
+	dbop->lastdat = (char *)rec->dat;
+	dbop->lastsize = rec->datsize;
 }
-#endif
 
 #ifdef USE_SQLITE3
 static const char *sqlite_header = "SQLite format 3";
@@ -205,36 +99,98 @@ is_sqlite3(const char *path) {
 	}
 	return sqlite3;
 }
+/**
+ * is_sqlite3_wal: whether the file is a sqlite3 database in WAL mode
+ *
+ *	@param[in]	path	path of the file
+ *	@return		1: in WAL mode, 0: not
+ *
+ * The read and write versions in the header are 2 in WAL mode.
+ */
+int
+is_sqlite3_wal(const char *path) {
+	char buf[32];
+	int wal = 0;
+	int fd = open(path, 0);
+
+	if (fd >= 0) {
+		if (read(fd, buf, sizeof(buf)) == sizeof(buf)) {
+			if (!strncmp(sqlite_header, buf, strlen(sqlite_header))
+			    && buf[18] == 2 && buf[19] == 2)
+				wal = 1;
+		}
+		close(fd);
+	}
+	return wal;
+}
 #endif
 /**
- * dbop_open: open db database.
+ * dbop_pagesize: page size of a new tag file.
+ *
+ *	@return		page size or 0 (decide it from the records)
+ *
+ * The value of GTAGSPAGESIZE is rounded down to a power of 2 which both
+ * the db library and sqlite3 accept. A value less than DBOP_MINPAGESIZE
+ * is ignored.
+ */
+static int
+dbop_pagesize(void)
+{
+	static int warned;
+	const char *p = getenv("GTAGSPAGESIZE");
+	int psize, size;
+
+	if (p == NULL || (psize = atoi(p)) <= 0)
+		return 0;
+	if (psize < DBOP_MINPAGESIZE) {
+		if (!warned++)
+			warning("GTAGSPAGESIZE less than %d ignored.", DBOP_MINPAGESIZE);
+		return 0;
+	}
+	for (size = DBOP_MINPAGESIZE; size < DBOP_MAXPAGESIZE && size * 2 <= psize; size *= 2)
+		;
+	return size;
+}
+/**
+ * dbop_fitpagesize: page size which fits the records.
+ *
+ *	@param[in]	dbop	descripter
+ *	@return		page size
+ *
+ * A page holds about DBOP_PAGERECORDS records of the average size.
+ * Short records like those of GRTAGS don't need a large page, while
+ * long records like line images in GTAGS would often be put in
+ * overflow pages with a small page.
+ */
+static int
+dbop_fitpagesize(DBOP *dbop)
+{
+	unsigned long recsize;
+	int size;
+
+	if (dbop->nrecords == 0)
+		return DBOP_PAGESIZE;
+	/* about 12 bytes are used for the header of a record and the index */
+	recsize = dbop->nbytes / dbop->nrecords + 12;
+	for (size = DBOP_MINAUTOPAGESIZE; size < DBOP_MAXPAGESIZE && size < recsize * DBOP_PAGERECORDS; size *= 2)
+		;
+	return size;
+}
+/**
+ * dbop_dbopen: open a B-tree of the db library.
  *
  *	@param[in]	path	database name
  *	@param[in]	mode	0: read only, 1: create, 2: modify
- *	@param[in]	perm	file permission
- *	@param[in]	flags
- *			DBOP_DUP: allow duplicate records.
- *			DBOP_SORTED_WRITE: use sorted writing. This requires POSIX sort.
- *	@return		descripter for dbop_xxx() or NULL
- *
- * Sorted wirting is fast because all writing is done by not insertion but addition.
+ *	@param[in]	flags	flags of dbop_open()
+ *	@param[in]	psize	page size of a new file
+ *	@return		DB or NULL
  */
-DBOP *
-dbop_open(const char *path, int mode, int perm, int flags)
+static DB *
+dbop_dbopen(const char *path, int mode, int flags, int psize)
 {
-	DB *db;
 	int rw = 0;
-	DBOP *dbop;
 	BTREEINFO info;
 
-#ifdef USE_SQLITE3
-	if (mode != 1 && is_sqlite3(path))
-		flags |= DBOP_SQLITE3;
-	if (flags & DBOP_SQLITE3) {
-		dbop = dbop3_open(path, mode, perm, flags);
-		goto finish;
-	}
-#endif
 	/*
 	 * setup arguments.
 	 */
@@ -254,7 +210,29 @@ dbop_open(const char *path, int mode, int perm, int flags)
 	memset(&info, 0, sizeof(info));
 	if (flags & DBOP_DUP)
 		info.flags |= R_DUP;
-	info.psize = DBOP_PAGESIZE;
+#ifndef USE_DB185_COMPAT
+	/*
+	 * The 2Q policy keeps a long sequential scan from evicting the
+	 * frequently used pages (the root and the internal pages).
+	 */
+	if (flags & DBOP_CACHE2Q)
+		info.flags |= R_CACHE2Q;
+	/*
+	 * Keys sharing a long prefix like path names take less room.
+	 * It is recorded in the file; older versions cannot read it.
+	 */
+	if (flags & DBOP_PFXLEAF)
+		info.flags |= R_PFXLEAF;
+	/*
+	 * Reading need not copy pages into the cache.
+	 */
+	if (mode == 0)
+		info.flags |= R_MMAP;
+#endif
+	/*
+	 * The page size of an existing file is read from the file.
+	 */
+	info.psize = psize;
 	/*
 	 * Decide cache size. The default value is 5MB.
 	 * See libutil/gparam.h for the details.
@@ -264,14 +242,61 @@ dbop_open(const char *path, int mode, int perm, int flags)
 		info.cachesize = atoi(getenv("GTAGSCACHE"));
 	if (info.cachesize < GTAGSMINCACHE)
 		info.cachesize = GTAGSMINCACHE;
+	/*
+	 * Decide the number of pages to read ahead in a sequential scan.
+	 * 0 disables reading ahead.
+	 */
+	info.readahead = GTAGSREADAHEAD;
+	if (getenv("GTAGSREADAHEAD") != NULL) {
+		int readahead = atoi(getenv("GTAGSREADAHEAD"));
+		info.readahead = readahead > 0 ? readahead : 0;
+	}
+	return dbopen(path, rw, 0600, DB_BTREE, &info);
+}
+/**
+ * dbop_open: open db database.
+ *
+ *	@param[in]	path	database name
+ *	@param[in]	mode	0: read only, 1: create, 2: modify
+ *	@param[in]	perm	file permission
+ *	@param[in]	flags
+ *			DBOP_DUP: allow duplicate records.
+ *			DBOP_SORTED_WRITE: use sorted writing.
+ *			DBOP_CACHE2Q: use the scan resistant cache (2Q).
+ *			DBOP_PFXLEAF: compress the keys in leaf pages (new file only).
+ *	@return		descripter for dbop_xxx() or NULL
+ *
+ * Sorted wirting is fast because all writing is done by not insertion but addition.
+ * The records are sorted in process by extsort (see libutil/extsort.c).
+ *
+ * The page size of a new file is GTAGSPAGESIZE if it is set. Otherwise it is
+ * decided from the records when they are written by sorted writing, and is
+ * DBOP_PAGESIZE when not.
+ */
+DBOP *
+dbop_open(const char *path, int mode, int perm, int flags)
+{
+	DB *db;
+	DBOP *dbop;
+	int psize = 0;
 
+#ifdef USE_SQLITE3
+	if (mode != 1 && is_sqlite3(path))
+		flags |= DBOP_SQLITE3;
+	if (flags & DBOP_SQLITE3) {
+		dbop = dbop3_open(path, mode, perm, flags);
+		goto finish;
+	}
+#endif
+	if (mode == 1)
+		psize = dbop_pagesize();
 	/*
 	 * if unlink do job normally, those who already open tag file can use
 	 * it until closing.
 	 */
 	if (path != NULL && mode == 1 && test("f", path))
 		(void)unlink(path);
-	db = dbopen(path, rw, 0600, DB_BTREE, &info);
+	db = dbop_dbopen(path, mode, flags, psize ? psize : DBOP_PAGESIZE);
 	if (!db)
 		return NULL;
 	/*
@@ -296,15 +321,25 @@ dbop_open(const char *path, int mode, int perm, int flags)
 	dbop->db	= db;
 	dbop->openflags	= flags;
 	dbop->perm	= (mode == 1) ? perm : 0;
+	dbop->mode	= mode;
 	dbop->lastdat	= NULL;
 	dbop->lastsize	= 0;
-	dbop->sortout	= NULL;
-	dbop->sortin	= NULL;
+	dbop->sort	= NULL;
+	dbop->autopagesize = (mode == 1 && psize == 0);
 	/*
 	 * Setup sorted writing.
+	 * Decide the memory size for sorting. The default value is 50MB.
+	 * See libutil/gparam.h for the details.
 	 */
-	if (mode != 0 && dbop->openflags & DBOP_SORTED_WRITE)
-		start_sort_process(dbop);
+	if (mode != 0 && dbop->openflags & DBOP_SORTED_WRITE) {
+		long sortmem = GTAGSSORTMEM;
+
+		if (getenv("GTAGSSORTMEM") != NULL)
+			sortmem = atol(getenv("GTAGSSORTMEM"));
+		if (sortmem < GTAGSMINSORTMEM)
+			sortmem = GTAGSMINSORTMEM;
+		dbop->sort = extsort_open(sortmem);
+	}
 #ifdef USE_SQLITE3
 finish:
 #endif
@@ -361,7 +396,7 @@ dbop_put(DBOP *dbop, const char *name, const char *data)
 
 #ifdef USE_SQLITE3
 	if (dbop->openflags & DBOP_SQLITE3) {
-		dbop3_put(dbop, name, data, NULL);
+		dbop3_put(dbop, name, data, NULL, 0);
 		return;
 	}
 #endif
@@ -370,11 +405,10 @@ dbop_put(DBOP *dbop, const char *name, const char *data)
 	if (len > MAXKEYLEN)
 		die("primary key too long.");
 	/* sorted writing */
-	if (dbop->sortout != NULL) {
-		fputs(name, dbop->sortout);
-		putc(SORT_SEP, dbop->sortout);
-		fputs(data, dbop->sortout);
-		putc('\n', dbop->sortout);
+	if (dbop->sort != NULL) {
+		extsort_put(dbop->sort, name, data);
+		dbop->nrecords++;
+		dbop->nbytes += len + strlen(data) + 2;
 		return;
 	}
 	key.data = (char *)name;
@@ -403,7 +437,7 @@ dbop_put_tag(DBOP *dbop, const char *name, const char *data)
 {
 #ifdef USE_SQLITE3
 	if (dbop->openflags & DBOP_SQLITE3) {
-		int len;
+		int len, lineno;
 		char fid[MAXFIDLEN], *q = fid;
 		const char *p = data;
 
@@ -411,6 +445,16 @@ dbop_put_tag(DBOP *dbop, const char *name, const char *data)
 		while (*p && isdigit(*p))
 			*q++ = *p++;
 		*q = '\0';
+		/*
+		 * extract the (first) line number
+		 * Standard format	fid <blank> tag <blank> lineno <blank> image
+		 * Compact format	fid <blank> tag <blank> lineno,...
+		 */
+		if (*p == ' ')
+			p++;
+		while (*p && *p != ' ')
+			p++;
+		lineno = atoi(p);
 		/* trim line */
 		len = strlen(data);
 		if (data[len-1] == '\n')
@@ -424,7 +468,7 @@ dbop_put_tag(DBOP *dbop, const char *name, const char *data)
 			strbuf_nputs(sb, data, len);
 			data = strbuf_value(sb);
 		}
-		dbop3_put(dbop, name, data, fid);
+		dbop3_put(dbop, name, data, fid, lineno);
 		return;
 	}
 #endif
@@ -452,7 +496,7 @@ dbop_put_path(DBOP *dbop, const char *name, const char *data, const char *flag)
 
 #ifdef USE_SQLITE3
 	if (dbop->openflags & DBOP_SQLITE3) {
-		dbop3_put(dbop, name, data, flag);
+		dbop3_put(dbop, name, data, flag, 0);
 		return;
 	}
 #endif
@@ -506,6 +550,84 @@ dbop_delete(DBOP *dbop, const char *path)
 	if (status == RET_ERROR)
 		die("dbop_delete failed.");
 }
+#ifndef USE_DB185_COMPAT
+/** argument of delete_if() */
+struct delete_if_arg {
+	DBOP *dbop;
+	int (*func)(const char *, const char *, void *);
+	void *arg;
+	int count;
+};
+/**
+ * delete_if: predicate for __bt_bulk_delete()
+ */
+static int
+delete_if(const DBT *key, const DBT *dat, void *p)
+{
+	struct delete_if_arg *a = (struct delete_if_arg *)p;
+
+	a->dbop->readcount++;
+	if (ismeta(key->data) && !(a->dbop->openflags & DBOP_RAW))
+		return 0;
+	if (!(*a->func)((char *)key->data, (char *)dat->data, a->arg))
+		return 0;
+	a->count++;
+	return 1;
+}
+#endif
+/**
+ * dbop_delete_if: delete records which satisfy a condition.
+ *
+ *	@param[in]	dbop	descripter
+ *	@param[in]	path	key, NULL: all records
+ *	@param[in]	func	condition; called with the key, the data and arg,
+ *				returns non-zero for a record to be deleted
+ *	@param[in]	arg	argument of func
+ *	@return		number of deleted records
+ *
+ * All the records are deleted in a pass over the B-tree, instead of
+ * deleting them one by one at the cursor. Meta records are not deleted.
+ * The position of dbop_first() and dbop_next() is lost.
+ */
+int
+dbop_delete_if(DBOP *dbop, const char *path, int (*func)(const char *, const char *, void *), void *arg)
+{
+	const char *p;
+	int count = 0;
+
+#ifndef USE_DB185_COMPAT
+#ifdef USE_SQLITE3
+	if (!(dbop->openflags & DBOP_SQLITE3))
+#endif
+	{
+		struct delete_if_arg a;
+		DBT key;
+
+		a.dbop = dbop;
+		a.func = func;
+		a.arg = arg;
+		a.count = 0;
+		if (path) {
+			key.data = (char *)path;
+			key.size = strlen(path)+1;
+		}
+		if (__bt_bulk_delete(dbop->db, path ? &key : NULL, path ? &key : NULL,
+						delete_if, &a) == RET_ERROR)
+			die("dbop_delete_if failed.");
+		return a.count;
+	}
+#endif
+	/*
+	 * Sqlite3 and DB 1.85 delete at the cursor.
+	 */
+	for (p = dbop_first(dbop, path, NULL, 0); p; p = dbop_next(dbop)) {
+		if ((*func)(dbop->lastkey, p, arg)) {
+			dbop_delete(dbop, NULL);
+			count++;
+		}
+	}
+	return count;
+}
 /**
  * dbop_update: update record.
  *
@@ -522,6 +644,25 @@ dbop_update(DBOP *dbop, const char *key, const char *dat)
 #endif
 	dbop_put(dbop, key, dat);
 }
+/**
+ * dbop_setregex: set the source of the regular expression for dbop_first()
+ *
+ *	@param[in]	dbop	dbop descripter
+ *	@param[in]	regex	regular expression compiled to preg of dbop_first(),
+ *			NULL: unknown
+ *	@param[in]	flags	flags of regcomp(3)
+ *
+ * Sqlite3 evaluates the expression in the engine instead of reading
+ * all the records. Other databases use only the compiled one.
+ */
+void
+dbop_setregex(DBOP *dbop, const char *regex, int flags)
+{
+	if (dbop->regex)
+		free(dbop->regex);
+	dbop->regex = regex ? check_strdup(regex) : NULL;
+	dbop->regflags = flags;
+}
 /**
  * dbop_first: get first record. 
  * 
@@ -545,6 +686,9 @@ dbop_first(DBOP *dbop, const char *name, regex_t *preg, int flags)
 
 	dbop->preg = preg;
 	dbop->ioflags = flags;
+	dbop->unread = 0;
+	dbop->npending = 0;
+	dbop->end = 0;
 	if (flags & DBOP_PREFIX && !name)
 		flags &= ~DBOP_PREFIX;
 #ifdef USE_SQLITE3
@@ -630,6 +774,12 @@ dbop_next(DBOP *dbop)
 		dbop->unread = 0;
 		return dbop->lastdat;
 	}
+	if (dbop->npending > 0) {
+		setlast(dbop, dbop->pending);
+		dbop->pending++;
+		dbop->npending--;
+		return (flags & DBOP_KEY) ? dbop->lastkey : dbop->lastdat;
+	}
 #ifdef USE_SQLITE3
 	if (dbop->openflags & DBOP_SQLITE3)
 		return dbop3_next(dbop);
@@ -670,6 +820,130 @@ dbop_next(DBOP *dbop)
 		die("dbop_next failed.");
 	return NULL;
 }
+/**
+ * dbop_next_batch: get next records at once.
+ *
+ *	@param[in]	dbop	dbop descripter
+ *	@param[out]	rec	array of records
+ *	@param[in]	n	size of the array
+ *	@return		number of records, 0: no more record
+ *
+ * It returns the records which dbop_next() would return, but several at
+ * a time, without entering the B-tree for each of them. The records are
+ * not copied: they point into a page of the tree and are valid until the
+ * next call of a dbop function for the dbop. Fewer than n records may be
+ * returned even if more records remain.
+ *
+ * [Note] dbop_next_batch() always skip meta records.
+ */
+int
+dbop_next_batch(DBOP *dbop, DBOP_RECORD *rec, int n)
+{
+#ifndef USE_DB185_COMPAT
+	DB *db = dbop->db;
+	int flags = dbop->ioflags;
+	DBT key[DBOP_BATCHSIZE], dat[DBOP_BATCHSIZE];
+	const char *k, *prev;
+	u_int i, size;
+	int count = 0;
+#endif
+
+	if (n <= 0)
+		return 0;
+	if (dbop->unread) {
+		dbop->unread = 0;
+		rec[0].key = dbop->lastkey;
+		rec[0].keysize = dbop->lastkeysize;
+		rec[0].dat = dbop->lastdat;
+		rec[0].datsize = dbop->lastsize;
+		return 1;
+	}
+	if (dbop->npending > 0) {
+		if (n > dbop->npending)
+			n = dbop->npending;
+		memmove(rec, dbop->pending, sizeof(DBOP_RECORD) * n);
+		dbop->pending += n;
+		dbop->npending -= n;
+		setlast(dbop, &rec[n - 1]);
+		return n;
+	}
+#ifndef USE_DB185_COMPAT
+#ifdef USE_SQLITE3
+	if (!(dbop->openflags & DBOP_SQLITE3))
+#endif
+	{
+		if (dbop->end)
+			return 0;
+		do {
+			size = n < DBOP_BATCHSIZE ? n : DBOP_BATCHSIZE;
+			switch (__bt_seqbatch(db, key, dat, &size, R_NEXT)) {
+			case RET_SUCCESS:
+				break;
+			case RET_ERROR:
+				die("dbop_next_batch failed.");
+			case RET_SPECIAL:
+				dbop->end = 1;
+				return 0;
+			}
+			/*
+			 * The same checks as dbop_next(). The previous key is
+			 * copied only once for each page.
+			 */
+			prev = dbop->prev;
+			for (i = 0; i < size; i++) {
+				dbop->readcount++;
+				k = (char *)key[i].data;
+				if (!(dbop->openflags & DBOP_RAW)) {
+					if (flags & DBOP_KEY && ismeta(k))
+						continue;
+					else if (ismeta(dat[i].data))
+						continue;
+				}
+				if (flags & DBOP_KEY) {
+					if (!strcmp(prev, k))
+						continue;
+					if (strlen(k) > MAXKEYLEN)
+						die("primary key too long.");
+					prev = k;
+				}
+				if (flags & DBOP_PREFIX) {
+					if (strncmp(k, dbop->key, dbop->keylen)) {
+						dbop->end = 1;
+						break;
+					}
+				} else if (dbop->keylen) {
+					if (strcmp(k, dbop->key)) {
+						dbop->end = 1;
+						break;
+					}
+				}
+				if (dbop->preg && regexec(dbop->preg, k, 0, 0, 0) != 0)
+					continue;
+				rec[count].key = k;
+				rec[count].keysize = key[i].size;
+				rec[count].dat = (char *)dat[i].data;
+				rec[count].datsize = dat[i].size;
+				count++;
+			}
+			if (prev != dbop->prev)
+				strlimcpy(dbop->prev, prev, sizeof(dbop->prev));
+		} while (count == 0 && !dbop->end);
+		if (count > 0)
+			setlast(dbop, &rec[count - 1]);
+		return count;
+	}
+#endif
+	/*
+	 * Sqlite3 and DB 1.85 return a record at a time.
+	 */
+	if (dbop_next(dbop) == NULL)
+		return 0;
+	rec[0].key = dbop->lastkey;
+	rec[0].keysize = dbop->lastkeysize;
+	rec[0].dat = dbop->lastdat;
+	rec[0].datsize = dbop->lastsize;
+	return 1;
+}
 /**
  * dbop_unread: unread record to read again.
  * 
@@ -682,6 +956,22 @@ dbop_unread(DBOP *dbop)
 {
 	dbop->unread = 1;
 }
+/**
+ * dbop_unread_batch: unread records to read again.
+ *
+ *	@param[in]	dbop	dbop descripter
+ *	@param[in]	rec	records returned by dbop_next_batch()
+ *	@param[in]	n	number of the records
+ *
+ * [Note] The array must be kept until the records are read again.
+ * dbop_next() and dbop_next_batch() will return them later.
+ */
+void
+dbop_unread_batch(DBOP *dbop, const DBOP_RECORD *rec, int n)
+{
+	dbop->pending = rec;
+	dbop->npending = n;
+}
 /**
  * dbop_lastdat: get last data
  * 
@@ -784,6 +1074,43 @@ dbop_putversion(DBOP *dbop, int version)
 	snprintf(number, sizeof(number), "%d", version);
 	dbop_putoption(dbop, VERSIONKEY, number);
 }
+/**
+ * dbop_cachestat: get the hit count and the miss count of the page cache
+ *
+ *	@param[in]	dbop	dbop descripter
+ *	@param[out]	hit	number of pages found in the cache
+ *	@param[out]	miss	number of pages read from the file
+ *	@return		0: normal, -1: not available
+ */
+int
+dbop_cachestat(DBOP *dbop, unsigned long *hit, unsigned long *miss)
+{
+#ifndef USE_DB185_COMPAT
+	DBCACHESTAT st;
+
+#ifdef USE_SQLITE3
+	if (dbop->openflags & DBOP_SQLITE3)
+		return -1;
+#endif
+	if (__bt_cachestat(dbop->db, &st) != RET_SUCCESS)
+		return -1;
+	*hit = st.cachehit;
+	*miss = st.cachemiss;
+	return 0;
+#else
+	return -1;
+#endif
+}
+/**
+ * dbop_io_name: name of the database in the statistics
+ */
+static const char *
+dbop_io_name(DBOP *dbop)
+{
+	const char *p = strrchr(dbop->dbname, '/');
+
+	return p ? p + 1 : dbop->dbname;
+}
 /**
  * dbop_close: close db
  * 
@@ -794,36 +1121,66 @@ dbop_close(DBOP *dbop)
 {
 	DB *db = dbop->db;
 
+	if (dbop->regex)
+		free(dbop->regex);
+
 	/*
 	 * Load sorted tag records and write them to the tag file.
 	 */
-	if (dbop->sortout != NULL) {
-		STRBUF *sb = strbuf_open(256);
-		char *p;
+	if (dbop->sort != NULL) {
+		EXTSORT *sort = dbop->sort;
+		const char *key, *dat;
+		int bulk = 0;
 
 		/*
-		 * End of the former stage of sorted writing.
-		 * fclose() and sortout = NULL is important.
-		 *
-		 * fclose(): enables reading from sortin descriptor.
-		 * sortout = NULL: makes the following dbop_put write to the tag file directly.
+		 * sort = NULL: makes the following dbop_put write to the tag file directly.
 		 */
-		fclose(dbop->sortout);
-		dbop->sortout = NULL;
+		dbop->sort = NULL;
+#ifndef USE_DB185_COMPAT
 		/*
-		 * The last stage of sorted writing.
+		 * Now that the records are known, remake the new tag file
+		 * with the page size which fits them. It is still empty.
 		 */
-		while (strbuf_fgets(sb, dbop->sortin, STRBUF_NOCRLF)) {
-			for (p = strbuf_value(sb); *p && *p != SORT_SEP; p++)
-				;
-			if (!*p)
-				die("unexpected end of record.");
-			*p++ = '\0';
-			dbop_put(dbop, strbuf_value(sb), p);
+		if (dbop->autopagesize && dbop_fitpagesize(dbop) != DBOP_PAGESIZE) {
+			DBT k, d;
+
+			if ((*db->seq)(db, &k, &d, R_FIRST) == RET_SPECIAL) {
+				(void)db->close(db, 1);
+				db = dbop_dbopen(dbop->dbname[0] ? dbop->dbname : NULL,
+						1, dbop->openflags, dbop_fitpagesize(dbop));
+				if (db == NULL)
+					die("cannot make '%s'.", dbop->dbname);
+				dbop->db = db;
+			}
 		}
-		fclose(dbop->sortin);
-		strbuf_close(sb);
-		terminate_sort_process(dbop);
+		/*
+		 * If the tag file is empty, it is built from the bottom
+		 * by the bulk loader of the db library.
+		 */
+		if (__bt_bulk_open(db, DBOP_FILLFACTOR) == RET_SUCCESS)
+			bulk = 1;
+#endif
+		for (key = extsort_first(sort, &dat); key; key = extsort_next(sort, &dat)) {
+#ifndef USE_DB185_COMPAT
+			if (bulk) {
+				DBT k, d;
+
+				k.data = (char *)key;
+				k.size = strlen(key)+1;
+				d.data = (char *)dat;
+				d.size = strlen(dat)+1;
+				if (__bt_bulk_put(db, &k, &d) != RET_SUCCESS)
+					die("%s", dbop->put_errmsg ? dbop->put_errmsg : "dbop_put failed.");
+				continue;
+			}
+#endif
+			dbop_put(dbop, key, dat);
+		}
+#ifndef USE_DB185_COMPAT
+		if (bulk && __bt_bulk_close(db) != RET_SUCCESS)
+			die("%s", dbop->put_errmsg ? dbop->put_errmsg : "dbop_put failed.");
+#endif
+		extsort_close(sort);
 	}
 #ifdef USE_SQLITE3
 	if (dbop->openflags & DBOP_SQLITE3) {
@@ -834,6 +1191,27 @@ dbop_close(DBOP *dbop)
 #ifdef USE_DB185_COMPAT
 	(void)db->close(db);
 #else
+	if (dbop->dbname[0] != '\0') {
+		DBCACHESTAT st;
+		STATISTICS_IO io;
+
+		/*
+		 * Flush the cache first so that the pages written at
+		 * closing are also counted.
+		 */
+		if (dbop->mode != 0)
+			(void)db->sync(db, 0);
+		if (__bt_cachestat(db, &st) == RET_SUCCESS) {
+			io.pageread = st.pageread;
+			io.pagewrite = st.pagewrite;
+			io.cachehit = st.cachehit;
+			io.cachemiss = st.cachemiss;
+			io.mapped = st.mapget;
+			io.split = st.split;
+			io.ovflpage = st.ovflpage;
+			statistics_io(dbop_io_name(dbop), &io);
+		}
+	}
 	/*
 	 * If dbname = NULL, omit writing to the disk in __bt_close().
 	 */
@@ -846,6 +1224,82 @@ dbop_close(DBOP *dbop)
 	(void)free(dbop);
 }
 #ifdef USE_SQLITE3
+static int
+page_size_callback(void *v, int argc, char **argv, char **colname) {
+	int *page_size = (int *)v;
+
+	if (argc > 0 && argv[0] && atoi(argv[0]) > 0)
+		*page_size = atoi(argv[0]);
+	return SQLITE_OK;
+}
+/**
+ * journal_mode_callback: set 1 if the journal mode is WAL
+ */
+static int
+journal_mode_callback(void *v, int argc, char **argv, char **colname) {
+	int *wal = (int *)v;
+
+	*wal = (argc > 0 && argv[0] && !strcmp(argv[0], "wal")) ? 1 : 0;
+	return SQLITE_OK;
+}
+/**
+ * dbop3_regexp: REGEXP function of sqlite3
+ *
+ *	regexp(pattern, string)
+ *	regexp(pattern, string, flags)
+ *
+ * The pattern is compiled with the flags of regcomp(3) (default:
+ * REG_EXTENDED). The compiled pattern is kept as the auxiliary data
+ * of the statement, so it is compiled only once while the pattern is
+ * the same. 'X REGEXP Y' calls regexp(Y, X).
+ */
+static void
+dbop3_regfree(void *v)
+{
+	regfree((regex_t *)v);
+	free(v);
+}
+static void
+dbop3_regexp(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+	regex_t *preg = sqlite3_get_auxdata(ctx, 0);
+	const char *string = (const char *)sqlite3_value_text(argv[1]);
+	int compiled = 0;
+
+	if (preg == NULL) {
+		const char *pattern = (const char *)sqlite3_value_text(argv[0]);
+		int flags = (argc > 2) ? sqlite3_value_int(argv[2]) : REG_EXTENDED;
+
+		if (pattern == NULL) {
+			sqlite3_result_null(ctx);
+			return;
+		}
+		preg = (regex_t *)check_malloc(sizeof(regex_t));
+		if (regcomp(preg, pattern, flags | REG_NOSUB) != 0) {
+			free(preg);
+			sqlite3_result_error(ctx, "invalid regular expression.", -1);
+			return;
+		}
+		compiled = 1;
+	}
+	sqlite3_result_int(ctx, string != NULL && regexec(preg, string, 0, 0, 0) == 0);
+	/*
+	 * sqlite3 may free the data at once, so it must be the last.
+	 */
+	if (compiled)
+		sqlite3_set_auxdata(ctx, 0, preg, dbop3_regfree);
+}
+/**
+ * fid_column_callback: find the fid column in the result of 'pragma table_info'
+ */
+static int
+fid_column_callback(void *v, int argc, char **argv, char **colname) {
+	int *fidcolumn = (int *)v;
+
+	if (argc > 1 && argv[1] && !strcmp(argv[1], "fid"))
+		*fidcolumn = 1;
+	return SQLITE_OK;
+}
 DBOP *
 dbop3_open(const char *path, int mode, int perm, int flags) {
 	int rc, rw = 0;
@@ -854,6 +1308,8 @@ dbop3_open(const char *path, int mode, int perm, int flags) {
 	sqlite3 *db3;
 	const char *tblname;
 	int cache_size = 0;
+	int page_size;
+	int inplace = 0;
 	STRBUF *sql = strbuf_open_tempbuf();
 	char buf[1024];
 
@@ -869,6 +1325,15 @@ dbop3_open(const char *path, int mode, int perm, int flags) {
 		 * In case of creation.
 		 */
 		if (mode == 1) {
+			/*
+			 * Readers of a database in WAL mode find the -wal and
+			 * -shm files by name, so such a database is remade
+			 * in place (see the 'drop table' below) and stays in
+			 * WAL mode. Others are truncated.
+			 */
+			inplace = is_sqlite3_wal(path);
+		}
+		if (mode == 1 && !inplace) {
 #ifndef _WIN32
 			(void)truncate(path, 0);
 #else
@@ -901,6 +1366,11 @@ dbop3_open(const char *path, int mode, int perm, int flags) {
 	rc = sqlite3_open_v2(path, &db3, rw, NULL);
 	if (rc != SQLITE_OK)
 		die("sqlite3_open_v2 failed. (rc = %d)", rc);
+	/*
+	 * A reader may meet a checkpoint, and a writer may meet a reader
+	 * which is recovering the WAL file.
+	 */
+	sqlite3_busy_timeout(db3, DBOP3_BUSYTIMEOUT);
 	dbop = (DBOP *)check_calloc(sizeof(DBOP), 1);
 	strlimcpy(dbop->dbname, path, sizeof(dbop->dbname));
 	dbop->sb        = strbuf_open(0);
@@ -911,15 +1381,27 @@ dbop3_open(const char *path, int mode, int perm, int flags) {
 	dbop->lastdat	= NULL;
 	dbop->lastflag	= NULL;
 	dbop->lastsize	= 0;
-	dbop->sortout	= NULL;
-	dbop->sortin	= NULL;
+	dbop->sort	= NULL;
 	dbop->stmt      = NULL;
+	dbop->batch	= strbuf_open(0);
+	dbop->nbatch	= 0;
 	dbop->tblname   = check_strdup(tblname);
 	/*
 	 * Maximum file size is DBOP_PAGESIZE * 2147483646.
 	 * if DBOP_PAGESIZE == 8192 then maximum file size is 17592186028032 (17T).
+	 * The page size of an existing file is kept in the file, and this is
+	 * ignored. Sqlite3 cannot change it after the table is made, so it is
+	 * not decided from the records.
 	 */
-	snprintf(buf, sizeof(buf), "pragma page_size=%d", DBOP_PAGESIZE);
+	rc = sqlite3_create_function(dbop->db3, "regexp", 2, SQLITE_UTF8, NULL, dbop3_regexp, NULL, NULL);
+	if (rc == SQLITE_OK)
+		rc = sqlite3_create_function(dbop->db3, "regexp", 3, SQLITE_UTF8, NULL, dbop3_regexp, NULL, NULL);
+	if (rc != SQLITE_OK)
+		die("sqlite3_create_function failed. (rc = %d)", rc);
+	page_size = dbop_pagesize();
+	if (page_size == 0)
+		page_size = DBOP_PAGESIZE;
+	snprintf(buf, sizeof(buf), "pragma page_size=%d", page_size);
 	rc = sqlite3_exec(dbop->db3, buf,  NULL, NULL, &errmsg);
 	if (rc != SQLITE_OK)
 		die("pragma page_size error: %s", errmsg);
@@ -927,6 +1409,19 @@ dbop3_open(const char *path, int mode, int perm, int flags) {
 	 * create table (GTAGS, GRTAGS, GSYMS, GPATH).
 	 */
 	if (mode == 1) {
+		/*
+		 * Readers of a database remade in place must not see
+		 * the empty table, so the transaction starts here.
+		 */
+		if (inplace) {
+			dbop->wal = 1;
+			rc = sqlite3_exec(dbop->db3, "pragma synchronous=normal", NULL, NULL, &errmsg);
+			if (rc != SQLITE_OK)
+				die("pragma synchronous=normal error: %s", errmsg);
+			rc = sqlite3_exec(dbop->db3, "begin transaction", NULL, NULL, &errmsg);
+			if (rc != SQLITE_OK)
+				die("begin transaction error: %s", errmsg);
+		}
 		/* drop table */
 		strbuf_clear(sql);
 		strbuf_puts(sql, "drop table ");
@@ -939,13 +1434,29 @@ dbop3_open(const char *path, int mode, int perm, int flags) {
 		strbuf_clear(sql);
 		strbuf_puts(sql, "create table ");
 		strbuf_puts(sql, dbop->tblname);
-		strbuf_puts(sql, " (key text, dat text, extra text");
-		if (!(flags & DBOP_DUP))
-			strbuf_puts(sql, ", primary key(key)");
-		strbuf_putc(sql, ')');
+		/*
+		 * Tag tables keep the file id and the line number as
+		 * integers, so that the records of a file can be found
+		 * by the index of the fid column.
+		 */
+		if (flags & DBOP_DUP) {
+			strbuf_puts(sql, " (key text, dat text, fid integer, lineno integer)");
+			dbop->fidcolumn = 1;
+		} else
+			strbuf_puts(sql, " (key text, dat text, extra text, primary key(key))");
 		rc = sqlite3_exec(dbop->db3, strbuf_value(sql), NULL, NULL, &errmsg);
         	if (rc != SQLITE_OK)
 			die("create table error: %s", errmsg);
+	} else if (*path) {
+		/*
+		 * Tag tables made by older version have the fid in the
+		 * extra column as a text.
+		 */
+		strbuf_clear(sql);
+		strbuf_sprintf(sql, "pragma table_info(%s)", dbop->tblname);
+		rc = sqlite3_exec(dbop->db3, strbuf_value(sql), fid_column_callback, &dbop->fidcolumn, &errmsg);
+		if (rc != SQLITE_OK)
+			die("pragma table_info error: %s", errmsg);
 	}
 	/*
 	rc = sqlite3_exec(dbop->db3, "pragma synchronous=off", NULL, NULL, &errmsg);
@@ -961,62 +1472,251 @@ dbop3_open(const char *path, int mode, int perm, int flags) {
 		cache_size = atoi(getenv("GTAGSCACHE"));
 	if (cache_size < GTAGSMINCACHE)
 		cache_size = GTAGSMINCACHE;
-	cache_size = (cache_size + DBOP_PAGESIZE - 1) / DBOP_PAGESIZE;
+	if (sqlite3_exec(dbop->db3, "pragma page_size", page_size_callback, &page_size, &errmsg) != SQLITE_OK)
+		die("pragma page_size error: %s", errmsg);
+	cache_size = (cache_size + page_size - 1) / page_size;
 	snprintf(buf, sizeof(buf), "pragma cache_size=%d", cache_size);
 	rc = sqlite3_exec(dbop->db3, buf,  NULL, NULL, &errmsg);
        	if (rc != SQLITE_OK)
 		die("pragma cache_size error: %s", errmsg);
-	sqlite3_exec(dbop->db3, "pragma journal_mode=memory", NULL, NULL, &errmsg);
-       	if (rc != SQLITE_OK)
-		die("pragma journal_mode=memory error: %s", errmsg);
-	sqlite3_exec(dbop->db3, "pragma synchronous=off", NULL, NULL, &errmsg);
-       	if (rc != SQLITE_OK)
-		die("pragma synchronous=off error: %s", errmsg);
+	/*
+	 * Reading doesn't touch the journal mode and doesn't start a
+	 * transaction, so that a reader doesn't keep a lock on the file
+	 * and reads a snapshot per statement. A database remade in place
+	 * is already set up.
+	 */
+	if (mode == 0 || inplace) {
+		strbuf_release_tempbuf(sql);
+		return dbop;
+	}
+	/*
+	 * In WAL mode, readers keep reading the last committed records
+	 * while a writer is working. The mode is kept in the file, so
+	 * updating follows the mode with which the file was made.
+	 */
+	if (mode == 1 && (flags & DBOP_WAL)) {
+		rc = sqlite3_exec(dbop->db3, "pragma journal_mode=wal", journal_mode_callback, &dbop->wal, &errmsg);
+		if (rc != SQLITE_OK)
+			die("pragma journal_mode=wal error: %s", errmsg);
+		if (!dbop->wal)
+			die("cannot use WAL mode for '%s'.", path);
+	} else if (mode == 2) {
+		rc = sqlite3_exec(dbop->db3, "pragma journal_mode", journal_mode_callback, &dbop->wal, &errmsg);
+		if (rc != SQLITE_OK)
+			die("pragma journal_mode error: %s", errmsg);
+	}
+	if (dbop->wal) {
+		rc = sqlite3_exec(dbop->db3, "pragma synchronous=normal", NULL, NULL, &errmsg);
+		if (rc != SQLITE_OK)
+			die("pragma synchronous=normal error: %s", errmsg);
+	} else {
+		rc = sqlite3_exec(dbop->db3, "pragma journal_mode=memory", NULL, NULL, &errmsg);
+		if (rc != SQLITE_OK)
+			die("pragma journal_mode=memory error: %s", errmsg);
+		rc = sqlite3_exec(dbop->db3, "pragma synchronous=off", NULL, NULL, &errmsg);
+		if (rc != SQLITE_OK)
+			die("pragma synchronous=off error: %s", errmsg);
+	}
 	rc = sqlite3_exec(dbop->db3, "begin transaction", NULL, NULL, &errmsg);
        	if (rc != SQLITE_OK)
 		die("begin transaction error: %s", errmsg);
 	strbuf_release_tempbuf(sql);
 	return dbop;
 }
+/**
+ * dbop3_prepare: prepare a statement once per dbop
+ *
+ *	@param[in]	dbop	dbop descripter
+ *	@param[out]	stmtp	the statement is kept here
+ *	@param[in]	format	SQL; '%s' is replaced with the table name
+ *	@return		prepared statement
+ *
+ * The statement is reused until dbop3_close(), so the SQL is compiled
+ * only once and the values are always bound, not quoted.
+ */
+static sqlite3_stmt *
+dbop3_prepare(DBOP *dbop, sqlite3_stmt **stmtp, const char *format)
+{
+	int rc;
+
+	if (*stmtp == NULL) {
+		STRBUF *sql = strbuf_open_tempbuf();
+
+		strbuf_sprintf(sql, format, dbop->tblname);
+		rc = sqlite3_prepare_v2(dbop->db3, strbuf_value(sql), -1, stmtp, NULL);
+		if (rc != SQLITE_OK)
+			die("sqlite3_prepare_v2 failed. (rc = %d, sql = %s)", rc, strbuf_value(sql));
+		strbuf_release_tempbuf(sql);
+	}
+	return *stmtp;
+}
+/**
+ * dbop3_step: execute a statement which returns no row, and reset it
+ */
+static void
+dbop3_step(DBOP *dbop, sqlite3_stmt *stmt, const char *name)
+{
+	int rc;
+
+	rc = sqlite3_step(stmt);
+	if (rc != SQLITE_DONE)
+		die("%s failed. (rc = %d, %s)", name, rc, sqlite3_errmsg(dbop->db3));
+	rc = sqlite3_reset(stmt);
+	if (rc != SQLITE_OK)
+		die("%s reset failed. (rc = %d)", name, rc);
+}
+/**
+ * dbop3_bind: bind a text to a statement
+ */
+static void
+dbop3_bind(sqlite3_stmt *stmt, int index, const char *text, void (*destructor)(void *))
+{
+	int rc;
+
+	if (text == NULL)
+		rc = sqlite3_bind_null(stmt, index);
+	else
+		rc = sqlite3_bind_text(stmt, index, text, -1, destructor);
+	if (rc != SQLITE_OK)
+		die("sqlite3_bind_text failed. (rc = %d, index = %d)", rc, index);
+}
+/**
+ * dbop3_bindrow: bind the values of a record to an insert statement
+ *
+ *	@param[in]	dbop	dbop descripter
+ *	@param[in]	stmt	insert statement
+ *	@param[in]	index	index of the first parameter
+ *	@param[in]	key	key
+ *	@param[in]	dat	data
+ *	@param[in]	extra	fid of a tag or flag of a path (may be NULL)
+ *	@param[in]	lineno	line number of a tag (0: none)
+ *	@return		index of the next parameter
+ */
 static int
-single_select_callback(void *v, int argc, char **argv, char **colname) {
-	STATIC_STRBUF(sb);
-	DBOP *dbop = (DBOP *)v;
+dbop3_bindrow(DBOP *dbop, sqlite3_stmt *stmt, int index, const char *key, const char *dat, const char *extra, int lineno)
+{
+	int rc;
 
-	if (argc > 0) {
-		strbuf_clear(sb);
-		strbuf_puts(sb, argv[0]);
-		dbop->lastsize = strbuf_getlen(sb);
-		if (argv[1]) {
-			strbuf_putc(sb, '\0');
-			strbuf_puts(sb, argv[1]);
+	dbop3_bind(stmt, index++, key, SQLITE_STATIC);
+	dbop3_bind(stmt, index++, dat, SQLITE_STATIC);
+	if (!dbop->fidcolumn) {
+		dbop3_bind(stmt, index++, extra, SQLITE_STATIC);
+		return index;
+	}
+	rc = extra ? sqlite3_bind_int(stmt, index, atoi(extra)) : sqlite3_bind_null(stmt, index);
+	if (rc != SQLITE_OK)
+		die("sqlite3_bind_int failed. (rc = %d, index = %d)", rc, index);
+	index++;
+	rc = lineno > 0 ? sqlite3_bind_int(stmt, index, lineno) : sqlite3_bind_null(stmt, index);
+	if (rc != SQLITE_OK)
+		die("sqlite3_bind_int failed. (rc = %d, index = %d)", rc, index);
+	return index + 1;
+}
+/**
+ * dbop3_insert: SQL to insert a record
+ */
+static const char *
+dbop3_insert(DBOP *dbop)
+{
+	return dbop->fidcolumn ? "insert into %s values (?, ?, ?, ?)" : "insert into %s values (?, ?, ?)";
+}
+/**
+ * dbop3_flush: write the records waiting in the batch of dbop3_put()
+ *
+ * A full batch is inserted by a multi-row statement. Remaining records
+ * are inserted one by one. This is called before any other access to
+ * the table, so the records are always visible.
+ */
+static void
+dbop3_flush(DBOP *dbop)
+{
+	sqlite3_stmt *stmt;
+	const char *key, *dat, *extra, *p;
+	int i, index, lineno;
+
+	if (dbop->nbatch == 0)
+		return;
+	if (dbop->nbatch == DBOP3_BATCHROWS) {
+		if (dbop->stmt_putn == NULL) {
+			STRBUF *sql = strbuf_open_tempbuf();
+			const char *row = dbop->fidcolumn ? ", (?, ?, ?, ?)" : ", (?, ?, ?)";
+			int rc;
+
+			strbuf_sprintf(sql, dbop3_insert(dbop), dbop->tblname);
+			for (i = 1; i < DBOP3_BATCHROWS; i++)
+				strbuf_puts(sql, row);
+			rc = sqlite3_prepare_v2(dbop->db3, strbuf_value(sql), -1, &dbop->stmt_putn, NULL);
+			if (rc != SQLITE_OK)
+				die("dbop3_put prepare failed. (rc = %d)", rc);
+			strbuf_release_tempbuf(sql);
 		}
-		dbop->lastdat = strbuf_value(sb);
-		dbop->lastflag = argv[1] ? dbop->lastdat + dbop->lastsize + 1 : NULL;
+		stmt = dbop->stmt_putn;
 	} else {
-		dbop->lastdat = NULL;
-		dbop->lastflag = NULL;
-		dbop->lastsize = 0;
+		stmt = dbop3_prepare(dbop, &dbop->stmt_put3, dbop3_insert(dbop));
 	}
-	return SQLITE_OK;
+	/*
+	 * Each record is kept as 'key\0dat\0', '\0' (no extra) or
+	 * '+extra\0', and 'lineno\0'.
+	 */
+	p = strbuf_value(dbop->batch);
+	index = 1;
+	for (i = 0; i < dbop->nbatch; i++) {
+		key = p;
+		p += strlen(p) + 1;
+		dat = p;
+		p += strlen(p) + 1;
+		extra = *p ? p + 1 : NULL;
+		p += strlen(p) + 1;
+		lineno = atoi(p);
+		p += strlen(p) + 1;
+		index = dbop3_bindrow(dbop, stmt, index, key, dat, extra, lineno);
+		if (stmt == dbop->stmt_put3) {
+			dbop3_step(dbop, stmt, "dbop3_put");
+			index = 1;
+		}
+	}
+	if (stmt == dbop->stmt_putn)
+		dbop3_step(dbop, stmt, "dbop3_put");
+	strbuf_reset(dbop->batch);
+	dbop->nbatch = 0;
 }
 const char *
 dbop3_get(DBOP *dbop, const char *name) {
+	STATIC_STRBUF(sb);
+	sqlite3_stmt *stmt;
+	const char *extra;
 	int rc;
-	char *errmsg = 0;
-	STRBUF *sql = strbuf_open_tempbuf();
 
-	strbuf_sprintf(sql, "select dat, extra from %s where key = '%s' limit 1",
-			dbop->tblname, name); 
+	dbop3_flush(dbop);
+	/*
+	 *	0: rowid
+	 *	1: key
+	 *	2: dat
+	 *	3: fid of a tag or flag of a path
+	 */
+	stmt = dbop3_prepare(dbop, &dbop->stmt_get, "select rowid, * from %s where key = ? limit 1");
+	dbop3_bind(stmt, 1, name, SQLITE_STATIC);
 	dbop->lastdat = NULL;
 	dbop->lastsize = 0;
 	dbop->lastflag = NULL;
-	rc = sqlite3_exec(dbop->db3, strbuf_value(sql), single_select_callback, dbop, &errmsg);
-       	if (rc != SQLITE_OK) {
-		sqlite3_close(dbop->db3);
-		die("dbop3_get failed: %s", errmsg);
+	rc = sqlite3_step(stmt);
+	if (rc == SQLITE_ROW) {
+		strbuf_clear(sb);
+		strbuf_puts(sb, (const char *)sqlite3_column_text(stmt, 2));
+		dbop->lastsize = strbuf_getlen(sb);
+		extra = (const char *)sqlite3_column_text(stmt, 3);
+		if (extra) {
+			strbuf_putc(sb, '\0');
+			strbuf_puts(sb, extra);
+		}
+		dbop->lastdat = strbuf_value(sb);
+		dbop->lastflag = extra ? dbop->lastdat + dbop->lastsize + 1 : NULL;
+	} else if (rc != SQLITE_DONE) {
+		die("dbop3_get failed. (rc = %d, %s)", rc, sqlite3_errmsg(dbop->db3));
 	}
-	strbuf_release_tempbuf(sql);
+	rc = sqlite3_reset(stmt);
+	if (rc != SQLITE_OK)
+		die("dbop3_get reset failed. (rc = %d)", rc);
 	return dbop->lastdat;
 }
 const char *
@@ -1024,57 +1724,40 @@ dbop3_getflag(DBOP *dbop)
 {
 	return dbop->lastflag ? dbop->lastflag : "";
 }
-char *
-dbop3_quote(char *string) {
-	STATIC_STRBUF(sb);
-	char *p;
-
-	strbuf_clear(sb);
-	for (p = string; *p; p++) {
-		if (*p == '\'')
-			strbuf_putc(sb, '\'');
-		strbuf_putc(sb, *p);
-	}
-	return strbuf_value(sb);
-}
 void
-dbop3_put(DBOP *dbop, const char *p1, const char *p2, const char *p3) {
+dbop3_put(DBOP *dbop, const char *p1, const char *p2, const char *p3, int lineno) {
 	int rc, len;
 	char *errmsg = 0;
-	STRBUF *sql = strbuf_open_tempbuf();
 
 	if (!(len = strlen(p1)))
 		die("primary key size == 0.");
 	if (len > MAXKEYLEN)
 		die("primary key too long.");
-	if (dbop->stmt_put3 == NULL) {
-		strbuf_sprintf(sql, "insert into %s values (?, ?, ?)", dbop->tblname);
-		rc = sqlite3_prepare_v2(dbop->db3, strbuf_value(sql), -1, &dbop->stmt_put3, NULL);
-		if (rc != SQLITE_OK) {
-			die("dbop3_put prepare failed. (rc = %d, sql = %s)", rc, strbuf_value(sql));
-		}
-	}
-	rc = sqlite3_bind_text(dbop->stmt_put3, 1, p1, -1, SQLITE_STATIC);
-       	if (rc != SQLITE_OK) {
-		die("dbop3_put 1 failed. (rc = %d)", rc);
-	}
-	rc = sqlite3_bind_text(dbop->stmt_put3, 2, p2, -1, SQLITE_STATIC);
-       	if (rc != SQLITE_OK) {
-		die("dbop3_put 2 failed. (rc = %d)", rc);
-	}
-	rc = sqlite3_bind_text(dbop->stmt_put3, 3, p3, -1, SQLITE_STATIC);
-       	if (rc != SQLITE_OK) {
-		die("dbop3_put 3 failed. (rc = %d)", rc);
-	}
-	rc = sqlite3_step(dbop->stmt_put3);
-       	if (rc != SQLITE_DONE) {
-		die("dbop3_put failed. (rc = %d)", rc);
-	}
-	rc = sqlite3_reset(dbop->stmt_put3);
-       	if (rc != SQLITE_OK) {
-		die("dbop3_put reset failed. (rc = %d)", rc);
-	}
-	if (dbop->writecount++ > DBOP_COMMIT_THRESHOLD) {
+	/*
+	 * The record waits in the batch, and is inserted with other ones.
+	 */
+	strbuf_puts0(dbop->batch, p1);
+	strbuf_puts0(dbop->batch, p2);
+	if (p3) {
+		strbuf_putc(dbop->batch, '+');
+		strbuf_puts0(dbop->batch, p3);
+	} else
+		strbuf_putc(dbop->batch, '\0');
+	strbuf_putn(dbop->batch, lineno);
+	strbuf_putc(dbop->batch, '\0');
+	if (++dbop->nbatch == DBOP3_BATCHROWS)
+		dbop3_flush(dbop);
+	/*
+	 * A new table is made in a transaction, since the file is
+	 * discarded anyway when it fails. Updating commits at times not to
+	 * hold too many pages in the journal.
+	 */
+	/*
+	 * In WAL mode, the records are committed at once in dbop3_close(),
+	 * so that readers don't see the tag file half updated.
+	 */
+	if (dbop->mode != 1 && !dbop->wal && dbop->writecount++ > DBOP_COMMIT_THRESHOLD) {
+		dbop3_flush(dbop);
 		dbop->writecount = 0;
 		rc = sqlite3_exec(dbop->db3, "end transaction", NULL, NULL, &errmsg);
 		if (rc != SQLITE_OK)
@@ -1083,98 +1766,138 @@ dbop3_put(DBOP *dbop, const char *p1, const char *p2, const char *p3) {
 		if (rc != SQLITE_OK)
 			die("begin transaction error: %s", errmsg);
 	}
-	strbuf_release_tempbuf(sql);
 }
 void
 dbop3_delete(DBOP *dbop, const char *path) {
 	int rc;
 	char *errmsg = 0;
-	STRBUF *sql = strbuf_open_tempbuf();
+	sqlite3_stmt *stmt;
 
-	strbuf_puts(sql, "delete from ");
-	strbuf_puts(sql, dbop->tblname);
-	strbuf_puts(sql, " where");
-	if (path) {
-		if (*path == '(') {
-			strbuf_puts(sql, " extra in ");
-			strbuf_puts(sql, path); 
-		} else {
-			strbuf_puts(sql, " key = '");
-			strbuf_puts(sql, path);
-			strbuf_puts(sql, "'");
+	dbop3_flush(dbop);
+	if (path && *path == '(') {
+		/*
+		 * The list of file ids is made by the caller.
+		 */
+		STRBUF *sql = strbuf_open_tempbuf();
+
+		strbuf_puts(sql, "delete from ");
+		strbuf_puts(sql, dbop->tblname);
+		strbuf_puts(sql, dbop->fidcolumn ? " where fid in " : " where extra in ");
+		strbuf_puts(sql, path); 
+		rc = sqlite3_exec(dbop->db3, strbuf_value(sql), NULL, NULL, &errmsg);
+		if (rc != SQLITE_OK) {
+			sqlite3_close(dbop->db3);
+			die("dbop3_delete failed: %s", errmsg);
 		}
+		strbuf_release_tempbuf(sql);
+	} else if (path) {
+		stmt = dbop3_prepare(dbop, &dbop->stmt_delete, "delete from %s where key = ?");
+		dbop3_bind(stmt, 1, path, SQLITE_STATIC);
+		dbop3_step(dbop, stmt, "dbop3_delete");
 	} else {
-		strbuf_puts(sql, " rowid = ");
-		strbuf_putn64(sql, dbop->lastrowid);
-	}
-	rc = sqlite3_exec(dbop->db3, strbuf_value(sql), NULL, NULL, &errmsg);
-       	if (rc != SQLITE_OK) {
-		sqlite3_close(dbop->db3);
-		die("dbop3_delete failed: %s", errmsg);
+		stmt = dbop3_prepare(dbop, &dbop->stmt_delete_rowid, "delete from %s where rowid = ?");
+		rc = sqlite3_bind_int64(stmt, 1, dbop->lastrowid);
+		if (rc != SQLITE_OK)
+			die("sqlite3_bind_int64 failed. (rc = %d)", rc);
+		dbop3_step(dbop, stmt, "dbop3_delete");
 	}
-	strbuf_release_tempbuf(sql);
 }
 void
 dbop3_update(DBOP *dbop, const char *key, const char *dat) {
-	int rc;
-	char *errmsg = 0;
-	STRBUF *sql = strbuf_open_tempbuf();
+	sqlite3_stmt *stmt;
 
-	strbuf_sprintf(sql, "update %s set dat = '%s' where key = '%s'",
-					dbop->tblname, dbop3_quote((char *)dat), key);
-	rc = sqlite3_exec(dbop->db3, strbuf_value(sql), NULL, NULL, &errmsg);
-       	if (rc != SQLITE_OK) {
-		sqlite3_close(dbop->db3);
-		die("dbop3_update failed: %s", errmsg);
-	}
+	dbop3_flush(dbop);
+	stmt = dbop3_prepare(dbop, &dbop->stmt_update, "update %s set dat = ? where key = ?");
+	dbop3_bind(stmt, 1, dat, SQLITE_STATIC);
+	dbop3_bind(stmt, 2, key, SQLITE_STATIC);
+	dbop3_step(dbop, stmt, "dbop3_update");
 	if (sqlite3_changes(dbop->db3) == 0) {
-		strbuf_clear(sql);
-		strbuf_sprintf(sql, "insert into %s values ('%s', '%s', NULL)",
-					dbop->tblname, key, dbop3_quote((char *)dat));
-		rc = sqlite3_exec(dbop->db3, strbuf_value(sql), NULL, NULL, &errmsg);
-		if (rc != SQLITE_OK) {
-			sqlite3_close(dbop->db3);
-			die("dbop3_updated failed: %s", errmsg);
-		}
+		stmt = dbop3_prepare(dbop, &dbop->stmt_put3, dbop3_insert(dbop));
+		(void)dbop3_bindrow(dbop, stmt, 1, key, dat, NULL, 0);
+		dbop3_step(dbop, stmt, "dbop3_update");
 	}
-	strbuf_release_tempbuf(sql);
 }
 const char *
 dbop3_first(DBOP *dbop, const char *name, regex_t *preg, int flags) {
-	int rc;
+	int rc, variant;
 	char *key;
-	STRBUF *sql = strbuf_open_tempbuf();
 
+	dbop3_flush(dbop);
 	dbop->done = 0; 	/* This is turned on when it receives SQLITE_DONE. */
-	strbuf_puts(sql, "select rowid, * from ");
-	strbuf_puts(sql, dbop->tblname);
+	if (dbop->stmt) {
+		rc = sqlite3_reset(dbop->stmt);
+		if (rc != SQLITE_OK)
+			die("dbop3_first: sqlite3_reset failed. (rc = %d)", rc);
+		dbop->stmt = NULL;
+	}
+	/*
+	 * The regular expression is evaluated by the REGEXP function in
+	 * the engine, and the prefix is given as a range of the key.
+	 *
+	 *	stmt_first[]	where
+	 *	0, 3		(none)
+	 *	1, 4		key = ?1
+	 *	2, 5		key >= ?1 and key < ?2
+	 *	3, 4, 5		... regexp(?3, key, ?4)
+	 */
+	dbop->sqlregex = (preg != NULL && dbop->regex != NULL);
+	if (name == NULL)
+		variant = 0;
+	else if (dbop->ioflags & DBOP_PREFIX)
+		variant = 2;
+	else
+		variant = 1;
+	if (dbop->sqlregex)
+		variant += 3;
+	if (dbop->stmt_first[variant] == NULL) {
+		static const char *where[] = {
+			"",
+			" where key = ?1",
+			" where key >= ?1 and key < ?2",
+			" where regexp(?3, key, ?4)",
+			" where key = ?1 and regexp(?3, key, ?4)",
+			" where key >= ?1 and key < ?2 and regexp(?3, key, ?4)",
+		};
+		STATIC_STRBUF(sql);
+
+		strbuf_clear(sql);
+		strbuf_puts(sql, "select rowid, * from %s");
+		strbuf_puts(sql, where[variant]);
+		strbuf_puts(sql, " order by key");
+		(void)dbop3_prepare(dbop, &dbop->stmt_first[variant], strbuf_value(sql));
+	}
+	dbop->stmt = dbop->stmt_first[variant];
 	if (name) {
-		strbuf_puts(sql, " where key ");
-		if (dbop->ioflags & DBOP_PREFIX) {
-			/*
-			 * In sqlite3, 'like' ignores case. 'glob' does not ignore case.
-			 */
-			strbuf_puts(sql, "glob '");
-			strbuf_puts(sql, name);
-			strbuf_puts(sql, "*'");
-		} else {
-			strbuf_puts(sql, "= '");
-			strbuf_puts(sql, name);
-			strbuf_puts(sql, "'");
-		}
+		dbop3_bind(dbop->stmt, 1, name, SQLITE_TRANSIENT);
 		strlimcpy(dbop->key, name, sizeof(dbop->key));
 		dbop->keylen = strlen(name);
 	}
-	strbuf_puts(sql, " order by key");
-	if (dbop->stmt) {
-		rc = sqlite3_finalize(dbop->stmt);
+	if (name && dbop->ioflags & DBOP_PREFIX) {
+		/*
+		 * The upper bound is the prefix whose last byte is incremented.
+		 * If there is no such string, a blob is used, which is greater
+		 * than any text.
+		 */
+		char upper[MAXKEYLEN];
+		int len = dbop->keylen;
+
+		strlimcpy(upper, name, sizeof(upper));
+		while (len > 0 && (unsigned char)upper[len - 1] == 0xff)
+			len--;
+		if (len > 0) {
+			upper[len - 1]++;
+			rc = sqlite3_bind_text(dbop->stmt, 2, upper, len, SQLITE_TRANSIENT);
+		} else
+			rc = sqlite3_bind_zeroblob(dbop->stmt, 2, 0);
 		if (rc != SQLITE_OK)
-			die("dbop3_finalize failed. (rc = %d)", rc);
-		dbop->stmt = NULL;
+			die("dbop3_first: bind failed. (rc = %d)", rc);
+	}
+	if (dbop->sqlregex) {
+		dbop3_bind(dbop->stmt, 3, dbop->regex, SQLITE_TRANSIENT);
+		rc = sqlite3_bind_int(dbop->stmt, 4, dbop->regflags);
+		if (rc != SQLITE_OK)
+			die("dbop3_first: bind failed. (rc = %d)", rc);
 	}
-	rc = sqlite3_prepare_v2(dbop->db3, strbuf_value(sql), -1, &dbop->stmt, NULL);
-	if (rc != SQLITE_OK)
-		die("dbop3_first: sqlite3_prepare_v2 failed. (rc = %d)", rc);
 	/*
 	 *	0: rowid
 	 *	1: key
@@ -1200,13 +1923,13 @@ dbop3_first(DBOP *dbop, const char *name, regex_t *preg, int flags) {
 					if (strcmp(key, dbop->key)) 
 						goto finish;
 				}
-				if (dbop->preg && regexec(dbop->preg, key, 0, 0, 0) != 0)
+				if (dbop->preg && !dbop->sqlregex && regexec(dbop->preg, key, 0, 0, 0) != 0)
 					continue;
 			} else {
 				/* skip meta records */
 				if (ismeta(key) && !(dbop->openflags & DBOP_RAW))
 					continue;
-				if (dbop->preg && regexec(dbop->preg, key, 0, 0, 0) != 0)
+				if (dbop->preg && !dbop->sqlregex && regexec(dbop->preg, key, 0, 0, 0) != 0)
 					continue;
 			}
 			break;
@@ -1225,14 +1948,12 @@ dbop3_first(DBOP *dbop, const char *name, regex_t *preg, int flags) {
 		dbop->lastflag = dbop->lastdat + dbop->lastsize + 1;
 	dbop->lastkey = key;
 	dbop->lastkeysize = strlen(dbop->lastkey);
-	strbuf_release_tempbuf(sql);
 	if (flags & DBOP_KEY) {
 		strlimcpy(dbop->prev, key, sizeof(dbop->prev));
 		return key;
 	}
 	return dbop->lastdat;
 finish:
-	strbuf_release_tempbuf(sql);
 	dbop->done = 1;
 	dbop->lastdat = NULL;
 	dbop->lastsize = 0;
@@ -1283,7 +2004,7 @@ dbop3_next(DBOP *dbop) {
 				if (strcmp(key, dbop->key)) 
 					goto finish;
 			}
-			if (dbop->preg && regexec(dbop->preg, key, 0, 0, 0) != 0)
+			if (dbop->preg && !dbop->sqlregex && regexec(dbop->preg, key, 0, 0, 0) != 0)
 				continue;
 			break;
 		} else {
@@ -1317,11 +2038,18 @@ dbop3_close(DBOP *dbop) {
 	int rc;
 	char *errmsg = 0;
 
-	rc = sqlite3_exec(dbop->db3, "end transaction", NULL, NULL, &errmsg);
-       	if (rc != SQLITE_OK)
-		die("end transaction error: %s", errmsg);
+	dbop3_flush(dbop);
+	if (dbop->stmt) {
+		(void)sqlite3_reset(dbop->stmt);
+		dbop->stmt = NULL;
+	}
+	if (dbop->mode != 0) {
+		rc = sqlite3_exec(dbop->db3, "end transaction", NULL, NULL, &errmsg);
+		if (rc != SQLITE_OK)
+			die("end transaction error: %s", errmsg);
+	}
 	/*
-	 * create index
+	 * Create the indexes after all the records are written.
 	 */
 	if (dbop->mode == 1 && dbop->openflags & DBOP_DUP) {
 		STATIC_STRBUF(sql);
@@ -1336,22 +2064,59 @@ dbop3_close(DBOP *dbop) {
 		strbuf_clear(sql);
 		strbuf_puts(sql, "create index fid_i on ");
 		strbuf_puts(sql, dbop->tblname);
-		strbuf_puts(sql, "(extra)");
+		strbuf_puts(sql, dbop->fidcolumn ? "(fid, lineno)" : "(extra)");
 		rc = sqlite3_exec(dbop->db3, strbuf_value(sql), NULL, NULL, &errmsg);
 		if (rc != SQLITE_OK)
 			die("create index error: %s", errmsg);
 	}
-	if (dbop->stmt) {
-		rc = sqlite3_finalize(dbop->stmt);
-		if (rc != SQLITE_OK)
-			die("sqlite3_finalize failed. (rc = %d)", rc);
-		dbop->stmt = NULL;
+	/*
+	 * Move the records from the WAL file into the database file, so that
+	 * the WAL file doesn't keep growing. Readers which are still using
+	 * old records may make it fail, which is harmless. It doesn't wait
+	 * for them.
+	 */
+	if (dbop->wal && dbop->mode != 0) {
+		sqlite3_busy_timeout(dbop->db3, 0);
+#ifdef SQLITE_CHECKPOINT_TRUNCATE
+		rc = sqlite3_wal_checkpoint_v2(dbop->db3, NULL, SQLITE_CHECKPOINT_TRUNCATE, NULL, NULL);
+#else
+		rc = sqlite3_wal_checkpoint_v2(dbop->db3, NULL, SQLITE_CHECKPOINT_RESTART, NULL, NULL);
+#endif
+		if (rc != SQLITE_OK && rc != SQLITE_BUSY)
+			die("sqlite3_wal_checkpoint_v2 failed. (rc = %d)", rc);
 	}
-	if (dbop->stmt_put3) {
-		rc = sqlite3_finalize(dbop->stmt_put3);
-		if (rc != SQLITE_OK)
-			die("dbop3_finalize failed. (rc = %d)", rc);
-		dbop->stmt_put3 = NULL;
+#ifdef SQLITE_DBSTATUS_CACHE_WRITE
+	if (dbop->dbname[0] != '\0') {
+		STATISTICS_IO io;
+		int cur, hiwtr;
+
+		memset(&io, 0, sizeof(io));
+		if (sqlite3_db_status(dbop->db3, SQLITE_DBSTATUS_CACHE_HIT, &cur, &hiwtr, 0) == SQLITE_OK)
+			io.cachehit = cur;
+		if (sqlite3_db_status(dbop->db3, SQLITE_DBSTATUS_CACHE_MISS, &cur, &hiwtr, 0) == SQLITE_OK)
+			io.cachemiss = io.pageread = cur;
+		if (sqlite3_db_status(dbop->db3, SQLITE_DBSTATUS_CACHE_WRITE, &cur, &hiwtr, 0) == SQLITE_OK)
+			io.pagewrite = cur;
+		statistics_io(dbop_io_name(dbop), &io);
+	}
+#endif
+	{
+		sqlite3_stmt **stmts[] = {
+			&dbop->stmt_first[0], &dbop->stmt_first[1], &dbop->stmt_first[2],
+			&dbop->stmt_first[3], &dbop->stmt_first[4], &dbop->stmt_first[5],
+			&dbop->stmt_put3, &dbop->stmt_putn, &dbop->stmt_get,
+			&dbop->stmt_delete, &dbop->stmt_delete_rowid, &dbop->stmt_update,
+		};
+		int i;
+
+		for (i = 0; i < sizeof(stmts) / sizeof(stmts[0]); i++) {
+			if (*stmts[i] == NULL)
+				continue;
+			rc = sqlite3_finalize(*stmts[i]);
+			if (rc != SQLITE_OK)
+				die("sqlite3_finalize failed. (rc = %d)", rc);
+			*stmts[i] = NULL;
+		}
 	}
 	rc = sqlite3_close(dbop->db3);
 	if (rc != SQLITE_OK)
@@ -1360,6 +2125,7 @@ dbop3_close(DBOP *dbop) {
 	if (dbop->tblname)
 		free((void *)dbop->tblname);
 	strbuf_close(dbop->sb);
+	strbuf_close(dbop->batch);
 	free(dbop);
 }
 #endif /* USE_SQLITE3 */
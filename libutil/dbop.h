@@ -31,17 +31,43 @@
 #include <sqlite3.h>
 #endif
 #include "regex.h"
+#include "extsort.h"
 #include "strbuf.h"
 
-#if defined(_WIN32) && !defined(__CYGWIN__)
-typedef void* HANDLE;
-#endif
-
 #define DBOP_PAGESIZE	8192
+/**
+ * range of the page size given by GTAGSPAGESIZE.
+ * The db library doesn't keep the trees right with pages of 512 bytes.
+ * The offsets in a page of the db library (indx_t) are 16 bits, so
+ * a page of 65536 bytes would make the empty page wrap around.
+ */
+#define DBOP_MINPAGESIZE	1024
+#define DBOP_MAXPAGESIZE	32768
+/** smallest page size decided from the records */
+#define DBOP_MINAUTOPAGESIZE	4096
+/** number of average records which a page decided from the records holds */
+#define DBOP_PAGERECORDS	64
+/** fill factor of the pages built by sorted writing (percent) */
+#define DBOP_FILLFACTOR	100
 #ifdef USE_SQLITE3
-#define DBOP_COMMIT_THRESHOLD	800
+/** records written between commits in updating */
+#define DBOP_COMMIT_THRESHOLD	100000
+/** records inserted by a statement */
+#define DBOP3_BATCHROWS		64
+/** milliseconds to wait for a lock held by another process in WAL mode */
+#define DBOP3_BUSYTIMEOUT	10000
 #endif
 #define VERSIONKEY	" __.VERSION"
+/** suggested size of the array for dbop_next_batch() */
+#define DBOP_BATCHSIZE	256
+
+/** a record returned by dbop_next_batch() */
+typedef struct {
+	const char *key;		/**< key */
+	int keysize;			/**< size of the key */
+	const char *dat;		/**< data */
+	int datsize;			/**< size of the data */
+} DBOP_RECORD;
 
 typedef	struct {
 	/*
@@ -55,7 +81,12 @@ typedef	struct {
 	char *lastkey;			/**< the key of last located record */
 	int lastkeysize;		/**< the size of the key */
 	regex_t	*preg;			/**< compiled regular expression */
+	char *regex;			/**< source of preg (see dbop_setregex()) */
+	int regflags;			/**< flags of regcomp(3) for regex */
 	int unread;			/**< leave record to read again */
+	const DBOP_RECORD *pending;	/**< records to read again */
+	int npending;			/**< number of the pending records */
+	int end;			/**< out of the range of xxxx_first() */
 	const char *put_errmsg;		/**< error message for put_xxx() */
 
 	/*
@@ -71,13 +102,10 @@ typedef	struct {
 	/*
 	 * (3) sorted write
 	 */
-	FILE *sortout;			/**< write to sort command */
-	FILE *sortin;			/**< read from sort command */
-#if defined(_WIN32) && !defined(__CYGWIN__)
-	HANDLE pid;
-#else
-	int pid;			/**< sort process id */
-#endif
+	EXTSORT *sort;			/**< sorter for sorted writing */
+	int autopagesize;		/**< 1: decide the page size from the records */
+	unsigned long nrecords;		/**< number of records to be sorted */
+	unsigned long nbytes;		/**< total size of the records */
 #ifdef USE_SQLITE3
 	/*
 	 * (4) sqlite3 part
@@ -86,8 +114,19 @@ typedef	struct {
 	STRBUF *sb;
 	int done;
 	const char *tblname;
-	sqlite3_stmt *stmt;
-	sqlite3_stmt *stmt_put3;
+	sqlite3_stmt *stmt;		/**< cursor; one of stmt_first */
+	sqlite3_stmt *stmt_first[6];	/**< reads of dbop3_first() */
+	sqlite3_stmt *stmt_put3;	/**< insert a record */
+	sqlite3_stmt *stmt_putn;	/**< insert DBOP3_BATCHROWS records */
+	sqlite3_stmt *stmt_get;		/**< get by a key */
+	sqlite3_stmt *stmt_delete;	/**< delete by a key */
+	sqlite3_stmt *stmt_delete_rowid; /**< delete by a rowid */
+	sqlite3_stmt *stmt_update;	/**< update by a key */
+	int fidcolumn;			/**< 1: integer fid and lineno columns */
+	int sqlregex;			/**< 1: the engine evaluates the regex */
+	int wal;			/**< 1: the journal is in WAL mode */
+	STRBUF *batch;			/**< records waiting for stmt_putn */
+	int nbatch;			/**< number of the records in batch */
 	sqlite3_int64 lastrowid;
 	char *lastflag;
 #endif
@@ -107,7 +146,13 @@ typedef	struct {
 #ifdef USE_SQLITE3
 		/** use sqlite3 database		*/
 #define DBOP_SQLITE3	2
+		/** write-ahead logging journal	*/
+#define DBOP_WAL	64
 #endif
+		/** scan resistant cache (2Q)	*/
+#define DBOP_CACHE2Q	16
+		/** prefix compressed leaf pages	*/
+#define DBOP_PFXLEAF	32
 
 /*
  * ioflags
@@ -127,16 +172,25 @@ void dbop_put(DBOP *, const char *, const char *);
 void dbop_put_tag(DBOP *, const char *, const char *);
 void dbop_put_path(DBOP *, const char *, const char *, const char *);
 void dbop_delete(DBOP *, const char *);
+int dbop_delete_if(DBOP *, const char *, int (*)(const char *, const char *, void *), void *);
 void dbop_update(DBOP *, const char *, const char *);
+void dbop_setregex(DBOP *, const char *, int);
 const char *dbop_first(DBOP *, const char *, regex_t *, int);
 const char *dbop_next(DBOP *);
+int dbop_next_batch(DBOP *, DBOP_RECORD *, int);
 void dbop_unread(DBOP *);
+void dbop_unread_batch(DBOP *, const DBOP_RECORD *, int);
 const char *dbop_lastdat(DBOP *, int *);
 const char *dbop_getflag(DBOP *);
 const char *dbop_getoption(DBOP *, const char *);
 void dbop_putoption(DBOP *, const char *, const char *);
 int dbop_getversion(DBOP *);
 void dbop_putversion(DBOP *, int);
+int dbop_cachestat(DBOP *, unsigned long *, unsigned long *);
 void dbop_close(DBOP *);
+#ifdef USE_SQLITE3
+int is_sqlite3(const char *);
+int is_sqlite3_wal(const char *);
+#endif
 
 #endif /* _DBOP_H_ */
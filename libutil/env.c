@@ -109,7 +109,10 @@ static const char *envname[] = {
 	/*"GTAGSLABEL",*/
 	"GTAGSLIBPATH",
 	"GTAGSLOGGING",
+	"GTAGSPAGESIZE",
+	"GTAGSREADAHEAD",
 	/*"GTAGSROOT",*/
+	"GTAGSSORTMEM",
 	"GTAGSTHROUGH",
 	"GTAGS_OPTIONS",
 	"HTAGS_OPTIONS",
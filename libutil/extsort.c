@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include "checkalloc.h"
+#include "die.h"
+#include "extsort.h"
+#include "strbuf.h"
+
+/*
+
+External sort of (key, data) records: usage
+
+es = extsort_open(memsize);		// memsize: memory budget
+
+extsort_put(es, "main", "1 @n 10 ...");	// records in arbitrary order
+extsort_put(es, "func", "2 @n 20 ...");
+...
+for (key = extsort_first(es, &dat); key; key = extsort_next(es, &dat))
+	...				// records in sorted order
+extsort_close(es);
+
+Records are kept in the memory until the budget is used up. Then they
+are sorted and written to a temporary file (run). At the first call of
+extsort_first(), the runs and the records left in the memory are merged.
+
+Records are ordered by the key and then by the data, comparing bytes as
+unsigned char. It is the same order as the one of 'LC_ALL=C sort -k 1,1'
+for the 'key<tab>data' lines which was used formerly.
+
+*/
+
+/** minimum size of the record area */
+#define MINBUFSIZE	8192
+/** merge runs when this number of runs are made */
+#define MAXRUNS		64
+
+static int compare(const void *, const void *);
+static void sort_records(EXTSORT *);
+static void add_run(EXTSORT *, FILE *);
+static void spill(EXTSORT *);
+static void merge_runs(EXTSORT *);
+static void source_next(struct extsort_source *);
+static void sift_down(EXTSORT *, int);
+static void start_merge(EXTSORT *, int);
+static const char *merge_next(EXTSORT *);
+static void end_merge(EXTSORT *);
+
+/**
+ * reccmp: compare two records.
+ *
+ *	@param[in]	a	record ("key\0dat\0")
+ *	@param[in]	b	record ("key\0dat\0")
+ *	@return		<0: a < b, 0: a == b, >0: a > b
+ */
+static int
+reccmp(const char *a, const char *b)
+{
+	int r = strcmp(a, b);
+
+	if (r == 0) {
+		size_t len = strlen(a) + 1;
+
+		r = strcmp(a + len, b + len);
+	}
+	return r;
+}
+static int
+compare(const void *a, const void *b)
+{
+	return reccmp(*(char * const *)a, *(char * const *)b);
+}
+/**
+ * sort_records: sort the records in the memory.
+ *
+ *	@param[in]	es	EXTSORT structure
+ *
+ * The result is set to es->index.
+ */
+static void
+sort_records(EXTSORT *es)
+{
+	int i;
+
+	if (es->index)
+		free(es->index);
+	es->index = (char **)check_malloc(sizeof(char *) * (es->count + 1));
+	for (i = 0; i < es->count; i++)
+		es->index[i] = es->buf + es->offset[i];
+	qsort(es->index, es->count, sizeof(char *), compare);
+}
+/**
+ * add_run: add a run file.
+ *
+ *	@param[in]	es	EXTSORT structure
+ *	@param[in]	fp	run file
+ */
+static void
+add_run(EXTSORT *es, FILE *fp)
+{
+	if (fflush(fp) != 0 || ferror(fp))
+		die("cannot write to temporary file.");
+	rewind(fp);
+	es->runs = (FILE **)check_realloc(es->runs, sizeof(FILE *) * (es->nruns + 1));
+	es->runs[es->nruns++] = fp;
+}
+/**
+ * spill: write the records in the memory to a new run.
+ *
+ *	@param[in]	es	EXTSORT structure
+ */
+static void
+spill(EXTSORT *es)
+{
+	FILE *fp;
+	int i;
+
+	sort_records(es);
+	if ((fp = tmpfile()) == NULL)
+		die("cannot make temporary file.");
+	for (i = 0; i < es->count; i++) {
+		const char *rec = es->index[i];
+		size_t len = strlen(rec) + 1;
+
+		len += strlen(rec + len) + 1;
+		fwrite(rec, 1, len, fp);
+	}
+	add_run(es, fp);
+	free(es->index);
+	es->index = NULL;
+	es->count = 0;
+	es->used = 0;
+	/*
+	 * Too many runs use up file descriptors. Merge them into one.
+	 */
+	if (es->nruns >= MAXRUNS)
+		merge_runs(es);
+}
+/**
+ * merge_runs: merge all runs into a new run.
+ *
+ *	@param[in]	es	EXTSORT structure
+ */
+static void
+merge_runs(EXTSORT *es)
+{
+	FILE *fp;
+	const char *rec;
+
+	if ((fp = tmpfile()) == NULL)
+		die("cannot make temporary file.");
+	start_merge(es, 0);
+	while ((rec = merge_next(es)) != NULL) {
+		size_t len = strlen(rec) + 1;
+
+		len += strlen(rec + len) + 1;
+		fwrite(rec, 1, len, fp);
+	}
+	end_merge(es);
+	add_run(es, fp);
+}
+/**
+ * source_next: read the next record of a source.
+ *
+ *	@param[in]	s	source
+ *
+ * s->rec is set to the record, or NULL at the end.
+ */
+static void
+source_next(struct extsort_source *s)
+{
+	if (s->fp == NULL) {
+		s->rec = (s->cur < s->end) ? *s->cur++ : NULL;
+	} else {
+		int c, nul = 0;
+
+		strbuf_reset(s->sb);
+		while ((c = getc(s->fp)) != EOF) {
+			strbuf_putc(s->sb, c);
+			if (c == '\0' && ++nul == 2)
+				break;
+		}
+		if (nul == 2)
+			s->rec = strbuf_value(s->sb);
+		else if (strbuf_getlen(s->sb) == 0 && !ferror(s->fp))
+			s->rec = NULL;
+		else
+			die("cannot read temporary file.");
+	}
+}
+/**
+ * sift_down: restore the heap property from the position.
+ *
+ *	@param[in]	es	EXTSORT structure
+ *	@param[in]	i	position
+ */
+static void
+sift_down(EXTSORT *es, int i)
+{
+	struct extsort_source **heap = es->heap;
+	struct extsort_source *s = heap[i];
+
+	for (;;) {
+		int child = 2 * i + 1;
+
+		if (child >= es->heapsize)
+			break;
+		if (child + 1 < es->heapsize
+		    && reccmp(heap[child + 1]->rec, heap[child]->rec) < 0)
+			child++;
+		if (reccmp(s->rec, heap[child]->rec) <= 0)
+			break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = s;
+}
+/**
+ * start_merge: prepare for merging.
+ *
+ *	@param[in]	es	EXTSORT structure
+ *	@param[in]	incore	1: merge also the records in the memory
+ */
+static void
+start_merge(EXTSORT *es, int incore)
+{
+	int n = es->nruns + (incore ? 1 : 0);
+	int i;
+
+	es->src = (struct extsort_source *)check_calloc(sizeof(struct extsort_source), n);
+	es->heap = (struct extsort_source **)check_malloc(sizeof(struct extsort_source *) * n);
+	es->heapsize = 0;
+	es->advance = 0;
+	for (i = 0; i < n; i++) {
+		struct extsort_source *s = &es->src[i];
+
+		if (i < es->nruns) {
+			s->fp = es->runs[i];
+			s->sb = strbuf_open(0);
+		} else {
+			sort_records(es);
+			s->cur = es->index;
+			s->end = es->index + es->count;
+		}
+		source_next(s);
+		if (s->rec != NULL)
+			es->heap[es->heapsize++] = s;
+	}
+	for (i = es->heapsize / 2 - 1; i >= 0; i--)
+		sift_down(es, i);
+}
+/**
+ * merge_next: get the next record in sorted order.
+ *
+ *	@param[in]	es	EXTSORT structure
+ *	@return		record or NULL at the end
+ *
+ * The record is valid until the next call.
+ */
+static const char *
+merge_next(EXTSORT *es)
+{
+	if (es->advance && es->heapsize > 0) {
+		source_next(es->heap[0]);
+		if (es->heap[0]->rec == NULL)
+			es->heap[0] = es->heap[--es->heapsize];
+		if (es->heapsize > 0)
+			sift_down(es, 0);
+	}
+	if (es->heapsize == 0)
+		return NULL;
+	es->advance = 1;
+	return es->heap[0]->rec;
+}
+/**
+ * end_merge: close all runs and sources.
+ *
+ *	@param[in]	es	EXTSORT structure
+ */
+static void
+end_merge(EXTSORT *es)
+{
+	int i;
+
+	for (i = 0; i < es->nruns; i++) {
+		fclose(es->runs[i]);
+		strbuf_close(es->src[i].sb);
+	}
+	es->nruns = 0;
+	free(es->src);
+	es->src = NULL;
+	free(es->heap);
+	es->heap = NULL;
+	es->heapsize = 0;
+}
+/**
+ * extsort_open: open external sort.
+ *
+ *	@param[in]	memsize	memory budget for the records
+ *	@return		EXTSORT structure
+ */
+EXTSORT *
+extsort_open(unsigned long memsize)
+{
+	EXTSORT *es = (EXTSORT *)check_calloc(sizeof(EXTSORT), 1);
+
+	es->memsize = memsize;
+	return es;
+}
+/**
+ * extsort_put: put a record.
+ *
+ *	@param[in]	es	EXTSORT structure
+ *	@param[in]	key	key
+ *	@param[in]	dat	data
+ */
+void
+extsort_put(EXTSORT *es, const char *key, const char *dat)
+{
+	size_t keylen = strlen(key) + 1;
+	size_t datlen = strlen(dat) + 1;
+	size_t size = keylen + datlen;
+	/* each record also costs an offset and a pointer for sorting */
+	const size_t overhead = sizeof(unsigned long) + sizeof(char *);
+
+	if (es->merging)
+		die("extsort_put: already in merge phase.");
+	if (es->count > 0 && es->used + size + (es->count + 1) * overhead > es->memsize)
+		spill(es);
+	if (es->used + size > es->bufsize) {
+		unsigned long newsize = es->bufsize ? es->bufsize * 2 : MINBUFSIZE;
+
+		if (newsize > es->memsize)
+			newsize = es->memsize;
+		if (newsize < es->used + size)
+			newsize = es->used + size;
+		es->buf = (char *)check_realloc(es->buf, newsize);
+		es->bufsize = newsize;
+	}
+	if (es->count >= es->alloced) {
+		es->alloced = es->alloced ? es->alloced * 2 : 1024;
+		es->offset = (unsigned long *)check_realloc(es->offset, sizeof(unsigned long) * es->alloced);
+	}
+	es->offset[es->count++] = es->used;
+	memcpy(es->buf + es->used, key, keylen);
+	memcpy(es->buf + es->used + keylen, dat, datlen);
+	es->used += size;
+}
+/**
+ * extsort_first: get the first record in sorted order.
+ *
+ *	@param[in]	es	EXTSORT structure
+ *	@param[out]	datp	data of the record
+ *	@return		key of the record or NULL at the end
+ *
+ * After this call, extsort_put() cannot be used.
+ */
+const char *
+extsort_first(EXTSORT *es, const char **datp)
+{
+	if (es->merging)
+		die("extsort_first: already in merge phase.");
+	es->merging = 1;
+	start_merge(es, 1);
+	return extsort_next(es, datp);
+}
+/**
+ * extsort_next: get the next record in sorted order.
+ *
+ *	@param[in]	es	EXTSORT structure
+ *	@param[out]	datp	data of the record
+ *	@return		key of the record or NULL at the end
+ *
+ * The record is valid until the next call.
+ */
+const char *
+extsort_next(EXTSORT *es, const char **datp)
+{
+	const char *rec = merge_next(es);
+
+	if (rec == NULL)
+		return NULL;
+	*datp = rec + strlen(rec) + 1;
+	return rec;
+}
+/**
+ * extsort_close: close external sort.
+ *
+ *	@param[in]	es	EXTSORT structure
+ */
+void
+extsort_close(EXTSORT *es)
+{
+	int i;
+
+	if (es->src)
+		end_merge(es);
+	for (i = 0; i < es->nruns; i++)
+		fclose(es->runs[i]);
+	if (es->runs)
+		free(es->runs);
+	if (es->index)
+		free(es->index);
+	if (es->offset)
+		free(es->offset);
+	if (es->buf)
+		free(es->buf);
+	free(es);
+}
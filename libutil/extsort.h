@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _EXTSORT_H
+#define _EXTSORT_H
+
+#include <stdio.h>
+#include "strbuf.h"
+
+/** input of the merge phase: a run file or the in-core buffer */
+struct extsort_source {
+	FILE *fp;			/**< run file (NULL: in-core buffer) */
+	STRBUF *sb;			/**< record buffer for run file */
+	char **cur;			/**< in-core: next record */
+	char **end;			/**< in-core: end of records */
+	const char *rec;		/**< current record or NULL at end */
+};
+
+typedef struct {
+	unsigned long memsize;		/**< memory budget */
+	/*
+	 * run generation
+	 */
+	char *buf;			/**< record area: "key\0dat\0" ... */
+	unsigned long bufsize;		/**< allocated size of buf */
+	unsigned long used;		/**< used size of buf */
+	unsigned long *offset;		/**< offset of each record in buf */
+	int count;			/**< number of records in buf */
+	int alloced;			/**< allocated size of offset */
+	FILE **runs;			/**< spilled runs */
+	int nruns;			/**< number of runs */
+	/*
+	 * merge
+	 */
+	char **index;			/**< sorted in-core records */
+	struct extsort_source *src;	/**< sources */
+	struct extsort_source **heap;	/**< heap of sources */
+	int heapsize;			/**< number of sources in heap */
+	int advance;			/**< 1: advance the top before reading */
+	int merging;			/**< 1: in merge phase */
+} EXTSORT;
+
+EXTSORT *extsort_open(unsigned long);
+void extsort_put(EXTSORT *, const char *, const char *);
+const char *extsort_first(EXTSORT *, const char **);
+const char *extsort_next(EXTSORT *, const char **);
+void extsort_close(EXTSORT *);
+
+#endif /* ! _EXTSORT_H */
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <errno.h>
 #ifdef STDC_HEADERS
 #include <stdlib.h>
 #endif
@@ -40,6 +41,9 @@
 #else
 #include <sys/file.h>
 #endif
+#if defined(HAVE_FLOCK) && defined(HAVE_FCNTL_H)
+#include <sys/file.h>
+#endif
 
 #include "checkalloc.h"
 #include "die.h"
@@ -51,6 +55,7 @@
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #define mkdir(path,mode) mkdir(path)
+#define fsync _commit
 #endif
 
 /*
@@ -260,3 +265,69 @@ read_first_line(const char *com, STRBUF *sb)
 	pclose(ip);
 	return (p == NULL) ? -1 : 0;
 }
+/**
+ * lock directory
+ *
+ *	@param[in]	dir	directory
+ *	@param[in]	exclusive	0: shared lock, 1: exclusive lock
+ *	@return			file descriptor for unlockdirectory(),
+ *				-1: cannot lock or not supported
+ *
+ * It waits until the lock is granted. Gtags(1) takes the exclusive lock
+ * of the dbpath while it replaces the tag files, and the readers take
+ * the shared lock while they open them, so that they never see a mixture
+ * of old and new ones. Opened files stay valid after they are replaced,
+ * so the readers release the lock soon.
+ */
+int
+lockdirectory(const char *dir, int exclusive)
+{
+#ifdef HAVE_FLOCK
+	int fd = open(dir, O_RDONLY);
+
+	if (fd < 0)
+		return -1;
+	while (flock(fd, exclusive ? LOCK_EX : LOCK_SH) < 0) {
+		if (errno != EINTR) {
+			close(fd);
+			return -1;
+		}
+	}
+	return fd;
+#else
+	return -1;
+#endif
+}
+/**
+ * unlock directory
+ *
+ *	@param[in]	fd	return value of lockdirectory()
+ */
+void
+unlockdirectory(int fd)
+{
+	if (fd < 0)
+		return;
+#ifdef HAVE_FLOCK
+	(void)flock(fd, LOCK_UN);
+#endif
+	close(fd);
+}
+/**
+ * write a file or a directory to the disk
+ *
+ *	@param[in]	path	path name
+ *	@return		0: normal, -1: error
+ */
+int
+syncfile(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	int ret;
+
+	if (fd < 0)
+		return -1;
+	ret = fsync(fd);
+	close(fd);
+	return ret;
+}
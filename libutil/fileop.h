@@ -46,5 +46,8 @@ void close_file(FILEOP *);
 void copyfile(const char *, const char *);
 void copydirectory(const char *, const char *);
 int read_first_line(const char *, STRBUF *);
+int lockdirectory(const char *, int);
+void unlockdirectory(int);
+int syncfile(const char *);
 
 #endif /* ! _FILEOP_H */
@@ -44,6 +44,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #include "gparam.h"
 #include "regex.h"
@@ -61,6 +64,8 @@
 #include "locatestring.h"
 #include "makepath.h"
 #include "path.h"
+#include "pathmatch.h"
+#include "statistics.h"
 #include "strbuf.h"
 #include "strlimcpy.h"
 #include "test.h"
@@ -93,8 +98,8 @@
  *	find_close();
  *
  */
-static regex_t *skip;			/**< regex for skipping units */
-static regex_t *suff;			/**< regex for suffixes */
+static PATHMATCH *skip;			/**< matcher for skipping units */
+static PATHMATCH *suff;			/**< matcher for suffixes */
 static FILE *ip;
 static FILE *temp;
 static char rootdir[PATH_MAX];
@@ -170,26 +175,26 @@ getreason(const char *path)
 	return is_directory << 8 | type;
 }
 /**
- * prepare_source: preparing regular expression.
+ * prepare_source: preparing matcher for source files.
  *
- *	@return	compiled regular expression for source files.
+ *	@return	compiled matcher for source files.
  */
-static regex_t *
+static PATHMATCH *
 prepare_source(void)
 {
-	static regex_t suff_area;
+	PATHMATCH *pm;
 	STRBUF *sb = strbuf_open(0);
 	char *sufflist = NULL;
 	char *langmap = NULL;
-	int flags = REG_EXTENDED;
+	int flags = 0;
 
 	/*
 	 * load icase_path option.
 	 */
 	if (getconfb("icase_path"))
-		flags |= REG_ICASE;
+		flags |= PATHMATCH_ICASE;
 #if defined(_WIN32) || defined(__DJGPP__)
-	flags |= REG_ICASE;
+	flags |= PATHMATCH_ICASE;
 #endif
 	/*
 	 * make suffix list.
@@ -202,64 +207,55 @@ prepare_source(void)
 	make_suffixes(langmap ? langmap : DEFAULTLANGMAP, sb);
 	sufflist = check_strdup(strbuf_value(sb));
 	trim(sufflist);
+	pm = pathmatch_open(flags);
 	{
 		const char *suffp;
 
-		strbuf_reset(sb);
-		strbuf_puts(sb, "\\.(");       /* ) */
 		for (suffp = sufflist; suffp; ) {
 			const char *p;
 
-			for (p = suffp; *p && *p != ','; p++) {
-				if (!isalnum((unsigned char)*p))
-					strbuf_putc(sb, '\\');
+			strbuf_reset(sb);
+			for (p = suffp; *p && *p != ','; p++)
 				strbuf_putc(sb, *p);
-			}
+			pathmatch_add_suffix(pm, strbuf_value(sb));
 			if (!*p)
 				break;
 			assert(*p == ',');
-			strbuf_putc(sb, '|');
 			suffp = ++p;
 		}
-		strbuf_puts(sb, ")$");
 		/*
 		 * compile regular expression.
 		 */
-		if (regcomp(&suff_area, strbuf_value(sb), flags) != 0)
-			die("cannot compile regular expression.");
+		pathmatch_compile(pm);
 	}
 	strbuf_close(sb);
 	if (langmap)
 		free(langmap);
 	if (sufflist)
 		free(sufflist);
-	return &suff_area;
+	return pm;
 }
 /**
  * prepare_skip: prepare skipping files.
  *
- *	Globals used (output):
- *		listarray[]: 	skip list.
- *		list_count:	 count of skip list.
- *
- *	@return	compiled regular expression for skip files.
+ *	@return	compiled matcher for skip files.
  */
-static regex_t *
+static PATHMATCH *
 prepare_skip(void)
 {
-	static regex_t skip_area;
+	PATHMATCH *pm;
 	char *skiplist;
 	STRBUF *reg = strbuf_open(0);
-	char *p, *q;
-	int flags = REG_EXTENDED|REG_NEWLINE;
+	char *p;
+	int flags = 0;
 
 	/*
 	 * load icase_path option.
 	 */
 	if (getconfb("icase_path"))
-		flags |= REG_ICASE;
+		flags |= PATHMATCH_ICASE;
 #if defined(_WIN32) || defined(__DJGPP__)
-	flags |= REG_ICASE;
+	flags |= PATHMATCH_ICASE;
 #endif
 	/*
 	 * load skip data.
@@ -272,28 +268,25 @@ prepare_skip(void)
 	if (debug)
 		fprintf(stderr, "DBG: Original skip list:\n%s\n", skiplist);
 	/* trim(skiplist);*/
-	strbuf_reset(reg);
+	strbuf_close(reg);
 	/*
-	 * construct regular expression.
+	 * construct matcher.
 	 */
-	strbuf_putc(reg, '(');	/* ) */
+	pm = pathmatch_open(flags);
 	/*
 	 * Hard coded skip files:
 	 * (1) files which start with '.'
 	 * (2) tag files
 	 */
 	/* skip files which start with '.' e.g. .cvsignore */
-	if (!accept_dotfiles) {
-		strbuf_puts(reg, "/\\.[^/]+$|");
-		strbuf_puts(reg, "/\\.[^/]+/|");
-	}
+	if (!accept_dotfiles)
+		pathmatch_add_dotfiles(pm);
 	/* skip tag files */
-	strbuf_puts(reg, "/GTAGS$|");
-	strbuf_puts(reg, "/GRTAGS$|");
-	strbuf_puts(reg, "/GSYMS$|");
-	strbuf_puts(reg, "/GPATH$|");
+	pathmatch_add(pm, "GTAGS");
+	pathmatch_add(pm, "GRTAGS");
+	pathmatch_add(pm, "GSYMS");
+	pathmatch_add(pm, "GPATH");
 	for (p = skiplist; *p; ) {
-		char *skipf;
 		STATIC_STRBUF(sb);
 		strbuf_clear(sb);
 
@@ -308,90 +301,17 @@ prepare_skip(void)
 				p++;
 			strbuf_putc(sb, *p);
 		}
-		skipf = strbuf_value(sb);
-		/* '/' means project root directory */
-		if (*skipf == '/') {
-			strbuf_puts(reg, "^\\./");
-			skipf++;
-		} else {
-			strbuf_putc(reg, '/');
-		}
-		for (q = skipf; *q; q++) {
-			/*
-			 * replaces wild cards into regular expressions.
-			 *
-			 * '*' -> '[^/]*'
-			 * '?' -> '[^/]'
-			 * '[...]' -> '[...]'
-			 * '[!...]' -> '[^...]'
-			 */
-			if (*q == '[') {
-				char *c = q;
-				STATIC_STRBUF(class);
-				int isclass = 1;
-
-				strbuf_clear(class);
-				strbuf_putc(class, *c++);		/* '[' */
-				if (*c == '\0')
-					isclass = 0;
-				else if (*c == ']')
-					strbuf_putc(class, *c++);
-				else if (*c == '!') {
-					strbuf_putc(class, '^');
-					c++;
-				} else
-					strbuf_putc(class, *c++);
-				if (isclass) {
-					while (*c && *c != ']')
-						strbuf_putc(class, *c++);
-					if (*c == ']')
-						strbuf_putc(class, *c);	/* ']' */
-					else
-						isclass = 0;
-				}
-				if (isclass) {
-					strbuf_puts(reg, strbuf_value(class));
-					q = c;
-				} else {
-					/* 'class' is thrown away */
-					strbuf_putc(reg, '\\');
-					strbuf_putc(reg, *q);
-				}
-			} else if (*q == '*')
-				strbuf_puts(reg, "[^/]*");
-			else if (*q == '?')
-				strbuf_puts(reg, "[^/]");
-			else if (*q == '\\' && *(q + 1) == ',')
-				strbuf_putc(reg, *++q);
-			else if (isregexchar(*q)) {
-				strbuf_putc(reg, '\\');
-				strbuf_putc(reg, *q);
-			} else {
-				if (*q == '\\' && *(q + 1) != '\0') {
-					strbuf_putc(reg, *q++);
-					strbuf_putc(reg, *q);
-				} else
-					strbuf_putc(reg, *q);
-			}
-		}
-		if (*(q - 1) != '/')
-			strbuf_putc(reg, '$');
-		if (*p == ',')
-			strbuf_putc(reg, '|');
+		pathmatch_add(pm, strbuf_value(sb));
 	}
-	strbuf_unputc(reg, '|');
-	strbuf_putc(reg, ')');
 	/*
 	 * compile regular expression.
 	 */
 	if (debug)
-		fprintf(stderr, "DBG: Regular expression of the skip list:\n%s\n", strbuf_value(reg));
-	if (regcomp(&skip_area, strbuf_value(reg), flags) != 0)
-		die("cannot compile regular expression.");
-	strbuf_close(reg);
+		fprintf(stderr, "DBG: Regular expression of the skip list:\n%s\n", pathmatch_regex(pm));
+	pathmatch_compile(pm);
 	free(skiplist);
 
-	return &skip_area;
+	return pm;
 }
 /**
  * issourcefile: check whether or not a source file.
@@ -407,9 +327,25 @@ issourcefile(const char *path)
 		if (suff == NULL)
 			die("prepare_source failed.");
 	}
-	if (regexec(suff, path, 0, 0, 0) == 0)
-		return 1;
-	return 0;
+	return pathmatch_match(suff, path, NULL, NULL);
+}
+/**
+ * isskipped: check whether or not the path is in the skip list.
+ *
+ *	@param[in]	path	path name (must start with "./")
+ *	@return		1: skip, 0: don't skip
+ *
+ * Unlike skipthisfile(), this function prints nothing.
+ */
+static int
+isskipped(const char *path)
+{
+	if (skip == NULL) {
+		skip = prepare_skip();
+		if (skip == NULL)
+			die("prepare_skip failed.");
+	}
+	return pathmatch_match(skip, path, NULL, NULL);
 }
 /**
  * skipthisfile: check whether or not we accept this file.
@@ -425,7 +361,7 @@ issourcefile(const char *path)
 int
 skipthisfile(const char *path)
 {
-	regmatch_t m;
+	int so, eo;
 	int i;
 
 	/*
@@ -436,18 +372,18 @@ skipthisfile(const char *path)
 		if (skip == NULL)
 			die("prepare_skip failed.");
 	}
-	if (regexec(skip, path, 1, &m, 0) == 0) {
+	if (pathmatch_match(skip, path, &so, &eo)) {
 		if (debug) {
 			int len = strlen(path);
 			fprintf(stderr, "DBG: ");
 			for (i = 0; i < len; i++) {
-				if (m.rm_so == i)
+				if (so == i)
 					fputc('[', stderr);
-				if (m.rm_eo == i)
+				if (eo == i)
 					fputc(']', stderr);
 				fputc(path[i], stderr);
 			}
-			if (m.rm_eo == len)
+			if (eo == len)
 				fputc(']', stderr);
 			fprintf(stderr, " => SKIPPED\n");
 		}
@@ -485,9 +421,49 @@ struct stack_entry {
 	STRBUF *sb;
 	char *real;
 	char *dirp, *start, *end, *p;
+	struct dirjob *jobs;			/**< listings of sub directories */
 };
 static int current_entry;			/**< current entry of the stack */
 
+/*
+ * Directory listing
+ *
+ * A directory is read by readdirs(), which never calls die() or warning()
+ * so that it can run in a reader thread. The result is examined by getdirs()
+ * in the order of the traversal, so the messages and the order of the paths
+ * are the same as those of the serial traversal.
+ *
+ * When reader threads are available, the sub directories of a directory are
+ * queued as soon as the directory is pushed onto the stack, and the idle
+ * readers read them in advance. If the traversal reaches a directory before
+ * any reader takes it, the directory is read by the traversal itself.
+ */
+#define JOB_NEW		0			/**< not queued */
+#define JOB_QUEUED	1			/**< waiting for a reader */
+#define JOB_RUN		2			/**< being read */
+#define JOB_DONE	3			/**< finished */
+struct dirjob {
+	char *dir;				/**< directory path (ends with '/') */
+	char *real;				/**< real path or NULL */
+	STRBUF *sb;				/**< raw directory list */
+	int error;				/**< cannot open the directory */
+	int state;				/**< JOB_XXX */
+	int queued;				/**< queued for readers */
+	struct dirjob *next;			/**< next sibling */
+	struct dirjob *qprev, *qnext;		/**< link of the queue */
+};
+#ifdef HAVE_PTHREAD_H
+#define FIND_MAXJOBS	4096			/**< max number of queued listings */
+static int find_threads;			/**< number of reader threads */
+static pthread_t *readers;			/**< reader threads or NULL */
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+static struct dirjob *queue_head, *queue_tail;
+static int job_count;				/**< queued and not consumed yet */
+static int reader_exit;
+#endif
+
 /**
  * getrealpath: return a real path of dir using allocated area.
  */
@@ -504,19 +480,18 @@ getrealpath(const char *dir)
  * has_symlinkloop: whether or not dir has a symbolic link loops.
  *
  *	@param[in]	dir	directory (should end by "/")
+ *	@param[in]	real	real path of dir
  *	@return		1: has a loop, 0: don't have a loop
  */
 int
-has_symlinkloop(const char *dir)
+has_symlinkloop(const char *dir, const char *real)
 {
 	struct stack_entry *sp;
-	char real[PATH_MAX], *p;
+	const char *p;
 	int i;
 
 	if (!strcmp(dir, "./"))
 		return 0;
-	if (realpath(dir, real) == NULL)
-		die("cannot get real path of '%s'.", trimpath(dir));
 #ifdef SLOOPDEBUG
 	fprintf(stderr, "======== has_symlinkloop ======\n");
 	fprintf(stderr, "dir = '%s', real path = '%s'\n", dir, real);
@@ -542,63 +517,323 @@ has_symlinkloop(const char *dir)
 #endif
 	return 0;
 }
+/**
+ * readdirs: read a directory.
+ *
+ *	@param[in]	job	directory listing
+ *
+ * format of raw directory list:
+ * |ddir1\0ffile1\0Sfile2\0|
+ * means directory "dir1", file "file1" and file "file2" which cannot be
+ * examined. 'S': cannot stat, 'N': not regular file, 'R': cannot read.
+ *
+ * This function is called in a reader thread. Don't use die(), warning()
+ * and the functions which return a static area, like makepath().
+ */
+static void
+readdirs(struct dirjob *job)
+{
+	char path[MAXPATHLEN], real[PATH_MAX];
+	DIR *dirp;
+	struct dirent *dp;
+	struct stat st;
+	int type;
 
+	job->real = realpath(job->dir, real) ? check_strdup(real) : NULL;
+	if ((dirp = opendir(job->dir)) == NULL) {
+		job->error = 1;
+		return;
+	}
+	job->sb = strbuf_open(0);
+	while ((dp = readdir(dirp)) != NULL) {
+		if (!strcmp(dp->d_name, "."))
+			continue;
+		if (!strcmp(dp->d_name, ".."))
+			continue;
+		snprintf(path, sizeof(path), "%s%s", job->dir, dp->d_name);
+		if (stat(path, &st) < 0)
+			type = 'S';
+		else if (S_ISSOCK(st.st_mode) && !strcmp(dp->d_name, "GTAGS.sock"))
+			continue;	/* socket of 'global --server' */
+		else if (S_ISSOCK(st.st_mode) || S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode))
+			type = 'N';
+		else if (access(path, R_OK) < 0)
+			type = 'R';
+		else if (S_ISDIR(st.st_mode))
+			type = 'd';
+		else if (S_ISREG(st.st_mode))
+			type = 'f';
+		else
+			type = ' ';
+		strbuf_putc(job->sb, type);
+		strbuf_puts0(job->sb, dp->d_name);
+	}
+	(void)closedir(dirp);
+}
 /**
  * getdirs: get directory list
  *
- *	@param[in]	dir	directory (should end by "/")
- *	@param[out]	sb	string buffer
+ *	@param[in]	job	directory listing made by readdirs()
  *	@return		-1: error, 0: normal
  *
  * format of directory list:
  * |ddir1\0ffile1\0|
  * means directory "dir1", file "file1".
+ * The list is made from the raw list in place.
  */
 static int
-getdirs(const char *dir, STRBUF *sb)
+getdirs(struct dirjob *job)
 {
-	DIR *dirp;
-	struct dirent *dp;
-	struct stat st;
+	char *p, *q, *end;
+	const char *name;
+	int len;
 
-	if (check_looplink && has_symlinkloop(dir)) {
-		warning("symbolic link loop detected. '%s' is ignored.", trimpath(dir));
+	if (job->real == NULL)
+		die("cannot get real path of '%s'.", trimpath(job->dir));
+	if (check_looplink && has_symlinkloop(job->dir, job->real)) {
+		warning("symbolic link loop detected. '%s' is ignored.", trimpath(job->dir));
 		return -1;
 	}
-	if ((dirp = opendir(dir)) == NULL) {
-		warning("cannot open directory '%s'. ignored.", trimpath(dir));
+	if (job->error) {
+		warning("cannot open directory '%s'. ignored.", trimpath(job->dir));
 		return -1;
 	}
-	while ((dp = readdir(dirp)) != NULL) {
-		if (!strcmp(dp->d_name, "."))
-			continue;
-		if (!strcmp(dp->d_name, ".."))
-			continue;
-		if (stat(makepath(dir, dp->d_name, NULL), &st) < 0) {
-			warning("cannot stat '%s'. ignored.", trimpath(dp->d_name));
-			continue;
+	p = q = strbuf_value(job->sb);
+	end = p + strbuf_getlen(job->sb);
+	for (; p < end; p += len) {
+		len = strlen(p) + 1;
+		name = p + 1;
+		switch (*p) {
+		case 'S':
+			warning("cannot stat '%s'. ignored.", trimpath(name));
+			break;
+		case 'N':
+			warning("file is not regular file '%s'. ignored.", trimpath(name));
+			break;
+		case 'R':
+			if (!skip_unreadable)
+				die("cannot read file '%s'.", trimpath(name));
+			warning("cannot read '%s'. ignored.", trimpath(name));
+			break;
+		default:
+			if (q != p)
+				memmove(q, p, len);
+			q += len;
+			break;
 		}
-		if (S_ISSOCK(st.st_mode) || S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode)) {
-			warning("file is not regular file '%s'. ignored.", trimpath(dp->d_name));
+	}
+	strbuf_setlen(job->sb, q - strbuf_value(job->sb));
+	return 0;
+}
+/**
+ * new_job: make a directory listing.
+ *
+ *	@param[in]	path	directory (should end by "/")
+ *	@return		directory listing
+ */
+static struct dirjob *
+new_job(const char *path)
+{
+	struct dirjob *job = (struct dirjob *)check_calloc(sizeof(struct dirjob), 1);
+
+	job->dir = check_strdup(path);
+	job->state = JOB_NEW;
+	return job;
+}
+/**
+ * free_job: free a directory listing.
+ */
+static void
+free_job(struct dirjob *job)
+{
+	if (job->sb)
+		strbuf_close(job->sb);
+	if (job->real)
+		free(job->real);
+	free(job->dir);
+	free(job);
+}
+#ifdef HAVE_PTHREAD_H
+/**
+ * reader_main: main loop of a reader thread.
+ */
+static void *
+reader_main(void *arg)
+{
+	struct dirjob *job;
+
+	pthread_mutex_lock(&job_lock);
+	for (;;) {
+		while (queue_head == NULL && !reader_exit)
+			pthread_cond_wait(&job_queued, &job_lock);
+		if (reader_exit)
+			break;
+		job = queue_head;
+		queue_head = job->qnext;
+		if (queue_head)
+			queue_head->qprev = NULL;
+		else
+			queue_tail = NULL;
+		job->state = JOB_RUN;
+		pthread_mutex_unlock(&job_lock);
+		readdirs(job);
+		pthread_mutex_lock(&job_lock);
+		job->state = JOB_DONE;
+		pthread_cond_broadcast(&job_done);
+	}
+	pthread_mutex_unlock(&job_lock);
+	return NULL;
+}
+/**
+ * readers_open: start reader threads.
+ */
+static void
+readers_open(void)
+{
+	int i;
+
+	if (find_threads <= 1)
+		return;
+	reader_exit = 0;
+	readers = (pthread_t *)check_calloc(sizeof(pthread_t), find_threads);
+	for (i = 0; i < find_threads; i++) {
+		if (pthread_create(&readers[i], NULL, reader_main, NULL) != 0)
+			break;
+	}
+	if (i == 0) {
+		/* fall back to the serial traversal */
+		free(readers);
+		readers = NULL;
+	} else
+		find_threads = i;
+}
+/**
+ * readers_close: stop reader threads.
+ *
+ * The listings in the queue are left as is. They are freed with the stack.
+ */
+static void
+readers_close(void)
+{
+	int i;
+
+	if (readers == NULL)
+		return;
+	pthread_mutex_lock(&job_lock);
+	reader_exit = 1;
+	pthread_cond_broadcast(&job_queued);
+	pthread_mutex_unlock(&job_lock);
+	for (i = 0; i < find_threads; i++)
+		pthread_join(readers[i], NULL);
+	free(readers);
+	readers = NULL;
+	queue_head = queue_tail = NULL;
+	job_count = 0;
+}
+#endif
+/**
+ * queue_subdirs: make listings of the sub directories in advance.
+ *
+ *	@param[in]	curp	stack entry just pushed
+ *
+ * The listings are made for the directories which are not skipped,
+ * in the order of the traversal.
+ */
+static void
+queue_subdirs(struct stack_entry *curp)
+{
+#ifdef HAVE_PTHREAD_H
+	struct dirjob *job, **tail = &curp->jobs;
+	STRBUF *path;
+	char *p;
+
+	curp->jobs = NULL;
+	if (readers == NULL)
+		return;
+	path = strbuf_open(0);
+	for (p = curp->start; p < curp->end; p += strlen(p) + 1) {
+		if (*p != 'd')
 			continue;
-		}
-		if (access(makepath(dir, dp->d_name, NULL), R_OK) < 0) {
-			if (!skip_unreadable)
-				die("cannot read file '%s'.", trimpath(dp->d_name));
-			warning("cannot read '%s'. ignored.", trimpath(dp->d_name));
+		/*
+		 * The same path as find_read_traverse() makes, so that
+		 * the listings are taken in the order.
+		 */
+		strbuf_reset(path);
+		strbuf_puts(path, makepath(dir, p + 1, NULL));
+		strbuf_putc(path, '/');
+		if (isskipped(strbuf_value(path)))
 			continue;
+		job = new_job(strbuf_value(path));
+		*tail = job;
+		tail = &job->next;
+		pthread_mutex_lock(&job_lock);
+		if (job_count < FIND_MAXJOBS) {
+			job->state = JOB_QUEUED;
+			job->queued = 1;
+			job->qprev = queue_tail;
+			if (queue_tail)
+				queue_tail->qnext = job;
+			else
+				queue_head = job;
+			queue_tail = job;
+			job_count++;
+			pthread_cond_signal(&job_queued);
 		}
-		if (S_ISDIR(st.st_mode))
-			strbuf_putc(sb, 'd');
-		else if (S_ISREG(st.st_mode))
-			strbuf_putc(sb, 'f');
-		else
-			strbuf_putc(sb, ' ');
-		strbuf_puts(sb, dp->d_name);
-		strbuf_putc(sb, '\0');
+		pthread_mutex_unlock(&job_lock);
+	}
+	strbuf_close(path);
+#else
+	curp->jobs = NULL;
+#endif
+}
+/**
+ * wait_job: wait for a directory listing.
+ *
+ *	@param[in]	job	directory listing
+ *
+ * If no reader has taken the listing yet, it is made by the caller.
+ */
+static void
+wait_job(struct dirjob *job)
+{
+#ifdef HAVE_PTHREAD_H
+	if (job->queued) {
+		pthread_mutex_lock(&job_lock);
+		job_count--;
+		if (job->state == JOB_QUEUED) {
+			if (job->qprev)
+				job->qprev->qnext = job->qnext;
+			else
+				queue_head = job->qnext;
+			if (job->qnext)
+				job->qnext->qprev = job->qprev;
+			else
+				queue_tail = job->qprev;
+			job->state = JOB_RUN;
+		} else {
+			while (job->state != JOB_DONE)
+				pthread_cond_wait(&job_done, &job_lock);
+		}
+		pthread_mutex_unlock(&job_lock);
+		if (job->state == JOB_DONE)
+			return;
+	}
+#endif
+	readdirs(job);
+	job->state = JOB_DONE;
+}
+/**
+ * free_jobs: free the listings of a stack entry.
+ */
+static void
+free_jobs(struct stack_entry *curp)
+{
+	struct dirjob *job;
+
+	while ((job = curp->jobs) != NULL) {
+		curp->jobs = job->next;
+		free_job(job);
 	}
-	(void)closedir(dirp);
-	return 0;
 }
 /**
  * set_accept_dotfiles: make find to accept dot files and dot directries.
@@ -616,6 +851,20 @@ set_skip_unreadable(void)
 {
 	skip_unreadable = 1;
 }
+/**
+ * set_find_threads: read directories using threads.
+ *
+ *	@param[in]	n	number of reader threads
+ *
+ * The order of the paths is not changed.
+ */
+void
+set_find_threads(int n)
+{
+#ifdef HAVE_PTHREAD_H
+	find_threads = n;
+#endif
+}
 /**
  * find_open: start iterator without GPATH.
  *
@@ -627,6 +876,7 @@ void
 find_open(const char *start, int explain)
 {
 	struct stack_entry *curp;
+	struct dirjob *job;
 	assert(find_mode == 0);
 	find_mode = FIND_OPEN;
 	find_explain = explain;
@@ -643,12 +893,21 @@ find_open(const char *start, int explain)
 	curp = varray_assign(stack, current_entry, 1);
 	strlimcpy(dir, start, sizeof(dir));
 	curp->dirp = dir + strlen(dir);
-	curp->sb = strbuf_open(0);
-	curp->real = getrealpath(dir);
-	if (getdirs(dir, curp->sb) < 0)
+	job = new_job(dir);
+	readdirs(job);
+	curp->real = job->real;
+	if (getdirs(job) < 0)
 		die("Work is given up.");
+	curp->sb = job->sb;
+	job->sb = NULL;
+	job->real = NULL;
+	free_job(job);
 	curp->start = curp->p = strbuf_value(curp->sb);
 	curp->end   = curp->start + strbuf_getlen(curp->sb);
+#ifdef HAVE_PTHREAD_H
+	readers_open();
+#endif
+	queue_subdirs(curp);
 	strlimcpy(cwddir, get_root(), sizeof(cwddir));
 }
 /**
@@ -745,18 +1004,9 @@ find_read_traverse(void)
 				continue;
 			if (type == 'f') {
 				/*
-				 * Skip the following:
-				 * o directory
-				 * o file which does not exist
-				 * o dead symbolic link
+				 * Getdirs() has already made sure that
+				 * this is a regular file by stat(2).
 				 */
-				if (!test("f", path)) {
-					if (test("d", path))
-						warning("'%s' is a directory. ignored.", trimpath(path));
-					else
-						warning("'%s' not found. ignored.", trimpath(path));
-					continue;
-				}
 				/*
 				 * Now GLOBAL can treat the path which includes blanks.
 				 * This message is obsoleted.
@@ -780,12 +1030,20 @@ find_read_traverse(void)
 				return val;
 			}
 			if (type == 'd') {
-				STRBUF *sb = strbuf_open(0);
+				struct dirjob *job;
 				char *dirp = curp->dirp;
 				strcat(dirp, unit);
 				strcat(dirp, "/");
-				if (getdirs(dir, sb) < 0) {
-					strbuf_close(sb);
+				/*
+				 * The listing may have been made in advance.
+				 */
+				if ((job = curp->jobs) != NULL)
+					curp->jobs = job->next;
+				else
+					job = new_job(dir);
+				wait_job(job);
+				if (getdirs(job) < 0) {
+					free_job(job);
 					*(curp->dirp) = 0;
 					continue;
 				}
@@ -794,16 +1052,21 @@ find_read_traverse(void)
 				 */
 				curp = varray_assign(stack, ++current_entry, 1);
 				curp->dirp = dirp + strlen(dirp);
-				curp->real = getrealpath(dir);
-				curp->sb = sb;
-				curp->start = curp->p = strbuf_value(sb);
-				curp->end   = curp->start + strbuf_getlen(sb);
+				curp->real = job->real;
+				curp->sb = job->sb;
+				job->sb = NULL;
+				job->real = NULL;
+				free_job(job);
+				curp->start = curp->p = strbuf_value(curp->sb);
+				curp->end   = curp->start + strbuf_getlen(curp->sb);
+				queue_subdirs(curp);
 			}
 		}
 		strbuf_close(curp->sb);
 		curp->sb = NULL;
 		free(curp->real);
 		curp->real = NULL;
+		free_jobs(curp);
 		if (current_entry == 0)
 			break;
 		/*
@@ -887,6 +1150,110 @@ find_read_filelist(void)
 		return path;
 	}
 }
+/**
+ * find_bench_match: compare the path matchers with regular expressions.
+ *
+ *	@param[in]	filename	file including list of path names.
+ *				When "-" is specified, read from standard input.
+ *	@param[in]	count	number of repetitions
+ *
+ * This is for developers. Each path is checked by skipthisfile() and
+ * issourcefile() using both the path matchers and the equivalent regular
+ * expressions. Paths for which they differ are reported, and the time of
+ * each method is printed.
+ */
+void
+find_bench_match(const char *filename, int count)
+{
+	STATISTICS_TIME *tim;
+	STRBUF *ib = strbuf_open(0);
+	STRBUF *sb = strbuf_open(0);
+	regex_t skip_area, suff_area;
+	FILE *fp;
+	const char *path, *start, *end;
+	int flags = REG_EXTENDED|REG_NEWLINE;
+	int i, n = 0, diff = 0;
+
+	if (!strcmp(filename, "-"))
+		fp = stdin;
+	else if ((fp = fopen(filename, "r")) == NULL)
+		die("cannot open '%s'.", trimpath(filename));
+	while ((path = strbuf_fgets(ib, fp, STRBUF_NOCRLF)) != NULL) {
+		if (*path == '\0')
+			continue;
+		if (strncmp(path, "./", 2))
+			strbuf_puts(sb, "./");
+		strbuf_puts0(sb, path);
+		n++;
+	}
+	if (fp != stdin)
+		fclose(fp);
+	start = strbuf_value(sb);
+	end = start + strbuf_getlen(sb);
+	/*
+	 * Prepare the path matchers and the equivalent regular expressions.
+	 */
+	if (skip == NULL && (skip = prepare_skip()) == NULL)
+		die("prepare_skip failed.");
+	if (suff == NULL && (suff = prepare_source()) == NULL)
+		die("prepare_source failed.");
+	if (skip->flags & PATHMATCH_ICASE)
+		flags |= REG_ICASE;
+	if (regcomp(&skip_area, pathmatch_regex(skip), flags) != 0)
+		die("cannot compile regular expression.");
+	if (regcomp(&suff_area, pathmatch_regex(suff), flags) != 0)
+		die("cannot compile regular expression.");
+	/*
+	 * Compare the results.
+	 */
+	for (path = start; path < end; path += strlen(path) + 1) {
+		int a = pathmatch_match(skip, path, NULL, NULL);
+		int b = regexec(&skip_area, path, 0, 0, 0) == 0;
+
+		if (a != b) {
+			warning("skip list: '%s' %s by matcher but %s by regex.", path,
+				a ? "matched" : "not matched", b ? "matched" : "not matched");
+			diff++;
+		}
+		a = pathmatch_match(suff, path, NULL, NULL);
+		b = regexec(&suff_area, path, 0, 0, 0) == 0;
+		if (a != b) {
+			warning("suffix: '%s' %s by matcher but %s by regex.", path,
+				a ? "matched" : "not matched", b ? "matched" : "not matched");
+			diff++;
+		}
+	}
+	/*
+	 * Measure the time.
+	 */
+	init_statistics();
+	tim = statistics_time_start("Time of skip list by matcher");
+	for (i = 0; i < count; i++)
+		for (path = start; path < end; path += strlen(path) + 1)
+			(void)pathmatch_match(skip, path, NULL, NULL);
+	statistics_time_end(tim);
+	tim = statistics_time_start("Time of skip list by regex");
+	for (i = 0; i < count; i++)
+		for (path = start; path < end; path += strlen(path) + 1)
+			(void)regexec(&skip_area, path, 0, 0, 0);
+	statistics_time_end(tim);
+	tim = statistics_time_start("Time of suffixes by matcher");
+	for (i = 0; i < count; i++)
+		for (path = start; path < end; path += strlen(path) + 1)
+			(void)pathmatch_match(suff, path, NULL, NULL);
+	statistics_time_end(tim);
+	tim = statistics_time_start("Time of suffixes by regex");
+	for (i = 0; i < count; i++)
+		for (path = start; path < end; path += strlen(path) + 1)
+			(void)regexec(&suff_area, path, 0, 0, 0);
+	statistics_time_end(tim);
+	fprintf(stdout, "%d paths, %d times, %d differences.\n", n, count, diff);
+	print_statistics(STATISTICS_STYLE_TABLE);
+	regfree(&skip_area);
+	regfree(&suff_area);
+	strbuf_close(ib);
+	strbuf_close(sb);
+}
 /**
  * find_close: close iterator.
  */
@@ -895,8 +1262,17 @@ find_close(void)
 {
 	assert(find_mode != 0);
 	if (find_mode == FIND_OPEN) {
-		if (stack)
+#ifdef HAVE_PTHREAD_H
+		readers_close();
+#endif
+		if (stack) {
+			struct stack_entry *sp = varray_assign(stack, 0, 0);
+			int i;
+
+			for (i = 0; i <= current_entry; i++)
+				free_jobs(&sp[i]);
 			varray_close(stack);
+		}
 	} else if (find_mode == FILELIST_OPEN) {
 		/*
 		 * The --file=- option is specified, we don't close file
@@ -907,9 +1283,17 @@ find_close(void)
 	} else {
 		die("find_close: internal error.");
 	}
-	if (suff)
-		regfree(suff);
-	if (skip)
-		regfree(skip);
+	/*
+	 * They are prepared again when skipthisfile() or issourcefile()
+	 * is called after this.
+	 */
+	if (suff) {
+		pathmatch_close(suff);
+		suff = NULL;
+	}
+	if (skip) {
+		pathmatch_close(skip);
+		skip = NULL;
+	}
 	find_eof = find_mode = 0;
 }
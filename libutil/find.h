@@ -23,11 +23,13 @@
 
 void set_accept_dotfiles(void);
 void set_skip_unreadable(void);
+void set_find_threads(int);
 int skipthisfile(const char *);
 int issourcefile(const char *);
 void find_open(const char *, int);
 void find_open_filelist(const char *, const char *, int);
 char *find_read(void);
 void find_close(void);
+void find_bench_match(const char *, int);
 
 #endif /* ! _FIND_H_ */
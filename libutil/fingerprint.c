@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <time.h>
+
+#include "checkalloc.h"
+#include "fingerprint.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/*
+
+Fingerprint of a file
+
+A fingerprint consists of the size, the modification time and the inode
+number of a file, and a hash value of the content. gtags(1) records it
+in GPATH for each source file, and in incremental updating it re-parses
+only the files whose content was changed.
+
+	FINGERPRINT old, cur;
+
+	fingerprint_stat(&cur, &st);		// cheap check first
+	if (fingerprint_samestat(&old, &cur))
+		=> not changed
+	else if (old.size != cur.size)
+		=> changed
+	else if (fingerprint_hash(&cur, path) == 0 && cur.hash == old.hash)
+		=> not changed (only the attributes were changed)
+
+The hash function is XXH64 (seed 0) by Yann Collet. It is fast and not
+cryptographic, which is enough to detect modification.
+
+*/
+#define PRIME64_1	0x9E3779B185EBCA87ULL
+#define PRIME64_2	0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3	0x165667B19E3779F9ULL
+#define PRIME64_4	0x85EBCA77C2B2AE63ULL
+#define PRIME64_5	0x27D4EB2F165667C5ULL
+
+#define ROTL64(x, r)	(((x) << (r)) | ((x) >> (64 - (r))))
+
+/** read 64 bit little endian value */
+static unsigned long long
+read64(const unsigned char *p)
+{
+	return (unsigned long long)p[0]
+		| (unsigned long long)p[1] << 8
+		| (unsigned long long)p[2] << 16
+		| (unsigned long long)p[3] << 24
+		| (unsigned long long)p[4] << 32
+		| (unsigned long long)p[5] << 40
+		| (unsigned long long)p[6] << 48
+		| (unsigned long long)p[7] << 56;
+}
+/** read 32 bit little endian value */
+static unsigned long long
+read32(const unsigned char *p)
+{
+	return (unsigned long long)p[0]
+		| (unsigned long long)p[1] << 8
+		| (unsigned long long)p[2] << 16
+		| (unsigned long long)p[3] << 24;
+}
+static unsigned long long
+hash_round(unsigned long long acc, unsigned long long input)
+{
+	acc += input * PRIME64_2;
+	acc = ROTL64(acc, 31);
+	return acc * PRIME64_1;
+}
+static unsigned long long
+hash_merge(unsigned long long acc, unsigned long long val)
+{
+	acc ^= hash_round(0, val);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+/**
+ * hash: compute hash value of a memory block.
+ *
+ *	@param[in]	buf	memory block
+ *	@param[in]	len	length of the block
+ *	@return		hash value
+ */
+static unsigned long long
+hash(const unsigned char *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	const unsigned char *end = buf + len;
+	unsigned long long h;
+
+	if (len >= 32) {
+		const unsigned char *limit = end - 32;
+		unsigned long long v1 = PRIME64_1 + PRIME64_2;
+		unsigned long long v2 = PRIME64_2;
+		unsigned long long v3 = 0;
+		unsigned long long v4 = -PRIME64_1;
+
+		do {
+			v1 = hash_round(v1, read64(p));
+			v2 = hash_round(v2, read64(p + 8));
+			v3 = hash_round(v3, read64(p + 16));
+			v4 = hash_round(v4, read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+		h = ROTL64(v1, 1) + ROTL64(v2, 7) + ROTL64(v3, 12) + ROTL64(v4, 18);
+		h = hash_merge(h, v1);
+		h = hash_merge(h, v2);
+		h = hash_merge(h, v3);
+		h = hash_merge(h, v4);
+	} else {
+		h = PRIME64_5;
+	}
+	h += (unsigned long long)len;
+	for (; p + 8 <= end; p += 8) {
+		h ^= hash_round(0, read64(p));
+		h = ROTL64(h, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (p + 4 <= end) {
+		h ^= read32(p) * PRIME64_1;
+		h = ROTL64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= *p * PRIME64_5;
+		h = ROTL64(h, 11) * PRIME64_1;
+	}
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+/**
+ * fingerprint_stat: set the attributes of a file to a fingerprint.
+ *
+ *	@param[out]	fp	fingerprint
+ *	@param[in]	st	result of stat(2)
+ *
+ * The hash value is cleared. If the file was modified in this second,
+ * the modification time is not reliable, because the file might be
+ * modified again in the same second. In that case, the time is recorded
+ * as 0 so that the content is always compared next time.
+ */
+void
+fingerprint_stat(FINGERPRINT *fp, const struct stat *st)
+{
+	fp->size = (long long)st->st_size;
+	fp->mtime = (long long)st->st_mtime;
+	fp->ino = (long long)st->st_ino;
+	fp->hash = 0;
+	if (st->st_mtime >= time(NULL))
+		fp->mtime = 0;
+}
+/**
+ * fingerprint_hash: compute the hash value of a file.
+ *
+ *	@param[out]	fp	fingerprint (only hash is set)
+ *	@param[in]	path	path name
+ *	@return		0: normal, -1: cannot read the file
+ */
+int
+fingerprint_hash(FINGERPRINT *fp, const char *path)
+{
+	struct stat st;
+	unsigned char *buf;
+	int fd, ret = -1;
+
+	if ((fd = open(path, O_RDONLY | O_BINARY)) < 0)
+		return -1;
+	if (fstat(fd, &st) < 0)
+		goto out;
+	if (st.st_size == 0) {
+		fp->hash = hash(NULL, 0);
+		ret = 0;
+		goto out;
+	}
+#ifdef HAVE_MMAP
+	buf = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buf != MAP_FAILED) {
+		fp->hash = hash(buf, st.st_size);
+		munmap(buf, st.st_size);
+		ret = 0;
+		goto out;
+	}
+	/* fall through to read(2) */
+#endif
+	buf = (unsigned char *)check_malloc(st.st_size);
+	if (read(fd, buf, st.st_size) == st.st_size) {
+		fp->hash = hash(buf, st.st_size);
+		ret = 0;
+	}
+	free(buf);
+out:
+	close(fd);
+	return ret;
+}
+/**
+ * fingerprint_make: make the fingerprint of a file.
+ *
+ *	@param[out]	fp	fingerprint
+ *	@param[in]	path	path name
+ *	@return		0: normal, -1: cannot read the file
+ */
+int
+fingerprint_make(FINGERPRINT *fp, const char *path)
+{
+	struct stat st;
+
+	if (stat(path, &st) < 0)
+		return -1;
+	fingerprint_stat(fp, &st);
+	return fingerprint_hash(fp, path);
+}
+/**
+ * fingerprint_samestat: compare the attributes of two fingerprints.
+ *
+ *	@param[in]	a	fingerprint
+ *	@param[in]	b	fingerprint
+ *	@return		1: same, 0: different or unknown
+ */
+int
+fingerprint_samestat(const FINGERPRINT *a, const FINGERPRINT *b)
+{
+	return a->mtime != 0 && a->mtime == b->mtime
+		&& a->size == b->size && a->ino == b->ino;
+}
+/**
+ * fingerprint_format: format a fingerprint into a string.
+ *
+ *	@param[in]	fp	fingerprint
+ *	@return		"<size> <mtime> <ino> <hash>"
+ *
+ * The result is valid until the next call.
+ */
+const char *
+fingerprint_format(const FINGERPRINT *fp)
+{
+	static char buf[100];
+
+	snprintf(buf, sizeof(buf), "%lld %lld %lld %016llx",
+		fp->size, fp->mtime, fp->ino, fp->hash);
+	return buf;
+}
+/**
+ * fingerprint_scan: read a fingerprint from a string.
+ *
+ *	@param[out]	fp	fingerprint
+ *	@param[in]	s	string made by fingerprint_format()
+ *	@return		0: normal, -1: illegal format
+ */
+int
+fingerprint_scan(FINGERPRINT *fp, const char *s)
+{
+	if (sscanf(s, "%lld %lld %lld %llx", &fp->size, &fp->mtime, &fp->ino, &fp->hash) != 4)
+		return -1;
+	return 0;
+}
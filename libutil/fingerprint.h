@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _FINGERPRINT_H
+#define _FINGERPRINT_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/** fingerprint of the content of a file */
+typedef struct {
+	long long size;			/**< file size */
+	long long mtime;		/**< modification time (0: unreliable) */
+	long long ino;			/**< inode number */
+	unsigned long long hash;	/**< hash value of the content */
+} FINGERPRINT;
+
+void fingerprint_stat(FINGERPRINT *, const struct stat *);
+int fingerprint_hash(FINGERPRINT *, const char *);
+int fingerprint_make(FINGERPRINT *, const char *);
+int fingerprint_samestat(const FINGERPRINT *, const FINGERPRINT *);
+const char *fingerprint_format(const FINGERPRINT *);
+int fingerprint_scan(FINGERPRINT *, const char *);
+
+#endif /* ! _FINGERPRINT_H */
@@ -59,5 +59,18 @@
 #define GTAGSCACHE	50000000
 		/** minimum cache size 500KB	*/
 #define GTAGSMINCACHE	500000
+/*
+ * The default number of pages read ahead in a sequential scan is 32 (256KB).
+ */
+		/** default readahead pages	*/
+#define GTAGSREADAHEAD	32
+/*
+ * The default memory size for sorted writing is 50MB.
+ * The minimum size is 1MB.
+ */
+		/** default sort memory size 50MB	*/
+#define GTAGSSORTMEM	50000000
+		/** minimum sort memory size 1MB	*/
+#define GTAGSMINSORTMEM	1000000
 
 #endif /* ! _GPARAM_H_ */
@@ -34,6 +34,7 @@
 #include "checkalloc.h"
 #include "die.h"
 #include "dbop.h"
+#include "fileop.h"
 #include "getdbpath.h"
 #include "gtagsop.h"
 #include "gpathop.h"
@@ -100,9 +101,29 @@ compare_nearpath(const void *s1, const void *s2)
  *      --------------------
  *      ./aaa.c\0       11\0
  *      ./README\0      12\0o\0         <=== 'o' means other files.
+ *
+ * Since GLOBAL-6.5.7, GPATH may have the fingerprint of source files.
+ * It is a meta record, so older GLOBAL just ignore it.
+ *
+ *      key             data
+ *      --------------------
+ *       __.FP.11\0     1234 1460000000 5678 0123456789abcdef\0
+ *                      (size mtime inode hash)
  */
 static int support_version = 2;	/**< acceptable format version   */
 static int create_version = 2;	/**< format version of newly created tag file */
+/**
+ * makefpkey: make the key of the fingerprint record
+ *
+ *	@param[out]	key	buffer
+ *	@param[in]	size	size of the buffer
+ *	@param[in]	fid	file id
+ */
+static void
+makefpkey(char *key, int size, const char *fid)
+{
+	snprintf(key, size, "%s%s", FINGERPRINTKEY, fid);
+}
 /**
  * gpath_open: open gpath tag file
  *
@@ -128,7 +149,14 @@ gpath_open(const char *dbpath, int mode)
 	_mode = mode;
 	if (mode == 1 && created)
 		mode = 0;
-	dbop = dbop_open(makepath(dbpath, dbname(GPATH), NULL), mode, 0644, openflags);
+	if (mode == 0) {
+		/* see lockdirectory() */
+		int lock = lockdirectory(dbpath, 0);
+
+		dbop = dbop_open(makepath(dbpath, dbname(GPATH), NULL), mode, 0644, openflags);
+		unlockdirectory(lock);
+	} else
+		dbop = dbop_open(makepath(dbpath, dbname(GPATH), NULL), mode, 0644, openflags);
 	if (dbop == NULL)
 		return -1;
 	if (mode == 1) {
@@ -235,6 +263,7 @@ gpath_fid2path(const char *fid, int *type)
 void
 gpath_delete(const char *path)
 {
+	char key[MAXFIDLEN + sizeof(FINGERPRINTKEY)];
 	const char *fid;
 
 	assert(opened > 0);
@@ -243,8 +272,50 @@ gpath_delete(const char *path)
 	fid = dbop_get(dbop, path);
 	if (fid == NULL)
 		return;
+	makefpkey(key, sizeof(key), fid);
 	dbop_delete(dbop, fid);
 	dbop_delete(dbop, path);
+	dbop_delete(dbop, key);
+}
+/**
+ * gpath_put_fingerprint: put the fingerprint of a source file
+ *
+ *	@param[in]	fid	file id
+ *	@param[in]	fp	fingerprint
+ */
+void
+gpath_put_fingerprint(const char *fid, const FINGERPRINT *fp)
+{
+	char key[MAXFIDLEN + sizeof(FINGERPRINTKEY)];
+
+	assert(opened > 0);
+	if (_mode == 1 && created)
+		return;
+	/* opened for reading; gtags --snapshot puts it into the copy later */
+	if (_mode == 0)
+		return;
+	makefpkey(key, sizeof(key), fid);
+	dbop_update(dbop, key, fingerprint_format(fp));
+}
+/**
+ * gpath_get_fingerprint: get the fingerprint of a source file
+ *
+ *	@param[in]	fid	file id
+ *	@param[out]	fp	fingerprint
+ *	@return		0: normal,
+ *			-1: not found (GPATH made by older version)
+ */
+int
+gpath_get_fingerprint(const char *fid, FINGERPRINT *fp)
+{
+	char key[MAXFIDLEN + sizeof(FINGERPRINTKEY)];
+	const char *data;
+
+	assert(opened > 0);
+	makefpkey(key, sizeof(key), fid);
+	if ((data = dbop_get(dbop, key)) == NULL)
+		return -1;
+	return fingerprint_scan(fp, data);
 }
 /**
  * gpath_nextkey: return next key
@@ -307,8 +378,10 @@ GFIND *
 gfind_open(const char *dbpath, const char *local, int target, int flags)
 {
 	GFIND *gfind = (GFIND *)check_calloc(sizeof(GFIND), 1);
+	int lock = lockdirectory(dbpath, 0);	/* see lockdirectory() */
 
 	gfind->dbop = dbop_open(makepath(dbpath, dbname(GPATH), NULL), 0, 0, 0);
+	unlockdirectory(lock);
 	if (gfind->dbop == NULL)
 		die("GPATH not found.");
 	gfind->path = NULL;
@@ -24,10 +24,12 @@
 
 #include "gparam.h"
 #include "dbop.h"
+#include "fingerprint.h"
 #include "pool.h"
 #include "varray.h"
 
 #define NEXTKEY		" __.NEXTKEY"
+#define FINGERPRINTKEY	" __.FP."
 
 /*
  * File type
@@ -65,6 +67,8 @@ const char *gpath_path2fid(const char *, int *);
 const char *gpath_fid2path(const char *, int *);
 void gpath_put(const char *, int);
 void gpath_delete(const char *);
+void gpath_put_fingerprint(const char *, const FINGERPRINT *);
+int gpath_get_fingerprint(const char *, FINGERPRINT *);
 void gpath_close(void);
 int gpath_nextkey(void);
 GFIND *gfind_open(const char *, const char *, int, int);
@@ -44,6 +44,7 @@
 #include "compress.h"
 #include "dbop.h"
 #include "die.h"
+#include "fileop.h"
 #include "format.h"
 #include "getdbpath.h"
 #include "gparam.h"
@@ -71,6 +72,10 @@ static int is_defined_in_GTAGS(GTOP *, const char *);
 static char *get_prefix(const char *, int);
 static int gtags_restart(GTOP *);
 static void flush_pool(GTOP *, const char *);
+static void flush_keys(GTOP *, const char *);
+static const char *fidindexkey(int);
+static void open_bloom(GTOP *, const char *);
+static void write_bloom(GTOP *);
 static void segment_read(GTOP *);
 
 /**
@@ -202,6 +207,19 @@ seekto(const char *string, int n)
  * - Put file id at the head of tag record.
  *     We can access file id without string processing.
  *     This is advantageous for deleting tag record when incremental updating.
+ * - Each file has an index record which lists the keys of the file
+ *     (GTAGS_FIDINDEX). When incremental updating, only these keys are
+ *     visited to delete the tag records of the file.
+ *
+ *         [example]
+ *         +------------------------------------
+ *         | __.FIDINDEX.110 func main
+ *
+ *     Tag files without the ' __.FIDINDEX' option record have no index.
+ *     Their tag records are deleted by scanning the whole file.
+ *     The index makes GTAGS and GRTAGS about 30% larger.
+ *     Since older gtags(1) would update the tag records leaving the index
+ *     out of date, the index is used only in format version 7 or later.
  * 
  * [Concept of format version]
  *
@@ -233,8 +251,10 @@ seekto(const char *string, int n)
                        if (format !=  4) then print error message.
   GLOBAL-5.4 - 5.8.2	support format version 4 and 5
                        if (format > 5 || format < 4) then print error message.
-  GLOBAL-5.9 -		support only format version 6
+  GLOBAL-5.9 - 6.5.6	support only format version 6
                        if (format > 6 || format < 6) then print error message.
+  GLOBAL-6.5.7 -	support format version 6 and 7
+                       if (format > 7 || format < 6) then print error message.
  *
  * In GLOBAL-5.0, we threw away the compatibility with the past formats.
  * Though we could continue the support for older formats, it seemed
@@ -249,8 +269,8 @@ seekto(const char *string, int n)
  *       $ global -x main
  *       GTAGS seems older format. Please remake tag files.
  */
-static int new_format_version = 6;	/**< new format version */
-static int upper_bound_version = 6;	/**< acceptable format version (upper bound) */
+static int new_format_version = 7;	/**< new format version */
+static int upper_bound_version = 7;	/**< acceptable format version (upper bound) */
 static int lower_bound_version = 6;	/**< acceptable format version (lower bound) */
 static const char *const tagslist[] = {"GPATH", "GTAGS", "GRTAGS", "GSYMS"};
 /**
@@ -267,9 +287,9 @@ static const char *const tagslist[] = {"GPATH", "GTAGS", "GRTAGS", "GSYMS"};
  *            +=======> GRTAGS	tags which is defined in GTAGS
  *            +=======> GSYMS	tags which is not defined in GTAGS
  */
-#define VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop) 						\
+#define VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop, key)					\
 	if (gtop->db == GRTAGS || gtop->db == GSYMS) {					\
-		int defined = is_defined_in_GTAGS(gtop, gtop->dbop->lastkey);		\
+		int defined = is_defined_in_GTAGS(gtop, key);				\
 		if ((gtop->db == GRTAGS && !defined) || (gtop->db == GSYMS && defined))	\
 			continue;							\
 	}
@@ -291,6 +311,8 @@ is_defined_in_GTAGS(GTOP *gtop, const char *name)
 	if (!strcmp(name, prev_name))
 		return prev_result;
 	strlimcpy(prev_name, name, sizeof(prev_name));
+	if (gtop->bloom && !bloom_test(gtop->bloom, prev_name))
+		return prev_result = 0;
 	return prev_result = dbop_get(gtop->gtags, prev_name) ? 1 : 0;
 }
 /**
@@ -316,7 +338,8 @@ dbname(int db)
  *	@param[in]	mode	GTAGS_READ: read only,
  *			GTAGS_CREATE: create tag,
  *			GTAGS_MODIFY: modify tag
- *	@param[in]	flags	GTAGS_COMPACT: compact format
+ *	@param[in]	flags	GTAGS_COMPACT: compact format,
+ *			GTAGS_PFXLEAF: compress the keys in leaf pages
  *	@return		GTOP structure
  *
  * [Note] when error occurred, gtags_open() doesn't return.
@@ -328,6 +351,7 @@ gtags_open(const char *dbpath, const char *root, int db, int mode, int flags)
 	char tagfile[MAXPATHLEN];
 	int dbmode;
 	int dbop_flags = DBOP_DUP;
+	int lock = -1;
 
 	gtop = (GTOP *)check_calloc(sizeof(GTOP), 1);
 	gtop->db = db;
@@ -355,10 +379,24 @@ gtags_open(const char *dbpath, const char *root, int db, int mode, int flags)
 	 */
 	if (flags & GTAGS_SQLITE3) {
 		dbop_flags |= DBOP_SQLITE3;
-		set_gpath_flags(DBOP_SQLITE3);
+		if (flags & GTAGS_WAL)
+			dbop_flags |= DBOP_WAL;
+		set_gpath_flags(dbop_flags & (DBOP_SQLITE3|DBOP_WAL));
 	} else
 #endif
+	{
 		dbop_flags |= DBOP_SORTED_WRITE;
+		if (flags & GTAGS_PFXLEAF) {
+			dbop_flags |= DBOP_PFXLEAF;
+			set_gpath_flags(DBOP_PFXLEAF);
+		}
+	}
+	/*
+	 * Reading and updating scan the tag file (e.g. global -c, gtags_delete()),
+	 * which would flush the pages used repeatedly out of a LRU cache.
+	 */
+	if (dbmode != 1)
+		dbop_flags |= DBOP_CACHE2Q;
 	/*
 	 * GRTAGS and GSYMS are virtual tag file. They are included in a real GRTAGS file.
 	 * In fact, GSYMS doesn't exist now.
@@ -366,6 +404,13 @@ gtags_open(const char *dbpath, const char *root, int db, int mode, int flags)
 	 * GRTAGS:	tags which belongs to GRTAGS, and are defined in GTAGS.
 	 * GSYMS:	tags which belongs to GRTAGS, and is not defined in GTAGS.
 	 */
+	/*
+	 * The tag file, GTAGS, GPATH and the Bloom filter are opened under
+	 * the shared lock, not to see tag files which 'gtags --snapshot'
+	 * is replacing.
+	 */
+	if (dbmode == 0)
+		lock = lockdirectory(dbpath, 0);
 	strlimcpy(tagfile, makepath(dbpath, dbname(db == GSYMS ? GRTAGS : db), NULL), sizeof(tagfile));
 	gtop->dbop = dbop_open(tagfile, dbmode, 0644, dbop_flags);
 	if (gtop->dbop == NULL) {
@@ -417,6 +462,16 @@ gtags_open(const char *dbpath, const char *root, int db, int mode, int flags)
 			dbop_putoption(gtop->dbop, COMPLINEKEY, NULL);
 		if (gtop->format & GTAGS_COMPNAME)
 			dbop_putoption(gtop->dbop, COMPNAMEKEY, NULL);
+		gtop->format |= GTAGS_FIDINDEX;
+#ifdef USE_SQLITE3
+		/*
+		 * Sqlite3 deletes records using the fid column.
+		 */
+		if (gtop->openflags & GTAGS_SQLITE3)
+			gtop->format &= ~GTAGS_FIDINDEX;
+#endif
+		if (gtop->format & GTAGS_FIDINDEX)
+			dbop_putoption(gtop->dbop, FIDINDEXKEY, NULL);
 		dbop_putversion(gtop->dbop, gtop->format_version); 
 	} else {
 		/*
@@ -445,6 +500,8 @@ gtags_open(const char *dbpath, const char *root, int db, int mode, int flags)
 			gtop->format |= GTAGS_COMPLINE;
 		if (dbop_getoption(gtop->dbop, COMPNAMEKEY) != NULL)
 			gtop->format |= GTAGS_COMPNAME;
+		if (gtop->format_version >= 7 && dbop_getoption(gtop->dbop, FIDINDEXKEY) != NULL)
+			gtop->format |= GTAGS_FIDINDEX;
 	}
 	if (gpath_open(dbpath, dbmode) < 0) {
 		if (dbmode == 1)
@@ -454,6 +511,10 @@ gtags_open(const char *dbpath, const char *root, int db, int mode, int flags)
 	}
 	if (gtop->mode != GTAGS_READ)
 		gtop->sb = strbuf_open(0);	/* This buffer is used for working area. */
+	if (gtop->mode != GTAGS_READ && gtop->format & GTAGS_FIDINDEX)
+		gtop->key_hash = strhash_open(HASHBUCKETS);
+	open_bloom(gtop, dbpath);
+	unlockdirectory(lock);
 	/*
 	 * Stuff for compact format.
 	 */
@@ -526,6 +587,10 @@ gtags_put_using(GTOP *gtop, const char *tag, int lno, const char *fid, const cha
 	strbuf_putc(gtop->sb, ' ');
 	strbuf_puts(gtop->sb, (gtop->format & GTAGS_COMPRESS) ? compress(img, key) : img);
 	dbop_put_tag(gtop->dbop, key, strbuf_value(gtop->sb));
+	if (gtop->key_hash)
+		strhash_assign(gtop->key_hash, key, 1);
+	if (gtop->bloom)
+		bloom_add(gtop->bloom, key);
 }
 /**
  * gtags_flush: Flush the pool for compact format.
@@ -540,18 +605,89 @@ gtags_flush(GTOP *gtop, const char *fid)
 		flush_pool(gtop, fid);
 		strhash_reset(gtop->path_hash);
 	}
+	if (gtop->key_hash) {
+		flush_keys(gtop, fid);
+		strhash_reset(gtop->key_hash);
+	}
+}
+/**
+ * in_deleteset: whether or not a tag record belongs to a file to be deleted.
+ *
+ *	@param[in]	key	tag name (not used)
+ *	@param[in]	tagline	tag record
+ *	@param[in]	arg	deleteset
+ *	@return		1: delete, 0: keep
+ */
+static int
+in_deleteset(const char *key, const char *tagline, void *arg)
+{
+	return idset_contains((IDSET *)arg, atoi(tagline));
+}
+/**
+ * compare_keys: compare function for sorting keys.
+ */
+static int
+compare_keys(const void *s1, const void *s2)
+{
+	return strcmp(*(char **)s1, *(char **)s2);
 }
 /**
  * gtags_delete: delete records belong to set of fid.
  *
  *	@param[in]	gtop	GTOP structure
  *	@param[in]	deleteset bit array of fid
+ *
+ * If the tag file has the per-fid index, only the keys of the files
+ * are visited. Otherwise, the whole tag file is scanned.
  */
 void
 gtags_delete(GTOP *gtop, IDSET *deleteset)
 {
-	const char *tagline;
-	int fid;
+	if (gtop->format & GTAGS_FIDINDEX) {
+		STRHASH *keys = strhash_open(HASHBUCKETS);
+		struct sh_entry *entry;
+		char **keylist;
+		unsigned int id;
+		int i, n;
+
+		/*
+		 * Collect the keys of the files and remove their index records.
+		 */
+		for (id = idset_first(deleteset); id != END_OF_ID; id = idset_next(deleteset)) {
+			const char *indexkey = fidindexkey(id);
+			const char *p, *q;
+
+			for (p = dbop_first(gtop->dbop, indexkey, NULL, 0); p; p = dbop_next(gtop->dbop)) {
+				while (*p) {
+					while (*p == ' ')
+						p++;
+					for (q = p; *q && *q != ' '; q++)
+						;
+					if (q > p) {
+						strbuf_reset(gtop->sb);
+						strbuf_nputs(gtop->sb, p, q - p);
+						strhash_assign(keys, strbuf_value(gtop->sb), 1);
+					}
+					p = q;
+				}
+			}
+			dbop_delete(gtop->dbop, indexkey);
+		}
+		/*
+		 * Visit the keys in sorted order to access the B-tree sequentially.
+		 */
+		n = keys->entries;
+		keylist = (char **)check_malloc(sizeof(char *) * (n + 1));
+		i = 0;
+		for (entry = strhash_first(keys); entry; entry = strhash_next(keys))
+			keylist[i++] = entry->name;
+		qsort(keylist, n, sizeof(char *), compare_keys);
+		for (i = 0; i < n; i++)
+			dbop_delete_if(gtop->dbop, keylist[i], in_deleteset, deleteset);
+		free(keylist);
+		strhash_close(keys);
+		return;
+	}
 
 #ifdef USE_SQLITE3
 	if (gtop->dbop->openflags & DBOP_SQLITE3) {
@@ -559,9 +695,8 @@ gtags_delete(GTOP *gtop, IDSET *deleteset)
 		long id;
 		strbuf_puts(where, "(");
 		for (id = idset_first(deleteset); id != END_OF_ID; id = idset_next(deleteset)) {
-			strbuf_puts(where, "'");
 			strbuf_putn(where, id);
-			strbuf_puts(where, "',");
+			strbuf_putc(where, ',');
 		}
 		strbuf_unputc(where, ',');
 		strbuf_puts(where, ")");
@@ -569,17 +704,10 @@ gtags_delete(GTOP *gtop, IDSET *deleteset)
 		strbuf_close(where);
 	} else
 #endif
-	for (tagline = dbop_first(gtop->dbop, NULL, NULL, 0); tagline; tagline = dbop_next(gtop->dbop)) {
-		/*
-		 * Extract path from the tag line.
-		 */
-		fid = atoi(tagline);
-		/*
-		 * If the file id exists in the deleteset, delete the tagline.
-		 */
-		if (idset_contains(deleteset, fid))
-			dbop_delete(gtop->dbop, NULL);
-	}
+	/*
+	 * Delete the taglines whose file id exists in the deleteset.
+	 */
+	dbop_delete_if(gtop->dbop, NULL, in_deleteset, deleteset);
 }
 /**
  * get_prefix: get as long prefix of the pattern as possible.
@@ -767,21 +895,31 @@ gtags_first(GTOP *gtop, const char *pattern, int flags)
 		gtop->key = gtop->prefix;
 		gtop->dbflags |= DBOP_PREFIX;
 	}
+	/*
+	 * The Bloom filter tells that the name is not defined without
+	 * searching the B-tree.
+	 */
+	if (gtop->db == GTAGS && gtop->mode == GTAGS_READ && gtop->bloom
+	    && gtop->key && !(gtop->dbflags & DBOP_PREFIX)
+	    && !bloom_test(gtop->bloom, gtop->key))
+		return NULL;
 	if (strbuf_getlen(regex) > 0) {
 		if (gtop->preg == NULL)
 			die("gtags_first: impossible (3).");
 		if (regcomp(gtop->preg, strbuf_value(regex), regflags) != 0)
 			die("invalid regular expression.");
-	}
+		dbop_setregex(gtop->dbop, strbuf_value(regex), regflags);
+	} else
+		dbop_setregex(gtop->dbop, NULL, 0);
 	/*
 	 * If GTOP_PATH is set, at first, we collect all path names in a pool and
 	 * sort them. gtags_first() and gtags_next() returns one of the pool.
 	 */
 	if (gtop->flags & GTOP_PATH) {
 		struct sh_entry *entry;
-		char *p;
-		const char *cp;
+		const char *fid, *cp;
 		unsigned long i;
+		int j, n;
 
 		gtop->path_hash = strhash_open(HASHBUCKETS);
 		/*
@@ -794,23 +932,31 @@ gtags_first(GTOP *gtop, const char *pattern, int flags)
 		 *  ...
 		 */
 again0:
-		for (tagline = dbop_first(gtop->dbop, gtop->key, gtop->preg, gtop->dbflags);
-		     tagline != NULL;
-		     tagline = dbop_next(gtop->dbop))
-		{
-			VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop);
-			/* extract file id */
-			p = locatestring(tagline, " ", MATCH_FIRST);
-			if (p == NULL)
-				die("Invalid tag record. '%s'\n", tagline);
-			*p = '\0';
-			entry = strhash_assign(gtop->path_hash, tagline, 1);
-			/* new entry: get path name and set. */
-			if (entry->value == NULL) {
-				cp = gpath_fid2path(tagline, NULL);
-				if (cp == NULL)
-					die("GPATH is corrupted.(file id '%s' not found)", tagline);
-				entry->value = strhash_strdup(gtop->path_hash, cp, 0);
+		if (dbop_first(gtop->dbop, gtop->key, gtop->preg, gtop->dbflags) != NULL) {
+			/*
+			 * Dbop_next_batch() will read the same record again.
+			 */
+			dbop_unread(gtop->dbop);
+			while ((n = dbop_next_batch(gtop->dbop, gtop->records, DBOP_BATCHSIZE)) > 0) {
+				for (j = 0; j < n; j++) {
+					tagline = gtop->records[j].dat;
+					VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop, gtop->records[j].key);
+					/*
+					 * extract file id. The record may be in a read
+					 * only mapping of the file, so it is not modified.
+					 */
+					if (locatestring(tagline, " ", MATCH_FIRST) == NULL)
+						die("Invalid tag record. '%s'\n", tagline);
+					fid = strmake(tagline, " ");
+					entry = strhash_assign(gtop->path_hash, fid, 1);
+					/* new entry: get path name and set. */
+					if (entry->value == NULL) {
+						cp = gpath_fid2path(fid, NULL);
+						if (cp == NULL)
+							die("GPATH is corrupted.(file id '%s' not found)", fid);
+						entry->value = strhash_strdup(gtop->path_hash, cp, 0);
+					}
+				}
 			}
 		}
 		if (gtop->prefix && gtags_restart(gtop))
@@ -846,7 +992,7 @@ again1:
 		     gtop->gtp.tag != NULL;
 		     gtop->gtp.tag = dbop_next(gtop->dbop))
 		{
-			VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop);
+			VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop, gtop->dbop->lastkey);
 			break;
 		}
 		if (gtop->gtp.tag == NULL) {
@@ -906,7 +1052,7 @@ gtags_next(GTOP *gtop)
 again3:
 		for (; gtop->gtp.tag != NULL; gtop->gtp.tag = dbop_next(gtop->dbop))
 		{
-			VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop);
+			VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop, gtop->dbop->lastkey);
 			break;
 		}
 		if (gtop->gtp.tag == NULL) {
@@ -943,8 +1089,12 @@ again3:
 void
 gtags_show_statistics(GTOP *gtop)
 {
+	unsigned long hit, miss;
+
 	fprintf(stderr, "Numbers of gtags (%s): %d\n", dbname(gtop->db), gtop->readcount);
 	fprintf(stderr, "Numbers of dbop  (%s): %d\n", dbname(gtop->db), gtop->dbop->readcount);
+	if (dbop_cachestat(gtop->dbop, &hit, &miss) == 0)
+		fprintf(stderr, "Page cache (%s): %lu hits, %lu misses\n", dbname(gtop->db), hit, miss);
 }
 /**
  * gtags_close: close tag file
@@ -966,12 +1116,145 @@ gtags_close(GTOP *gtop)
 		varray_close(gtop->vb);
 	if (gtop->path_hash)
 		strhash_close(gtop->path_hash);
+	if (gtop->key_hash)
+		strhash_close(gtop->key_hash);
+	if (gtop->bloom) {
+		if (gtop->mode != GTAGS_READ)
+			write_bloom(gtop);
+		bloom_close(gtop->bloom);
+	}
 	gpath_close();
 	dbop_close(gtop->dbop);
 	if (gtop->gtags)
 		dbop_close(gtop->gtags);
 	free(gtop);
 }
+/**
+ * open_bloom: set up the Bloom filter of GTAGS keys.
+ *
+ *	@param[in]	gtop	GTOP structure
+ *	@param[in]	dbpath	dbpath directory
+ *
+ * GTAGS records the stamp of its filter file (GTAGS.bloom) in the
+ * " __.BLOOM" meta record. A filter whose stamp is different is out of
+ * date and is not used. Since older gtags(1) would add keys without
+ * updating the filter, it is used only in format version 7 or later.
+ * When updating, the stamp is removed first, so the old filter is
+ * ignored until the new one is written by gtags_close().
+ */
+static void
+open_bloom(GTOP *gtop, const char *dbpath)
+{
+	const char *p;
+	unsigned long long stamp;
+
+	if (gtop->mode == GTAGS_READ) {
+		gtop->bloom = gtags_open_bloom(dbpath, gtop->db == GTAGS ? gtop->dbop : gtop->gtags);
+		return;
+	}
+	if (gtop->db != GTAGS)
+		return;
+	strlimcpy(gtop->bloom_path, makepath(dbpath, dbname(GTAGS), "bloom"), sizeof(gtop->bloom_path));
+	if (gtop->mode == GTAGS_CREATE)
+		gtop->bloom = bloom_create();
+	else if (gtop->format_version >= 7
+		&& (p = dbop_getoption(gtop->dbop, BLOOMKEY)) != NULL
+		&& sscanf(p, "%llx", &stamp) == 1)
+		gtop->bloom = bloom_load(gtop->bloom_path, stamp);
+	if (gtop->bloom == NULL) {
+		/* The filter will be made next time GTAGS is created. */
+		(void)unlink(gtop->bloom_path);
+		return;
+	}
+	if (gtop->mode == GTAGS_MODIFY && dbop_first(gtop->dbop, BLOOMKEY, NULL, 0))
+		dbop_delete(gtop->dbop, NULL);
+}
+/**
+ * write_bloom: write the Bloom filter and record its stamp in GTAGS.
+ *
+ *	@param[in]	gtop	GTOP structure
+ *
+ * The filter is written before the tag file, which records its stamp.
+ * If we die in between, the stamps differ.
+ * A filter which has more keys than its size allows is made again.
+ * The keys put by this update are not in GTAGS yet with sorted writing,
+ * so they are kept by bloom_reset().
+ */
+static void
+write_bloom(GTOP *gtop)
+{
+	const char *key;
+	char buf[32];
+
+	if (bloom_isfull(gtop->bloom)) {
+		bloom_reset(gtop->bloom);
+		for (key = dbop_first(gtop->dbop, NULL, NULL, DBOP_KEY); key; key = dbop_next(gtop->dbop))
+			bloom_add(gtop->bloom, key);
+	}
+	if (bloom_write(gtop->bloom, gtop->bloom_path) < 0) {
+		warning("cannot write %s.", gtop->bloom_path);
+		(void)unlink(gtop->bloom_path);
+		return;
+	}
+	snprintf(buf, sizeof(buf), "%016llx", gtop->bloom->stamp);
+	dbop_putoption(gtop->dbop, BLOOMKEY, buf);
+}
+/**
+ * gtags_open_bloom: open the Bloom filter of GTAGS keys for reading.
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	gtags	descripter of GTAGS
+ *	@return		filter or NULL (not available)
+ */
+BLOOM *
+gtags_open_bloom(const char *dbpath, DBOP *gtags)
+{
+	const char *p;
+	unsigned long long stamp;
+
+	if (dbop_getversion(gtags) < 7)
+		return NULL;
+	if ((p = dbop_getoption(gtags, BLOOMKEY)) == NULL || sscanf(p, "%llx", &stamp) != 1)
+		return NULL;
+	return bloom_open(makepath(dbpath, dbname(GTAGS), "bloom"), stamp);
+}
+/**
+ * fidindexkey: make the key of the index record of a file.
+ *
+ *	@param[in]	fid	file id
+ *	@return		key (valid until the next call)
+ */
+static const char *
+fidindexkey(int fid)
+{
+	static char key[sizeof(FIDINDEXKEY) + MAXFIDLEN];
+
+	snprintf(key, sizeof(key), "%s.%d", FIDINDEXKEY, fid);
+	return key;
+}
+/**
+ * flush_keys: write the index record of a file.
+ *
+ *	@param[in]	gtop	descripter of GTOP
+ *	@param[in]	s_fid	file id
+ *
+ * The record lists the keys which the file has put.
+ * Its data begins with a blank, so it is skipped as a meta record.
+ */
+static void
+flush_keys(GTOP *gtop, const char *s_fid)
+{
+	struct sh_entry *entry;
+
+	if (gtop->key_hash->entries == 0)
+		return;
+	strbuf_reset(gtop->sb);
+	for (entry = strhash_first(gtop->key_hash); entry; entry = strhash_next(gtop->key_hash)) {
+		strbuf_putc(gtop->sb, ' ');
+		strbuf_puts(gtop->sb, entry->name);
+	}
+	dbop_put(gtop->dbop, fidindexkey(atoi(s_fid)), strbuf_value(gtop->sb));
+}
 /**
  * flush_pool: flush and write the pool as compact format.
  *
@@ -1098,6 +1381,10 @@ flush_pool(GTOP *gtop, const char *s_fid)
 		if (strbuf_getlen(gtop->sb) > header_offset) {
 			dbop_put_tag(gtop->dbop, key, strbuf_value(gtop->sb));
 		}
+		if (gtop->key_hash)
+			strhash_assign(gtop->key_hash, key, 1);
+		if (gtop->bloom)
+			bloom_add(gtop->bloom, key);
 		/* Free line number table */
 		varray_close(vb);
 	}
@@ -1126,46 +1413,53 @@ void
 segment_read(GTOP *gtop)
 {
 	const char *tagline, *fid, *path, *lineno;
+	const DBOP_RECORD *rec;
 	GTP *gtp;
 	struct sh_entry *sh;
+	int i, n;
 
 	/*
 	 * Save tag lines.
 	 */
 	gtop->cur_tagname[0] = '\0';
-	while ((tagline = dbop_next(gtop->dbop)) != NULL) {
-		VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop);
-		/*
-		 * get tag name and line number.
-		 *
-		 * tagline = <file id> <tag name> <line number>
-		 */
-		if (gtop->cur_tagname[0] == '\0') {
-			strlimcpy(gtop->cur_tagname, gtop->dbop->lastkey, sizeof(gtop->cur_tagname));
-		} else if (strcmp(gtop->cur_tagname, gtop->dbop->lastkey) != 0) {
+	while ((n = dbop_next_batch(gtop->dbop, gtop->records, DBOP_BATCHSIZE)) > 0) {
+		for (i = 0; i < n; i++) {
+			rec = &gtop->records[i];
+			tagline = rec->dat;
+			VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop, rec->key);
 			/*
-			 * Dbop_next() wil read the same record again.
+			 * get tag name and line number.
+			 *
+			 * tagline = <file id> <tag name> <line number>
 			 */
-			dbop_unread(gtop->dbop);
-			break;
+			if (gtop->cur_tagname[0] == '\0') {
+				strlimcpy(gtop->cur_tagname, rec->key, sizeof(gtop->cur_tagname));
+			} else if (strcmp(gtop->cur_tagname, rec->key) != 0) {
+				/*
+				 * Dbop_next_batch() will read the rest again.
+				 */
+				dbop_unread_batch(gtop->dbop, rec, n - i);
+				goto end;
+			}
+			gtp = varray_append(gtop->vb);
+			gtp->tagline = pool_strdup(gtop->segment_pool, tagline, 0);
+			gtp->tag = (const char *)gtop->cur_tagname;
+			/*
+			 * convert fid into hashed path name to save memory.
+			 */
+			fid = (const char *)strmake(tagline, " ");
+			path = gpath_fid2path(fid, NULL);
+			if (path == NULL)
+				die("gtags_first: path not found. (fid=%s)", fid);
+			sh = strhash_assign(gtop->path_hash, path, 1);
+			gtp->path = sh->name;
+			lineno = seekto(gtp->tagline, SEEKTO_LINENO);
+			if (lineno == NULL)
+				die("invalid tag record.\n%s", tagline);
+			gtp->lineno = atoi(lineno);
 		}
-		gtp = varray_append(gtop->vb);
-		gtp->tagline = pool_strdup(gtop->segment_pool, tagline, 0);
-		gtp->tag = (const char *)gtop->cur_tagname;
-		/*
-		 * convert fid into hashed path name to save memory.
-		 */
-		fid = (const char *)strmake(tagline, " ");
-		path = gpath_fid2path(fid, NULL);
-		if (path == NULL)
-			die("gtags_first: path not found. (fid=%s)", fid);
-		sh = strhash_assign(gtop->path_hash, path, 1);
-		gtp->path = sh->name;
-		lineno = seekto(gtp->tagline, SEEKTO_LINENO);
-		if (lineno == NULL)
-			die("invalid tag record.\n%s", tagline);
-		gtp->lineno = atoi(lineno);
 	}
+end:
 	/*
 	 * Sort tag lines.
 	 */
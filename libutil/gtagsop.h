@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 
+#include "bloom.h"
 #include "gparam.h"
 #include "dbop.h"
 #include "idset.h"
@@ -35,6 +36,8 @@
 #define COMPRESSKEY	" __.COMPRESS"
 #define COMPLINEKEY	" __.COMPLINE"
 #define COMPNAMEKEY	" __.COMPNAME"
+#define FIDINDEXKEY	" __.FIDINDEX"
+#define BLOOMKEY	" __.BLOOM"
 
 #define NOTAGS		-1
 #define GPATH		0
@@ -60,9 +63,15 @@
 #define GTAGS_COMPNAME		8
 			/** extract method from class definition */
 #define GTAGS_EXTRACTMETHOD	16
+			/** per-fid index of keys */
+#define GTAGS_FIDINDEX		64
+			/** prefix compressed leaf pages */
+#define GTAGS_PFXLEAF		128
 			/** use sqlite3 database */
 #ifdef USE_SQLITE3
 #define GTAGS_SQLITE3	32
+			/** sqlite3 database in WAL mode */
+#define GTAGS_WAL		256
 #endif
 			/** print information for debug */
 #define GTAGS_DEBUG		65536
@@ -125,6 +134,7 @@ typedef struct {
 	POOL *segment_pool;
 	VARRAY *vb;
 	char cur_tagname[IDENTLEN];	/**< current tag name */
+	DBOP_RECORD records[DBOP_BATCHSIZE]; /**< records read at once */
 
 	/*
 	 * Stuff for compact format
@@ -134,6 +144,15 @@ typedef struct {
 	/** used for compact format and path name only read */
 	STRHASH *path_hash;
 
+	/** keys of the current file; used for per-fid index */
+	STRHASH *key_hash;
+
+	/*
+	 * Stuff for Bloom filter of GTAGS keys
+	 */
+	BLOOM *bloom;			/**< filter or NULL */
+	char bloom_path[MAXPATHLEN];	/**< path of the filter file */
+
 	/*
 	 * Stuff for calling dbop
 	 */
@@ -146,6 +165,7 @@ typedef struct {
 
 const char *dbname(int);
 GTOP *gtags_open(const char *, const char *, int, int, int);
+BLOOM *gtags_open_bloom(const char *, DBOP *);
 void gtags_put_using(GTOP *, const char *, int, const char *, const char *);
 void gtags_flush(GTOP *, const char *);
 void gtags_delete(GTOP *, IDSET *);
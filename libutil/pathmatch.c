@@ -0,0 +1,472 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <ctype.h>
+#include <stdio.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include "char.h"
+#include "checkalloc.h"
+#include "die.h"
+#include "pathmatch.h"
+
+/*
+
+Path matcher
+
+A path matcher decides whether or not a path name matches a list of
+patterns of the skip list in gtags.conf(5). It used to be done by a big
+regular expression which consists of all the patterns, but most patterns
+are simple names, so they are looked up in hash tables instead.
+
+	pattern		regular expression	lookup
+	-----------------------------------------------------------------
+	/dir/		^\./dir/		prefix of the path
+	/dir/file	^\./dir/file$		the whole path
+	dir/		/dir/			each directory name
+	file		/file$			the last component
+	*.suffix	/[^/]*\.suffix$		suffixes of the last component
+	(others)	(as is)			regular expression
+
+The result is the same as that of the regular expression.
+The path name must start with "./".
+
+	PATHMATCH *pm = pathmatch_open(0);
+	pathmatch_add(pm, "CVS/");
+	pathmatch_add(pm, "*.o");
+	pathmatch_compile(pm);
+	if (pathmatch_match(pm, "./src/main.o", NULL, NULL))
+		=> matched
+	pathmatch_close(pm);
+*/
+#define HASHBUCKETS	256
+
+/**
+ * isliteral: whether or not the pattern includes no wild card.
+ */
+static int
+isliteral(const char *s)
+{
+	for (; *s; s++)
+		if (*s == '*' || *s == '?' || *s == '[' || *s == '\\')
+			return 0;
+	return 1;
+}
+/**
+ * glob2regex: convert a pattern into regular expression.
+ *
+ *	@param[out]	reg	regular expression
+ *	@param[in]	skipf	pattern
+ */
+static void
+glob2regex(STRBUF *reg, const char *skipf)
+{
+	const char *q;
+
+	if (strbuf_getlen(reg) > 0)
+		strbuf_putc(reg, '|');
+	/* '/' means project root directory */
+	if (*skipf == '/') {
+		strbuf_puts(reg, "^\\./");
+		skipf++;
+	} else {
+		strbuf_putc(reg, '/');
+	}
+	for (q = skipf; *q; q++) {
+		/*
+		 * replaces wild cards into regular expressions.
+		 *
+		 * '*' -> '[^/]*'
+		 * '?' -> '[^/]'
+		 * '[...]' -> '[...]'
+		 * '[!...]' -> '[^...]'
+		 */
+		if (*q == '[') {
+			const char *c = q;
+			STATIC_STRBUF(class);
+			int isclass = 1;
+
+			strbuf_clear(class);
+			strbuf_putc(class, *c++);		/* '[' */
+			if (*c == '\0')
+				isclass = 0;
+			else if (*c == ']')
+				strbuf_putc(class, *c++);
+			else if (*c == '!') {
+				strbuf_putc(class, '^');
+				c++;
+			} else
+				strbuf_putc(class, *c++);
+			if (isclass) {
+				while (*c && *c != ']')
+					strbuf_putc(class, *c++);
+				if (*c == ']')
+					strbuf_putc(class, *c);	/* ']' */
+				else
+					isclass = 0;
+			}
+			if (isclass) {
+				strbuf_puts(reg, strbuf_value(class));
+				q = c;
+			} else {
+				/* 'class' is thrown away */
+				strbuf_putc(reg, '\\');
+				strbuf_putc(reg, *q);
+			}
+		} else if (*q == '*')
+			strbuf_puts(reg, "[^/]*");
+		else if (*q == '?')
+			strbuf_puts(reg, "[^/]");
+		else if (*q == '\\' && *(q + 1) == ',')
+			strbuf_putc(reg, *++q);
+		else if (isregexchar(*q)) {
+			strbuf_putc(reg, '\\');
+			strbuf_putc(reg, *q);
+		} else {
+			if (*q == '\\' && *(q + 1) != '\0') {
+				strbuf_putc(reg, *q++);
+				strbuf_putc(reg, *q);
+			} else
+				strbuf_putc(reg, *q);
+		}
+	}
+	if (*(q - 1) != '/')
+		strbuf_putc(reg, '$');
+}
+/**
+ * suffix2regex: convert a suffix into regular expression.
+ *
+ *	@param[out]	reg	regular expression
+ *	@param[in]	suffix	suffix without '.'
+ */
+static void
+suffix2regex(STRBUF *reg, const char *suffix)
+{
+	const char *p;
+
+	if (strbuf_getlen(reg) > 0)
+		strbuf_putc(reg, '|');
+	strbuf_puts(reg, "\\.");
+	for (p = suffix; *p; p++) {
+		if (!isalnum((unsigned char)*p))
+			strbuf_putc(reg, '\\');
+		strbuf_putc(reg, *p);
+	}
+	strbuf_putc(reg, '$');
+}
+/**
+ * addkey: add a key to a hash table.
+ *
+ *	@param[in]	pm	PATHMATCH structure
+ *	@param[in]	sh	hash table
+ *	@param[in]	key	key
+ *	@param[in]	len	length of the key
+ */
+static void
+addkey(PATHMATCH *pm, STRHASH *sh, const char *key, int len)
+{
+	STATIC_STRBUF(sb);
+	char *p;
+
+	strbuf_clear(sb);
+	strbuf_nputs(sb, key, len);
+	if (pm->flags & PATHMATCH_ICASE)
+		for (p = strbuf_value(sb); *p; p++)
+			*p = tolower((unsigned char)*p);
+	strhash_assign(sh, strbuf_value(sb), 1);
+}
+/**
+ * lookup: look up a part of a path in a hash table.
+ *
+ *	@param[in]	sh	hash table
+ *	@param[in]	start	start of the part
+ *	@param[in]	end	end of the part
+ *	@return		1: found, 0: not found
+ */
+static int
+lookup(STRHASH *sh, char *start, char *end)
+{
+	int c = *end, found;
+
+	if (sh->entries == 0)
+		return 0;
+	*end = '\0';
+	found = strhash_assign(sh, start, 0) != NULL;
+	*end = c;
+	return found;
+}
+/**
+ * pathmatch_open: open a path matcher.
+ *
+ *	@param[in]	flags	PATHMATCH_ICASE: ignore case distinctions
+ *	@return		PATHMATCH structure
+ */
+PATHMATCH *
+pathmatch_open(int flags)
+{
+	PATHMATCH *pm = (PATHMATCH *)check_calloc(sizeof(PATHMATCH), 1);
+
+	pm->flags = flags;
+	pm->exact = strhash_open(HASHBUCKETS);
+	pm->prefix = strhash_open(HASHBUCKETS);
+	pm->dirs = strhash_open(HASHBUCKETS);
+	pm->names = strhash_open(HASHBUCKETS);
+	pm->suffixes = strhash_open(HASHBUCKETS);
+	pm->reg = strbuf_open(0);
+	pm->all = strbuf_open(0);
+	pm->path = strbuf_open(0);
+	return pm;
+}
+/**
+ * pathmatch_add: add a pattern of the skip list.
+ *
+ *	@param[in]	pm	PATHMATCH structure
+ *	@param[in]	pattern	pattern
+ */
+void
+pathmatch_add(PATHMATCH *pm, const char *pattern)
+{
+	const char *p = pattern;
+	const char *slash;
+	int len;
+
+	glob2regex(pm->all, pattern);
+	if (*p == '/') {
+		p++;
+		if (isliteral(p)) {
+			len = strlen(p);
+			strbuf_reset(pm->path);
+			strbuf_puts(pm->path, "./");
+			strbuf_puts(pm->path, p);
+			if (len == 0 || p[len - 1] == '/')
+				addkey(pm, pm->prefix, strbuf_value(pm->path), len + 2);
+			else
+				addkey(pm, pm->exact, strbuf_value(pm->path), len + 2);
+			return;
+		}
+	} else if (isliteral(p)) {
+		len = strlen(p);
+		slash = strchr(p, '/');
+		if (slash == NULL) {
+			addkey(pm, pm->names, p, len);
+			return;
+		}
+		if (slash == p + len - 1 && len > 1) {
+			addkey(pm, pm->dirs, p, len - 1);
+			return;
+		}
+	} else if (*p == '*' && *(p + 1) == '.' && isliteral(p + 1) && !strchr(p, '/')) {
+		addkey(pm, pm->suffixes, p + 1, strlen(p + 1));
+		return;
+	}
+	glob2regex(pm->reg, pattern);
+}
+/**
+ * pathmatch_add_suffix: add a suffix of source files.
+ *
+ *	@param[in]	pm	PATHMATCH structure
+ *	@param[in]	suffix	suffix without '.'
+ *
+ * It is equivalent to the regular expression '\.suffix$'.
+ */
+void
+pathmatch_add_suffix(PATHMATCH *pm, const char *suffix)
+{
+	suffix2regex(pm->all, suffix);
+	if (strchr(suffix, '/')) {
+		suffix2regex(pm->reg, suffix);
+		return;
+	}
+	strbuf_reset(pm->path);
+	strbuf_putc(pm->path, '.');
+	strbuf_puts(pm->path, suffix);
+	addkey(pm, pm->suffixes, strbuf_value(pm->path), strbuf_getlen(pm->path));
+}
+/**
+ * pathmatch_add_dotfiles: match files and directories which start with '.'.
+ *
+ *	@param[in]	pm	PATHMATCH structure
+ */
+void
+pathmatch_add_dotfiles(PATHMATCH *pm)
+{
+	if (strbuf_getlen(pm->all) > 0)
+		strbuf_putc(pm->all, '|');
+	strbuf_puts(pm->all, "/\\.[^/]+$|");
+	strbuf_puts(pm->all, "/\\.[^/]+/");
+	pm->dotfiles = 1;
+}
+/**
+ * pathmatch_compile: compile the patterns which cannot be looked up.
+ *
+ *	@param[in]	pm	PATHMATCH structure
+ */
+void
+pathmatch_compile(PATHMATCH *pm)
+{
+	STRBUF *sb;
+	int flags = REG_EXTENDED|REG_NEWLINE;
+
+	if (pm->preg) {
+		regfree(pm->preg);
+		pm->preg = NULL;
+	}
+	if (strbuf_getlen(pm->reg) == 0)
+		return;
+	if (pm->flags & PATHMATCH_ICASE)
+		flags |= REG_ICASE;
+	sb = strbuf_open(0);
+	strbuf_putc(sb, '(');
+	strbuf_puts(sb, strbuf_value(pm->reg));
+	strbuf_putc(sb, ')');
+	if (regcomp(&pm->reg_area, strbuf_value(sb), flags) != 0)
+		die("cannot compile regular expression.");
+	pm->preg = &pm->reg_area;
+	strbuf_close(sb);
+}
+/**
+ * pathmatch_match: whether or not a path matches the patterns.
+ *
+ *	@param[in]	pm	PATHMATCH structure
+ *	@param[in]	path	path name (must start with "./")
+ *	@param[out]	so	start offset of the matched part or NULL
+ *	@param[out]	eo	end offset of the matched part or NULL
+ *	@return		1: matched, 0: not matched
+ */
+int
+pathmatch_match(PATHMATCH *pm, const char *path, int *so, int *eo)
+{
+	char *buf, *p, *q, *last = NULL;
+	int start = 0, end = 0;
+	regmatch_t m;
+
+	strbuf_reset(pm->path);
+	strbuf_puts(pm->path, path);
+	buf = strbuf_value(pm->path);
+	if (pm->flags & PATHMATCH_ICASE)
+		for (p = buf; *p; p++)
+			*p = tolower((unsigned char)*p);
+	p = buf + strbuf_getlen(pm->path);
+	if (lookup(pm->exact, buf, p)) {
+		end = p - buf;
+		goto matched;
+	}
+	/*
+	 * Check each component after '/'.
+	 */
+	for (p = buf; (p = strchr(p, '/')) != NULL; p = q) {
+		if (lookup(pm->prefix, buf, p + 1)) {
+			end = p + 1 - buf;
+			goto matched;
+		}
+		last = p + 1;
+		for (q = last; *q && *q != '/'; q++)
+			;
+		if (pm->dotfiles && *last == '.' && q > last + 1) {
+			start = p - buf;
+			end = (*q == '/') ? q + 1 - buf : q - buf;
+			goto matched;
+		}
+		if (*q == '/' && lookup(pm->dirs, last, q)) {
+			start = p - buf;
+			end = q + 1 - buf;
+			goto matched;
+		}
+	}
+	/*
+	 * Check the last component.
+	 */
+	if (last && *last) {
+		q = last + strlen(last);
+		if (lookup(pm->names, last, q)) {
+			start = last - 1 - buf;
+			end = q - buf;
+			goto matched;
+		}
+		if (pm->suffixes->entries) {
+			for (p = last; (p = strchr(p, '.')) != NULL; p++) {
+				if (lookup(pm->suffixes, p, q)) {
+					start = p - buf;
+					end = q - buf;
+					goto matched;
+				}
+			}
+		}
+	}
+	if (pm->preg && regexec(pm->preg, path, 1, &m, 0) == 0) {
+		start = m.rm_so;
+		end = m.rm_eo;
+		goto matched;
+	}
+	return 0;
+matched:
+	if (so)
+		*so = start;
+	if (eo)
+		*eo = end;
+	return 1;
+}
+/**
+ * pathmatch_regex: regular expression equivalent to the matcher.
+ *
+ *	@param[in]	pm	PATHMATCH structure
+ *	@return		regular expression
+ */
+const char *
+pathmatch_regex(PATHMATCH *pm)
+{
+	STATIC_STRBUF(sb);
+
+	strbuf_clear(sb);
+	strbuf_putc(sb, '(');
+	strbuf_puts(sb, strbuf_value(pm->all));
+	strbuf_putc(sb, ')');
+	return strbuf_value(sb);
+}
+/**
+ * pathmatch_close: close a path matcher.
+ *
+ *	@param[in]	pm	PATHMATCH structure
+ */
+void
+pathmatch_close(PATHMATCH *pm)
+{
+	if (pm->preg)
+		regfree(pm->preg);
+	strhash_close(pm->exact);
+	strhash_close(pm->prefix);
+	strhash_close(pm->dirs);
+	strhash_close(pm->names);
+	strhash_close(pm->suffixes);
+	strbuf_close(pm->reg);
+	strbuf_close(pm->all);
+	strbuf_close(pm->path);
+	free(pm);
+}
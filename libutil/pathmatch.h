@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2016
+ *	Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _PATHMATCH_H
+#define _PATHMATCH_H
+
+#include "regex.h"
+#include "strbuf.h"
+#include "strhash.h"
+
+/** compiled matcher for a list of path patterns */
+typedef struct {
+	int flags;			/**< PATHMATCH_XXX */
+	int dotfiles;			/**< match dot files and dot directories */
+	STRHASH *exact;			/**< '/path': whole path names */
+	STRHASH *prefix;		/**< '/dir/': leading directories */
+	STRHASH *dirs;			/**< 'dir/': directory names */
+	STRHASH *names;			/**< 'name': last components */
+	STRHASH *suffixes;		/**< '*.suffix': suffixes */
+	STRBUF *reg;			/**< regular expression for the rest */
+	STRBUF *all;			/**< regular expression for all */
+	regex_t *preg;			/**< compiled reg or NULL */
+	regex_t reg_area;
+	STRBUF *path;			/**< working area */
+} PATHMATCH;
+
+			/** ignore case distinctions */
+#define PATHMATCH_ICASE		1
+
+PATHMATCH *pathmatch_open(int);
+void pathmatch_add(PATHMATCH *, const char *);
+void pathmatch_add_suffix(PATHMATCH *, const char *);
+void pathmatch_add_dotfiles(PATHMATCH *);
+void pathmatch_compile(PATHMATCH *);
+int pathmatch_match(PATHMATCH *, const char *, int *, int *);
+const char *pathmatch_regex(PATHMATCH *);
+void pathmatch_close(PATHMATCH *);
+
+#endif /* ! _PATHMATCH_H */
@@ -115,10 +115,21 @@ struct statistics_time {
 	char name[1];
 };
 
+struct statistics_io {
+	STAILQ_ENTRY(statistics_io) next;
+
+	STATISTICS_IO io;
+
+	int name_len;
+	char name[1];
+};
+
 static STRBUF *sb;
 static STATISTICS_TIME *T_all;
 static STAILQ_HEAD(statistics_time_list, statistics_time)
 	statistics_time_list = STAILQ_HEAD_INITIALIZER(statistics_time_list);
+static STAILQ_HEAD(statistics_io_list, statistics_io)
+	statistics_io_list = STAILQ_HEAD_INITIALIZER(statistics_io_list);
 
 void
 init_statistics(void)
@@ -186,6 +197,57 @@ statistics_time_end(STATISTICS_TIME *t)
 	STAILQ_INSERT_TAIL(&statistics_time_list, t, next);
 }
 
+/**
+ * statistics_io: add up the counters of the page cache of a database
+ *
+ *	@param[in]	name	name of the database
+ *	@param[in]	io	counters
+ *
+ * It does nothing unless init_statistics() has been called.
+ */
+void
+statistics_io(const char *name, const STATISTICS_IO *io)
+{
+	struct statistics_io *s;
+
+	if (sb == NULL)
+		return;
+	STAILQ_FOREACH(s, &statistics_io_list, next)
+		if (!strcmp(s->name, name))
+			break;
+	if (s == NULL) {
+		s = check_calloc(offsetof(struct statistics_io, name) + strlen(name) + 1, 1);
+		s->name_len = strlen(name);
+		strcpy(s->name, name);
+		STAILQ_INSERT_TAIL(&statistics_io_list, s, next);
+	}
+	s->io.pageread += io->pageread;
+	s->io.pagewrite += io->pagewrite;
+	s->io.cachehit += io->cachehit;
+	s->io.cachemiss += io->cachemiss;
+	s->io.mapped += io->mapped;
+	s->io.split += io->split;
+	s->io.ovflpage += io->ovflpage;
+}
+
+/**
+ * statistics_style: style of the argument of the --statistics option
+ *
+ *	@param[in]	arg	"table", "list", "json" or NULL (table)
+ *	@return		STATISTICS_STYLE_XXX or -1 (unknown)
+ */
+int
+statistics_style(const char *arg)
+{
+	if (arg == NULL || !strcmp(arg, "table"))
+		return STATISTICS_STYLE_TABLE;
+	if (!strcmp(arg, "list"))
+		return STATISTICS_STYLE_LIST;
+	if (!strcmp(arg, "json"))
+		return STATISTICS_STYLE_JSON;
+	return -1;
+}
+
 struct printing_width {
 	int name;
 	int elapsed;
@@ -405,6 +467,242 @@ print_time_table(const STATISTICS_TIME *t, void *priv)
 #endif
 }
 
+/**
+ * hit_ratio: ratio of the pages found in the cache
+ *
+ * @return ratio or a negative value (no access)
+ */
+static double
+hit_ratio(const STATISTICS_IO *io)
+{
+	if (io->cachehit + io->cachemiss == 0)
+		return -1;
+	return (double)io->cachehit / (io->cachehit + io->cachemiss);
+}
+
+static void
+print_io_list(void *priv)
+{
+	const struct statistics_io *s;
+	double ratio;
+
+	(void)priv;
+	STAILQ_FOREACH(s, &statistics_io_list, next) {
+		ratio = hit_ratio(&s->io);
+		message("- Pages of %s:"
+			" read %lu written %lu cache hit %lu miss %lu (%.1f%%)"
+			" mapped %lu split %lu overflow %lu",
+			s->name, s->io.pageread, s->io.pagewrite,
+			s->io.cachehit, s->io.cachemiss, ratio < 0 ? 0.0 : ratio * 100,
+			s->io.mapped, s->io.split, s->io.ovflpage);
+	}
+}
+
+static const char *io_heading_string[] = {
+	"database", "page reads", "page writes", "cache hits",
+	"cache misses", "hit[%]", "mapped pages", "splits", "overflow pages"
+};
+#define IO_COLUMNS	(sizeof(io_heading_string) / sizeof(io_heading_string[0]))
+
+static void
+print_io_table(void *priv)
+{
+	const struct statistics_io *s;
+	int width[IO_COLUMNS];
+	unsigned long value[IO_COLUMNS];
+	char ratio[16];
+	char *bar;
+	int i, w, bar_len;
+
+	(void)priv;
+	if (STAILQ_EMPTY(&statistics_io_list))
+		return;
+	bar_len = 0;
+	for (i = 0; i < IO_COLUMNS; i++) {
+		width[i] = strlen(io_heading_string[i]);
+		if (width[i] > bar_len)
+			bar_len = width[i];
+	}
+	STAILQ_FOREACH(s, &statistics_io_list, next) {
+		if (s->name_len > width[0])
+			width[0] = s->name_len;
+		value[1] = s->io.pageread;
+		value[2] = s->io.pagewrite;
+		value[3] = s->io.cachehit;
+		value[4] = s->io.cachemiss;
+		value[6] = s->io.mapped;
+		value[7] = s->io.split;
+		value[8] = s->io.ovflpage;
+		for (i = 1; i < IO_COLUMNS; i++) {
+			w = (i == 5) ? 5 : decimal_width(value[i]);
+			if (w > width[i])
+				width[i] = w;
+		}
+	}
+	for (i = 0; i < IO_COLUMNS; i++)
+		if (width[i] > bar_len)
+			bar_len = width[i];
+	bar = check_malloc(bar_len + 1);
+	memset(bar, '-', bar_len);
+	bar[bar_len] = '\0';
+
+	setverbose();
+	message("%s", "");
+	message("%-*s %*s %*s %*s %*s %*s %*s %*s %*s",
+		width[0], io_heading_string[0],
+		width[1], io_heading_string[1],
+		width[2], io_heading_string[2],
+		width[3], io_heading_string[3],
+		width[4], io_heading_string[4],
+		width[5], io_heading_string[5],
+		width[6], io_heading_string[6],
+		width[7], io_heading_string[7],
+		width[8], io_heading_string[8]);
+	message("%.*s %.*s %.*s %.*s %.*s %.*s %.*s %.*s %.*s",
+		width[0], bar, width[1], bar, width[2], bar, width[3], bar,
+		width[4], bar, width[5], bar, width[6], bar, width[7], bar,
+		width[8], bar);
+	STAILQ_FOREACH(s, &statistics_io_list, next) {
+		double r = hit_ratio(&s->io);
+
+		if (r < 0)
+			strcpy(ratio, "-");
+		else
+			snprintf(ratio, sizeof(ratio), "%.1f", r * 100);
+		message("%-*s %*lu %*lu %*lu %*lu %*s %*lu %*lu %*lu",
+			width[0], s->name,
+			width[1], s->io.pageread,
+			width[2], s->io.pagewrite,
+			width[3], s->io.cachehit,
+			width[4], s->io.cachemiss,
+			width[5], ratio,
+			width[6], s->io.mapped,
+			width[7], s->io.split,
+			width[8], s->io.ovflpage);
+	}
+	free(bar);
+}
+
+/**
+ * json_string: put a JSON string
+ */
+static void
+json_string(STRBUF *json, const char *s)
+{
+	strbuf_putc(json, '"');
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			strbuf_putc(json, '\\');
+			strbuf_putc(json, *s);
+		} else if ((unsigned char)*s < ' ') {
+			char buf[8];
+
+			snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)*s);
+			strbuf_puts(json, buf);
+		} else
+			strbuf_putc(json, *s);
+	}
+	strbuf_putc(json, '"');
+}
+
+/**
+ * json_number: put a JSON number, or null if it is NaN or infinity
+ */
+static void
+json_number(STRBUF *json, const char *name, int precision, double value)
+{
+	char buf[64];
+
+	strbuf_sprintf(json, ",\"%s\":", name);
+	if (value != value || value > HUGE_VAL / 2 || value < -HUGE_VAL / 2)
+		strbuf_puts(json, "null");
+	else {
+		snprintf(buf, sizeof(buf), "%.*f", precision, value);
+		strbuf_puts(json, buf);
+	}
+}
+
+/**
+ * json_count: put a JSON member of a counter
+ */
+static void
+json_count(STRBUF *json, const char *name, unsigned long value)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%lu", value);
+	strbuf_sprintf(json, ",\"%s\":%s", name, buf);
+}
+
+static void
+print_header_json(void **ppriv)
+{
+	STRBUF *json = strbuf_open(0);
+
+	strbuf_puts(json, "{\"times\":[");
+	*ppriv = json;
+}
+
+static void
+print_time_json(const STATISTICS_TIME *t, void *priv)
+{
+	STRBUF *json = priv;
+
+	if (strbuf_value(json)[strbuf_getlen(json) - 1] != '[')
+		strbuf_putc(json, ',');
+	strbuf_puts(json, "{\"period\":");
+	json_string(json, t->name);
+#if CPU_TIME_AVAILABLE
+	json_number(json, "user", USER_PRECISION, t->user);
+	json_number(json, "system", SYSTEM_PRECISION, t->system);
+#endif
+	json_number(json, "elapsed", ELAPSED_PRECISION, t->elapsed);
+#if CPU_TIME_AVAILABLE
+	json_number(json, "cpu", PERCENT_PRECISION, t->percent);
+#endif
+	strbuf_putc(json, '}');
+}
+
+static void
+print_io_json(void *priv)
+{
+	const struct statistics_io *s;
+	STRBUF *json = priv;
+	double ratio;
+
+	strbuf_puts(json, "],\"databases\":[");
+	STAILQ_FOREACH(s, &statistics_io_list, next) {
+		if (s != STAILQ_FIRST(&statistics_io_list))
+			strbuf_putc(json, ',');
+		strbuf_puts(json, "{\"name\":");
+		json_string(json, s->name);
+		json_count(json, "page_reads", s->io.pageread);
+		json_count(json, "page_writes", s->io.pagewrite);
+		json_count(json, "cache_hits", s->io.cachehit);
+		json_count(json, "cache_misses", s->io.cachemiss);
+		ratio = hit_ratio(&s->io);
+		if (ratio < 0)
+			strbuf_puts(json, ",\"hit_ratio\":null");
+		else
+			json_number(json, "hit_ratio", 3, ratio);
+		json_count(json, "mapped_pages", s->io.mapped);
+		json_count(json, "splits", s->io.split);
+		json_count(json, "overflow_pages", s->io.ovflpage);
+		strbuf_putc(json, '}');
+	}
+	strbuf_puts(json, "]}");
+}
+
+static void
+print_footer_json(void *priv)
+{
+	STRBUF *json = priv;
+
+	setverbose();
+	message("%s", strbuf_value(json));
+	strbuf_close(json);
+}
+
 static void
 print_footer_common(void *priv)
 {
@@ -414,16 +712,19 @@ print_footer_common(void *priv)
 struct printng_style {
 	void (*print_header)(void **);
 	void (*print_time)(const STATISTICS_TIME *, void *);
+	void (*print_io)(void *);
 	void (*print_footer)(void *);
 };
 
 static const struct printng_style printing_styles[] = {
 	/* STATISTICS_STYLE_NONE */
-	{ NULL, NULL, NULL },
+	{ NULL, NULL, NULL, NULL },
 	/* STATISTICS_STYLE_LIST */
-	{ print_header_list, print_time_list, print_footer_common },
+	{ print_header_list, print_time_list, print_io_list, print_footer_common },
 	/* STATISTICS_STYLE_TABLE */
-	{ print_header_table, print_time_table, print_footer_common },
+	{ print_header_table, print_time_table, print_io_table, print_footer_common },
+	/* STATISTICS_STYLE_JSON */
+	{ print_header_json, print_time_json, print_io_json, print_footer_json },
 };
 
 #if !defined(ARRAY_SIZE)
@@ -456,6 +757,15 @@ print_statistics(int style_no)
 		free(t);
 	}
 
+	if (style->print_io != NULL)
+		style->print_io(priv);
+	while (!STAILQ_EMPTY(&statistics_io_list)) {
+		struct statistics_io *s = STAILQ_FIRST(&statistics_io_list);
+
+		STAILQ_REMOVE_HEAD(&statistics_io_list, next);
+		free(s);
+	}
+
 	if (style->print_footer != NULL)
 		style->print_footer(priv);
 
@@ -58,6 +58,30 @@
 struct statistics_time;
 typedef struct statistics_time STATISTICS_TIME;
 
+/*
+ * STATISTICS_IO
+ *
+ * The counters of the page cache of a database. They are added up by
+ * the name of the database when it is closed, and are printed after
+ * the times. The pages of a mapped file are counted apart from the
+ * cache, and are not included in the hit ratio.
+ *
+ *     database page reads page writes cache hits cache misses hit[%] mapped pages splits overflow pages
+ *     -------- ---------- ----------- ---------- ------------ ------ ------------ ------ --------------
+ *     GPATH            24          58       3120           31   99.0            0      0              0
+ *     GTAGS            12        2331      17620          167   99.1            0      0            193
+ *     GRTAGS            9        1240      10511           92   99.1            0      0              0
+ */
+typedef struct {
+	unsigned long pageread;		/**< pages read from the file */
+	unsigned long pagewrite;	/**< pages written to the file */
+	unsigned long cachehit;		/**< pages found in the cache */
+	unsigned long cachemiss;	/**< pages not found in the cache */
+	unsigned long mapped;		/**< pages got from the mapped file */
+	unsigned long split;		/**< pages split */
+	unsigned long ovflpage;		/**< overflow pages written */
+} STATISTICS_IO;
+
 /**
  * STATISTICS_STYLE_NONE:
  *    Resource deallocation only.
@@ -82,17 +106,29 @@ typedef struct statistics_time STATISTICS_TIME;
  *     Time of making bar2    18.325       2.112       16.010 127.3
  *     ------------------- --------- ----------- ------------ -----
  *     The entire time        21.721       2.420       18.989 127.4
+ *
+ * STATISTICS_STYLE_JSON:
+ *    Print statistics information as a JSON object in a line like following,
+ *    and deallocate resource.
+ *
+ *     {"times":[{"period":"Time of making foo","user":2.016,"system":0.128,
+ *     "elapsed":1.437,"cpu":149.0}, ...],"databases":[{"name":"GTAGS",
+ *     "page_reads":12,"page_writes":2331,"cache_hits":17620,
+ *     "cache_misses":167,"hit_ratio":0.991,"splits":0,"overflow_pages":193}]}
  */
 enum {
 	STATISTICS_STYLE_NONE,
 	STATISTICS_STYLE_LIST,
-	STATISTICS_STYLE_TABLE
+	STATISTICS_STYLE_TABLE,
+	STATISTICS_STYLE_JSON
 };
 
 void init_statistics(void);
 STATISTICS_TIME *statistics_time_start(const char *, ...)
 	__attribute__ ((__format__ (__printf__, 1, 2)));
 void statistics_time_end(STATISTICS_TIME *);
+void statistics_io(const char *, const STATISTICS_IO *);
+int statistics_style(const char *);
 void print_statistics(int);
 
 #endif
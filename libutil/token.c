@@ -23,71 +23,174 @@
 #endif
 #include <ctype.h>
 #include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
 #ifdef HAVE_STRING_H
 #include <string.h>
 #else
 #include <strings.h>
 #endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
+#include "checkalloc.h"
 #include "die.h"
 #include "gparam.h"
 #include "strlimcpy.h"
 #include "token.h"
 
-/*
- * File input method.
- */
-int lineno;
-const char *sp, *cp, *lp;
-int crflag;			/* 1: return '\n', 0: doesn't return */
-int cmode;			/* allow token which start with '#' */
-int cppmode;			/* allow '::' as a token */
-int ymode;			/* allow token which start with '%' */
-char token[MAXTOKEN];
-char curfile[MAXPATHLEN];
-int continued_line;		/* previous line ends with '\' */
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
-static char ptok[MAXTOKEN];
-static int lasttok;
-static FILE *ip;
-static STRBUF *ib;
+#define tlen	(p - &t->token[0])
+static void pushbackchar(TOKEN *);
 
-#define tlen	(p - &token[0])
-static void pushbackchar(void);
+/*
+ * The whole file is mapped into memory (or read into a buffer when it cannot
+ * be mapped), and nextchar() reads characters through a pointer into it.
+ * Each line is terminated by '\0' in place when nextchar() reaches it, so
+ * t->sp is always a line without the newline, like the one read by fgets(3).
+ * The mapping is private, so the file itself is never modified.
+ */
+/**
+ * readfile: read the rest of a file into an allocated buffer.
+ *
+ *	@param[in]	fd	file descriptor
+ *	@param[in]	hint	expected size
+ *	@param[out]	sizep	size of the contents
+ *	@return		buffer (one byte larger than the contents), NULL: error
+ */
+static char *
+readfile(int fd, size_t hint, size_t *sizep)
+{
+	size_t size = 0, bufsize = hint + 1;
+	char *buf = (char *)check_malloc(bufsize);
+	ssize_t n;
 
+	for (;;) {
+		if (size + 1 >= bufsize) {
+			bufsize *= 2;
+			buf = (char *)check_realloc(buf, bufsize);
+		}
+		n = read(fd, buf + size, bufsize - size - 1);
+		if (n < 0) {
+			free(buf);
+			return NULL;
+		}
+		if (n == 0)
+			break;
+		size += n;
+	}
+	*sizep = size;
+	return buf;
+}
 /**
- * opentoken:
+ * opentoken: open a file for tokenizing.
  *
  *	@param[in]	file
+ *	@return		tokenizer context, NULL: cannot open
  */
-int
+TOKEN *
 opentoken(const char *file)
 {
+	TOKEN *t;
+	struct stat st;
+	char *buf = NULL;
+	size_t size = 0, mapsize = 0;
+	int fd;
+
+	/*
+	 * O_BINARY is needed for WIN32 environment. Almost unix ignore it.
+	 */
+	if ((fd = open(file, O_RDONLY | O_BINARY)) < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return NULL;
+	}
+#ifdef HAVE_MMAP
 	/*
-	 * b flag is needed for WIN32 environment. Almost unix ignore it.
+	 * An extra byte is mapped for the terminator of the last line.
+	 * It is available only when it is in the last page of the file.
 	 */
-	if ((ip = fopen(file, "rb")) == NULL)
-		return 0;
-	ib = strbuf_open(MAXBUFLEN);
-	strlimcpy(curfile, file, sizeof(curfile));
-	sp = cp = lp = NULL; ptok[0] = '\0'; lineno = 0;
-	crflag = cmode = cppmode = ymode = 0;
-	continued_line = 0;
-	return 1;
+	if (S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size % sysconf(_SC_PAGESIZE) != 0) {
+		size = st.st_size;
+		buf = mmap(NULL, size + 1, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (buf == MAP_FAILED)
+			buf = NULL;
+		else
+			mapsize = size + 1;
+	}
+#endif
+	if (buf == NULL)
+		buf = readfile(fd, S_ISREG(st.st_mode) ? st.st_size : 0, &size);
+	close(fd);
+	if (buf == NULL)
+		return NULL;
+	t = (TOKEN *)check_calloc(sizeof(TOKEN), 1);
+	t->buf = t->np = buf;
+	t->end = buf + size;
+	t->mapsize = mapsize;
+	strlimcpy(t->curfile, file, sizeof(t->curfile));
+	return t;
 }
 /**
  * closetoken:
+ *
+ *	@param[in]	t	tokenizer context
  */
 void
-closetoken(void)
+closetoken(TOKEN *t)
+{
+#ifdef HAVE_MMAP
+	if (t->mapsize)
+		munmap(t->buf, t->mapsize);
+	else
+#endif
+		free(t->buf);
+	free(t);
+}
+/**
+ * nextline_token: get the next line. (called by nextchar())
+ *
+ *	@param[in]	t	tokenizer context
+ *	@return		line without the newline, NULL: end of file
+ */
+const char *
+nextline_token(TOKEN *t)
 {
-	strbuf_close(ib);
-	fclose(ip);
+	char *line = t->np, *p;
+
+	if (line >= t->end)
+		return NULL;
+	p = memchr(line, '\n', t->end - line);
+	if (p == NULL) {
+		/* the last line without a newline */
+		p = t->np = t->end;
+	} else {
+		t->np = p + 1;
+		if (p > line && *(p - 1) == '\r')
+			p--;
+	}
+	*p = '\0';
+	return line;
 }
 
 /*
  * nexttoken: get next token
  *
+ *	@param[in]	t	tokenizer context
  *	@param[in]	interested	interested special character
  *				if NULL then all character.
  *	@param[in]	reserved	converter from token to token number
@@ -106,7 +209,7 @@ closetoken(void)
  */
 
 int
-nexttoken(const char *interested, int (*reserved)(const char *, int))
+nexttoken(TOKEN *t, const char *interested, int (*reserved)(const char *, int))
 {
 	int c;
 	char *p;
@@ -114,19 +217,19 @@ nexttoken(const char *interested, int (*reserved)(const char *, int))
 	int percent = 0;
 
 	/* check push back buffer */
-	if (ptok[0]) {
-		strlimcpy(token, ptok, sizeof(token));
-		ptok[0] = '\0';
-		return lasttok;
+	if (t->ptok[0]) {
+		strlimcpy(t->token, t->ptok, sizeof(t->token));
+		t->ptok[0] = '\0';
+		return t->lasttok;
 	}
 
 	for (;;) {
 		/* skip spaces */
-		if (!crflag)
-			while ((c = nextchar()) != EOF && isspace(c))
+		if (!t->crflag)
+			while ((c = nextchar(t)) != EOF && isspace(c))
 				;
 		else
-			while ((c = nextchar()) != EOF && isspace(c) && c != '\n')
+			while ((c = nextchar(t)) != EOF && isspace(c) && c != '\n')
 				;
 		if (c == EOF || c == '\n')
 			break;
@@ -134,67 +237,67 @@ nexttoken(const char *interested, int (*reserved)(const char *, int))
 		if (c == '"' || c == '\'') {	/* quoted string */
 			int quote = c;
 
-			while ((c = nextchar()) != EOF) {
+			while ((c = nextchar(t)) != EOF) {
 				if (c == quote)
 					break;
 				if (quote == '\'' && c == '\n')
 					break;
-				if (c == '\\' && (c = nextchar()) == EOF)
+				if (c == '\\' && (c = nextchar(t)) == EOF)
 					break;
 			}
 		} else if (c == '/') {			/* comment */
-			if ((c = nextchar()) == '/') {
-				while ((c = nextchar()) != EOF)
+			if ((c = nextchar(t)) == '/') {
+				while ((c = nextchar(t)) != EOF)
 					if (c == '\n') {
-						pushbackchar();
+						pushbackchar(t);
 						break;
 					}
 			} else if (c == '*') {
-				while ((c = nextchar()) != EOF) {
+				while ((c = nextchar(t)) != EOF) {
 					if (c == '*') {
-						if ((c = nextchar()) == '/')
+						if ((c = nextchar(t)) == '/')
 							break;
-						pushbackchar();
+						pushbackchar(t);
 					}
 				}
 			} else
-				pushbackchar();
+				pushbackchar(t);
 		} else if (c == '\\') {
-			if (nextchar() == '\n')
-				continued_line = 1;
+			if (nextchar(t) == '\n')
+				t->continued_line = 1;
 		} else if (isdigit(c)) {		/* digit */
-			while ((c = nextchar()) != EOF && (c == '.' || isalnum(c)))
+			while ((c = nextchar(t)) != EOF && (c == '.' || isalnum(c)))
 				;
-			pushbackchar();
-		} else if (c == '#' && cmode) {
+			pushbackchar(t);
+		} else if (c == '#' && t->cmode) {
 			/* recognize '##' as a token if it is reserved word. */
-			if (peekc(1) == '#') {
-				p = token;
+			if (peekc(t, 1) == '#') {
+				p = t->token;
 				*p++ = c;
-				*p++ = nextchar();
+				*p++ = nextchar(t);
 				*p   = 0;
-				if (reserved && (c = (*reserved)(token, tlen)) == 0)
+				if (reserved && (c = (*reserved)(t->token, tlen)) == 0)
 					break;
-			} else if (!continued_line && atfirst_exceptspace()) {
+			} else if (!t->continued_line && atfirst_exceptspace(t)) {
 				sharp = 1;
 				continue;
 			}
-		} else if (c == ':' && cppmode && peekc(1) == ':') {
-			p = token;
+		} else if (c == ':' && t->cppmode && peekc(t, 1) == ':') {
+			p = t->token;
 			*p++ = c;
-			*p++ = nextchar();
+			*p++ = nextchar(t);
 			*p   = 0;
-			if (reserved && (c = (*reserved)(token, tlen)) == 0)
+			if (reserved && (c = (*reserved)(t->token, tlen)) == 0)
 				break;
-		} else if (c == '%' && ymode) {
+		} else if (c == '%' && t->ymode) {
 			/* recognize '%%' as a token if it is reserved word. */
-			if (atfirst) {
-				p = token;
+			if (atfirst(t)) {
+				p = t->token;
 				*p++ = c;
-				if ((c = peekc(1)) == '%' || c == '{' || c == '}') {
-					*p++ = nextchar();
+				if ((c = peekc(t, 1)) == '%' || c == '{' || c == '}') {
+					*p++ = nextchar(t);
 					*p   = 0;
-					if (reserved && (c = (*reserved)(token, tlen)) != 0)
+					if (reserved && (c = (*reserved)(t->token, tlen)) != 0)
 						break;
 				} else if (!isspace(c)) {
 					percent = 1;
@@ -202,7 +305,7 @@ nexttoken(const char *interested, int (*reserved)(const char *, int))
 				}
 			}
 		} else if (c & 0x80 || isalpha(c) || c == '_') {/* symbol */
-			p = token;
+			p = t->token;
 			if (sharp) {
 				sharp = 0;
 				*p++ = '#';
@@ -210,28 +313,28 @@ nexttoken(const char *interested, int (*reserved)(const char *, int))
 				percent = 0;
 				*p++ = '%';
 			} else if (c == 'L') {
-				int tmp = peekc(1);
+				int tmp = peekc(t, 1);
 
 				if (tmp == '\"' || tmp == '\'')
 					continue;
 			}
-			for (*p++ = c; (c = nextchar()) != EOF && (c & 0x80 || isalnum(c) || c == '_');) {
-				if (tlen < sizeof(token))
+			for (*p++ = c; (c = nextchar(t)) != EOF && (c & 0x80 || isalnum(c) || c == '_');) {
+				if (tlen < sizeof(t->token))
 					*p++ = c;
 			}
-			if (tlen == sizeof(token)) {
-				warning("symbol name is too long. (Ignored) [+%d %s]", lineno, curfile);
-				token[0] = '\0';
+			if (tlen == sizeof(t->token)) {
+				warning("symbol name is too long. (Ignored) [+%d %s]", t->lineno, t->curfile);
+				t->token[0] = '\0';
 				continue;
 			}
 			*p = 0;
 	
 			if (c != EOF)
-				pushbackchar();
+				pushbackchar(t);
 			/* convert token string into token number */
 			c = SYMBOL;
 			if (reserved)
-				c = (*reserved)(token, tlen);
+				c = (*reserved)(t->token, tlen);
 			break;
 		} else {				/* special char */
 			if (interested == NULL || strchr(interested, c))
@@ -240,49 +343,56 @@ nexttoken(const char *interested, int (*reserved)(const char *, int))
 		}
 		sharp = percent = 0;
 	}
-	return lasttok = c;
+	return t->lasttok = c;
 }
 /**
  * pushbacktoken: push back token
  *
+ *	@param[in]	t	tokenizer context
+ *
  *	following nexttoken() return same token again.
  */
 void
-pushbacktoken(void)
+pushbacktoken(TOKEN *t)
 {
-	strlimcpy(ptok, token, sizeof(ptok));
+	strlimcpy(t->ptok, t->token, sizeof(t->ptok));
 }
+/*
+ * getcp: read a character after the current line without changing the state.
+ */
+#define getcp(t, p)	((p) < (t)->end ? (unsigned char)*(p)++ : EOF)
 /**
  * peekc: peek next char
  *
+ *	@param[in]	t	tokenizer context
  *	@param[in]	immediate	0: ignore blank, 1: include blank
  *
  * peekc() read ahead following blanks but doesn't change line.
  */
 int
-peekc(int immediate)
+peekc(TOKEN *t, int immediate)
 {
 	int c;
-	long pos;
+	const char *pos;
     int comment = 0;
 
-	if (cp != NULL) {
+	if (t->cp != NULL) {
 		if (immediate)
-			c = nextchar();
+			c = nextchar(t);
 		else
-            while ((c = nextchar()) != EOF && c != '\n') {
+            while ((c = nextchar(t)) != EOF && c != '\n') {
                 if (c == '/') {			/* comment */
-                    if ((c = nextchar()) == '/') {
-                        while ((c = nextchar()) != EOF)
+                    if ((c = nextchar(t)) == '/') {
+                        while ((c = nextchar(t)) != EOF)
                             if (c == '\n') {
-                                pushbackchar();
+                                pushbackchar(t);
                                 break;
                             }
                     } else if (c == '*') {
                         comment = 1;
-                        while ((c = nextchar()) != EOF) {
+                        while ((c = nextchar(t)) != EOF) {
                             if (c == '*') {
-                                if ((c = nextchar()) == '/')
+                                if ((c = nextchar(t)) == '/')
                                 {
                                     comment = 0;
                                     break;
@@ -290,30 +400,30 @@ peekc(int immediate)
                             }
                             else if (c == '\n')
                             {
-                                pushbackchar();
+                                pushbackchar(t);
                                 break;
                             }
                         }
                     } else
-                        pushbackchar();
+                        pushbackchar(t);
                 }
                 else if (!isspace(c))
                     break;
             }
 		if (c != EOF)
-			pushbackchar();
+			pushbackchar(t);
 		if (c != '\n' || immediate)
 			return c;
 	}
-	pos = ftell(ip);
+	pos = t->np;
 	if (immediate)
-		c = getc(ip);
+		c = getcp(t, pos);
 	else
-        while ((c = getc(ip)) != EOF) {
+        while ((c = getcp(t, pos)) != EOF) {
             if (comment) {
-                while ((c = getc(ip)) != EOF) {
+                while ((c = getcp(t, pos)) != EOF) {
                     if (c == '*') {
-                        if ((c = getc(ip)) == '/')
+                        if ((c = getcp(t, pos)) == '/')
                         {
                             comment = 0;
                             break;
@@ -322,15 +432,15 @@ peekc(int immediate)
                 }
             }
             else if (c == '/') {			/* comment */
-                if ((c = getc(ip)) == '/') {
-                    while ((c = getc(ip)) != EOF)
+                if ((c = getcp(t, pos)) == '/') {
+                    while ((c = getcp(t, pos)) != EOF)
                         if (c == '\n') {
                             break;
                         }
                 } else if (c == '*') {
-                    while ((c = getc(ip)) != EOF) {
+                    while ((c = getcp(t, pos)) != EOF) {
                         if (c == '*') {
-                            if ((c = getc(ip)) == '/')
+                            if ((c = getcp(t, pos)) == '/')
                                 break;
                         }
                     }
@@ -341,17 +451,17 @@ peekc(int immediate)
                 break;
         }
 
-	(void)fseek(ip, pos, SEEK_SET);
-
 	return c;
 }
 /**
  * throwaway_nextchar: throw away next character
+ *
+ *	@param[in]	t	tokenizer context
  */
 void
-throwaway_nextchar(void)
+throwaway_nextchar(TOKEN *t)
 {
-	nextchar();
+	nextchar(t);
 }
 /**
  * atfirst_exceptspace: return if current position is the first column
@@ -359,12 +469,14 @@ throwaway_nextchar(void)
  *	|      1 0
  *      |      v v
  *	|      # define
+ *
+ *	@param[in]	t	tokenizer context
  */
 int
-atfirst_exceptspace(void)
+atfirst_exceptspace(TOKEN *t)
 {
-	const char *start = sp;
-	const char *end = cp ? cp - 1 : lp;
+	const char *start = t->sp;
+	const char *end = t->cp ? t->cp - 1 : t->lp;
 
 	while (start < end && *start && isspace(*start))
 		start++;
@@ -373,16 +485,18 @@ atfirst_exceptspace(void)
 /**
  * pushbackchar: push back character.
  *
+ *	@param[in]	t	tokenizer context
+ *
  *	following nextchar() return same character again.
  * 
  */
 static void
-pushbackchar(void)
+pushbackchar(TOKEN *t)
 {
-        if (sp == NULL)
+        if (t->sp == NULL)
                 return;         /* nothing to do */
-        if (cp == NULL)
-                cp = lp;
+        if (t->cp == NULL)
+                t->cp = t->lp;
         else
-                --cp;
+                --t->cp;
 }
@@ -26,34 +26,52 @@
 
 #define SYMBOL		0
 
-extern const char *sp, *cp, *lp;
-extern int lineno;
-extern int crflag;
-extern int cmode;
-extern int cppmode;
-extern int ymode;
-extern char token[MAXTOKEN];
-extern char curfile[MAXPATHLEN];
-extern int continued_line;
+/**
+ * Tokenizer context.
+ *
+ * All the state of the tokenizer is in this structure, so that
+ * two or more files can be tokenized at the same time.
+ */
+typedef struct {
+	const char *sp, *cp, *lp;	/**< start, current and last pointer */
+	int lineno;			/**< current line number */
+	int crflag;			/**< 1: return '\n', 0: doesn't return */
+	int cmode;			/**< allow token which start with '#' */
+	int cppmode;			/**< allow '::' as a token */
+	int ymode;			/**< allow token which start with '%' */
+	int continued_line;		/**< previous line ends with '\' */
+	char token[MAXTOKEN];		/**< current token */
+	char curfile[MAXPATHLEN];	/**< current file */
+	/*
+	 * private
+	 */
+	char ptok[MAXTOKEN];		/**< push back buffer */
+	int lasttok;
+	char *buf;			/**< contents of the file */
+	char *np;			/**< start of the next line */
+	char *end;			/**< end of the contents */
+	size_t mapsize;			/**< size of the mapping, 0: allocated */
+} TOKEN;
 
-#define nextchar() \
-	(cp == NULL ? \
-		((sp = cp = strbuf_fgets(ib, ip, STRBUF_NOCRLF)) == NULL ? \
+#define nextchar(t) \
+	((t)->cp == NULL ? \
+		(((t)->sp = (t)->cp = nextline_token(t)) == NULL ? \
 			EOF : \
-			(lineno++, *cp == 0 ? \
-				(lp = cp, cp = NULL, continued_line = 0, '\n') : \
-				(unsigned char)*cp++)) : \
-		(*cp == 0 ? \
-			(lp = cp, cp = NULL, continued_line = 0, '\n') : \
-			(unsigned char)*cp++))
-#define atfirst (sp && sp == (cp ? cp - 1 : lp))
+			((t)->lineno++, *(t)->cp == 0 ? \
+				((t)->lp = (t)->cp, (t)->cp = NULL, (t)->continued_line = 0, '\n') : \
+				(unsigned char)*(t)->cp++)) : \
+		(*(t)->cp == 0 ? \
+			((t)->lp = (t)->cp, (t)->cp = NULL, (t)->continued_line = 0, '\n') : \
+			(unsigned char)*(t)->cp++))
+#define atfirst(t) ((t)->sp && (t)->sp == ((t)->cp ? (t)->cp - 1 : (t)->lp))
 
-int opentoken(const char *);
-void closetoken(void);
-int nexttoken(const char *, int (*)(const char *, int));
-void pushbacktoken(void);
-int peekc(int);
-void throwaway_nextchar(void);
-int atfirst_exceptspace(void);
+TOKEN *opentoken(const char *);
+void closetoken(TOKEN *);
+const char *nextline_token(TOKEN *);
+int nexttoken(TOKEN *, const char *, int (*)(const char *, int));
+void pushbacktoken(TOKEN *);
+int peekc(TOKEN *, int);
+void throwaway_nextchar(TOKEN *);
+int atfirst_exceptspace(TOKEN *);
 
 #endif /* ! _TOKEN_H_ */